@@ -5,6 +5,7 @@
 #include <bench/bench.h>
 #include <coins.h>
 #include <policy/policy.h>
+#include <random.h>
 #include <script/signingprovider.h>
 
 #include <vector>
@@ -86,3 +87,33 @@ static void CCoinsCaching(benchmark::State& state)
 }
 
 BENCHMARK(CCoinsCaching, 170 * 1000);
+
+// Fill a coins map with P2PKH coins, look each of them up and erase them
+// again, as a cache does between two flushes.
+static void CoinsMapChurn(benchmark::State& state, CCoinsMap::Type type)
+{
+    FastRandomContext rng(true);
+    std::vector<COutPoint> outpoints;
+    for (int i = 0; i < 10000; i++) {
+        outpoints.emplace_back(rng.rand256(), rng.randrange(4));
+    }
+    const CScript script = GetScriptForDestination(PKHash(uint160(rng.randbytes(20))));
+
+    while (state.KeepRunning()) {
+        CCoinsMap map(type);
+        for (const COutPoint& outpoint : outpoints) {
+            map[outpoint].coin = Coin(CTxOut(COIN, script), 1, false, false);
+        }
+        for (const COutPoint& outpoint : outpoints) {
+            auto it = map.find(outpoint);
+            assert(it != map.end());
+            map.erase(it);
+        }
+    }
+}
+
+static void CoinsMapUnordered(benchmark::State& state) { CoinsMapChurn(state, CCoinsMap::Type::UNORDERED); }
+static void CoinsMapFlat(benchmark::State& state) { CoinsMapChurn(state, CCoinsMap::Type::FLAT); }
+
+BENCHMARK(CoinsMapUnordered, 20);
+BENCHMARK(CoinsMapFlat, 20);
@@ -5,6 +5,8 @@
 #include <bench/bench.h>
 #include <util/system.h>
 #include <checkqueue.h>
+#include <crypto/common.h>
+#include <crypto/sha256.h>
 #include <prevector.h>
 #include <vector>
 #include <boost/thread/thread.hpp>
@@ -59,3 +61,59 @@ static void CCheckQueueSpeedPrevectorJob(benchmark::State& state)
     tg.join_all();
 }
 BENCHMARK(CCheckQueueSpeedPrevectorJob, 1400);
+
+// Tests how the CheckQueue scales with the number of threads (the master
+// included) for checks that each take about as long as hashing a few
+// hundred bytes, in both queue modes.
+static void CCheckQueueScaling(benchmark::State& state, int threads, CheckQueueMode mode)
+{
+    struct HashJob {
+        uint32_t n{0};
+        HashJob() {}
+        explicit HashJob(uint32_t nIn) : n(nIn) {}
+        bool operator()()
+        {
+            unsigned char hash[CSHA256::OUTPUT_SIZE] = {};
+            WriteLE32(hash, n);
+            for (int i = 0; i < 8; ++i) {
+                CSHA256().Write(hash, sizeof(hash)).Finalize(hash);
+            }
+            return true;
+        }
+        void swap(HashJob& x) { std::swap(n, x.n); };
+    };
+    CCheckQueue<HashJob> queue {QUEUE_BATCH_SIZE};
+    queue.SetMode(mode);
+    boost::thread_group tg;
+    for (auto x = 0; x < threads - 1; ++x) {
+       tg.create_thread([&]{queue.Thread();});
+    }
+    while (state.KeepRunning()) {
+        CCheckQueueControl<HashJob> control(&queue);
+        for (size_t b = 0; b < BATCHES; ++b) {
+            std::vector<HashJob> vChecks;
+            vChecks.reserve(BATCH_SIZE);
+            for (size_t x = 0; x < BATCH_SIZE; ++x)
+                vChecks.emplace_back(b * BATCH_SIZE + x);
+            control.Add(vChecks);
+        }
+        bool ok = control.Wait();
+        assert(ok);
+    }
+    tg.interrupt_all();
+    tg.join_all();
+}
+
+#define CHECKQUEUE_SCALING_BENCHMARK(threads) \
+    static void CCheckQueueScaling##threads##Shared(benchmark::State& state) { CCheckQueueScaling(state, threads, CheckQueueMode::SHARED); } \
+    static void CCheckQueueScaling##threads##Stealing(benchmark::State& state) { CCheckQueueScaling(state, threads, CheckQueueMode::WORK_STEALING); } \
+    BENCHMARK(CCheckQueueScaling##threads##Shared, 100); \
+    BENCHMARK(CCheckQueueScaling##threads##Stealing, 100);
+
+CHECKQUEUE_SCALING_BENCHMARK(1)
+CHECKQUEUE_SCALING_BENCHMARK(2)
+CHECKQUEUE_SCALING_BENCHMARK(4)
+CHECKQUEUE_SCALING_BENCHMARK(8)
+CHECKQUEUE_SCALING_BENCHMARK(16)
+CHECKQUEUE_SCALING_BENCHMARK(32)
+CHECKQUEUE_SCALING_BENCHMARK(64)
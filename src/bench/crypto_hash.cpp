@@ -59,6 +59,31 @@ static void SHA256D64_1024(benchmark::State& state)
     }
 }
 
+static void SHA256D_76b_1024(benchmark::State& state)
+{
+    std::vector<uint8_t> in(76 * 1024, 0);
+    std::vector<uint8_t> out(32 * 1024);
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < 1024; ++i) {
+            CHash256().Write(in.data() + 76 * i, 76).Finalize(out.data() + 32 * i);
+        }
+    }
+}
+
+static void SHA256DMulti_76b_1024(benchmark::State& state)
+{
+    std::vector<uint8_t> in(76 * 1024, 0);
+    std::vector<uint8_t> out(32 * 1024);
+    std::vector<const unsigned char*> inputs(1024);
+    std::vector<size_t> lengths(1024, 76);
+    for (size_t i = 0; i < 1024; ++i) {
+        inputs[i] = in.data() + 76 * i;
+    }
+    while (state.KeepRunning()) {
+        SHA256DMulti(out.data(), inputs.data(), lengths.data(), 1024);
+    }
+}
+
 static void SHA512(benchmark::State& state)
 {
     uint8_t hash[CSHA512::OUTPUT_SIZE];
@@ -100,5 +125,7 @@ BENCHMARK(SHA512, 330);
 BENCHMARK(SHA256_32b, 4700 * 1000);
 BENCHMARK(SipHash_32b, 40 * 1000 * 1000);
 BENCHMARK(SHA256D64_1024, 7400);
+BENCHMARK(SHA256D_76b_1024, 1000);
+BENCHMARK(SHA256DMulti_76b_1024, 3000);
 BENCHMARK(FastRandom_32bit, 110 * 1000 * 1000);
 BENCHMARK(FastRandom_1bit, 440 * 1000 * 1000);
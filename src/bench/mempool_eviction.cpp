@@ -132,3 +132,76 @@ static void MempoolEviction(benchmark::State& state)
 }
 
 BENCHMARK(MempoolEviction, 41000);
+
+// Transactions are added children first, as when a block is disconnected, so
+// that UpdateTransactionsFromBlock walks every descendant of the first one.
+static void MempoolPackageBookkeeping(benchmark::State& state, const std::vector<CTransactionRef>& txs)
+{
+    CTxMemPool pool;
+    LOCK2(cs_main, pool.cs);
+
+    while (state.KeepRunning()) {
+        for (size_t i = 1; i < txs.size(); i++) {
+            AddTx(txs[i], 1000LL, pool);
+        }
+        AddTx(txs[0], 1000LL, pool);
+        pool.UpdateTransactionsFromBlock({txs[0]->GetHash()});
+        pool.removeRecursive(*txs[0], MemPoolRemovalReason::CONFLICT);
+        assert(pool.size() == 0);
+    }
+}
+
+// A chain of transactions, each spending the one before, like repeated
+// contract calls from the same sender.
+static void MempoolDeepChain(benchmark::State& state)
+{
+    std::vector<CTransactionRef> txs;
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].scriptSig = CScript() << OP_1;
+    tx.vout.resize(1);
+    tx.vout[0].scriptPubKey = CScript() << OP_1 << OP_EQUAL;
+    tx.vout[0].nValue = 10 * COIN;
+    for (int i = 0; i < 200; i++) {
+        txs.push_back(MakeTransactionRef(tx));
+        tx.vin[0].prevout = COutPoint(txs.back()->GetHash(), 0);
+    }
+    MempoolPackageBookkeeping(state, txs);
+}
+
+// One transaction with many children, all of which are spent by a last one.
+static void MempoolWideFanOut(benchmark::State& state)
+{
+    const int width = 200;
+    std::vector<CTransactionRef> txs;
+    CMutableTransaction root;
+    root.vin.resize(1);
+    root.vin[0].scriptSig = CScript() << OP_1;
+    root.vout.resize(width);
+    for (int i = 0; i < width; i++) {
+        root.vout[i].scriptPubKey = CScript() << OP_1 << OP_EQUAL;
+        root.vout[i].nValue = COIN;
+    }
+    txs.push_back(MakeTransactionRef(root));
+
+    CMutableTransaction sink;
+    sink.vout.resize(1);
+    sink.vout[0].scriptPubKey = CScript() << OP_3 << OP_EQUAL;
+    sink.vout[0].nValue = width * COIN / 2;
+    for (int i = 0; i < width; i++) {
+        CMutableTransaction child;
+        child.vin.resize(1);
+        child.vin[0].prevout = COutPoint(txs[0]->GetHash(), i);
+        child.vin[0].scriptSig = CScript() << OP_2;
+        child.vout.resize(1);
+        child.vout[0].scriptPubKey = CScript() << OP_2 << OP_EQUAL;
+        child.vout[0].nValue = COIN / 2;
+        txs.push_back(MakeTransactionRef(child));
+        sink.vin.emplace_back(COutPoint(txs.back()->GetHash(), 0));
+    }
+    txs.push_back(MakeTransactionRef(sink));
+    MempoolPackageBookkeeping(state, txs);
+}
+
+BENCHMARK(MempoolDeepChain, 20);
+BENCHMARK(MempoolWideFanOut, 40);
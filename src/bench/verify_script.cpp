@@ -8,10 +8,14 @@
 #include <script/bitcoinconsensus.h>
 #endif
 #include <script/script.h>
+#include <script/sigcache.h>
 #include <script/standard.h>
 #include <streams.h>
 
 #include <array>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 // FIXME: Dedup with BuildCreditingTransaction in test/script_tests.cpp.
 static CMutableTransaction BuildCreditingTransaction(const CScript& scriptPubKey)
@@ -106,3 +110,161 @@ static void VerifyScriptBench(benchmark::State& state)
 }
 
 BENCHMARK(VerifyScriptBench, 6300);
+
+static const size_t SIGCACHE_BENCH_SIGNATURES = 256;
+static const size_t SIGCACHE_BENCH_LOOKUPS = 16384;
+
+// Measures how signature cache hits scale with the number of threads looking
+// them up, as parallel script checks do when a block arrives whose signatures
+// were already seen in the mempool. Every iteration spreads the same number
+// of lookups over the worker threads.
+static void SigCacheLookup(benchmark::State& state, int num_threads)
+{
+    CKey key;
+    key.MakeNewKey(true);
+    CPubKey pubkey = key.GetPubKey();
+
+    CMutableTransaction mtx;
+    mtx.vin.resize(1);
+    mtx.vout.resize(1);
+    const CTransaction tx(mtx);
+    PrecomputedTransactionData txdata(tx);
+
+    std::vector<uint256> hashes(SIGCACHE_BENCH_SIGNATURES);
+    std::vector<std::vector<unsigned char>> sigs(SIGCACHE_BENCH_SIGNATURES);
+    for (size_t i = 0; i < SIGCACHE_BENCH_SIGNATURES; ++i) {
+        hashes[i] = SerializeHash((uint64_t)i);
+        key.Sign(hashes[i], sigs[i]);
+        CachingTransactionSignatureChecker checker(&tx, 0, 0, true, txdata);
+        bool stored = checker.VerifySignature(sigs[i], pubkey, hashes[i]);
+        assert(stored);
+    }
+
+    std::mutex mutex;
+    std::condition_variable cond_start;
+    std::condition_variable cond_done;
+    uint64_t round = 0;
+    int running = 0;
+    bool stop = false;
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < num_threads; ++t) {
+        workers.emplace_back([&, t] {
+            uint64_t seen = 0;
+            CachingTransactionSignatureChecker checker(&tx, 0, 0, true, txdata);
+            while (true) {
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    cond_start.wait(lock, [&] { return stop || round != seen; });
+                    if (stop) return;
+                    seen = round;
+                }
+                for (size_t i = t; i < SIGCACHE_BENCH_LOOKUPS; i += num_threads) {
+                    const size_t n = i % SIGCACHE_BENCH_SIGNATURES;
+                    bool ok = checker.VerifySignature(sigs[n], pubkey, hashes[n]);
+                    assert(ok);
+                }
+                std::lock_guard<std::mutex> lock(mutex);
+                if (--running == 0) cond_done.notify_one();
+            }
+        });
+    }
+
+    while (state.KeepRunning()) {
+        std::unique_lock<std::mutex> lock(mutex);
+        running = num_threads;
+        ++round;
+        cond_start.notify_all();
+        cond_done.wait(lock, [&] { return running == 0; });
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    cond_start.notify_all();
+    for (std::thread& worker : workers) worker.join();
+}
+
+static void SigCacheLookup1Thread(benchmark::State& state) { SigCacheLookup(state, 1); }
+static void SigCacheLookup4Threads(benchmark::State& state) { SigCacheLookup(state, 4); }
+static void SigCacheLookup16Threads(benchmark::State& state) { SigCacheLookup(state, 16); }
+static void SigCacheLookup64Threads(benchmark::State& state) { SigCacheLookup(state, 64); }
+
+BENCHMARK(SigCacheLookup1Thread, 60);
+BENCHMARK(SigCacheLookup4Threads, 200);
+BENCHMARK(SigCacheLookup16Threads, 400);
+BENCHMARK(SigCacheLookup64Threads, 400);
+
+static const size_t BATCH_BENCH_SIGNATURES = 64;
+
+// Compares verifying a block's worth of signatures one at a time against
+// handing them to CPubKeyBatchVerifier, which shares the inversions and
+// parses each public key once. Both verify the same signatures per iteration.
+static void ECDSAVerify(benchmark::State& state, bool batched)
+{
+    std::vector<CPubKey> pubkeys(BATCH_BENCH_SIGNATURES);
+    std::vector<uint256> hashes(BATCH_BENCH_SIGNATURES);
+    std::vector<std::vector<unsigned char>> sigs(BATCH_BENCH_SIGNATURES);
+    for (size_t i = 0; i < BATCH_BENCH_SIGNATURES; ++i) {
+        CKey key;
+        key.MakeNewKey(true);
+        pubkeys[i] = key.GetPubKey();
+        hashes[i] = SerializeHash((uint64_t)i);
+        key.Sign(hashes[i], sigs[i]);
+    }
+
+    std::vector<bool> results;
+    while (state.KeepRunning()) {
+        bool ok = true;
+        if (batched) {
+            CPubKeyBatchVerifier batch;
+            for (size_t i = 0; i < BATCH_BENCH_SIGNATURES; ++i) {
+                batch.Add(pubkeys[i], hashes[i], sigs[i]);
+            }
+            ok = batch.Verify(results);
+        } else {
+            for (size_t i = 0; i < BATCH_BENCH_SIGNATURES; ++i) {
+                ok &= pubkeys[i].Verify(hashes[i], sigs[i]);
+            }
+        }
+        assert(ok);
+    }
+}
+
+static void ECDSAVerifySingle(benchmark::State& state) { ECDSAVerify(state, false); }
+static void ECDSAVerifyBatch(benchmark::State& state) { ECDSAVerify(state, true); }
+
+BENCHMARK(ECDSAVerifySingle, 20);
+BENCHMARK(ECDSAVerifyBatch, 20);
+
+static const size_t SIGHASH_BENCH_INPUTS = 500;
+
+// Computes the legacy signature hash of every input of a transaction as large
+// as a big coinstake or consolidation, with and without the precomputed
+// midstates of PrecomputedTransactionData.
+static void SighashLegacy(benchmark::State& state, bool cached)
+{
+    CMutableTransaction mtx;
+    mtx.vin.resize(SIGHASH_BENCH_INPUTS);
+    for (size_t i = 0; i < SIGHASH_BENCH_INPUTS; ++i) {
+        mtx.vin[i].prevout = COutPoint(SerializeHash((uint64_t)i), i);
+        mtx.vin[i].scriptSig = CScript() << std::vector<unsigned char>(72) << std::vector<unsigned char>(33);
+    }
+    mtx.vout.resize(2);
+    const CTransaction tx(mtx);
+    const CScript scriptCode = GetScriptForDestination(PKHash(uint160()));
+
+    while (state.KeepRunning()) {
+        PrecomputedTransactionData txdata(tx);
+        for (size_t i = 0; i < SIGHASH_BENCH_INPUTS; ++i) {
+            SignatureHash(scriptCode, tx, i, SIGHASH_ALL, 0, SigVersion::BASE, cached ? &txdata : nullptr);
+        }
+    }
+}
+
+static void SighashLegacyUncached(benchmark::State& state) { SighashLegacy(state, false); }
+static void SighashLegacyCached(benchmark::State& state) { SighashLegacy(state, true); }
+
+BENCHMARK(SighashLegacyUncached, 20);
+BENCHMARK(SighashLegacyCached, 50);
@@ -8,6 +8,9 @@
 #include <sync.h>
 
 #include <algorithm>
+#include <atomic>
+#include <deque>
+#include <memory>
 #include <vector>
 
 #include <boost/thread/condition_variable.hpp>
@@ -16,6 +19,21 @@
 template <typename T>
 class CCheckQueueControl;
 
+/** How a CCheckQueue hands out its checks to the worker threads */
+enum class CheckQueueMode {
+    //! All checks live in one queue, taken in batches under a single mutex
+    SHARED,
+    //! Every worker has a local queue it takes from, and steals from the
+    //! other workers' queues once its own is empty
+    WORK_STEALING,
+};
+
+/** -checkqueue default */
+static const char* const DEFAULT_CHECKQUEUE = "shared";
+
+/** Number of local queues of a work stealing CCheckQueue, workers beyond it share them */
+static const unsigned int CHECKQUEUE_LOCAL_QUEUES = 64;
+
 /**
  * Queue for verifications that have to be performed.
   * The verifications are represented by a type T, which must provide an
@@ -25,6 +43,11 @@ class CCheckQueueControl;
   * onto the queue, where they are processed by N-1 worker threads. When
   * the master is done adding work, it temporarily joins the worker pool
   * as an N'th worker, until all jobs are done.
+  *
+  * In WORK_STEALING mode every batch added by the master goes to the local
+  * queue of one worker, in turn. Workers take checks from the back of their
+  * own queue and steal from the front of the others', so that contention is
+  * limited to two threads per queue and nobody idles while checks are left.
   */
 template <typename T>
 class CCheckQueue
@@ -62,6 +85,113 @@ private:
     //! The maximum number of elements to be processed in one batch
     unsigned int nBatchSize;
 
+    //! How checks are handed to the workers, set before any of them starts
+    CheckQueueMode m_mode{CheckQueueMode::SHARED};
+
+    //! Local queue of one worker in WORK_STEALING mode
+    struct LocalQueue {
+        boost::mutex mutex;
+        std::deque<T> checks;
+    };
+    std::vector<std::unique_ptr<LocalQueue>> m_local;
+
+    //! Number of workers that registered a local queue
+    std::atomic<unsigned int> m_workers{0};
+
+    //! Local queue the next batch is added to (only used by the master)
+    unsigned int m_add_cursor{0};
+
+    //! Checks added to the local queues that no worker took yet. Raised
+    //! before the checks are queued, so it never underestimates them.
+    std::atomic<unsigned int> m_queued{0};
+
+    //! Checks that haven't completed yet in WORK_STEALING mode
+    std::atomic<unsigned int> m_todo{0};
+
+    //! The evaluation result in WORK_STEALING mode
+    std::atomic<bool> m_all_ok{true};
+
+    unsigned int ActiveLocalQueues() const
+    {
+        return std::max(1U, std::min(m_workers.load(), (unsigned int)m_local.size()));
+    }
+
+    /**
+     * Take a batch of checks, from the back of the local queue self if it
+     * has any, else from the front of another one. Batches are sized from
+     * the checks still queued for the whole block, aiming for all workers
+     * to finish together, and are at most half of the queue they come from.
+     */
+    bool TakeChecks(unsigned int self, std::vector<T>& vChecks)
+    {
+        const unsigned int active = ActiveLocalQueues();
+        for (unsigned int i = 0; i < active; i++) {
+            const bool own = i == 0 && self < active;
+            LocalQueue& local = *m_local[(self + i) % active];
+            boost::unique_lock<boost::mutex> lock(local.mutex);
+            if (local.checks.empty()) continue;
+            const unsigned int nShare = std::min((unsigned int)local.checks.size() / 2, m_queued / (active + 1));
+            const unsigned int nNow = std::max(1U, std::min(nBatchSize, nShare));
+            vChecks.resize(nNow);
+            for (unsigned int j = 0; j < nNow; j++) {
+                if (own) {
+                    vChecks[j].swap(local.checks.back());
+                    local.checks.pop_back();
+                } else {
+                    vChecks[j].swap(local.checks.front());
+                    local.checks.pop_front();
+                }
+            }
+            m_queued -= nNow;
+            return true;
+        }
+        return false;
+    }
+
+    /** WORK_STEALING counterpart of Loop. The master has no local queue of its own. */
+    bool LoopStealing(unsigned int self, bool fMaster = false)
+    {
+        boost::condition_variable& cond = fMaster ? condMaster : condWorker;
+        std::vector<T> vChecks;
+        vChecks.reserve(nBatchSize);
+        do {
+            if (!TakeChecks(self, vChecks)) {
+                boost::unique_lock<boost::mutex> lock(mutex);
+                if (fMaster && m_todo == 0) {
+                    // reset the status for new work later
+                    return m_all_ok.exchange(true);
+                }
+                if (m_queued == 0) {
+                    nIdle++;
+                    cond.wait(lock); // wait
+                    nIdle--;
+                }
+                continue;
+            }
+            // Pass the wakeup on while checks are left for an idle worker
+            if (m_queued > 0) {
+                boost::unique_lock<boost::mutex> lock(mutex);
+                if (nIdle > 0) {
+                    condWorker.notify_one();
+                }
+            }
+            // execute work
+            bool fOk = m_all_ok;
+            for (T& check : vChecks)
+                if (fOk)
+                    fOk = check();
+            if (!fOk)
+                m_all_ok = false;
+            const unsigned int nNow = vChecks.size();
+            vChecks.clear();
+            if (m_todo.fetch_sub(nNow) == nNow) {
+                // We processed the last element; inform the master it can exit and return the result
+                boost::unique_lock<boost::mutex> lock(mutex);
+                condMaster.notify_one();
+            }
+        } while (true);
+    }
+
     /** Internal function that does bulk of the verification work. */
     bool Loop(bool fMaster = false)
     {
@@ -130,21 +260,58 @@ public:
     //! Create a new check queue
     explicit CCheckQueue(unsigned int nBatchSizeIn) : nIdle(0), nTotal(0), fAllOk(true), nTodo(0), nBatchSize(nBatchSizeIn) {}
 
+    //! Select how checks are handed out. Must be called before any worker thread starts.
+    void SetMode(CheckQueueMode mode)
+    {
+        m_mode = mode;
+        m_local.clear();
+        if (m_mode == CheckQueueMode::WORK_STEALING) {
+            for (unsigned int i = 0; i < CHECKQUEUE_LOCAL_QUEUES; i++) {
+                m_local.emplace_back(new LocalQueue());
+            }
+        }
+    }
+
     //! Worker thread
     void Thread()
     {
-        Loop();
+        if (m_mode == CheckQueueMode::WORK_STEALING) {
+            LoopStealing(m_workers++ % m_local.size());
+        } else {
+            Loop();
+        }
     }
 
     //! Wait until execution finishes, and return whether all evaluations were successful.
     bool Wait()
     {
+        if (m_mode == CheckQueueMode::WORK_STEALING) {
+            return LoopStealing(m_local.size(), true);
+        }
         return Loop(true);
     }
 
     //! Add a batch of checks to the queue
     void Add(std::vector<T>& vChecks)
     {
+        if (m_mode == CheckQueueMode::WORK_STEALING) {
+            if (vChecks.empty()) return;
+            m_todo += vChecks.size();
+            m_queued += vChecks.size();
+            {
+                LocalQueue& local = *m_local[m_add_cursor++ % ActiveLocalQueues()];
+                boost::unique_lock<boost::mutex> lock(local.mutex);
+                for (T& check : vChecks) {
+                    local.checks.emplace_back();
+                    check.swap(local.checks.back());
+                }
+            }
+            // Each batch lands in a single queue. One worker is woken to take
+            // a share, and wakes the next one while checks are left.
+            boost::unique_lock<boost::mutex> lock(mutex);
+            condWorker.notify_one();
+            return;
+        }
         boost::unique_lock<boost::mutex> lock(mutex);
         for (T& check : vChecks) {
             queue.push_back(T());
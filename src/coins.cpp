@@ -5,10 +5,13 @@
 #include <coins.h>
 
 #include <consensus/consensus.h>
+#include <crypto/common.h>
 #include <logging.h>
 #include <random.h>
 #include <version.h>
 
+#include <atomic>
+
 bool CCoinsView::GetCoin(const COutPoint &outpoint, Coin &coin) const { return false; }
 uint256 CCoinsView::GetBestBlock() const { return uint256(); }
 std::vector<uint256> CCoinsView::GetHeadBlocks() const { return std::vector<uint256>(); }
@@ -33,10 +36,178 @@ size_t CCoinsViewBacked::EstimateSize() const { return base->EstimateSize(); }
 
 SaltedOutpointHasher::SaltedOutpointHasher() : k0(GetRand(std::numeric_limits<uint64_t>::max())), k1(GetRand(std::numeric_limits<uint64_t>::max())) {}
 
+//! Size of the first arena chunk of a flat CCoinsMap
+static const uint32_t COINSMAP_FIRST_CHUNK = 16;
+//! Smallest number of slots of a non-empty flat CCoinsMap
+static const size_t COINSMAP_MIN_SLOTS = 16;
+
+static std::atomic<CCoinsMap::Type> g_coins_map_type{CCoinsMap::Type::UNORDERED};
+
+CCoinsMap::Type CCoinsMap::GetDefaultType()
+{
+    return g_coins_map_type;
+}
+
+void CCoinsMap::SetDefaultType(Type type)
+{
+    g_coins_map_type = type;
+}
+
+CCoinsMap::value_type* CCoinsMap::EntryAt(uint32_t node) const
+{
+    // Chunk k holds the nodes from COINSMAP_FIRST_CHUNK * (2^k - 1) on
+    const uint32_t index = node - 1;
+    const int chunk = CountBits(index / COINSMAP_FIRST_CHUNK + 1) - 1;
+    const uint32_t offset = index - COINSMAP_FIRST_CHUNK * ((uint32_t{1} << chunk) - 1);
+    return m_chunks[chunk][offset].Entry();
+}
+
+uint32_t CCoinsMap::AllocateNode()
+{
+    if (m_free != 0) {
+        const uint32_t node = m_free;
+        m_free = *reinterpret_cast<uint32_t*>(EntryAt(node));
+        return node;
+    }
+    if (m_nodes_used == COINSMAP_FIRST_CHUNK * ((uint32_t{1} << m_chunks.size()) - 1)) {
+        m_chunks.emplace_back(new Node[COINSMAP_FIRST_CHUNK << m_chunks.size()]);
+    }
+    return ++m_nodes_used;
+}
+
+void CCoinsMap::FreeNode(uint32_t node)
+{
+    value_type* entry = EntryAt(node);
+    entry->~value_type();
+    *reinterpret_cast<uint32_t*>(entry) = m_free;
+    m_free = node;
+}
+
+size_t CCoinsMap::FindSlot(const COutPoint& key, size_t hash) const
+{
+    if (m_slots.empty()) {
+        return 0;
+    }
+    const size_t mask = m_slots.size() - 1;
+    const uint32_t tag = Tag(hash);
+    for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+        const Slot& slot = m_slots[i];
+        if (slot.node == EMPTY) {
+            return m_slots.size();
+        }
+        if (slot.node != TOMBSTONE && slot.tag == tag && EntryAt(slot.node)->first == key) {
+            return i;
+        }
+    }
+}
+
+size_t CCoinsMap::ReserveSlot(size_t hash)
+{
+    // Keep at least a quarter of the slots empty, so that probing stays short
+    if ((m_size + m_tombstones + 1) * 4 > m_slots.size() * 3) {
+        size_t slots = std::max(COINSMAP_MIN_SLOTS, m_slots.size());
+        while ((m_size + 1) * 2 > slots) {
+            slots *= 2;
+        }
+        Rehash(slots);
+    }
+    const size_t mask = m_slots.size() - 1;
+    for (size_t i = hash & mask; ; i = (i + 1) & mask) {
+        if (m_slots[i].node == EMPTY) {
+            return i;
+        }
+        if (m_slots[i].node == TOMBSTONE) {
+            m_tombstones--;
+            return i;
+        }
+    }
+}
+
+void CCoinsMap::Rehash(size_t slots)
+{
+    std::vector<Slot> old_slots(slots, Slot{EMPTY, 0});
+    old_slots.swap(m_slots);
+    m_tombstones = 0;
+    const size_t mask = m_slots.size() - 1;
+    for (const Slot& slot : old_slots) {
+        if (slot.node == EMPTY || slot.node == TOMBSTONE) {
+            continue;
+        }
+        size_t i = m_hasher(EntryAt(slot.node)->first) & mask;
+        while (m_slots[i].node != EMPTY) {
+            i = (i + 1) & mask;
+        }
+        m_slots[i] = slot;
+    }
+}
+
+CCoinsMap::iterator CCoinsMap::find(const COutPoint& key)
+{
+    if (m_type != Type::FLAT) {
+        return iterator(m_map.find(key));
+    }
+    return iterator(this, FindSlot(key, m_hasher(key)));
+}
+
+CCoinsMap::const_iterator CCoinsMap::find(const COutPoint& key) const
+{
+    if (m_type != Type::FLAT) {
+        return const_iterator(m_map.find(key));
+    }
+    return const_iterator(this, FindSlot(key, m_hasher(key)));
+}
+
+CCoinsMap::iterator CCoinsMap::erase(const_iterator pos)
+{
+    if (m_type != Type::FLAT) {
+        return iterator(m_map.erase(pos.m_map_it));
+    }
+    const size_t slot = pos.m_slot;
+    FreeNode(m_slots[slot].node);
+    // A slot followed by an empty one ends no probe sequence but its own
+    const bool next_empty = m_slots[(slot + 1) & (m_slots.size() - 1)].node == EMPTY;
+    m_slots[slot].node = next_empty ? EMPTY : TOMBSTONE;
+    if (!next_empty) {
+        m_tombstones++;
+    }
+    m_size--;
+    return iterator(this, slot + 1);
+}
+
+void CCoinsMap::clear()
+{
+    if (m_type != Type::FLAT) {
+        m_map.clear();
+        return;
+    }
+    for (const Slot& slot : m_slots) {
+        if (slot.node != EMPTY && slot.node != TOMBSTONE) {
+            EntryAt(slot.node)->~value_type();
+        }
+    }
+    // Release the memory, as a flushed cache is not expected to hold on to it
+    std::vector<Slot>().swap(m_slots);
+    std::vector<std::unique_ptr<Node[]>>().swap(m_chunks);
+    m_size = 0;
+    m_tombstones = 0;
+    m_nodes_used = 0;
+    m_free = 0;
+}
+
+size_t CCoinsMap::DynamicMemoryUsage() const
+{
+    if (m_type != Type::FLAT) {
+        return memusage::DynamicUsage(m_map);
+    }
+    // Free arena nodes are handed out again before the arena grows, so only
+    // the live entries count towards the size of the cache
+    return memusage::DynamicUsage(m_slots) + memusage::DynamicUsage(m_chunks) + m_size * sizeof(Node);
+}
+
 CCoinsViewCache::CCoinsViewCache(CCoinsView *baseIn) : CCoinsViewBacked(baseIn), cachedCoinsUsage(0) {}
 
 size_t CCoinsViewCache::DynamicMemoryUsage() const {
-    return memusage::DynamicUsage(cacheCoins) + cachedCoinsUsage;
+    return cacheCoins.DynamicMemoryUsage() + cachedCoinsUsage;
 }
 
 CCoinsMap::iterator CCoinsViewCache::FetchCoin(const COutPoint &outpoint) const {
@@ -46,7 +217,7 @@ CCoinsMap::iterator CCoinsViewCache::FetchCoin(const COutPoint &outpoint) const
     Coin tmp;
     if (!base->GetCoin(outpoint, tmp))
         return cacheCoins.end();
-    CCoinsMap::iterator ret = cacheCoins.emplace(std::piecewise_construct, std::forward_as_tuple(outpoint), std::forward_as_tuple(std::move(tmp))).first;
+    CCoinsMap::iterator ret = cacheCoins.try_emplace(outpoint, std::move(tmp)).first;
     if (ret->second.coin.IsSpent()) {
         // The parent only has an empty entry for this outpoint; we can consider our
         // version as fresh.
@@ -70,7 +241,7 @@ void CCoinsViewCache::AddCoin(const COutPoint &outpoint, Coin&& coin, bool possi
     if (coin.out.scriptPubKey.IsUnspendable()) return;
     CCoinsMap::iterator it;
     bool inserted;
-    std::tie(it, inserted) = cacheCoins.emplace(std::piecewise_construct, std::forward_as_tuple(outpoint), std::tuple<>());
+    std::tie(it, inserted) = cacheCoins.try_emplace(outpoint);
     bool fresh = false;
     if (!inserted) {
         cachedCoinsUsage -= it->second.coin.DynamicMemoryUsage();
@@ -210,6 +381,28 @@ bool CCoinsViewCache::Flush() {
     return fOk;
 }
 
+bool CCoinsViewCache::Sync() {
+    CCoinsMap dirty(cacheCoins.GetType());
+    for (CCoinsMap::iterator it = cacheCoins.begin(); it != cacheCoins.end();) {
+        if (!(it->second.flags & CCoinsCacheEntry::DIRTY)) {
+            ++it;
+            continue;
+        }
+        if (it->second.coin.IsSpent()) {
+            // Nothing to keep once the base knows the coin is spent
+            cachedCoinsUsage -= it->second.coin.DynamicMemoryUsage();
+            dirty.try_emplace(it->first, std::move(it->second));
+            it = cacheCoins.erase(it);
+        } else {
+            CCoinsCacheEntry& entry = dirty.try_emplace(it->first, Coin(it->second.coin)).first->second;
+            entry.flags = it->second.flags;
+            it->second.flags = 0;
+            ++it;
+        }
+    }
+    return base->BatchWrite(dirty, hashBlock);
+}
+
 void CCoinsViewCache::Uncache(const COutPoint& hash)
 {
     CCoinsMap::iterator it = cacheCoins.find(hash);
@@ -219,6 +412,18 @@ void CCoinsViewCache::Uncache(const COutPoint& hash)
     }
 }
 
+void CCoinsViewCache::Trim(size_t target_usage)
+{
+    for (CCoinsMap::iterator it = cacheCoins.begin(); it != cacheCoins.end() && DynamicMemoryUsage() > target_usage;) {
+        if (it->second.flags == 0) {
+            cachedCoinsUsage -= it->second.coin.DynamicMemoryUsage();
+            it = cacheCoins.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
 unsigned int CCoinsViewCache::GetCacheSize() const {
     return cacheCoins.size();
 }
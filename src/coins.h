@@ -18,7 +18,13 @@
 #include <stdint.h>
 
 #include <functional>
+#include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #ifdef ENABLE_BITCORE_RPC
 ////////////////////////////////////////////////////////////////// // qtum
@@ -212,7 +218,180 @@ struct CCoinsCacheEntry
     explicit CCoinsCacheEntry(Coin&& coin_) : coin(std::move(coin_)), flags(0) {}
 };
 
-typedef std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher> CCoinsMap;
+/** -coinsmap default */
+static const char* const DEFAULT_COINSMAP = "unordered";
+
+/**
+ * Map from outpoints to coins cache entries, backed by one of two
+ * implementations chosen when the map is constructed:
+ *
+ * - UNORDERED: std::unordered_map, one heap node per entry.
+ * - FLAT: an open-addressing table with linear probing. Its 8-byte slots
+ *   hold part of the hash and the index of the entry in an arena. The arena
+ *   hands out entries from chunks of doubling size, so there is no
+ *   per-entry allocation and no bucket chain to follow.
+ *
+ * Both keep references to an entry valid until it is erased, and keep
+ * iterators valid when other entries are erased. Inserting may invalidate
+ * iterators.
+ */
+class CCoinsMap
+{
+public:
+    enum class Type { UNORDERED, FLAT };
+    typedef std::pair<const COutPoint, CCoinsCacheEntry> value_type;
+
+private:
+    typedef std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher> UnorderedMap;
+
+    //! Arena storage for one entry, holding a free list link while unused
+    struct Node {
+        typename std::aligned_storage<sizeof(value_type), alignof(value_type)>::type storage;
+        value_type* Entry() { return reinterpret_cast<value_type*>(&storage); }
+    };
+
+    struct Slot {
+        //! Arena index of the entry plus one, or EMPTY or TOMBSTONE
+        uint32_t node;
+        //! Upper bits of the hash of the entry's key
+        uint32_t tag;
+    };
+    static constexpr uint32_t EMPTY = 0;
+    static constexpr uint32_t TOMBSTONE = std::numeric_limits<uint32_t>::max();
+
+    template <bool Const>
+    class Iterator
+    {
+        friend class CCoinsMap;
+        template <bool> friend class Iterator;
+        typedef typename std::conditional<Const, const CCoinsMap*, CCoinsMap*>::type MapPtr;
+        typedef typename std::conditional<Const, UnorderedMap::const_iterator, UnorderedMap::iterator>::type MapIter;
+
+        MapIter m_map_it;
+        MapPtr m_map = nullptr;
+        size_t m_slot = 0;
+
+        explicit Iterator(MapIter it) : m_map_it(it) {}
+        Iterator(MapPtr map, size_t slot) : m_map(map), m_slot(slot) { SkipFree(); }
+        void SkipFree()
+        {
+            while (m_slot < m_map->m_slots.size() && (m_map->m_slots[m_slot].node == EMPTY || m_map->m_slots[m_slot].node == TOMBSTONE)) {
+                m_slot++;
+            }
+        }
+
+    public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef CCoinsMap::value_type value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef typename std::conditional<Const, const value_type*, value_type*>::type pointer;
+        typedef typename std::conditional<Const, const value_type&, value_type&>::type reference;
+
+        Iterator() {}
+        //! Conversion from iterator to const_iterator
+        template <bool OtherConst, typename = typename std::enable_if<Const && !OtherConst>::type>
+        Iterator(const Iterator<OtherConst>& other) : m_map_it(other.m_map_it), m_map(other.m_map), m_slot(other.m_slot) {}
+
+        reference operator*() const { return m_map ? *m_map->EntryAt(m_map->m_slots[m_slot].node) : *m_map_it; }
+        pointer operator->() const { return &**this; }
+        Iterator& operator++()
+        {
+            if (m_map) {
+                m_slot++;
+                SkipFree();
+            } else {
+                ++m_map_it;
+            }
+            return *this;
+        }
+        Iterator operator++(int)
+        {
+            Iterator ret = *this;
+            ++*this;
+            return ret;
+        }
+        bool operator==(const Iterator& other) const { return m_map ? m_slot == other.m_slot : m_map_it == other.m_map_it; }
+        bool operator!=(const Iterator& other) const { return !(*this == other); }
+    };
+
+    const Type m_type;
+    UnorderedMap m_map;
+    SaltedOutpointHasher m_hasher;
+
+    //! Slots of the flat table, a power of two of them
+    std::vector<Slot> m_slots;
+    size_t m_size = 0;
+    size_t m_tombstones = 0;
+    //! Arena chunks, each twice the size of the one before
+    std::vector<std::unique_ptr<Node[]>> m_chunks;
+    //! Number of arena nodes handed out so far
+    uint32_t m_nodes_used = 0;
+    //! Arena index plus one of the first free node, or zero
+    uint32_t m_free = 0;
+
+    value_type* EntryAt(uint32_t node) const;
+    uint32_t AllocateNode();
+    void FreeNode(uint32_t node);
+    static uint32_t Tag(size_t hash) { return (uint64_t)hash >> 32; }
+    size_t FindSlot(const COutPoint& key, size_t hash) const;
+    size_t ReserveSlot(size_t hash);
+    void Rehash(size_t slots);
+
+public:
+    typedef Iterator<false> iterator;
+    typedef Iterator<true> const_iterator;
+
+    CCoinsMap() : CCoinsMap(GetDefaultType()) {}
+    explicit CCoinsMap(Type type) : m_type(type) {}
+    ~CCoinsMap() { clear(); }
+
+    CCoinsMap(const CCoinsMap&) = delete;
+    CCoinsMap& operator=(const CCoinsMap&) = delete;
+
+    //! The type of maps constructed without an explicit one, set at startup
+    static Type GetDefaultType();
+    static void SetDefaultType(Type type);
+
+    Type GetType() const { return m_type; }
+    size_t size() const { return m_type == Type::FLAT ? m_size : m_map.size(); }
+    bool empty() const { return size() == 0; }
+    size_t DynamicMemoryUsage() const;
+
+    iterator begin() { return m_type == Type::FLAT ? iterator(this, 0) : iterator(m_map.begin()); }
+    iterator end() { return m_type == Type::FLAT ? iterator(this, m_slots.size()) : iterator(m_map.end()); }
+    const_iterator begin() const { return m_type == Type::FLAT ? const_iterator(this, 0) : const_iterator(m_map.begin()); }
+    const_iterator end() const { return m_type == Type::FLAT ? const_iterator(this, m_slots.size()) : const_iterator(m_map.end()); }
+
+    iterator find(const COutPoint& key);
+    const_iterator find(const COutPoint& key) const;
+
+    /** Insert an entry constructed from args, unless the key is present. */
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(const COutPoint& key, Args&&... args)
+    {
+        if (m_type != Type::FLAT) {
+            auto ret = m_map.emplace(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...));
+            return {iterator(ret.first), ret.second};
+        }
+        const size_t hash = m_hasher(key);
+        size_t slot = FindSlot(key, hash);
+        if (slot != m_slots.size()) {
+            return {iterator(this, slot), false};
+        }
+        slot = ReserveSlot(hash);
+        const uint32_t node = AllocateNode();
+        new (EntryAt(node)) value_type(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...));
+        m_slots[slot] = Slot{node, Tag(hash)};
+        m_size++;
+        return {iterator(this, slot), true};
+    }
+    std::pair<iterator, bool> emplace(const COutPoint& key, CCoinsCacheEntry&& entry) { return try_emplace(key, std::move(entry)); }
+    CCoinsCacheEntry& operator[](const COutPoint& key) { return try_emplace(key).first->second; }
+
+    /** Erase the entry at pos and return the iterator following it. */
+    iterator erase(const_iterator pos);
+    void clear();
+};
 
 /** Cursor for iterating over CoinsView state */
 class CCoinsViewCursor
@@ -361,12 +540,22 @@ public:
      */
     bool Flush();
 
+    /**
+     * Push the modifications applied to this cache to its base, like Flush,
+     * but keep the unspent coins cached as unmodified entries.
+     * If false is returned, the state of this cache (and its backing view) will be undefined.
+     */
+    bool Sync();
+
     /**
      * Removes the UTXO with the given outpoint from the cache, if it is
      * not modified.
      */
     void Uncache(const COutPoint &outpoint);
 
+    /** Remove unmodified coins from the cache until its memory usage is at most target_usage. */
+    void Trim(size_t target_usage);
+
     //! Calculate the size of the cache (in number of transaction outputs)
     unsigned int GetCacheSize() const;
 
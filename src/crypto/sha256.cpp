@@ -22,11 +22,13 @@ void Transform(uint32_t* s, const unsigned char* chunk, size_t blocks);
 namespace sha256d64_sse41
 {
 void Transform_4way(unsigned char* out, const unsigned char* in);
+void TransformMulti_4way(uint32_t* s, const unsigned char* const* chunks);
 }
 
 namespace sha256d64_avx2
 {
 void Transform_8way(unsigned char* out, const unsigned char* in);
+void TransformMulti_8way(uint32_t* s, const unsigned char* const* chunks);
 }
 
 namespace sha256d64_shani
@@ -416,6 +418,7 @@ void TransformD64(unsigned char* out, const unsigned char* in)
 
 typedef void (*TransformType)(uint32_t*, const unsigned char*, size_t);
 typedef void (*TransformD64Type)(unsigned char*, const unsigned char*);
+typedef void (*TransformMultiType)(uint32_t*, const unsigned char* const*);
 
 template<TransformType tr>
 void TransformD64Wrapper(unsigned char* out, const unsigned char* in)
@@ -461,6 +464,8 @@ TransformD64Type TransformD64 = sha256::TransformD64;
 TransformD64Type TransformD64_2way = nullptr;
 TransformD64Type TransformD64_4way = nullptr;
 TransformD64Type TransformD64_8way = nullptr;
+TransformMultiType TransformMulti_4way = nullptr;
+TransformMultiType TransformMulti_8way = nullptr;
 
 bool SelfTest() {
     // Input state (equal to the initial SHA256 state)
@@ -544,6 +549,23 @@ bool SelfTest() {
         if (!std::equal(out, out + 256, result_d64)) return false;
     }
 
+    // Test TransformMulti_4way and TransformMulti_8way, if available. Lane l
+    // starts from the state after l chunks and transforms the next one.
+    for (TransformMultiType tr : {TransformMulti_4way, TransformMulti_8way}) {
+        if (!tr) continue;
+        const size_t ways = tr == TransformMulti_4way ? 4 : 8;
+        uint32_t state[64];
+        const unsigned char* chunks[8];
+        for (size_t l = 0; l < ways; ++l) {
+            std::copy(result[l], result[l] + 8, state + l * 8);
+            chunks[l] = data + 1 + 64 * l;
+        }
+        tr(state, chunks);
+        for (size_t l = 0; l < ways; ++l) {
+            if (!std::equal(state + l * 8, state + l * 8 + 8, result[l + 1])) return false;
+        }
+    }
+
     return true;
 }
 
@@ -622,6 +644,7 @@ std::string SHA256AutoDetect()
 #endif
 #if defined(ENABLE_SSE41) && !defined(BUILD_BITCOIN_INTERNAL)
         TransformD64_4way = sha256d64_sse41::Transform_4way;
+        TransformMulti_4way = sha256d64_sse41::TransformMulti_4way;
         ret += ",sse41(4way)";
 #endif
     }
@@ -629,6 +652,7 @@ std::string SHA256AutoDetect()
 #if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
     if (have_avx2 && have_avx && enabled_avx) {
         TransformD64_8way = sha256d64_avx2::Transform_8way;
+        TransformMulti_8way = sha256d64_avx2::TransformMulti_8way;
         ret += ",avx2(8way)";
     }
 #endif
@@ -728,3 +752,104 @@ void SHA256D64(unsigned char* out, const unsigned char* in, size_t blocks)
         --blocks;
     }
 }
+
+namespace {
+
+/** Hash messages of any length in lock-step lanes of a multi-way transform.
+ *  A lane that finishes its message picks up the next one, so messages of
+ *  different lengths do not leave lanes idle until the last few. With
+ *  double_hash the lane goes on to hash its own 32-byte digest. */
+void MultiHash(TransformMultiType tr, size_t ways, unsigned char* out, const unsigned char* const* in, const size_t* lengths, size_t count, bool double_hash)
+{
+    static const unsigned char idle[64] = {0};
+    // Idle lanes still run through the transform, so their state must be defined
+    uint32_t s[64] = {0};
+    const unsigned char* chunks[8];
+    unsigned char tails[8][128];
+    const unsigned char* data[8];
+    size_t msg[8], block[8], full[8], blocks[8];
+    bool second[8];
+    size_t next = 0, active = 0;
+
+    // Set lane l up to hash len bytes at ptr, whose last partial block is padded into the lane's tail.
+    auto start = [&](size_t l, const unsigned char* ptr, size_t len) {
+        const size_t rem = len % 64;
+        const size_t tail = rem < 56 ? 64 : 128;
+        data[l] = ptr;
+        full[l] = len / 64;
+        blocks[l] = full[l] + tail / 64;
+        block[l] = 0;
+        if (rem) memcpy(tails[l], ptr + full[l] * 64, rem);
+        tails[l][rem] = 0x80;
+        memset(tails[l] + rem + 1, 0, tail - rem - 9);
+        WriteBE64(tails[l] + tail - 8, (uint64_t)len << 3);
+        sha256::Initialize(s + l * 8);
+    };
+    auto take = [&](size_t l) {
+        if (next < count) {
+            msg[l] = next;
+            second[l] = false;
+            start(l, in[next], lengths[next]);
+            ++next;
+            ++active;
+        } else {
+            msg[l] = count;
+        }
+    };
+
+    for (size_t l = 0; l < ways; ++l) take(l);
+    while (active) {
+        for (size_t l = 0; l < ways; ++l) {
+            if (msg[l] == count) {
+                chunks[l] = idle;
+            } else if (block[l] < full[l]) {
+                chunks[l] = data[l] + block[l] * 64;
+            } else {
+                chunks[l] = tails[l] + (block[l] - full[l]) * 64;
+            }
+        }
+        tr(s, chunks);
+        for (size_t l = 0; l < ways; ++l) {
+            if (msg[l] == count || ++block[l] < blocks[l]) continue;
+            unsigned char* dst = out + msg[l] * 32;
+            for (int i = 0; i < 8; ++i) WriteBE32(dst + i * 4, s[l * 8 + i]);
+            if (double_hash && !second[l]) {
+                second[l] = true;
+                start(l, dst, 32);
+                continue;
+            }
+            --active;
+            take(l);
+        }
+    }
+}
+
+} // namespace
+
+void SHA256Multi(unsigned char* out, const unsigned char* const* in, const size_t* lengths, size_t count)
+{
+    if (TransformMulti_8way && count > 4) {
+        MultiHash(TransformMulti_8way, 8, out, in, lengths, count, false);
+    } else if (TransformMulti_4way && count > 1) {
+        MultiHash(TransformMulti_4way, 4, out, in, lengths, count, false);
+    } else {
+        for (size_t i = 0; i < count; ++i) {
+            CSHA256().Write(in[i], lengths[i]).Finalize(out + i * 32);
+        }
+    }
+}
+
+void SHA256DMulti(unsigned char* out, const unsigned char* const* in, const size_t* lengths, size_t count)
+{
+    if (TransformMulti_8way && count > 4) {
+        MultiHash(TransformMulti_8way, 8, out, in, lengths, count, true);
+    } else if (TransformMulti_4way && count > 1) {
+        MultiHash(TransformMulti_4way, 4, out, in, lengths, count, true);
+    } else {
+        for (size_t i = 0; i < count; ++i) {
+            unsigned char hash[CSHA256::OUTPUT_SIZE];
+            CSHA256().Write(in[i], lengths[i]).Finalize(hash);
+            CSHA256().Write(hash, sizeof(hash)).Finalize(out + i * 32);
+        }
+    }
+}
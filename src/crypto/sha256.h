@@ -38,4 +38,17 @@ std::string SHA256AutoDetect();
  */
 void SHA256D64(unsigned char* output, const unsigned char* input, size_t blocks);
 
+/** Compute the SHA256's of multiple messages of any length at once.
+ *  output:  pointer to a count*32 byte output buffer
+ *  input:   pointers to the count messages
+ *  lengths: the length of each message
+ *  count:   the number of hashes to compute.
+ */
+void SHA256Multi(unsigned char* output, const unsigned char* const* input, const size_t* lengths, size_t count);
+
+/** Compute the double-SHA256's of multiple messages of any length at once.
+ *  Arguments as for SHA256Multi.
+ */
+void SHA256DMulti(unsigned char* output, const unsigned char* const* input, const size_t* lengths, size_t count);
+
 #endif // BITCOIN_CRYPTO_SHA256_H
@@ -6,6 +6,7 @@
 
 #include <memory>
 #include <random.h>
+#include <util/time.h>
 
 #include <leveldb/cache.h>
 #include <leveldb/env.h>
@@ -13,12 +14,27 @@
 #include <memenv.h>
 #include <stdint.h>
 #include <algorithm>
+#include <cstring>
+#include <mutex>
+#include <sstream>
+
+//! Number of level 0 files at which LevelDB delays writes (kL0_SlowdownWritesTrigger)
+static const int LEVELDB_L0_SLOWDOWN_TRIGGER = 8;
 
 class CBitcoinLevelDBLogger : public leveldb::Logger {
 public:
+    //! Writes that waited, counted from the messages LevelDB logs when they do
+    std::atomic<uint64_t> m_l0_stops{0};
+    std::atomic<uint64_t> m_write_buffer_stalls{0};
+
     // This code is adapted from posix_logger.h, which is why it is using vsprintf.
     // Please do not do this in normal code
     void Logv(const char * format, va_list ap) override {
+            if (strncmp(format, "Too many L0 files; waiting", 26) == 0) {
+                m_l0_stops++;
+            } else if (strncmp(format, "Current memtable full; waiting", 30) == 0) {
+                m_write_buffer_stalls++;
+            }
             if (!LogAcceptCategory(BCLog::LEVELDB)) {
                 return;
             }
@@ -97,13 +113,51 @@ static void SetMaxOpenFiles(leveldb::Options *options) {
              options->max_open_files, default_open_files);
 }
 
-static leveldb::Options GetOptions(size_t nCacheSize)
+/** Block cache that counts its lookups and hits */
+class CountingCache : public leveldb::Cache {
+public:
+    explicit CountingCache(size_t capacity) : m_cache(leveldb::NewLRUCache(capacity)) {}
+
+    Handle* Insert(const leveldb::Slice& key, void* value, size_t charge, void (*deleter)(const leveldb::Slice& key, void* value)) override
+    {
+        return m_cache->Insert(key, value, charge, deleter);
+    }
+    Handle* Lookup(const leveldb::Slice& key) override
+    {
+        Handle* handle = m_cache->Lookup(key);
+        m_lookups++;
+        if (handle) m_hits++;
+        return handle;
+    }
+    void Release(Handle* handle) override { m_cache->Release(handle); }
+    void* Value(Handle* handle) override { return m_cache->Value(handle); }
+    void Erase(const leveldb::Slice& key) override { m_cache->Erase(key); }
+    uint64_t NewId() override { return m_cache->NewId(); }
+    void Prune() override { m_cache->Prune(); }
+    size_t TotalCharge() const override { return m_cache->TotalCharge(); }
+
+    std::atomic<uint64_t> m_lookups{0};
+    std::atomic<uint64_t> m_hits{0};
+
+private:
+    std::unique_ptr<leveldb::Cache> m_cache;
+};
+
+void ApplyDBProfile(const DBProfile& profile, leveldb::Options& options)
+{
+    options.filter_policy = profile.bloom_bits > 0 ? leveldb::NewBloomFilterPolicy(profile.bloom_bits) : nullptr;
+    options.compression = profile.compression ? leveldb::kSnappyCompression : leveldb::kNoCompression;
+    options.max_file_size = profile.max_file_size;
+    options.block_size = profile.block_size;
+}
+
+static leveldb::Options GetOptions(size_t nCacheSize, const DBProfile& profile)
 {
     leveldb::Options options;
-    options.block_cache = leveldb::NewLRUCache(nCacheSize / 2);
-    options.write_buffer_size = nCacheSize / 4; // up to two write buffers may be held in memory simultaneously
-    options.filter_policy = leveldb::NewBloomFilterPolicy(10);
-    options.compression = leveldb::kNoCompression;
+    // up to two write buffers may be held in memory simultaneously
+    options.write_buffer_size = nCacheSize * profile.write_buffer_percent / 100;
+    options.block_cache = new CountingCache(nCacheSize - 2 * options.write_buffer_size);
+    ApplyDBProfile(profile, options);
     options.info_log = new CBitcoinLevelDBLogger();
     if (leveldb::kMajorVersion > 1 || (leveldb::kMajorVersion == 1 && leveldb::kMinorVersion >= 16)) {
         // LevelDB versions before 1.16 consider short writes to be corruption. Only trigger error
@@ -114,6 +168,161 @@ static leveldb::Options GetOptions(size_t nCacheSize)
     return options;
 }
 
+/** Apply one -dbprofile setting. Sizes are given in KiB. */
+static bool ApplyDBProfileSetting(DBProfile& profile, const std::string& key, const std::string& value)
+{
+    int32_t n;
+    if (!ParseInt32(value, &n)) return false;
+    if (key == "compression" && (n == 0 || n == 1)) {
+        profile.compression = n;
+    } else if (key == "writebuffer" && n >= 1 && n <= 50) {
+        profile.write_buffer_percent = n;
+    } else if (key == "bloombits" && n >= 0 && n <= 64) {
+        profile.bloom_bits = n;
+    } else if (key == "maxfilesize" && n >= 64 && n <= (1 << 20)) {
+        profile.max_file_size = (size_t)n << 10;
+    } else if (key == "blocksize" && n >= 1 && n <= 1024) {
+        profile.block_size = (size_t)n << 10;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/** Apply the -dbprofile argument arg to profile if it is for the named database, or to a scratch profile if name is empty. */
+static bool ApplyDBProfileArg(const std::string& arg, const std::string& name, DBProfile& profile, std::string& error)
+{
+    if (arg.empty()) {
+        return true;
+    }
+    const size_t colon = arg.find(':');
+    if (colon == std::string::npos || colon == 0) {
+        error = strprintf("Invalid -dbprofile '%s' (expected <db>:<setting>=<value>,...)", arg);
+        return false;
+    }
+    if (!name.empty() && arg.compare(0, colon, name) != 0) {
+        return true;
+    }
+    std::stringstream settings(arg.substr(colon + 1));
+    std::string setting;
+    while (std::getline(settings, setting, ',')) {
+        const size_t eq = setting.find('=');
+        if (eq == std::string::npos || !ApplyDBProfileSetting(profile, setting.substr(0, eq), setting.substr(eq + 1))) {
+            error = strprintf("Invalid -dbprofile setting '%s' for %s (known: compression=0|1, writebuffer=<percent>, bloombits=<n>, maxfilesize=<KiB>, blocksize=<KiB>)", setting, arg.substr(0, colon));
+            return false;
+        }
+    }
+    return true;
+}
+
+DBProfile GetDBProfile(const std::string& name)
+{
+    DBProfile profile;
+    std::string error;
+    for (const std::string& arg : gArgs.GetArgs("-dbprofile")) {
+        // Errors are reported at startup by CheckDBProfiles
+        ApplyDBProfileArg(arg, name, profile, error);
+    }
+    return profile;
+}
+
+bool CheckDBProfiles(std::string& error)
+{
+    for (const std::string& arg : gArgs.GetArgs("-dbprofile")) {
+        DBProfile profile;
+        if (!ApplyDBProfileArg(arg, "", profile, error)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static std::mutex g_dbwrappers_mutex;
+static std::vector<const CDBWrapper*> g_dbwrappers;
+
+static std::vector<std::pair<std::string, leveldb::DB*>> g_leveldbs;
+
+void ForEachDBWrapper(const std::function<void(const CDBWrapper&)>& f)
+{
+    std::lock_guard<std::mutex> lock(g_dbwrappers_mutex);
+    for (const CDBWrapper* dbw : g_dbwrappers) {
+        f(*dbw);
+    }
+}
+
+void RegisterLevelDB(const std::string& name, leveldb::DB* db)
+{
+    std::lock_guard<std::mutex> lock(g_dbwrappers_mutex);
+    g_leveldbs.emplace_back(name, db);
+}
+
+void UnregisterLevelDB(leveldb::DB* db)
+{
+    std::lock_guard<std::mutex> lock(g_dbwrappers_mutex);
+    g_leveldbs.erase(std::remove_if(g_leveldbs.begin(), g_leveldbs.end(), [db](const std::pair<std::string, leveldb::DB*>& entry) { return entry.second == db; }), g_leveldbs.end());
+}
+
+void ForEachLevelDB(const std::function<void(const std::string& name, leveldb::DB* db)>& f)
+{
+    std::lock_guard<std::mutex> lock(g_dbwrappers_mutex);
+    for (const auto& entry : g_leveldbs) {
+        f(entry.first, entry.second);
+    }
+}
+
+LevelDBProperties GetLevelDBProperties(leveldb::DB* db)
+{
+    LevelDBProperties properties;
+    std::string value;
+    if (db->GetProperty("leveldb.stats", &value)) {
+        // One line per level below the header of the compaction table
+        std::istringstream lines(value);
+        std::string line;
+        while (std::getline(lines, line)) {
+            LevelDBLevelStats level;
+            double size_mb, read_mb, write_mb;
+            if (sscanf(line.c_str(), "%d %d %lf %lf %lf %lf", &level.level, &level.files, &size_mb, &level.compaction_seconds, &read_mb, &write_mb) == 6) {
+                level.bytes = size_mb * 1048576;
+                level.compaction_bytes_read = read_mb * 1048576;
+                level.compaction_bytes_written = write_mb * 1048576;
+                properties.levels.push_back(level);
+            }
+        }
+    }
+    if (db->GetProperty("leveldb.approximate-memory-usage", &value)) {
+        properties.memory_usage = std::stoull(value);
+    }
+    return properties;
+}
+
+static std::string FormatLevels(const LevelDBProperties& properties)
+{
+    std::string levels;
+    for (const LevelDBLevelStats& level : properties.levels) {
+        levels += strprintf(" L%d=%d files/%.1fMiB/%.0fs/%.1fMiB read/%.1fMiB written", level.level, level.files, level.bytes / 1048576.0,
+                            level.compaction_seconds, level.compaction_bytes_read / 1048576.0, level.compaction_bytes_written / 1048576.0);
+    }
+    return levels;
+}
+
+void LogDBStats()
+{
+    if (!LogAcceptCategory(BCLog::LEVELDB)) {
+        return;
+    }
+    ForEachDBWrapper([](const CDBWrapper& dbw) {
+        const DBWrapperStats stats = dbw.GetStats();
+        LogPrint(BCLog::LEVELDB, "LevelDB %s: mem=%.1fMiB, reads=%u, cache hits=%u/%u, writes=%u (%.1fMiB), stalls: l0 slowdown=%u, l0 stop=%u, write buffer=%u (%.2fs);%s\n",
+                 stats.name, stats.properties.memory_usage / 1048576.0, stats.reads, stats.cache_hits, stats.cache_lookups,
+                 stats.batches_written, stats.bytes_written / 1048576.0, stats.l0_slowdowns, stats.l0_stops, stats.write_buffer_stalls,
+                 stats.stall_micros * 0.000001, FormatLevels(stats.properties));
+    });
+    ForEachLevelDB([](const std::string& name, leveldb::DB* db) {
+        const LevelDBProperties properties = GetLevelDBProperties(db);
+        LogPrint(BCLog::LEVELDB, "LevelDB %s: mem=%.1fMiB;%s\n", name, properties.memory_usage / 1048576.0, FormatLevels(properties));
+    });
+}
+
 CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bool fWipe, bool obfuscate)
     : m_name{path.stem().string()}
 {
@@ -122,7 +331,8 @@ CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bo
     iteroptions.verify_checksums = true;
     iteroptions.fill_cache = false;
     syncoptions.sync = true;
-    options = GetOptions(nCacheSize);
+    m_profile = GetDBProfile(m_name);
+    options = GetOptions(nCacheSize, m_profile);
     options.create_if_missing = true;
     if (fMemory) {
         penv = leveldb::NewMemEnv(leveldb::Env::Default());
@@ -139,6 +349,8 @@ CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bo
     leveldb::Status status = leveldb::DB::Open(options, path.string(), &pdb);
     dbwrapper_private::HandleError(status);
     LogPrintf("Opened LevelDB successfully\n");
+    LogPrint(BCLog::LEVELDB, "LevelDB profile of %s: compression=%d, write_buffer_size=%u, bloom_bits=%d, max_file_size=%u, block_size=%u\n",
+             m_name, m_profile.compression, options.write_buffer_size, m_profile.bloom_bits, m_profile.max_file_size, m_profile.block_size);
 
     if (gArgs.GetBoolArg("-forcecompactdb", false)) {
         LogPrintf("Starting database compaction of %s\n", path.string());
@@ -164,10 +376,17 @@ CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bo
     }
 
     LogPrintf("Using obfuscation key for %s: %s\n", path.string(), HexStr(obfuscate_key));
+
+    std::lock_guard<std::mutex> lock(g_dbwrappers_mutex);
+    g_dbwrappers.push_back(this);
 }
 
 CDBWrapper::~CDBWrapper()
 {
+    {
+        std::lock_guard<std::mutex> lock(g_dbwrappers_mutex);
+        g_dbwrappers.erase(std::find(g_dbwrappers.begin(), g_dbwrappers.end(), this));
+    }
     delete pdb;
     pdb = nullptr;
     delete options.filter_policy;
@@ -187,8 +406,22 @@ bool CDBWrapper::WriteBatch(CDBBatch& batch, bool fSync)
     if (log_memory) {
         mem_before = DynamicMemoryUsage() / 1024.0 / 1024;
     }
+    // Note whether LevelDB is about to delay this write, and how long the write takes if it does
+    const CBitcoinLevelDBLogger* logger = static_cast<const CBitcoinLevelDBLogger*>(options.info_log);
+    const uint64_t waits_before = logger->m_l0_stops + logger->m_write_buffer_stalls;
+    std::string l0_files;
+    const bool slowdown = pdb->GetProperty("leveldb.num-files-at-level0", &l0_files) && atoi(l0_files) >= LEVELDB_L0_SLOWDOWN_TRIGGER;
+    const int64_t write_start = GetTimeMicros();
     leveldb::Status status = pdb->Write(fSync ? syncoptions : writeoptions, &batch.batch);
     dbwrapper_private::HandleError(status);
+    m_batches_written++;
+    m_bytes_written += batch.SizeEstimate();
+    if (slowdown) {
+        m_l0_slowdowns++;
+    }
+    if (slowdown || logger->m_l0_stops + logger->m_write_buffer_stalls != waits_before) {
+        m_stall_micros += GetTimeMicros() - write_start;
+    }
     if (log_memory) {
         double mem_after = DynamicMemoryUsage() / 1024.0 / 1024;
         LogPrint(BCLog::LEVELDB, "WriteBatch memory usage: db=%s, before=%.1fMiB, after=%.1fMiB\n",
@@ -206,6 +439,31 @@ size_t CDBWrapper::DynamicMemoryUsage() const {
     return stoul(memory);
 }
 
+DBWrapperStats CDBWrapper::GetStats() const
+{
+    DBWrapperStats stats;
+    stats.name = m_name;
+    stats.profile = m_profile;
+    stats.reads = m_reads;
+    stats.bytes_read = m_bytes_read;
+    stats.batches_written = m_batches_written;
+    stats.bytes_written = m_bytes_written;
+    const CountingCache* cache = static_cast<const CountingCache*>(options.block_cache);
+    stats.cache_lookups = cache->m_lookups;
+    stats.cache_hits = cache->m_hits;
+    const CBitcoinLevelDBLogger* logger = static_cast<const CBitcoinLevelDBLogger*>(options.info_log);
+    stats.l0_slowdowns = m_l0_slowdowns;
+    stats.l0_stops = logger->m_l0_stops;
+    stats.write_buffer_stalls = logger->m_write_buffer_stalls;
+    stats.stall_micros = m_stall_micros;
+    stats.properties = GetLevelDBProperties(pdb);
+    for (const LevelDBLevelStats& level : stats.properties.levels) {
+        stats.compaction_bytes_read += level.compaction_bytes_read;
+        stats.compaction_bytes_written += level.compaction_bytes_written;
+    }
+    return stats;
+}
+
 // Prefixed with null character to avoid collisions with other keys
 //
 // We must use a string constructor which specifies length so that we copy
@@ -16,9 +16,103 @@
 #include <leveldb/db.h>
 #include <leveldb/write_batch.h>
 
+#include <atomic>
+#include <functional>
+
 static const size_t DBWRAPPER_PREALLOC_KEY_SIZE = 64;
 static const size_t DBWRAPPER_PREALLOC_VALUE_SIZE = 1024;
 
+/**
+ * LevelDB settings of a database. The defaults apply to every database and
+ * can be changed per database with -dbprofile=<name>:<setting>=<value>,...
+ */
+struct DBProfile {
+    //! Compress table blocks (only if LevelDB was built with Snappy)
+    bool compression = false;
+    //! Share of the cache size for each of the up to two write buffers, in percent. The block cache gets the rest.
+    int write_buffer_percent = 25;
+    //! Bits per key of the bloom filter, 0 for no filter
+    int bloom_bits = 10;
+    //! Size at which table files are split (bytes)
+    size_t max_file_size = 2 << 20;
+    //! Size of uncompressed table blocks (bytes)
+    size_t block_size = 4 << 10;
+};
+
+/** Profile of the database with the given name, with its -dbprofile settings applied. */
+DBProfile GetDBProfile(const std::string& name);
+
+/** Check the -dbprofile settings. Returns false and sets error if one is invalid. */
+bool CheckDBProfiles(std::string& error);
+
+/**
+ * Apply the table settings of a profile (all but the write buffer share) to
+ * the options of a database opened without CDBWrapper. The caller owns the
+ * filter policy this sets.
+ */
+void ApplyDBProfile(const DBProfile& profile, leveldb::Options& options);
+
+//! Interval between the -debug=leveldb summaries of all open databases (seconds)
+static const int64_t DB_STATS_LOG_INTERVAL = 10 * 60;
+
+/** Compactions into one level, from the leveldb.stats property, which rounds sizes to whole MiB */
+struct LevelDBLevelStats {
+    int level = 0;
+    int files = 0;
+    uint64_t bytes = 0;
+    //! Time spent compacting into this level, rounded to seconds by LevelDB
+    double compaction_seconds = 0;
+    uint64_t compaction_bytes_read = 0;
+    uint64_t compaction_bytes_written = 0;
+};
+
+/** State of a LevelDB database as reported by its properties */
+struct LevelDBProperties {
+    //! Levels that hold files or have seen compactions
+    std::vector<LevelDBLevelStats> levels;
+    //! Memtables and block cache (bytes)
+    uint64_t memory_usage = 0;
+};
+
+/** Read the properties of a LevelDB database. */
+LevelDBProperties GetLevelDBProperties(leveldb::DB* db);
+
+/**
+ * Register a database opened without CDBWrapper, such as the contract state
+ * and receipt databases, so that getdbstats and the -debug=leveldb summaries
+ * cover it. It must be unregistered before it is closed.
+ */
+void RegisterLevelDB(const std::string& name, leveldb::DB* db);
+void UnregisterLevelDB(leveldb::DB* db);
+
+/** Activity of a database since it was opened */
+struct DBWrapperStats {
+    std::string name;
+    DBProfile profile;
+    //! Point lookups (Read and Exists)
+    uint64_t reads = 0;
+    //! Bytes of the values returned by lookups
+    uint64_t bytes_read = 0;
+    //! Write batches and their size in bytes
+    uint64_t batches_written = 0;
+    uint64_t bytes_written = 0;
+    //! Block cache lookups, from point lookups, iterators and compactions
+    uint64_t cache_lookups = 0;
+    uint64_t cache_hits = 0;
+    //! Bytes read and written by memtable flushes and compactions
+    uint64_t compaction_bytes_read = 0;
+    uint64_t compaction_bytes_written = 0;
+    //! Writes delayed by LevelDB because level 0 had many files
+    uint64_t l0_slowdowns = 0;
+    //! Writes that waited for level 0 to be compacted
+    uint64_t l0_stops = 0;
+    //! Writes that waited for the previous write buffer to be flushed
+    uint64_t write_buffer_stalls = 0;
+    //! Time spent in writes that were delayed for any of these reasons (microseconds)
+    uint64_t stall_micros = 0;
+    LevelDBProperties properties;
+};
+
 class dbwrapper_error : public std::runtime_error
 {
 public:
@@ -201,6 +295,17 @@ private:
     //! the name of this database
     std::string m_name;
 
+    //! settings this database was opened with
+    DBProfile m_profile;
+
+    //! lookups and writes, see DBWrapperStats
+    mutable std::atomic<uint64_t> m_reads{0};
+    mutable std::atomic<uint64_t> m_bytes_read{0};
+    std::atomic<uint64_t> m_batches_written{0};
+    std::atomic<uint64_t> m_bytes_written{0};
+    std::atomic<uint64_t> m_l0_slowdowns{0};
+    std::atomic<uint64_t> m_stall_micros{0};
+
     //! a key used for optional XOR-obfuscation of the database
     std::vector<unsigned char> obfuscate_key;
 
@@ -237,12 +342,14 @@ public:
 
         std::string strValue;
         leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
+        m_reads++;
         if (!status.ok()) {
             if (status.IsNotFound())
                 return false;
             LogPrintf("LevelDB read failure: %s\n", status.ToString());
             dbwrapper_private::HandleError(status);
         }
+        m_bytes_read += strValue.size();
         try {
             CDataStream ssValue(strValue.data(), strValue.data() + strValue.size(), SER_DISK, CLIENT_VERSION);
             ssValue.Xor(obfuscate_key);
@@ -271,6 +378,7 @@ public:
 
         std::string strValue;
         leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
+        m_reads++;
         if (!status.ok()) {
             if (status.IsNotFound())
                 return false;
@@ -293,6 +401,11 @@ public:
     // Get an estimate of LevelDB memory usage (in bytes).
     size_t DynamicMemoryUsage() const;
 
+    const std::string& GetName() const { return m_name; }
+
+    //! Lookup, write and compaction activity since the database was opened
+    DBWrapperStats GetStats() const;
+
     // not available for LevelDB; provide for compatibility with BDB
     bool Flush()
     {
@@ -349,4 +462,13 @@ public:
 
 };
 
+/** Call f for each open database, in the order they were opened. */
+void ForEachDBWrapper(const std::function<void(const CDBWrapper&)>& f);
+
+/** Call f with each database registered with RegisterLevelDB. */
+void ForEachLevelDB(const std::function<void(const std::string& name, leveldb::DB* db)>& f);
+
+/** Log a summary of each open database to the leveldb category, if it is enabled. */
+void LogDBStats();
+
 #endif // BITCOIN_DBWRAPPER_H
@@ -6,6 +6,7 @@
 #ifndef BITCOIN_FLATFILE_H
 #define BITCOIN_FLATFILE_H
 
+#include <memory>
 #include <string>
 
 #include <fs.h>
@@ -45,6 +46,35 @@ struct FlatFilePos
     std::string ToString() const;
 };
 
+/**
+ * A read-only memory mapping of one file of a FlatFileSeq. The mapping stays
+ * valid for as long as this object lives, even if the file is removed.
+ */
+class FlatFileMapping
+{
+private:
+    const unsigned char* const m_data;
+    const size_t m_size;
+
+public:
+    FlatFileMapping(const unsigned char* data, size_t size) : m_data(data), m_size(size) {}
+    ~FlatFileMapping();
+
+    FlatFileMapping(const FlatFileMapping&) = delete;
+    FlatFileMapping& operator=(const FlatFileMapping&) = delete;
+
+    const unsigned char* data() const { return m_data; }
+    size_t size() const { return m_size; }
+};
+
+/**
+ * Map a whole file into memory, read-only.
+ *
+ * @return The mapping, or nullptr if the file could not be mapped or
+ *         memory mapping is not supported on this platform.
+ */
+std::shared_ptr<const FlatFileMapping> MapFile(const fs::path& path);
+
 /**
  * FlatFileSeq represents a sequence of numbered files storing raw data. This class facilitates
  * access to and efficient management of these files.
@@ -72,6 +102,15 @@ public:
     /** Open a handle to the file at the given position. */
     FILE* Open(const FlatFilePos& pos, bool read_only = false);
 
+    /**
+     * Map the whole file at the given position into memory, read-only. Bytes
+     * appended to the file afterwards are not covered by the mapping.
+     *
+     * @return The mapping, or nullptr if the file could not be mapped or
+     *         memory mapping is not supported on this platform.
+     */
+    std::shared_ptr<const FlatFileMapping> Map(const FlatFilePos& pos) const;
+
     /**
      * Allocate additional space in a file after the given starting position. The amount allocated
      * will be the minimum multiple of the sequence chunk size greater than add_size.
@@ -66,6 +66,10 @@ private:
 static std::string strRPCUserColonPass;
 /* Stored RPC timer interface (for unregistration) */
 static std::unique_ptr<HTTPRPCTimerInterface> httpRPCTimerInterface;
+/* Work queue by RPC method, for methods that don't run on the default queue */
+static std::map<std::string, std::string> g_rpc_method_queues;
+/* Bytes of the request body searched for the method name */
+static const size_t RPC_METHOD_PEEK_SIZE = 4096;
 
 static void JSONErrorReply(HTTPRequest* req, const UniValue& objError, const UniValue& id)
 {
@@ -194,9 +198,19 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
         // singleton request
         if (valRequest.isObject()) {
             jreq.parse(valRequest);
+            jreq.canStream = true;
 
             UniValue result = tableRPC.execute(jreq);
 
+            if (jreq.isParked) {
+                return true;
+            }
+
+            // The result was streamed by the handler
+            if (req->ReplySent()) {
+                return true;
+            }
+
             if (jreq.isLongPolling) {
                 jreq.PollReply(result);
                 return true;
@@ -245,15 +259,89 @@ static bool InitRPCAuthentication()
     return true;
 }
 
+/** Find the method of a single JSON-RPC request without parsing the whole
+ * body. Returns an empty string for batches or if the method isn't found.
+ */
+static std::string PeekJSONRPCMethod(const std::string& body)
+{
+    size_t pos = body.find_first_not_of(" \t\r\n");
+    if (pos == std::string::npos || body[pos] != '{')
+        return "";
+    pos = body.find("\"method\"", pos);
+    if (pos == std::string::npos)
+        return "";
+    pos = body.find_first_not_of(" \t\r\n", pos + 8);
+    if (pos == std::string::npos || body[pos] != ':')
+        return "";
+    pos = body.find_first_not_of(" \t\r\n", pos + 1);
+    if (pos == std::string::npos || body[pos] != '"')
+        return "";
+    size_t end = body.find('"', pos + 1);
+    if (end == std::string::npos)
+        return "";
+    return body.substr(pos + 1, end - pos - 1);
+}
+
+static std::string SelectRPCWorkQueue(HTTPRequest* req)
+{
+    auto it = g_rpc_method_queues.find(PeekJSONRPCMethod(req->PeekBody(RPC_METHOD_PEEK_SIZE)));
+    if (it == g_rpc_method_queues.end())
+        return "";
+    return it->second;
+}
+
+/** Create the work queues of -rpcqueue, plus the built-in queues for blocking calls and UTXO set scans */
+static bool InitRPCWorkQueues()
+{
+    std::map<std::string, std::string> definitions;
+    definitions[RPC_BLOCKING_WORKQUEUE] = strprintf("%d:%d:%s", DEFAULT_RPC_BLOCKING_THREADS, DEFAULT_RPC_BLOCKING_WORKQUEUE, DEFAULT_RPC_BLOCKING_METHODS);
+    definitions[RPC_SCAN_WORKQUEUE] = strprintf("%d:%d:%s", DEFAULT_RPC_SCAN_THREADS, DEFAULT_RPC_SCAN_WORKQUEUE, DEFAULT_RPC_SCAN_METHODS);
+    for (const std::string& arg : gArgs.GetArgs("-rpcqueue")) {
+        size_t pos = arg.find(':');
+        if (pos == std::string::npos || pos == 0 || arg.substr(0, pos) == HTTP_DEFAULT_WORKQUEUE) {
+            LogPrintf("Invalid -rpcqueue=%s\n", arg);
+            return false;
+        }
+        definitions[arg.substr(0, pos)] = arg.substr(pos + 1);
+    }
+
+    for (const auto& definition : definitions) {
+        std::vector<std::string> fields;
+        boost::split(fields, definition.second, boost::is_any_of(":"));
+        int32_t threads, depth;
+        if (fields.size() != 3 || !ParseInt32(fields[0], &threads) || !ParseInt32(fields[1], &depth) || threads < 0) {
+            LogPrintf("Invalid -rpcqueue=%s:%s\n", definition.first, definition.second);
+            return false;
+        }
+        if (threads == 0) {
+            // Disabled, the methods stay on the default queue
+            continue;
+        }
+        if (!AddHTTPWorkQueue(definition.first, threads, depth)) {
+            LogPrintf("Unable to create RPC work queue %s\n", definition.first);
+            return false;
+        }
+        std::vector<std::string> methods;
+        boost::split(methods, fields[2], boost::is_any_of(","));
+        for (const std::string& method : methods) {
+            if (!method.empty())
+                g_rpc_method_queues[method] = definition.first;
+        }
+    }
+    return true;
+}
+
 bool StartHTTPRPC()
 {
     LogPrint(BCLog::RPC, "Starting HTTP RPC server\n");
     if (!InitRPCAuthentication())
         return false;
+    if (!InitRPCWorkQueues())
+        return false;
 
-    RegisterHTTPHandler("/", true, HTTPReq_JSONRPC);
+    RegisterHTTPHandler("/", true, HTTPReq_JSONRPC, SelectRPCWorkQueue);
     if (g_wallet_init_interface.HasWalletSupport()) {
-        RegisterHTTPHandler("/wallet/", false, HTTPReq_JSONRPC);
+        RegisterHTTPHandler("/wallet/", false, HTTPReq_JSONRPC, SelectRPCWorkQueue);
     }
     struct event_base* eventBase = EventBase();
     assert(eventBase);
@@ -278,4 +366,5 @@ void StopHTTPRPC()
         RPCUnsetTimerInterface(httpRPCTimerInterface.get());
         httpRPCTimerInterface.reset();
     }
+    g_rpc_method_queues.clear();
 }
@@ -8,6 +8,18 @@
 #include <string>
 #include <map>
 
+/** Work queue for RPC calls that may block for a long time */
+static const char* const RPC_BLOCKING_WORKQUEUE = "blocking";
+static const int DEFAULT_RPC_BLOCKING_THREADS = 2;
+static const int DEFAULT_RPC_BLOCKING_WORKQUEUE = 16;
+static const char* const DEFAULT_RPC_BLOCKING_METHODS = "waitforlogs,waitfornewblock,waitforblock,waitforblockheight,searchlogs";
+/** Work queue for scantxoutset. Only one scan runs at a time, so the second
+ *  thread stays free for its abort and status actions. */
+static const char* const RPC_SCAN_WORKQUEUE = "scan";
+static const int DEFAULT_RPC_SCAN_THREADS = 2;
+static const int DEFAULT_RPC_SCAN_WORKQUEUE = 16;
+static const char* const DEFAULT_RPC_SCAN_METHODS = "scantxoutset";
+
 /** Start HTTP RPC subsystem.
  * Precondition; HTTP and RPC has been started.
  */
@@ -17,6 +17,7 @@
 #include <ui_interface.h>
 
 #include <deque>
+#include <map>
 #include <memory>
 #include <stdio.h>
 #include <stdlib.h>
@@ -57,13 +58,29 @@ public:
         func(req.get(), path);
     }
 
-    std::unique_ptr<HTTPRequest> req;
+    std::shared_ptr<HTTPRequest> req;
 
 private:
     std::string path;
     HTTPRequestHandler func;
 };
 
+/** Work item running an arbitrary function */
+class HTTPFunctionItem final : public HTTPClosure
+{
+public:
+    explicit HTTPFunctionItem(const std::function<void()>& _func): func(_func)
+    {
+    }
+    void operator()() override
+    {
+        func();
+    }
+
+private:
+    std::function<void()> func;
+};
+
 /** Simple work queue for distributing work over multiple threads.
  * Work items are simply callable objects.
  */
@@ -71,16 +88,36 @@ template <typename WorkItem>
 class WorkQueue
 {
 private:
+    struct Entry
+    {
+        std::unique_ptr<WorkItem> item;
+        int64_t enqueued;
+    };
+
     /** Mutex protects entire object */
     Mutex cs;
     std::condition_variable cond;
-    std::deque<std::unique_ptr<WorkItem>> queue;
+    std::deque<Entry> queue;
     bool running;
     size_t maxDepth;
 
+    /** Statistics, see HTTPWorkQueueStats */
+    uint64_t started;
+    uint64_t processed;
+    uint64_t rejected;
+    int64_t totalWaitMicros;
+    int64_t maxWaitMicros;
+    int64_t totalExecMicros;
+
 public:
     explicit WorkQueue(size_t _maxDepth) : running(true),
-                                 maxDepth(_maxDepth)
+                                 maxDepth(_maxDepth),
+                                 started(0),
+                                 processed(0),
+                                 rejected(0),
+                                 totalWaitMicros(0),
+                                 maxWaitMicros(0),
+                                 totalExecMicros(0)
     {
     }
     /** Precondition: worker threads have all stopped (they have been joined).
@@ -92,10 +129,11 @@ public:
     bool Enqueue(WorkItem* item)
     {
         LOCK(cs);
-        if (queue.size() >= maxDepth) {
+        if (!running || queue.size() >= maxDepth) {
+            ++rejected;
             return false;
         }
-        queue.emplace_back(std::unique_ptr<WorkItem>(item));
+        queue.push_back(Entry{std::unique_ptr<WorkItem>(item), GetTimeMicros()});
         cond.notify_one();
         return true;
     }
@@ -104,16 +142,27 @@ public:
     {
         while (true) {
             std::unique_ptr<WorkItem> i;
+            int64_t start;
             {
                 WAIT_LOCK(cs, lock);
                 while (running && queue.empty())
                     cond.wait(lock);
                 if (!running)
                     break;
-                i = std::move(queue.front());
+                i = std::move(queue.front().item);
+                start = GetTimeMicros();
+                int64_t wait = start - queue.front().enqueued;
+                // Counted together, so long running requests do not skew the average wait
+                ++started;
+                totalWaitMicros += wait;
+                maxWaitMicros = std::max(maxWaitMicros, wait);
                 queue.pop_front();
             }
             (*i)();
+            int64_t exec = GetTimeMicros() - start;
+            LOCK(cs);
+            ++processed;
+            totalExecMicros += exec;
         }
     }
     /** Interrupt and exit loops */
@@ -123,17 +172,38 @@ public:
         running = false;
         cond.notify_all();
     }
+    /** Fill in the counters of this queue */
+    void GetStats(HTTPWorkQueueStats& stats)
+    {
+        LOCK(cs);
+        stats.depth = queue.size();
+        stats.maxDepth = maxDepth;
+        stats.started = started;
+        stats.processed = processed;
+        stats.rejected = rejected;
+        stats.totalWaitMicros = totalWaitMicros;
+        stats.maxWaitMicros = maxWaitMicros;
+        stats.totalExecMicros = totalExecMicros;
+    }
 };
 
 struct HTTPPathHandler
 {
-    HTTPPathHandler(std::string _prefix, bool _exactMatch, HTTPRequestHandler _handler):
-        prefix(_prefix), exactMatch(_exactMatch), handler(_handler)
+    HTTPPathHandler(std::string _prefix, bool _exactMatch, HTTPRequestHandler _handler, HTTPQueueSelector _selector):
+        prefix(_prefix), exactMatch(_exactMatch), handler(_handler), selector(_selector)
     {
     }
     std::string prefix;
     bool exactMatch;
     HTTPRequestHandler handler;
+    HTTPQueueSelector selector;
+};
+
+/** Named work queue and the number of worker threads serving it */
+struct HTTPNamedWorkQueue
+{
+    WorkQueue<HTTPClosure>* queue;
+    int threads;
 };
 
 /** HTTP module state */
@@ -146,6 +216,8 @@ static struct evhttp* eventHTTP = nullptr;
 static std::vector<CSubNet> rpc_allow_subnets;
 //! Work queue for handling longer requests off the event loop thread
 static WorkQueue<HTTPClosure>* workQueue = nullptr;
+//! All work queues by name, including workQueue. Only changed before the server starts
+static std::map<std::string, HTTPNamedWorkQueue> g_work_queues;
 //! Handlers for (sub)paths
 static std::vector<HTTPPathHandler> pathHandlers;
 //! Bound listening sockets
@@ -211,6 +283,22 @@ static std::string RequestMethodString(HTTPRequest::RequestMethod m)
     }
 }
 
+/** Re-enable reading from the socket after a reply was sent. This is the
+ * second part of the libevent workaround in http_request_cb.
+ */
+static void http_reenable_read(struct evhttp_request* req)
+{
+    if (event_get_version_number() >= 0x02010600 && event_get_version_number() < 0x02020001) {
+        evhttp_connection* conn = evhttp_request_get_connection(req);
+        if (conn) {
+            bufferevent* bev = evhttp_connection_get_bufferevent(conn);
+            if (bev) {
+                bufferevent_enable(bev, EV_READ | EV_WRITE);
+            }
+        }
+    }
+}
+
 /** HTTP request callback */
 static void http_request_cb(struct evhttp_request* req, void* arg)
 {
@@ -264,12 +352,21 @@ static void http_request_cb(struct evhttp_request* req, void* arg)
 
     // Dispatch to worker thread
     if (i != iend) {
-        std::unique_ptr<HTTPWorkItem> item(new HTTPWorkItem(std::move(hreq), path, i->handler));
         assert(workQueue);
-        if (workQueue->Enqueue(item.get()))
+        WorkQueue<HTTPClosure>* queue = workQueue;
+        std::string queueName = HTTP_DEFAULT_WORKQUEUE;
+        if (i->selector) {
+            auto it = g_work_queues.find(i->selector(hreq.get()));
+            if (it != g_work_queues.end()) {
+                queue = it->second.queue;
+                queueName = it->first;
+            }
+        }
+        std::unique_ptr<HTTPWorkItem> item(new HTTPWorkItem(std::move(hreq), path, i->handler));
+        if (queue->Enqueue(item.get()))
             item.release(); /* if true, queue took ownership */
         else {
-            LogPrintf("WARNING: request rejected because http work queue depth exceeded, it can be increased with the -rpcworkqueue= setting\n");
+            LogPrintf("WARNING: request rejected because http work queue %s depth exceeded, it can be increased with the -rpcworkqueue= or -rpcqueue= setting\n", queueName);
             item->req->WriteReply(HTTP_INTERNAL, "Work queue depth exceeded");
         }
     } else {
@@ -338,9 +435,9 @@ static bool HTTPBindAddresses(struct evhttp* http)
 }
 
 /** Simple wrapper to set thread name and run work queue */
-static void HTTPWorkQueueRun(WorkQueue<HTTPClosure>* queue, int worker_num)
+static void HTTPWorkQueueRun(WorkQueue<HTTPClosure>* queue, std::string thread_name)
 {
-    util::ThreadRename(strprintf("httpworker.%i", worker_num));
+    util::ThreadRename(std::move(thread_name));
     queue->Run();
 }
 
@@ -402,6 +499,8 @@ bool InitHTTPServer()
     LogPrintf("HTTP: creating work queue of depth %d\n", workQueueDepth);
 
     workQueue = new WorkQueue<HTTPClosure>(workQueueDepth);
+    int rpcThreads = std::max((long)gArgs.GetArg("-rpcthreads", DEFAULT_HTTP_THREADS), 1L);
+    g_work_queues[HTTP_DEFAULT_WORKQUEUE] = HTTPNamedWorkQueue{workQueue, rpcThreads};
     // transfer ownership to eventBase/HTTP via .release()
     eventBase = base_ctr.release();
     eventHTTP = http_ctr.release();
@@ -428,13 +527,40 @@ static std::vector<std::thread> g_thread_http_workers;
 void StartHTTPServer()
 {
     LogPrint(BCLog::HTTP, "Starting HTTP server\n");
-    int rpcThreads = std::max((long)gArgs.GetArg("-rpcthreads", DEFAULT_HTTP_THREADS), 1L);
-    LogPrintf("HTTP: starting %d worker threads\n", rpcThreads);
     threadHTTP = std::thread(ThreadHTTP, eventBase);
 
-    for (int i = 0; i < rpcThreads; i++) {
-        g_thread_http_workers.emplace_back(HTTPWorkQueueRun, workQueue, i);
+    for (const auto& entry : g_work_queues) {
+        const bool is_default = entry.second.queue == workQueue;
+        LogPrintf("HTTP: starting %d worker threads for work queue %s\n", entry.second.threads, entry.first);
+        for (int i = 0; i < entry.second.threads; i++) {
+            std::string thread_name = is_default ? strprintf("httpworker.%i", i) : strprintf("httpworker.%s.%i", entry.first, i);
+            g_thread_http_workers.emplace_back(HTTPWorkQueueRun, entry.second.queue, thread_name);
+        }
+    }
+}
+
+bool AddHTTPWorkQueue(const std::string& name, int threads, int depth)
+{
+    assert(workQueue && g_thread_http_workers.empty());
+    if (threads < 1 || depth < 1 || g_work_queues.count(name)) {
+        return false;
     }
+    LogPrintf("HTTP: creating work queue %s of depth %d\n", name, depth);
+    g_work_queues[name] = HTTPNamedWorkQueue{new WorkQueue<HTTPClosure>(depth), threads};
+    return true;
+}
+
+std::vector<HTTPWorkQueueStats> GetHTTPWorkQueueStats()
+{
+    std::vector<HTTPWorkQueueStats> result;
+    for (const auto& entry : g_work_queues) {
+        HTTPWorkQueueStats stats;
+        stats.name = entry.first;
+        stats.threads = entry.second.threads;
+        entry.second.queue->GetStats(stats);
+        result.push_back(stats);
+    }
+    return result;
 }
 
 void InterruptHTTPServer()
@@ -444,8 +570,9 @@ void InterruptHTTPServer()
         // Reject requests on current connections
         evhttp_set_gencb(eventHTTP, http_reject_request_cb, nullptr);
     }
-    if (workQueue)
-        workQueue->Interrupt();
+    for (const auto& entry : g_work_queues) {
+        entry.second.queue->Interrupt();
+    }
 }
 
 void StopHTTPServer()
@@ -457,7 +584,10 @@ void StopHTTPServer()
             thread.join();
         }
         g_thread_http_workers.clear();
-        delete workQueue;
+        for (const auto& entry : g_work_queues) {
+            delete entry.second.queue;
+        }
+        g_work_queues.clear();
         workQueue = nullptr;
     }
     // Unlisten sockets, these are what make the event loop running, which means
@@ -486,6 +616,17 @@ struct event_base* EventBase()
     return eventBase;
 }
 
+bool QueueHTTPWork(const std::function<void()>& func)
+{
+    if (!workQueue)
+        return false;
+    std::unique_ptr<HTTPFunctionItem> item(new HTTPFunctionItem(func));
+    if (!workQueue->Enqueue(item.get()))
+        return false;
+    item.release(); /* queue took ownership */
+    return true;
+}
+
 static void httpevent_callback_fn(evutil_socket_t, short, void* data)
 {
     // Static handler: simply call inner handler
@@ -518,11 +659,18 @@ void HTTPEvent::trigger(struct timeval* tv)
 HTTPRequest::HTTPRequest(struct evhttp_request* _req) : req(_req),
                                                         replySent(false),
                                                         startedChunkTransfer(false),
-                                                        connClosed(false)
+                                                        startedStream(false),
+                                                        connClosed(false),
+                                                        streamPending(0),
+                                                        streamHandedOff(0)
 {
 }
 HTTPRequest::~HTTPRequest()
 {
+    if (startedStream && !replySent) {
+        // Handler gave up half way, terminate the chunked reply
+        StreamEnd();
+    }
     if (!replySent && !startedChunkTransfer) {
         // Keep track of whether reply was sent to avoid request leaks
         LogPrintf("%s: Unhandled request\n", __func__);
@@ -602,6 +750,19 @@ std::pair<bool, std::string> HTTPRequest::GetHeader(const std::string& hdr) cons
         return std::make_pair(false, "");
 }
 
+std::string HTTPRequest::PeekBody(size_t maxSize) const
+{
+    struct evbuffer* buf = evhttp_request_get_input_buffer(req);
+    if (!buf)
+        return "";
+    std::string rv(std::min(evbuffer_get_length(buf), maxSize), '\0');
+    if (rv.empty())
+        return rv;
+    ev_ssize_t copied = evbuffer_copyout(buf, &rv[0], rv.size());
+    rv.resize(copied < 0 ? 0 : copied);
+    return rv;
+}
+
 std::string HTTPRequest::ReadBody()
 {
     struct evbuffer* buf = evhttp_request_get_input_buffer(req);
@@ -676,6 +837,100 @@ void HTTPRequest::Chunk(const std::string& chunk) {
     }
 }
 
+bool HTTPRequest::StreamChunk(const std::string& chunk)
+{
+    assert(!replySent && !startedChunkTransfer && req);
+
+    if (!startedStream) {
+        HTTPEvent* ev = new HTTPEvent(eventBase, true, nullptr, [this]{
+            // This request outlives the connection callback: StreamEnd clears it
+            // on the event thread before the request is destroyed.
+            evhttp_connection_set_closecb(evhttp_request_get_connection(req), [](struct evhttp_connection*, void* data) {
+                static_cast<HTTPRequest*>(data)->setConnClosed();
+            }, this);
+            evhttp_send_reply_start(req, HTTP_OK, nullptr);
+        });
+        ev->trigger(nullptr);
+        startedStream = true;
+    }
+
+    std::unique_lock<std::mutex> lock(cs);
+    // Wait for the client to catch up before queueing more output
+    while (streamPending > HTTP_STREAM_MAX_PENDING && !connClosed && IsRPCRunning()) {
+        closeCv.wait_for(lock, std::chrono::milliseconds(500));
+    }
+    if (connClosed || !IsRPCRunning()) {
+        return false;
+    }
+    if (chunk.empty()) {
+        return true;
+    }
+    streamPending += chunk.size();
+    lock.unlock();
+
+    auto databuf = evbuffer_new(); // HTTPEvent will free this buffer
+    evbuffer_add(databuf, chunk.data(), chunk.size());
+    size_t size = chunk.size();
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, databuf, [this, databuf, size]{
+        // The client went away, drop the output
+        if (isConnClosed()) return;
+        {
+            std::lock_guard<std::mutex> lock(cs);
+            streamHandedOff += size;
+        }
+#if LIBEVENT_VERSION_NUMBER >= 0x02010100
+        evhttp_send_reply_chunk_with_cb(req, databuf, [](struct evhttp_connection*, void* data) {
+            static_cast<HTTPRequest*>(data)->streamDrained();
+        }, this);
+#else
+        evhttp_send_reply_chunk(req, databuf);
+        streamDrained();
+#endif
+    });
+    ev->trigger(nullptr);
+    return true;
+}
+
+void HTTPRequest::streamDrained()
+{
+    // Everything handed to libevent so far has been written to the socket
+    std::lock_guard<std::mutex> lock(cs);
+    streamPending -= streamHandedOff;
+    streamHandedOff = 0;
+    closeCv.notify_all();
+}
+
+void HTTPRequest::StreamEnd()
+{
+    assert(!replySent && !startedChunkTransfer && req);
+    if (!startedStream) {
+        // Nothing was written, still send the status line and headers
+        StreamChunk(std::string());
+    }
+
+    bool ended = false;
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, nullptr, [this, &ended]{
+        evhttp_connection* conn = evhttp_request_get_connection(req);
+        if (conn) {
+            evhttp_connection_set_closecb(conn, nullptr, nullptr);
+            http_reenable_read(req);
+        }
+        // Also frees the request if the connection was already closed
+        evhttp_send_reply_end(req);
+        std::lock_guard<std::mutex> lock(cs);
+        ended = true;
+        closeCv.notify_all();
+    });
+    ev->trigger(nullptr);
+
+    // The event thread keeps running until all workers have exited, so this
+    // always completes. Wait for it as the event refers to this request.
+    std::unique_lock<std::mutex> lock(cs);
+    closeCv.wait(lock, [&ended]{ return ended; });
+    replySent = true;
+    req = nullptr; // transferred back to main thread
+}
+
 /** Closure sent to main thread to request a reply to be sent to
  * a HTTP request.
  * Replies must be sent in the main loop in the main http thread,
@@ -694,17 +949,7 @@ void HTTPRequest::WriteReply(int nStatus, const std::string& strReply)
     auto req_copy = req;
     HTTPEvent* ev = new HTTPEvent(eventBase, true, nullptr, [req_copy, nStatus]{
         evhttp_send_reply(req_copy, nStatus, nullptr, nullptr);
-        // Re-enable reading from the socket. This is the second part of the libevent
-        // workaround above.
-        if (event_get_version_number() >= 0x02010600 && event_get_version_number() < 0x02020001) {
-            evhttp_connection* conn = evhttp_request_get_connection(req_copy);
-            if (conn) {
-                bufferevent* bev = evhttp_connection_get_bufferevent(conn);
-                if (bev) {
-                    bufferevent_enable(bev, EV_READ | EV_WRITE);
-                }
-            }
-        }
+        http_reenable_read(req_copy);
     });
     ev->trigger(nullptr);
     replySent = true;
@@ -751,10 +996,10 @@ HTTPRequest::RequestMethod HTTPRequest::GetRequestMethod() const
     }
 }
 
-void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler)
+void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler, const HTTPQueueSelector &selector)
 {
     LogPrint(BCLog::HTTP, "Registering HTTP handler for %s (exactmatch %d)\n", prefix, exactMatch);
-    pathHandlers.push_back(HTTPPathHandler(prefix, exactMatch, handler));
+    pathHandlers.push_back(HTTPPathHandler(prefix, exactMatch, handler, selector));
 }
 
 void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch)
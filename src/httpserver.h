@@ -8,12 +8,16 @@
 #include <string>
 #include <stdint.h>
 #include <functional>
+#include <memory>
 #include <mutex>
 #include <condition_variable>
+#include <vector>
 
 static const int DEFAULT_HTTP_THREADS=4;
 static const int DEFAULT_HTTP_WORKQUEUE=16;
 static const int DEFAULT_HTTP_SERVER_TIMEOUT=30;
+/** Maximum number of bytes of a streamed reply that may be waiting to be written to the client */
+static const size_t HTTP_STREAM_MAX_PENDING=1024*1024;
 
 struct evhttp_request;
 struct event_base;
@@ -40,11 +44,16 @@ bool UpdateHTTPServerLogging(bool enable);
 
 /** Handler for requests to a certain HTTP path */
 typedef std::function<bool(HTTPRequest* req, const std::string &)> HTTPRequestHandler;
+/** Picks the name of the work queue that runs a request, or an empty string
+ * for the default queue. Called on the event thread, so it must be cheap and
+ * must not consume the request body.
+ */
+typedef std::function<std::string(HTTPRequest* req)> HTTPQueueSelector;
 /** Register handler for prefix.
  * If multiple handlers match a prefix, the first-registered one will
  * be invoked.
  */
-void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler);
+void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler, const HTTPQueueSelector &selector = nullptr);
 /** Unregister handler for prefix */
 void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch);
 
@@ -53,22 +62,64 @@ void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch);
  */
 struct event_base* EventBase();
 
+/** Name of the work queue sized by -rpcthreads and -rpcworkqueue */
+static const char* const HTTP_DEFAULT_WORKQUEUE = "default";
+
+/** Add a work queue with its own worker threads, to be picked by a
+ * HTTPQueueSelector. Call between InitHTTPServer and StartHTTPServer.
+ * Returns false if the name is taken or the sizes are invalid.
+ */
+bool AddHTTPWorkQueue(const std::string& name, int threads, int depth);
+
+/** Depth and latency counters of a work queue */
+struct HTTPWorkQueueStats
+{
+    std::string name;
+    int threads;
+    //! Requests waiting for a worker, and the limit
+    size_t depth;
+    size_t maxDepth;
+    //! Requests taken by a worker, and those it finished
+    uint64_t started;
+    uint64_t processed;
+    //! Requests refused because the queue was full
+    uint64_t rejected;
+    //! Time spent waiting in the queue, and running
+    int64_t totalWaitMicros;
+    int64_t maxWaitMicros;
+    int64_t totalExecMicros;
+};
+
+std::vector<HTTPWorkQueueStats> GetHTTPWorkQueueStats();
+
+/** Run a function on the HTTP worker threads. This can be used to finish
+ * requests that were parked by their handler.
+ * Returns false if the work queue is full or not running.
+ */
+bool QueueHTTPWork(const std::function<void()>& func);
+
 /** In-flight HTTP request.
  * Thin C++ wrapper around evhttp_request.
+ * Owned through a shared_ptr by the work item that runs its handler, so a
+ * handler can keep it alive past its return with shared_from_this().
  */
-class HTTPRequest
+class HTTPRequest : public std::enable_shared_from_this<HTTPRequest>
 {
 private:
     struct evhttp_request* req;
     bool replySent;
     bool startedChunkTransfer;
+    bool startedStream;
     bool connClosed;
+    size_t streamPending;
+    size_t streamHandedOff;
 
     std::mutex cs;
     std::condition_variable closeCv;
 
     void startDetectClientClose();
     void waitClientClose();
+    void streamDrained();
 
 public:
     explicit HTTPRequest(struct evhttp_request* req);
@@ -112,6 +163,12 @@ public:
      */
     std::string ReadBody();
 
+    /**
+     * Return up to maxSize bytes from the start of the request body without
+     * consuming them.
+     */
+    std::string PeekBody(size_t maxSize) const;
+
     /**
      * Write output header.
      *
@@ -139,6 +196,21 @@ public:
 	 */
     void ChunkEnd();
 
+    /**
+     * Write the next part of a streamed reply. The first call sends status 200
+     * with the headers written so far and switches to chunked transfer encoding.
+     * Blocks while more than HTTP_STREAM_MAX_PENDING bytes are still waiting to
+     * be written to the client, so memory used by the reply stays bounded.
+     * Returns false if the client went away or the server is shutting down.
+     */
+    bool StreamChunk(const std::string& chunk);
+
+    /**
+     * End a streamed reply. Unlike ChunkEnd this does not wait for the client
+     * to close the connection, so it may be kept alive for further requests.
+     */
+    void StreamEnd();
+
     /**
      * Is reply sent?
      */
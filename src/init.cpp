@@ -16,6 +16,7 @@
 #include <chain.h>
 #include <chainparams.h>
 #include <checkpointsync.h>
+#include <checkqueue.h>
 #include <compat/sanity.h>
 #include <consensus/validation.h>
 #include <fs.h>
@@ -105,6 +106,7 @@ std::unique_ptr<BanMan> g_banman;
 #endif
 
 static const char* FEE_ESTIMATES_FILENAME="fee_estimates.dat";
+static const char* GAS_ESTIMATES_FILENAME="gas_estimates.dat";
 
 /**
  * The PID file facilities.
@@ -195,6 +197,7 @@ void Shutdown(InitInterfaces& interfaces)
     StopHTTPRPC();
     StopREST();
     StopRPC();
+    StopWaitForLogs();
     StopHTTPServer();
     for (const auto& client : interfaces.chain_clients) {
         client->flush();
@@ -214,6 +217,7 @@ void Shutdown(InitInterfaces& interfaces)
     // CScheduler/checkqueue threadGroup
     threadGroup.interrupt_all();
     threadGroup.join_all();
+    StopBlockPipelineThreads();
 
     // After the threads that potentially access these pointers have been stopped,
     // destruct and reset all to nullptr.
@@ -236,6 +240,12 @@ void Shutdown(InitInterfaces& interfaces)
             ::feeEstimator.Write(est_fileout);
         else
             LogPrintf("%s: Failed to write fee estimates to %s\n", __func__, est_path.string());
+        fs::path gas_est_path = GetDataDir() / GAS_ESTIMATES_FILENAME;
+        CAutoFile gas_est_fileout(fsbridge::fopen(gas_est_path, "wb"), SER_DISK, CLIENT_VERSION);
+        if (!gas_est_fileout.IsNull())
+            ::feeEstimator.WriteGasPrices(gas_est_fileout);
+        else
+            LogPrintf("%s: Failed to write gas price estimates to %s\n", __func__, gas_est_path.string());
         fFeeEstimatesInitialized = false;
     }
 
@@ -268,6 +278,10 @@ void Shutdown(InitInterfaces& interfaces)
         }
         pblocktree.reset();
         pstorageresult.reset();
+        if (globalState) {
+            UnregisterLevelDB(globalState->db().db());
+            UnregisterLevelDB(globalState->dbUtxo().db());
+        }
         globalState.reset();
         globalSealEngine.reset();
     }
@@ -375,15 +389,20 @@ void SetupServerArgs()
 #if HAVE_SYSTEM
     gArgs.AddArg("-blocknotify=<cmd>", "Execute command when the best block changes (%s in cmd is replaced by block hash)", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
 #endif
+    gArgs.AddArg("-blockprefetch=<n>", strprintf("Number of blocks to read from disk ahead of the tip during initial block download (0 to %d, default: %d)", MAX_BLOCK_PREFETCH, DEFAULT_BLOCK_PREFETCH), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-blockreconstructionextratxn=<n>", strprintf("Extra transactions to keep in memory for compact block reconstructions (default: %u)", DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-blocksonly", strprintf("Whether to reject transactions from network peers. Transactions from the wallet, RPC and relay whitelisted inbound peers are not affected. (default: %u)", DEFAULT_BLOCKSONLY), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-coinprefetchthreads=<n>", strprintf("Number of threads looking up the inputs of upcoming blocks in the coin database (0 to %d, default: %d)", MAX_COIN_PREFETCH_THREADS, DEFAULT_COIN_PREFETCH_THREADS), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-coinsmap=<type>", strprintf("Hash table used by the coin caches, one of: unordered, flat (default: %s)", DEFAULT_COINSMAP), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-conf=<file>", strprintf("Specify configuration file. Relative paths will be prefixed by datadir location. (default: %s)", BITCOIN_CONF_FILENAME), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-datadir=<dir>", "Specify data directory", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-dbbatchsize", strprintf("Maximum database write batch size in bytes (default: %u)", nDefaultDbBatchSize), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-dbprofile=<db>:<setting>=<value>,...", "Change LevelDB settings of the database <db> (chainstate, index, txindex, resultsDB, ...). Settings: compression=0|1 (default: 0, needs LevelDB built with Snappy), writebuffer=<percent of the cache per write buffer> (default: 25), bloombits=<bits per key, 0 for none> (default: 10), maxfilesize=<KiB> (default: 2048), blocksize=<KiB> (default: 4). Can be specified multiple times", ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-dbcache=<n>", strprintf("Maximum database cache size <n> MiB (%d to %d, default: %d). In addition, unused mempool memory is shared for this cache (see -maxmempool).", nMinDbCache, nMaxDbCache, nDefaultDbCache), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-debuglogfile=<file>", strprintf("Specify location of debug log file. Relative paths will be prefixed by a net-specific datadir location. (-nodebuglogfile to disable; default: %s)", DEFAULT_DEBUGLOGFILE), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-feefilter", strprintf("Tell other nodes to filter invs to us by our mempool min fee (default: %u)", DEFAULT_FEEFILTER), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-includeconf=<file>", "Specify additional configuration file, relative to the -datadir path (only useable from configuration file, not command line)", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-incrementalflush", strprintf("Write modified coins to the coin database in the background when the coins cache fills up, and keep the unmodified ones cached (default: %u)", DEFAULT_INCREMENTAL_FLUSH), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-loadblock=<file>", "Imports blocks from external blk000??.dat file on startup", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-maxmempool=<n>", strprintf("Keep the transaction memory pool below <n> megabytes (default: %u)", DEFAULT_MAX_MEMPOOL_SIZE), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-maxorphantx=<n>", strprintf("Keep at most <n> unconnectable transactions in memory (default: %u)", DEFAULT_MAX_ORPHAN_TRANSACTIONS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
@@ -391,6 +410,8 @@ void SetupServerArgs()
     gArgs.AddArg("-minimumchainwork=<hex>", strprintf("Minimum work assumed to exist on a valid chain in hex (default: %s, testnet: %s)", defaultChainParams->GetConsensus().nMinimumChainWork.GetHex(), testnetChainParams->GetConsensus().nMinimumChainWork.GetHex()), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-par=<n>", strprintf("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)",
         -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-checkqueue=<mode>", strprintf("How script checks are handed to the verification threads, one of: shared, stealing (default: %s). stealing gives every thread its own queue and lets idle threads take work from the others", DEFAULT_CHECKQUEUE), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-parallelaccept", strprintf("Verify the scripts of transactions relayed by peers on the script verification threads, outside the validation lock, together with those arriving from other peers at the same time (default: %u)", DEFAULT_PARALLEL_ACCEPT), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-persistmempool", strprintf("Whether to save the mempool on shutdown and load on restart (default: %u)", DEFAULT_PERSIST_MEMPOOL), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-pid=<file>", strprintf("Specify pid file. Relative paths will be prefixed by a net-specific datadir location. (default: %s)", BITCOIN_PID_FILENAME), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-prune=<n>", strprintf("Reduce storage requirements by enabling pruning (deleting) of old blocks. This allows the pruneblockchain RPC to be called to delete specific blocks, and enables automatic pruning of old blocks if a target size in MiB is provided. This mode is incompatible with -txindex and -rescan. "
@@ -399,6 +420,7 @@ void SetupServerArgs()
     gArgs.AddArg("-reindex", "Rebuild chain state and block index from the blk*.dat files on disk", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-reindex-chainstate", "Rebuild chain state from the currently indexed blocks. When in pruning mode or if blocks on disk might be corrupted, use full -reindex instead.", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-record-log-opcodes", "Logs all EVM LOG opcode operations to the file vmExecLogs.json", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    gArgs.AddArg("-sigbatchsize=<n>", strprintf("Verify the signatures of up to <n> single-signature inputs of a block together, sharing part of the work (0 to %d, 0 = off, default: %d)", MAX_SIGNATURE_BATCH_SIZE, DEFAULT_SIGNATURE_BATCH_SIZE), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
 #ifndef WIN32
     gArgs.AddArg("-sysperms", "Create new files with system default permissions, instead of umask 077 (only effective with disabled wallet functionality)", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
 #else
@@ -433,6 +455,7 @@ void SetupServerArgs()
     gArgs.AddArg("-maxsendbuffer=<n>", strprintf("Maximum per-connection send buffer, <n>*1000 bytes (default: %u)", DEFAULT_MAXSENDBUFFER), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     gArgs.AddArg("-maxtimeadjustment", strprintf("Maximum allowed median peer time offset adjustment. Local perspective of time may be influenced by peers forward or backward by this amount. (default: %u seconds)", DEFAULT_MAX_TIME_ADJUSTMENT), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     gArgs.AddArg("-maxuploadtarget=<n>", strprintf("Tries to keep outbound traffic under the given target (in MiB per 24h), 0 = no limit (default: %d)", DEFAULT_MAX_UPLOAD_TARGET), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
+    gArgs.AddArg("-msghandlerthreads=<n>", strprintf("Number of threads processing peer messages; each peer is always served by the same thread (1 to %d, default: %d)", MAX_MSG_HANDLER_THREADS, DEFAULT_MSG_HANDLER_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     gArgs.AddArg("-onion=<ip:port>", "Use separate SOCKS5 proxy to reach peers via Tor hidden services, set -noonion to disable (default: -proxy)", ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     gArgs.AddArg("-onlynet=<net>", "Make outgoing connections only through network <net> (ipv4, ipv6 or onion). Incoming connections are not affected by this option. This option can be specified multiple times to allow multiple networks.", ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     gArgs.AddArg("-peerbloomfilters", strprintf("Support filtering of blocks and transaction with bloom filters (default: %u)", DEFAULT_PEERBLOOMFILTERS), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
@@ -441,6 +464,7 @@ void SetupServerArgs()
     gArgs.AddArg("-proxy=<ip:port>", "Connect through SOCKS5 proxy, set -noproxy to disable (default: disabled)", ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     gArgs.AddArg("-proxyrandomize", strprintf("Randomize credentials for every proxy connection. This enables Tor stream isolation (default: %u)", DEFAULT_PROXYRANDOMIZE), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     gArgs.AddArg("-seednode=<ip>", "Connect to a node to retrieve peer addresses, and disconnect. This option can be specified multiple times to connect to multiple nodes.", ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
+    gArgs.AddArg("-socketevents=<mode>", strprintf("Mechanism used to wait for socket events, one of: %s (default: %s). epoll scales to large numbers of mostly idle connections", GetSupportedSocketEventsModes(), DEFAULT_SOCKETEVENTS), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     gArgs.AddArg("-timeout=<n>", strprintf("Specify connection timeout in milliseconds (minimum: 1, default: %d)", DEFAULT_CONNECT_TIMEOUT), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     gArgs.AddArg("-peertimeout=<n>", strprintf("Specify p2p connection timeout in seconds. This option determines the amount of time a peer may be inactive before the connection to it is dropped. (minimum: 1, default: %d)", DEFAULT_PEER_CONNECT_TIMEOUT), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::CONNECTION);
     gArgs.AddArg("-torcontrol=<ip>:<port>", strprintf("Tor control port to use if onion listening enabled (default: %s)", DEFAULT_TOR_CONTROL), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
@@ -476,19 +500,27 @@ void SetupServerArgs()
     gArgs.AddArg("-zmqpubhashtx=<address>", "Enable publish hash transaction in <address>", ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
     gArgs.AddArg("-zmqpubrawblock=<address>", "Enable publish raw block in <address>", ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
     gArgs.AddArg("-zmqpubrawtx=<address>", "Enable publish raw transaction in <address>", ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubcontractlogs=<address>", "Enable publish contract event logs in <address> (requires -logevents)", ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubreceipt=<address>", "Enable publish contract transaction receipts in <address> (requires -logevents)", ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
     gArgs.AddArg("-zmqpubhashblockhwm=<n>", strprintf("Set publish hash block outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
     gArgs.AddArg("-zmqpubhashtxhwm=<n>", strprintf("Set publish hash transaction outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
     gArgs.AddArg("-zmqpubrawblockhwm=<n>", strprintf("Set publish raw block outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
     gArgs.AddArg("-zmqpubrawtxhwm=<n>", strprintf("Set publish raw transaction outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubcontractlogshwm=<n>", strprintf("Set publish contract event logs outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
+    gArgs.AddArg("-zmqpubreceipthwm=<n>", strprintf("Set publish contract transaction receipts outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
 #else
     hidden_args.emplace_back("-zmqpubhashblock=<address>");
     hidden_args.emplace_back("-zmqpubhashtx=<address>");
     hidden_args.emplace_back("-zmqpubrawblock=<address>");
     hidden_args.emplace_back("-zmqpubrawtx=<address>");
+    hidden_args.emplace_back("-zmqpubcontractlogs=<address>");
+    hidden_args.emplace_back("-zmqpubreceipt=<address>");
     hidden_args.emplace_back("-zmqpubhashblockhwm=<n>");
     hidden_args.emplace_back("-zmqpubhashtxhwm=<n>");
     hidden_args.emplace_back("-zmqpubrawblockhwm=<n>");
     hidden_args.emplace_back("-zmqpubrawtxhwm=<n>");
+    hidden_args.emplace_back("-zmqpubcontractlogshwm=<n>");
+    hidden_args.emplace_back("-zmqpubreceipthwm=<n>");
 #endif
 
     gArgs.AddArg("-checkblocks=<n>", strprintf("How many blocks to check at startup (default: %u, 0 = all)", DEFAULT_CHECKBLOCKS), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
@@ -565,6 +597,7 @@ void SetupServerArgs()
     gArgs.AddArg("-rpcport=<port>", strprintf("Listen for JSON-RPC connections on <port> (default: %u, testnet: %u, regtest: %u)", defaultBaseParams->RPCPort(), testnetBaseParams->RPCPort(), regtestBaseParams->RPCPort()), ArgsManager::ALLOW_ANY | ArgsManager::NETWORK_ONLY, OptionsCategory::RPC);
     gArgs.AddArg("-rpcserialversion", strprintf("Sets the serialization of raw transaction or block hex returned in non-verbose mode, non-segwit(0) or segwit(1) (default: %d)", DEFAULT_RPC_SERIALIZE_VERSION), ArgsManager::ALLOW_ANY, OptionsCategory::RPC);
     gArgs.AddArg("-rpcservertimeout=<n>", strprintf("Timeout during HTTP requests (default: %d)", DEFAULT_HTTP_SERVER_TIMEOUT), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::RPC);
+    gArgs.AddArg("-rpcqueue=<name>:<threads>:<depth>:<methods>", strprintf("Run the comma separated RPC methods on their own work queue, so they can not hold up other calls. Can be specified multiple times, 0 threads disables a queue (default: %s:%d:%d:%s and %s:%d:%d:%s)", RPC_BLOCKING_WORKQUEUE, DEFAULT_RPC_BLOCKING_THREADS, DEFAULT_RPC_BLOCKING_WORKQUEUE, DEFAULT_RPC_BLOCKING_METHODS, RPC_SCAN_WORKQUEUE, DEFAULT_RPC_SCAN_THREADS, DEFAULT_RPC_SCAN_WORKQUEUE, DEFAULT_RPC_SCAN_METHODS), ArgsManager::ALLOW_ANY, OptionsCategory::RPC);
     gArgs.AddArg("-rpcthreads=<n>", strprintf("Set the number of threads to service RPC calls (default: %d)", DEFAULT_HTTP_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::RPC);
     gArgs.AddArg("-rpcuser=<user>", "Username for JSON-RPC connections", ArgsManager::ALLOW_ANY, OptionsCategory::RPC);
     gArgs.AddArg("-rpcworkqueue=<n>", strprintf("Set the depth of the work queue to service RPC calls (default: %d)", DEFAULT_HTTP_WORKQUEUE), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::RPC);
@@ -702,6 +735,7 @@ void DeleteBlockChainData()
     fs::remove_all(GetDataDir() / "stateQtum");
     fs::remove(GetDataDir() / "banlist.dat");
     fs::remove(GetDataDir() / FEE_ESTIMATES_FILENAME);
+    fs::remove(GetDataDir() / GAS_ESTIMATES_FILENAME);
     fs::remove(GetDataDir() / "mempool.dat");
 }
 
@@ -915,6 +949,7 @@ int nUserMaxConnections;
 int nFD;
 ServiceFlags nLocalServices = ServiceFlags(NODE_NETWORK | NODE_NETWORK_LIMITED);
 int64_t peer_connect_timeout;
+SocketEventsMode socket_events_mode;
 std::set<BlockFilterType> g_enabled_filter_types;
 
 } // namespace
@@ -1121,6 +1156,34 @@ bool AppInitParameterInteraction()
         nScriptCheckThreads = 0;
     else if (nScriptCheckThreads > MAX_SCRIPTCHECK_THREADS)
         nScriptCheckThreads = MAX_SCRIPTCHECK_THREADS;
+    nCoinPrefetchThreads = std::max(0, std::min<int>(gArgs.GetArg("-coinprefetchthreads", DEFAULT_COIN_PREFETCH_THREADS), MAX_COIN_PREFETCH_THREADS));
+
+    fIncrementalFlush = gArgs.GetBoolArg("-incrementalflush", DEFAULT_INCREMENTAL_FLUSH);
+    fParallelAccept = gArgs.GetBoolArg("-parallelaccept", DEFAULT_PARALLEL_ACCEPT);
+    nSignatureBatchSize = std::max(0, std::min<int>(gArgs.GetArg("-sigbatchsize", DEFAULT_SIGNATURE_BATCH_SIZE), MAX_SIGNATURE_BATCH_SIZE));
+
+    const std::string check_queue = gArgs.GetArg("-checkqueue", DEFAULT_CHECKQUEUE);
+    if (check_queue == "shared") {
+        SetScriptCheckQueueMode(CheckQueueMode::SHARED);
+    } else if (check_queue == "stealing") {
+        SetScriptCheckQueueMode(CheckQueueMode::WORK_STEALING);
+    } else {
+        return InitError(strprintf(_("Invalid -checkqueue mode '%s' (must be one of: shared, stealing)").translated, check_queue));
+    }
+
+    std::string db_profile_error;
+    if (!CheckDBProfiles(db_profile_error)) {
+        return InitError(db_profile_error);
+    }
+
+    const std::string coins_map = gArgs.GetArg("-coinsmap", DEFAULT_COINSMAP);
+    if (coins_map == "unordered") {
+        CCoinsMap::SetDefaultType(CCoinsMap::Type::UNORDERED);
+    } else if (coins_map == "flat") {
+        CCoinsMap::SetDefaultType(CCoinsMap::Type::FLAT);
+    } else {
+        return InitError(strprintf(_("Invalid -coinsmap type '%s' (must be one of: unordered, flat)").translated, coins_map));
+    }
 
     // block pruning; get the amount of disk space (in MiB) to allot for block & undo files
     int64_t nPruneArg = gArgs.GetArg("-prune", 0);
@@ -1150,6 +1213,11 @@ bool AppInitParameterInteraction()
         return InitError("peertimeout cannot be configured with a negative value.");
     }
 
+    const std::string socket_events = gArgs.GetArg("-socketevents", DEFAULT_SOCKETEVENTS);
+    if (!ParseSocketEventsMode(socket_events, socket_events_mode)) {
+        return InitError(strprintf(_("Invalid -socketevents mode '%s' (must be one of: %s)").translated, socket_events, GetSupportedSocketEventsModes()));
+    }
+
     if (gArgs.IsArgSet("-minrelaytxfee")) {
         CAmount n = 0;
         if (!ParseMoney(gArgs.GetArg("-minrelaytxfee", ""), n)) {
@@ -1388,8 +1456,16 @@ bool AppInitMain(InitInterfaces& interfaces)
     if (nScriptCheckThreads) {
         for (int i=0; i<nScriptCheckThreads-1; i++)
             threadGroup.create_thread([i]() { return ThreadScriptCheck(i); });
+        if (fParallelAccept) {
+            for (int i=0; i<nScriptCheckThreads-1; i++)
+                threadGroup.create_thread([i]() { return ThreadMempoolScriptCheck(i); });
+        }
     }
 
+    int nBlockPrefetch = std::max(0, std::min<int>(gArgs.GetArg("-blockprefetch", DEFAULT_BLOCK_PREFETCH), MAX_BLOCK_PREFETCH));
+    LogPrintf("Reading up to %d blocks ahead during initial block download\n", nBlockPrefetch);
+    StartBlockPipelineThreads(nBlockPrefetch);
+
     // Start the lightweight task scheduler thread
     CScheduler::Function serviceLoop = std::bind(&CScheduler::serviceQueue, &scheduler);
     threadGroup.create_thread(std::bind(&TraceThread<CScheduler::Function>, "scheduler", serviceLoop));
@@ -1619,6 +1695,10 @@ bool AppInitMain(InitInterfaces& interfaces)
                 // fails if it's still open from the previous loop. Close it first:
                 pblocktree.reset();
                 pstorageresult.reset();
+                if (globalState) {
+                    UnregisterLevelDB(globalState->db().db());
+                    UnregisterLevelDB(globalState->dbUtxo().db());
+                }
                 globalState.reset();
                 globalSealEngine.reset();
                 pblocktree.reset(new CBlockTreeDB(nBlockTreeDBCache, false, fReset));
@@ -1727,6 +1807,8 @@ bool AppInitMain(InitInterfaces& interfaces)
                 const dev::h256 hashDB(dev::sha3(dev::rlp("")));
                 dev::eth::BaseState existsQtumstate = fStatus ? dev::eth::BaseState::PreExisting : dev::eth::BaseState::Empty;
                 globalState = std::unique_ptr<QtumState>(new QtumState(dev::u256(0), QtumState::openDB(dirQtum, hashDB, dev::WithExisting::Trust), dirQtum, existsQtumstate));
+                RegisterLevelDB("stateQtum", globalState->db().db());
+                RegisterLevelDB("qtumDB", globalState->dbUtxo().db());
                 dev::eth::ChainParams cp((chainparams.EVMGenesisInfo(dev::eth::Network::qtumMainNetwork)));
                 globalSealEngine = std::unique_ptr<dev::eth::SealEngineFace>(cp.createSealEngine());
 
@@ -1857,8 +1939,12 @@ bool AppInitMain(InitInterfaces& interfaces)
     fs::path est_path = GetDataDir() / FEE_ESTIMATES_FILENAME;
     CAutoFile est_filein(fsbridge::fopen(est_path, "rb"), SER_DISK, CLIENT_VERSION);
     // Allowed to fail as this file IS missing on first startup.
-    if (!est_filein.IsNull())
-        ::feeEstimator.Read(est_filein);
+    if (!est_filein.IsNull() && ::feeEstimator.Read(est_filein)) {
+        fs::path gas_est_path = GetDataDir() / GAS_ESTIMATES_FILENAME;
+        CAutoFile gas_est_filein(fsbridge::fopen(gas_est_path, "rb"), SER_DISK, CLIENT_VERSION);
+        if (!gas_est_filein.IsNull())
+            ::feeEstimator.ReadGasPrices(gas_est_filein);
+    }
     fFeeEstimatesInitialized = true;
 
     // ********************************************************* Step 8: start indexers
@@ -1989,6 +2075,8 @@ bool AppInitMain(InitInterfaces& interfaces)
     connOptions.nMaxOutboundTimeframe = nMaxOutboundTimeframe;
     connOptions.nMaxOutboundLimit = nMaxOutboundLimit;
     connOptions.m_peer_connect_timeout = peer_connect_timeout;
+    connOptions.m_socket_events_mode = socket_events_mode;
+    connOptions.m_msg_handler_threads = gArgs.GetArg("-msghandlerthreads", DEFAULT_MSG_HANDLER_THREADS);
 
     for (const std::string& strBind : gArgs.GetArgs("-bind")) {
         CService addrBind;
@@ -2038,6 +2126,12 @@ bool AppInitMain(InitInterfaces& interfaces)
         g_banman->DumpBanlist();
     }, DUMP_BANS_INTERVAL * 1000);
 
+    scheduler.scheduleEvery([]{
+        LogDBStats();
+    }, DB_STATS_LOG_INTERVAL * 1000);
+
+    StartWaitForLogs(scheduler);
+
     return true;
 }
 
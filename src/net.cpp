@@ -33,6 +33,10 @@
 #include <poll.h>
 #endif
 
+#ifdef USE_EPOLL
+#include <sys/epoll.h>
+#endif
+
 #ifdef USE_UPNP
 #include <miniupnpc/miniupnpc.h>
 #include <miniupnpc/miniwget.h>
@@ -77,6 +81,13 @@ enum BindFlags {
 // The sleep time needs to be small to avoid new sockets stalling
 static const uint64_t SELECT_TIMEOUT_MILLISECONDS = 50;
 
+#ifdef USE_EPOLL
+/** Maximum number of readiness events fetched by one epoll_wait() call */
+static const int EPOLL_MAX_EVENTS = 1024;
+/** Set in the event data of listening sockets, which otherwise carries the index into vhListenSocket */
+static const uint64_t EPOLL_LISTEN_SOCKET_TAG = 1ULL << 63;
+#endif
+
 const std::string NET_MESSAGE_COMMAND_OTHER = "*other*";
 
 static const uint64_t RANDOMIZER_ID_NETGROUP = 0x6c0edd8036ef4036ULL; // SHA256("netgroup")[0:8]
@@ -92,6 +103,37 @@ std::map<CNetAddr, LocalServiceInfo> mapLocalHost GUARDED_BY(cs_mapLocalHost);
 static bool vfLimited[NET_MAX] GUARDED_BY(cs_mapLocalHost) = {};
 std::string strSubVersion;
 
+bool ParseSocketEventsMode(const std::string& str, SocketEventsMode& mode)
+{
+#ifdef USE_POLL
+    if (str == "poll") {
+        mode = SocketEventsMode::POLL;
+        return true;
+    }
+#else
+    if (str == "select") {
+        mode = SocketEventsMode::SELECT;
+        return true;
+    }
+#endif
+#ifdef USE_EPOLL
+    if (str == "epoll") {
+        mode = SocketEventsMode::EPOLL;
+        return true;
+    }
+#endif
+    return false;
+}
+
+std::string GetSupportedSocketEventsModes()
+{
+    std::string modes = DEFAULT_SOCKETEVENTS;
+#ifdef USE_EPOLL
+    modes += ", epoll";
+#endif
+    return modes;
+}
+
 void CConnman::AddOneShot(const std::string& strDest)
 {
     LOCK(cs_vOneShots);
@@ -1003,6 +1045,9 @@ void CConnman::AcceptConnection(const ListenSocket& hListenSocket) {
     {
         LOCK(cs_vNodes);
         vNodes.push_back(pnode);
+#ifdef USE_EPOLL
+        AddSocketEvents(pnode);
+#endif
     }
 }
 
@@ -1029,6 +1074,10 @@ void CConnman::DisconnectNodes()
             {
                 // remove from vNodes
                 vNodes.erase(remove(vNodes.begin(), vNodes.end(), pnode), vNodes.end());
+#ifdef USE_EPOLL
+                m_epoll_nodes.erase(pnode->GetId());
+                m_receivable_nodes.erase(pnode);
+#endif
 
                 // release outbound grant (if any)
                 pnode->grantOutbound.Release();
@@ -1279,6 +1328,64 @@ void CConnman::SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_s
 }
 #endif
 
+bool CConnman::SocketRecvData(CNode *pnode)
+{
+    // typical socket buffer is 8K-64K
+    char pchBuf[0x10000];
+    int nBytes = 0;
+    {
+        LOCK(pnode->cs_hSocket);
+        if (pnode->hSocket == INVALID_SOCKET)
+            return false;
+        nBytes = recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
+    }
+    if (nBytes > 0)
+    {
+        bool notify = false;
+        if (!pnode->ReceiveMsgBytes(pchBuf, nBytes, notify))
+            pnode->CloseSocketDisconnect();
+        RecordBytesRecv(nBytes);
+        if (notify) {
+            size_t nSizeAdded = 0;
+            auto it(pnode->vRecvMsg.begin());
+            for (; it != pnode->vRecvMsg.end(); ++it) {
+                if (!it->complete())
+                    break;
+                nSizeAdded += it->vRecv.size() + CMessageHeader::HEADER_SIZE;
+            }
+            {
+                LOCK(pnode->cs_vProcessMsg);
+                pnode->vProcessMsg.splice(pnode->vProcessMsg.end(), pnode->vRecvMsg, pnode->vRecvMsg.begin(), it);
+                pnode->nProcessQueueSize += nSizeAdded;
+                pnode->fPauseRecv = pnode->nProcessQueueSize > nReceiveFloodSize;
+            }
+            WakeMessageHandler(pnode);
+        }
+        // A short read drained the socket buffer
+        return nBytes == sizeof(pchBuf);
+    }
+    else if (nBytes == 0)
+    {
+        // socket closed gracefully
+        if (!pnode->fDisconnect) {
+            LogPrint(BCLog::NET, "socket closed\n");
+        }
+        pnode->CloseSocketDisconnect();
+    }
+    else if (nBytes < 0)
+    {
+        // error
+        int nErr = WSAGetLastError();
+        if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE && nErr != WSAEINTR && nErr != WSAEINPROGRESS)
+        {
+            if (!pnode->fDisconnect)
+                LogPrintf("socket recv error %s\n", NetworkErrorString(nErr));
+            pnode->CloseSocketDisconnect();
+        }
+    }
+    return false;
+}
+
 void CConnman::SocketHandler()
 {
     std::set<SOCKET> recv_set, send_set, error_set;
@@ -1328,57 +1435,7 @@ void CConnman::SocketHandler()
         }
         if (recvSet || errorSet)
         {
-            // typical socket buffer is 8K-64K
-            char pchBuf[0x10000];
-            int nBytes = 0;
-            {
-                LOCK(pnode->cs_hSocket);
-                if (pnode->hSocket == INVALID_SOCKET)
-                    continue;
-                nBytes = recv(pnode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
-            }
-            if (nBytes > 0)
-            {
-                bool notify = false;
-                if (!pnode->ReceiveMsgBytes(pchBuf, nBytes, notify))
-                    pnode->CloseSocketDisconnect();
-                RecordBytesRecv(nBytes);
-                if (notify) {
-                    size_t nSizeAdded = 0;
-                    auto it(pnode->vRecvMsg.begin());
-                    for (; it != pnode->vRecvMsg.end(); ++it) {
-                        if (!it->complete())
-                            break;
-                        nSizeAdded += it->vRecv.size() + CMessageHeader::HEADER_SIZE;
-                    }
-                    {
-                        LOCK(pnode->cs_vProcessMsg);
-                        pnode->vProcessMsg.splice(pnode->vProcessMsg.end(), pnode->vRecvMsg, pnode->vRecvMsg.begin(), it);
-                        pnode->nProcessQueueSize += nSizeAdded;
-                        pnode->fPauseRecv = pnode->nProcessQueueSize > nReceiveFloodSize;
-                    }
-                    WakeMessageHandler();
-                }
-            }
-            else if (nBytes == 0)
-            {
-                // socket closed gracefully
-                if (!pnode->fDisconnect) {
-                    LogPrint(BCLog::NET, "socket closed\n");
-                }
-                pnode->CloseSocketDisconnect();
-            }
-            else if (nBytes < 0)
-            {
-                // error
-                int nErr = WSAGetLastError();
-                if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE && nErr != WSAEINTR && nErr != WSAEINPROGRESS)
-                {
-                    if (!pnode->fDisconnect)
-                        LogPrintf("socket recv error %s\n", NetworkErrorString(nErr));
-                    pnode->CloseSocketDisconnect();
-                }
-            }
+            SocketRecvData(pnode);
         }
 
         //
@@ -1402,13 +1459,156 @@ void CConnman::SocketHandler()
     }
 }
 
+#ifdef USE_EPOLL
+void CConnman::AddSocketEvents(CNode *pnode)
+{
+    if (m_epoll_fd == -1)
+        return;
+
+    LOCK(pnode->cs_hSocket);
+    if (pnode->hSocket == INVALID_SOCKET)
+        return;
+
+    // Registering reports the current readiness, so anything that arrived or
+    // was queued for sending before this point is not missed.
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    event.data.u64 = pnode->GetId();
+    if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, pnode->hSocket, &event) != 0) {
+        LogPrintf("epoll_ctl failed for peer=%d: %s\n", pnode->GetId(), NetworkErrorString(WSAGetLastError()));
+        pnode->fDisconnect = true;
+        return;
+    }
+    m_epoll_nodes.emplace(pnode->GetId(), pnode);
+}
+
+void CConnman::SocketHandlerEpoll()
+{
+    // Don't block while a node is known to have unread data
+    int timeout = SELECT_TIMEOUT_MILLISECONDS;
+    {
+        LOCK(cs_vNodes);
+        for (const CNode* pnode : m_receivable_nodes) {
+            if (!pnode->fPauseRecv) {
+                timeout = 0;
+                break;
+            }
+        }
+    }
+
+    struct epoll_event events[EPOLL_MAX_EVENTS];
+    int nEvents = epoll_wait(m_epoll_fd, events, EPOLL_MAX_EVENTS, timeout);
+
+    if (interruptNet) return;
+
+    if (nEvents < 0) {
+        int nErr = WSAGetLastError();
+        if (nErr != WSAEINTR) {
+            LogPrintf("socket epoll_wait error %s\n", NetworkErrorString(nErr));
+            interruptNet.sleep_for(std::chrono::milliseconds(SELECT_TIMEOUT_MILLISECONDS));
+        }
+        return;
+    }
+
+    std::vector<size_t> vListenReady;
+    std::vector<CNode*> vRecvNodes;
+    std::vector<CNode*> vSendNodes;
+    {
+        LOCK(cs_vNodes);
+        for (int i = 0; i < nEvents; i++) {
+            const uint64_t tag = events[i].data.u64;
+            if (tag & EPOLL_LISTEN_SOCKET_TAG) {
+                vListenReady.push_back(tag & ~EPOLL_LISTEN_SOCKET_TAG);
+                continue;
+            }
+            auto it = m_epoll_nodes.find(tag);
+            if (it == m_epoll_nodes.end())
+                continue;
+            CNode* pnode = it->second;
+            if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLERR | EPOLLHUP))
+                m_receivable_nodes.insert(pnode);
+            if (events[i].events & EPOLLOUT) {
+                pnode->AddRef();
+                vSendNodes.push_back(pnode);
+            }
+        }
+        for (CNode* pnode : m_receivable_nodes) {
+            if (!pnode->fPauseRecv) {
+                pnode->AddRef();
+                vRecvNodes.push_back(pnode);
+            }
+        }
+
+        // Inactivity timeouts are measured in seconds, so there is no need
+        // to walk every node on each wakeup
+        int64_t nTime = GetSystemTimeInSeconds();
+        if (nTime != m_last_inactivity_check) {
+            m_last_inactivity_check = nTime;
+            for (CNode* pnode : vNodes)
+                InactivityCheck(pnode);
+        }
+    }
+
+    //
+    // Accept new connections
+    //
+    for (size_t i : vListenReady)
+    {
+        AcceptConnection(vhListenSocket[i]);
+    }
+
+    //
+    // Receive once from each node with unread data, round-robin
+    //
+    std::vector<CNode*> vDrained;
+    for (CNode* pnode : vRecvNodes)
+    {
+        if (interruptNet)
+            break;
+        if (!SocketRecvData(pnode))
+            vDrained.push_back(pnode);
+    }
+
+    //
+    // Send whatever is still queued to nodes that became writable again.
+    // Queues only stay non-empty after a short write, which guarantees a
+    // further EPOLLOUT edge once the socket buffer drains.
+    //
+    for (CNode* pnode : vSendNodes)
+    {
+        if (interruptNet)
+            break;
+        LOCK(pnode->cs_vSend);
+        size_t nBytes = SocketSendData(pnode);
+        if (nBytes) {
+            RecordBytesSent(nBytes);
+        }
+    }
+
+    {
+        LOCK(cs_vNodes);
+        for (CNode* pnode : vDrained)
+            m_receivable_nodes.erase(pnode);
+        for (CNode* pnode : vRecvNodes)
+            pnode->Release();
+        for (CNode* pnode : vSendNodes)
+            pnode->Release();
+    }
+}
+#endif
+
 void CConnman::ThreadSocketHandler()
 {
     while (!interruptNet)
     {
         DisconnectNodes();
         NotifyNumConnectionsChanged();
-        SocketHandler();
+#ifdef USE_EPOLL
+        if (m_socket_events_mode == SocketEventsMode::EPOLL)
+            SocketHandlerEpoll();
+        else
+#endif
+            SocketHandler();
     }
 }
 
@@ -1416,9 +1616,29 @@ void CConnman::WakeMessageHandler()
 {
     {
         std::lock_guard<std::mutex> lock(mutexMsgProc);
-        fMsgProcWake = true;
+        std::fill(vMsgProcWake.begin(), vMsgProcWake.end(), true);
+    }
+    condMsgProc.notify_all();
+}
+
+void CConnman::WakeMessageHandler(const CNode* pnode)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutexMsgProc);
+        if (vMsgProcWake.empty())
+            return;
+        vMsgProcWake[GetMsgHandlerShard(pnode)] = true;
     }
-    condMsgProc.notify_one();
+    if (m_msg_handler_threads == 1)
+        condMsgProc.notify_one();
+    else
+        condMsgProc.notify_all();
+}
+
+int CConnman::GetMsgHandlerShard(const CNode* pnode) const
+{
+    // Peers stick to one thread, so their messages are processed in order
+    return pnode->GetId() % m_msg_handler_threads;
 }
 
 
@@ -1972,19 +2192,25 @@ void CConnman::OpenNetworkConnection(const CAddress& addrConnect, bool fCountFai
     {
         LOCK(cs_vNodes);
         vNodes.push_back(pnode);
+#ifdef USE_EPOLL
+        AddSocketEvents(pnode);
+#endif
     }
 }
 
-void CConnman::ThreadMessageHandler()
+void CConnman::ThreadMessageHandler(int shard)
 {
     while (!flagInterruptMsgProc)
     {
         std::vector<CNode*> vNodesCopy;
         {
             LOCK(cs_vNodes);
-            vNodesCopy = vNodes;
-            for (CNode* pnode : vNodesCopy) {
-                pnode->AddRef();
+            vNodesCopy.reserve(vNodes.size() / m_msg_handler_threads + 1);
+            for (CNode* pnode : vNodes) {
+                if (GetMsgHandlerShard(pnode) == shard) {
+                    pnode->AddRef();
+                    vNodesCopy.push_back(pnode);
+                }
             }
         }
 
@@ -2018,9 +2244,9 @@ void CConnman::ThreadMessageHandler()
 
         WAIT_LOCK(mutexMsgProc, lock);
         if (!fMoreWork) {
-            condMsgProc.wait_until(lock, std::chrono::steady_clock::now() + std::chrono::milliseconds(100), [this] { return fMsgProcWake; });
+            condMsgProc.wait_until(lock, std::chrono::steady_clock::now() + std::chrono::milliseconds(100), [this, shard] { return vMsgProcWake[shard]; });
         }
-        fMsgProcWake = false;
+        vMsgProcWake[shard] = false;
     }
 }
 
@@ -2275,9 +2501,32 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
 
     {
         LOCK(mutexMsgProc);
-        fMsgProcWake = false;
+        vMsgProcWake.assign(m_msg_handler_threads, false);
     }
 
+#ifdef USE_EPOLL
+    if (m_socket_events_mode == SocketEventsMode::EPOLL) {
+        m_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (m_epoll_fd == -1) {
+            if (clientInterface) {
+                clientInterface->ThreadSafeMessageBox(
+                    strprintf(_("Failed to create epoll instance: %s").translated, NetworkErrorString(WSAGetLastError())),
+                    "", CClientUIInterface::MSG_ERROR);
+            }
+            return false;
+        }
+        // Listening sockets stay level-triggered; one connection is accepted per wakeup
+        for (size_t i = 0; i < vhListenSocket.size(); i++) {
+            struct epoll_event event;
+            event.events = EPOLLIN;
+            event.data.u64 = EPOLL_LISTEN_SOCKET_TAG | i;
+            if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, vhListenSocket[i].socket, &event) != 0) {
+                LogPrintf("epoll_ctl failed for listening socket: %s\n", NetworkErrorString(WSAGetLastError()));
+            }
+        }
+    }
+#endif
+
     // Send and receive from sockets, accept connections
     threadSocketHandler = std::thread(&TraceThread<std::function<void()> >, "net", std::function<void()>(std::bind(&CConnman::ThreadSocketHandler, this)));
 
@@ -2300,8 +2549,13 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
     if (connOptions.m_use_addrman_outgoing || !connOptions.m_specified_outgoing.empty())
         threadOpenConnections = std::thread(&TraceThread<std::function<void()> >, "opencon", std::function<void()>(std::bind(&CConnman::ThreadOpenConnections, this, connOptions.m_specified_outgoing)));
 
-    // Process messages
-    threadMessageHandler = std::thread(&TraceThread<std::function<void()> >, "msghand", std::function<void()>(std::bind(&CConnman::ThreadMessageHandler, this)));
+    // Process messages, each thread serving the peers of one shard
+    for (int shard = 0; shard < m_msg_handler_threads; shard++) {
+        std::string name = m_msg_handler_threads == 1 ? "msghand" : strprintf("msghand.%d", shard);
+        threadMessageHandlers.emplace_back([this, shard, name] {
+            TraceThread(name.c_str(), std::function<void()>(std::bind(&CConnman::ThreadMessageHandler, this, shard)));
+        });
+    }
 
     // Dump network addresses
     scheduler.scheduleEvery(std::bind(&CConnman::DumpAddresses, this), DUMP_PEERS_INTERVAL * 1000);
@@ -2350,8 +2604,11 @@ void CConnman::Interrupt()
 
 void CConnman::Stop()
 {
-    if (threadMessageHandler.joinable())
-        threadMessageHandler.join();
+    for (std::thread& thread : threadMessageHandlers) {
+        if (thread.joinable())
+            thread.join();
+    }
+    threadMessageHandlers.clear();
     if (threadOpenConnections.joinable())
         threadOpenConnections.join();
     if (threadOpenAddedConnections.joinable())
@@ -2385,6 +2642,14 @@ void CConnman::Stop()
     vNodes.clear();
     vNodesDisconnected.clear();
     vhListenSocket.clear();
+#ifdef USE_EPOLL
+    m_epoll_nodes.clear();
+    m_receivable_nodes.clear();
+    if (m_epoll_fd != -1) {
+        close(m_epoll_fd);
+        m_epoll_fd = -1;
+    }
+#endif
     semOutbound.reset();
     semAddnode.reset();
 }
@@ -2692,13 +2957,15 @@ bool CConnman::NodeFullyConnected(const CNode* pnode)
 
 void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
 {
-    size_t nMessageSize = msg.data.size();
+    const bool external = msg.external_owner != nullptr;
+    const unsigned char* payload = external ? msg.external_data.data() : msg.data.data();
+    size_t nMessageSize = external ? msg.external_data.size() : msg.data.size();
     size_t nTotalSize = nMessageSize + CMessageHeader::HEADER_SIZE;
     LogPrint(BCLog::NET, "sending %s (%d bytes) peer=%d\n",  SanitizeString(msg.command.c_str()), nMessageSize, pnode->GetId());
 
     std::vector<unsigned char> serializedHeader;
     serializedHeader.reserve(CMessageHeader::HEADER_SIZE);
-    uint256 hash = Hash(msg.data.data(), msg.data.data() + nMessageSize);
+    uint256 hash = Hash(payload, payload + nMessageSize);
     CMessageHeader hdr(Params().MessageStart(), msg.command.c_str(), nMessageSize);
     memcpy(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE);
 
@@ -2715,9 +2982,11 @@ void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
 
         if (pnode->nSendSize > nSendBufferMaxSize)
             pnode->fPauseSend = true;
-        pnode->vSendMsg.push_back(std::move(serializedHeader));
-        if (nMessageSize)
-            pnode->vSendMsg.push_back(std::move(msg.data));
+        pnode->vSendMsg.emplace_back(std::move(serializedHeader));
+        if (external && nMessageSize)
+            pnode->vSendMsg.emplace_back(std::move(msg.external_owner), msg.external_data);
+        else if (nMessageSize)
+            pnode->vSendMsg.emplace_back(std::move(msg.data));
 
         // If write queue empty, attempt "optimistic write"
         if (optimisticSend == true)
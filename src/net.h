@@ -19,6 +19,7 @@
 #include <policy/feerate.h>
 #include <protocol.h>
 #include <random.h>
+#include <span.h>
 #include <streams.h>
 #include <sync.h>
 #include <uint256.h>
@@ -30,6 +31,8 @@
 #include <thread>
 #include <memory>
 #include <condition_variable>
+#include <unordered_map>
+#include <unordered_set>
 
 #ifndef WIN32
 #include <arpa/inet.h>
@@ -86,10 +89,28 @@ static const bool DEFAULT_BLOCKSONLY = false;
 /** -peertimeout default */
 static const int64_t DEFAULT_PEER_CONNECT_TIMEOUT = 60;
 
+/** Default number of message handler threads; peers are sharded across them by NodeId */
+static const int DEFAULT_MSG_HANDLER_THREADS = 1;
+/** Maximum number of message handler threads */
+static const int MAX_MSG_HANDLER_THREADS = 16;
+
 static const bool DEFAULT_FORCEDNSSEED = false;
 static const size_t DEFAULT_MAXRECEIVEBUFFER = 5 * 1000;
 static const size_t DEFAULT_MAXSENDBUFFER    = 1 * 1000;
 
+/** Mechanisms the socket handler thread can use to wait for socket readiness */
+enum class SocketEventsMode {
+    SELECT, // select(), rebuilding the fd sets on every iteration
+    POLL,   // poll(), rebuilding the pollfd vector on every iteration
+    EPOLL,  // edge-triggered epoll with persistent registration per socket
+};
+/** Name of the -socketevents default, the mechanism selected at compile time */
+#ifdef USE_POLL
+static const char* const DEFAULT_SOCKETEVENTS = "poll";
+#else
+static const char* const DEFAULT_SOCKETEVENTS = "select";
+#endif
+
 typedef int64_t NodeId;
 
 struct AddedNodeInfo
@@ -103,6 +124,11 @@ struct AddedNodeInfo
 class CNodeStats;
 class CClientUIInterface;
 
+/** Parse a -socketevents value, failing for mechanisms unavailable on this platform */
+bool ParseSocketEventsMode(const std::string& str, SocketEventsMode& mode);
+/** Comma-separated names of the -socketevents values available on this platform */
+std::string GetSupportedSocketEventsModes();
+
 struct CSerializedNetMsg
 {
     CSerializedNetMsg() = default;
@@ -114,6 +140,28 @@ struct CSerializedNetMsg
 
     std::vector<unsigned char> data;
     std::string command;
+    /**
+     * Payload kept alive by external_owner and sent in place of data without
+     * being copied, e.g. a block inside a memory-mapped block file.
+     */
+    std::shared_ptr<const void> external_owner;
+    Span<const unsigned char> external_data;
+};
+
+/** One entry of a node's send queue: either owned bytes or a view into memory held by an owner */
+class CSendChunk
+{
+private:
+    std::vector<unsigned char> m_data;
+    std::shared_ptr<const void> m_owner;
+    Span<const unsigned char> m_view;
+
+public:
+    explicit CSendChunk(std::vector<unsigned char>&& data) : m_data(std::move(data)) {}
+    CSendChunk(std::shared_ptr<const void> owner, Span<const unsigned char> view) : m_owner(std::move(owner)), m_view(view) {}
+
+    const unsigned char* data() const { return m_owner ? m_view.data() : m_data.data(); }
+    size_t size() const { return m_owner ? m_view.size() : m_data.size(); }
 };
 
 
@@ -153,6 +201,8 @@ public:
         bool m_use_addrman_outgoing = true;
         std::vector<std::string> m_specified_outgoing;
         std::vector<std::string> m_added_nodes;
+        SocketEventsMode m_socket_events_mode = SocketEventsMode::SELECT;
+        int m_msg_handler_threads = DEFAULT_MSG_HANDLER_THREADS;
     };
 
     void Init(const Options& connOptions) {
@@ -171,6 +221,8 @@ public:
         nSendBufferMaxSize = connOptions.nSendBufferMaxSize;
         nReceiveFloodSize = connOptions.nReceiveFloodSize;
         m_peer_connect_timeout = connOptions.m_peer_connect_timeout;
+        m_socket_events_mode = connOptions.m_socket_events_mode;
+        m_msg_handler_threads = std::max(1, std::min(connOptions.m_msg_handler_threads, MAX_MSG_HANDLER_THREADS));
         {
             LOCK(cs_totalBytesSent);
             nMaxOutboundTimeframe = connOptions.nMaxOutboundTimeframe;
@@ -322,7 +374,10 @@ public:
 
     unsigned int GetReceiveFloodSize() const;
 
+    /** Wake every message handler thread */
     void WakeMessageHandler();
+    /** Wake the message handler thread responsible for pnode */
+    void WakeMessageHandler(const CNode* pnode);
 
     /** Attempts to obfuscate tx time through exponentially distributed emitting.
         Works assuming that a single interval is used.
@@ -347,14 +402,20 @@ private:
     void AddOneShot(const std::string& strDest);
     void ProcessOneShot();
     void ThreadOpenConnections(std::vector<std::string> connect);
-    void ThreadMessageHandler();
+    int GetMsgHandlerShard(const CNode* pnode) const;
+    void ThreadMessageHandler(int shard);
     void AcceptConnection(const ListenSocket& hListenSocket);
     void DisconnectNodes();
     void NotifyNumConnectionsChanged();
     void InactivityCheck(CNode *pnode);
     bool GenerateSelectSet(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set);
     void SocketEvents(std::set<SOCKET> &recv_set, std::set<SOCKET> &send_set, std::set<SOCKET> &error_set);
+    bool SocketRecvData(CNode *pnode);
     void SocketHandler();
+#ifdef USE_EPOLL
+    void AddSocketEvents(CNode *pnode) EXCLUSIVE_LOCKS_REQUIRED(cs_vNodes);
+    void SocketHandlerEpoll();
+#endif
     void ThreadSocketHandler();
     void ThreadDNSAddressSeed();
 
@@ -419,6 +480,22 @@ private:
     std::atomic<NodeId> nLastNodeId{0};
     unsigned int nPrevNodeCount{0};
 
+    SocketEventsMode m_socket_events_mode{SocketEventsMode::SELECT};
+#ifdef USE_EPOLL
+    /** epoll instance every listening and peer socket is registered with once */
+    int m_epoll_fd{-1};
+    /** Nodes registered with m_epoll_fd, looked up by the NodeId in each event */
+    std::unordered_map<NodeId, CNode*> m_epoll_nodes GUARDED_BY(cs_vNodes);
+    /**
+     * Nodes whose socket was reported readable and has not been drained yet.
+     * Edge-triggered events are not repeated, so a node stays here until a
+     * recv() comes back short, independently of fPauseRecv.
+     */
+    std::unordered_set<CNode*> m_receivable_nodes GUARDED_BY(cs_vNodes);
+    /** Last time (in seconds) InactivityCheck ran over all nodes */
+    int64_t m_last_inactivity_check{0};
+#endif
+
     /**
      * Services this instance offers.
      *
@@ -456,8 +533,10 @@ private:
     /** SipHasher seeds for deterministic randomness */
     const uint64_t nSeed0, nSeed1;
 
-    /** flag for waking the message processor. */
-    bool fMsgProcWake;
+    /** flags for waking the message processors, one per shard. */
+    std::vector<bool> vMsgProcWake GUARDED_BY(mutexMsgProc);
+    /** Number of message handler threads, each owning the peers of one shard */
+    int m_msg_handler_threads{DEFAULT_MSG_HANDLER_THREADS};
 
     std::condition_variable condMsgProc;
     Mutex mutexMsgProc;
@@ -469,7 +548,7 @@ private:
     std::thread threadSocketHandler;
     std::thread threadOpenAddedConnections;
     std::thread threadOpenConnections;
-    std::thread threadMessageHandler;
+    std::vector<std::thread> threadMessageHandlers;
 
     /** flag for deciding to connect to an extra outbound peer,
      *  in excess of m_max_outbound_full_relay
@@ -665,7 +744,7 @@ public:
     size_t nSendSize{0}; // total size of all vSendMsg entries
     size_t nSendOffset{0}; // offset inside the first vSendMsg already sent
     uint64_t nSendBytes GUARDED_BY(cs_vSend){0};
-    std::deque<std::vector<unsigned char>> vSendMsg GUARDED_BY(cs_vSend);
+    std::deque<CSendChunk> vSendMsg GUARDED_BY(cs_vSend);
     CCriticalSection cs_vSend;
     CCriticalSection cs_hSocket;
     CCriticalSection cs_vRecv;
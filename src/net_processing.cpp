@@ -109,6 +109,12 @@ std::map<uint256, COrphanBlock*> mapOrphanBlocks GUARDED_BY(cs_main);
 std::multimap<uint256, COrphanBlock*> mapOrphanBlocksByPrev GUARDED_BY(cs_main);
 std::set<std::pair<COutPoint, unsigned int>> setStakeSeenOrphan GUARDED_BY(cs_main);
 size_t nOrphanBlocksSize = 0;
+/**
+ * Serializes ProcessNetBlock between message handler threads: connecting
+ * orphan blocks walks mapOrphanBlocksByPrev across ProcessNewBlock calls,
+ * which release cs_main.
+ */
+Mutex g_cs_net_block;
 
 /** Increase a node's misbehavior score. */
 void Misbehaving(NodeId nodeid, int howmuch, const std::string& message="") EXCLUSIVE_LOCKS_REQUIRED(cs_main);
@@ -187,11 +193,13 @@ namespace {
     /** When our tip was last updated. */
     std::atomic<int64_t> g_last_tip_update(0);
 
+    /** Guards the relay map, so transactions can be served without cs_main. */
+    Mutex g_cs_relay;
     /** Relay map */
     typedef std::map<uint256, CTransactionRef> MapRelay;
-    MapRelay mapRelay GUARDED_BY(cs_main);
+    MapRelay mapRelay GUARDED_BY(g_cs_relay);
     /** Expiration-time ordered list of (expire time, relay map entry) pairs. */
-    std::deque<std::pair<int64_t, MapRelay::iterator>> vRelayExpiration GUARDED_BY(cs_main);
+    std::deque<std::pair<int64_t, MapRelay::iterator>> vRelayExpiration GUARDED_BY(g_cs_relay);
 
     struct IteratorComparator
     {
@@ -1550,56 +1558,87 @@ void static ProcessGetBlockData(CNode* pfrom, const CChainParams& chainparams, c
         }
     }
 
-    LOCK(cs_main);
-    const CBlockIndex* pindex = LookupBlockIndex(inv.hash);
-    if (pindex) {
-        send = BlockRequestAllowed(pindex, consensusParams);
-        if (!send) {
-            LogPrint(BCLog::NET, "%s: ignoring request from peer=%i for old block that isn't in the main chain\n", __func__, pfrom->GetId());
-        }
-    }
     const CNetMsgMaker msgMaker(pfrom->GetSendVersion());
-    // disconnect node in case we have reached the outbound limit for serving historical blocks
-    // never disconnect whitelisted nodes
-    if (send && connman->OutboundTargetReached(true) && ( ((pindexBestHeader != nullptr) && (pindexBestHeader->GetBlockTime() - pindex->GetBlockTime() > HISTORICAL_BLOCK_AGE)) || inv.type == MSG_FILTERED_BLOCK) && !pfrom->HasPermission(PF_NOBAN))
+    // Decide what to send under cs_main, but read and serialize the block
+    // without it. The index entry itself may be cleaned up once cs_main is
+    // released, so only copies of what is needed are kept.
+    FlatFilePos block_pos;
+    uint256 tip_hash;
+    bool fPeerWantsWitness = false;
+    bool fCmpctAllowed = false;
     {
-        LogPrint(BCLog::NET, "historical block serving limit reached, disconnect peer=%d\n", pfrom->GetId());
+        LOCK(cs_main);
+        const CBlockIndex* pindex = LookupBlockIndex(inv.hash);
+        if (pindex) {
+            send = BlockRequestAllowed(pindex, consensusParams);
+            if (!send) {
+                LogPrint(BCLog::NET, "%s: ignoring request from peer=%i for old block that isn't in the main chain\n", __func__, pfrom->GetId());
+            }
+        }
+        // disconnect node in case we have reached the outbound limit for serving historical blocks
+        // never disconnect whitelisted nodes
+        if (send && connman->OutboundTargetReached(true) && ( ((pindexBestHeader != nullptr) && (pindexBestHeader->GetBlockTime() - pindex->GetBlockTime() > HISTORICAL_BLOCK_AGE)) || inv.type == MSG_FILTERED_BLOCK) && !pfrom->HasPermission(PF_NOBAN))
+        {
+            LogPrint(BCLog::NET, "historical block serving limit reached, disconnect peer=%d\n", pfrom->GetId());
 
-        //disconnect node
-        pfrom->fDisconnect = true;
-        send = false;
-    }
-    // Avoid leaking prune-height by never sending blocks below the NODE_NETWORK_LIMITED threshold
-    if (send && !pfrom->HasPermission(PF_NOBAN) && (
-            (((pfrom->GetLocalServices() & NODE_NETWORK_LIMITED) == NODE_NETWORK_LIMITED) && ((pfrom->GetLocalServices() & NODE_NETWORK) != NODE_NETWORK) && (::ChainActive().Tip()->nHeight - pindex->nHeight > (int)NODE_NETWORK_LIMITED_MIN_BLOCKS + 2 /* add two blocks buffer extension for possible races */) )
-       )) {
-        LogPrint(BCLog::NET, "Ignore block request below NODE_NETWORK_LIMITED threshold from peer=%d\n", pfrom->GetId());
+            //disconnect node
+            pfrom->fDisconnect = true;
+            send = false;
+        }
+        // Avoid leaking prune-height by never sending blocks below the NODE_NETWORK_LIMITED threshold
+        if (send && !pfrom->HasPermission(PF_NOBAN) && (
+                (((pfrom->GetLocalServices() & NODE_NETWORK_LIMITED) == NODE_NETWORK_LIMITED) && ((pfrom->GetLocalServices() & NODE_NETWORK) != NODE_NETWORK) && (::ChainActive().Tip()->nHeight - pindex->nHeight > (int)NODE_NETWORK_LIMITED_MIN_BLOCKS + 2 /* add two blocks buffer extension for possible races */) )
+           )) {
+            LogPrint(BCLog::NET, "Ignore block request below NODE_NETWORK_LIMITED threshold from peer=%d\n", pfrom->GetId());
 
-        //disconnect node and prevent it from stalling (would otherwise wait for the missing block)
-        pfrom->fDisconnect = true;
-        send = false;
-    }
-    // Pruned nodes may have deleted the block, so check whether
-    // it's available before trying to send.
-    if (send && (pindex->nStatus & BLOCK_HAVE_DATA))
+            //disconnect node and prevent it from stalling (would otherwise wait for the missing block)
+            pfrom->fDisconnect = true;
+            send = false;
+        }
+        // Pruned nodes may have deleted the block, so check whether
+        // it's available before trying to send.
+        send = send && (pindex->nStatus & BLOCK_HAVE_DATA);
+        if (send) {
+            block_pos = pindex->GetBlockPos();
+            tip_hash = ::ChainActive().Tip()->GetBlockHash();
+            fPeerWantsWitness = State(pfrom->GetId())->fWantsCmpctWitness;
+            fCmpctAllowed = CanDirectFetch(consensusParams) && pindex->nHeight >= ::ChainActive().Height() - MAX_CMPCTBLOCK_DEPTH;
+        }
+    } // release cs_main
+
+    if (send)
     {
         std::shared_ptr<const CBlock> pblock;
-        if (a_recent_block && a_recent_block->GetHash() == pindex->GetBlockHash()) {
+        if (a_recent_block && a_recent_block->GetHash() == inv.hash) {
             pblock = a_recent_block;
         } else if (inv.type == MSG_WITNESS_BLOCK) {
             // Fast-path: in this case it is possible to serve the block directly from disk,
-            // as the network format matches the format on disk
-            std::vector<uint8_t> block_data;
-            if (!ReadRawBlockFromDisk(block_data, pindex, chainparams.MessageStart())) {
-                assert(!"cannot load block from disk");
+            // as the network format matches the format on disk. Where the block file can be
+            // memory-mapped, the send queue references the mapping instead of a copy.
+            std::shared_ptr<const FlatFileMapping> mapping;
+            Span<const unsigned char> block_view;
+            if (MapRawBlockFromDisk(mapping, block_view, block_pos, chainparams.MessageStart())) {
+                connman->PushMessage(pfrom, msgMaker.MakeView(NetMsgType::BLOCK, std::move(mapping), block_view));
+            } else {
+                std::vector<uint8_t> block_data;
+                if (!ReadRawBlockFromDisk(block_data, block_pos, chainparams.MessageStart())) {
+                    // The block may have been pruned since cs_main was released
+                    LogPrint(BCLog::NET, "%s: cannot load block %s from disk, disconnect peer=%d\n", __func__, inv.hash.ToString(), pfrom->GetId());
+                    pfrom->fDisconnect = true;
+                    return;
+                }
+                connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCK, MakeSpan(block_data)));
             }
-            connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::BLOCK, MakeSpan(block_data)));
             // Don't set pblock as we've sent the block
         } else {
             // Send block from disk
             std::shared_ptr<CBlock> pblockRead = std::make_shared<CBlock>();
-            if (!ReadBlockFromDisk(*pblockRead, pindex, consensusParams))
-                assert(!"cannot load block from disk");
+            if (!ReadBlockFromDisk(*pblockRead, block_pos, consensusParams) || pblockRead->GetHash() != inv.hash) {
+                // The block may have been pruned since cs_main was released
+                LogPrint(BCLog::NET, "%s: cannot load block %s from disk, disconnect peer=%d\n", __func__, inv.hash.ToString(), pfrom->GetId());
+                pfrom->fDisconnect = true;
+                return;
+            }
             pblock = pblockRead;
         }
         if (pblock) {
@@ -1639,10 +1678,9 @@ void static ProcessGetBlockData(CNode* pfrom, const CChainParams& chainparams, c
                 // they won't have a useful mempool to match against a compact block,
                 // and we don't feel like constructing the object for them, so
                 // instead we respond with the full, non-compact block.
-                bool fPeerWantsWitness = State(pfrom->GetId())->fWantsCmpctWitness;
                 int nSendFlags = fPeerWantsWitness ? 0 : SERIALIZE_TRANSACTION_NO_WITNESS;
-                if (CanDirectFetch(consensusParams) && pindex->nHeight >= ::ChainActive().Height() - MAX_CMPCTBLOCK_DEPTH) {
-                    if ((fPeerWantsWitness || !fWitnessesPresentInARecentCompactBlock) && a_recent_compact_block && a_recent_compact_block->header.GetHash() == pindex->GetBlockHash()) {
+                if (fCmpctAllowed) {
+                    if ((fPeerWantsWitness || !fWitnessesPresentInARecentCompactBlock) && a_recent_compact_block && a_recent_compact_block->header.GetHash() == inv.hash) {
                         connman->PushMessage(pfrom, msgMaker.Make(nSendFlags, NetMsgType::CMPCTBLOCK, *a_recent_compact_block));
                     } else {
                         CBlockHeaderAndShortTxIDs cmpctblock(*pblock, fPeerWantsWitness);
@@ -1661,7 +1699,7 @@ void static ProcessGetBlockData(CNode* pfrom, const CChainParams& chainparams, c
             // and we want it right after the last block so they don't
             // wait for other stuff first.
             std::vector<CInv> vInv;
-            vInv.push_back(CInv(MSG_BLOCK, ::ChainActive().Tip()->GetBlockHash()));
+            vInv.push_back(CInv(MSG_BLOCK, tip_hash));
             connman->PushMessage(pfrom, msgMaker.Make(NetMsgType::INV, vInv));
             pfrom->hashContinue.SetNull();
         }
@@ -1681,8 +1719,6 @@ void static ProcessGetData(CNode* pfrom, const CChainParams& chainparams, CConnm
     // messages from this peer (likely resulting in our peer eventually
     // disconnecting us).
     if (pfrom->m_tx_relay != nullptr) {
-        LOCK(cs_main);
-
         while (it != pfrom->vRecvGetData.end() && (it->type == MSG_TX || it->type == MSG_WITNESS_TX)) {
             if (interruptMsgProc)
                 return;
@@ -1695,10 +1731,17 @@ void static ProcessGetData(CNode* pfrom, const CChainParams& chainparams, CConnm
 
             // Send stream from relay memory
             bool push = false;
-            auto mi = mapRelay.find(inv.hash);
+            CTransactionRef relay_tx;
+            {
+                LOCK(g_cs_relay);
+                auto mi = mapRelay.find(inv.hash);
+                if (mi != mapRelay.end()) {
+                    relay_tx = mi->second;
+                }
+            }
             int nSendFlags = (inv.type == MSG_TX ? SERIALIZE_TRANSACTION_NO_WITNESS : 0);
-            if (mi != mapRelay.end()) {
-                connman->PushMessage(pfrom, msgMaker.Make(nSendFlags, NetMsgType::TX, *mi->second));
+            if (relay_tx) {
+                connman->PushMessage(pfrom, msgMaker.Make(nSendFlags, NetMsgType::TX, *relay_tx));
                 push = true;
             } else if (pfrom->m_tx_relay->timeLastMempoolReq) {
                 auto txinfo = mempool.info(inv.hash);
@@ -1713,7 +1756,7 @@ void static ProcessGetData(CNode* pfrom, const CChainParams& chainparams, CConnm
                 vNotFound.push_back(inv);
             }
         }
-    } // release cs_main
+    }
 
     if (it != pfrom->vRecvGetData.end() && !pfrom->fPauseSend) {
         const CInv &inv = *it;
@@ -2418,12 +2461,35 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         if (pfrom->HasPermission(PF_RELAY))
             fBlocksOnly = false;
 
+        // Most transaction announcements are for transactions already in our
+        // mempool, relayed to us by several peers. Settle those without
+        // cs_main and only take it for what is left.
+        std::vector<CInv> vInvNeedMain;
+        vInvNeedMain.reserve(vInv.size());
+        for (CInv &inv : vInv)
+        {
+            if (inv.type != MSG_TX || !mempool.exists(inv.hash)) {
+                vInvNeedMain.push_back(inv);
+                continue;
+            }
+            LogPrint(BCLog::NET, "got inv: %s  have peer=%d\n", inv.ToString(), pfrom->GetId());
+            pfrom->AddInventoryKnown(inv);
+            if (fBlocksOnly) {
+                LogPrint(BCLog::NET, "transaction (%s) inv sent in violation of protocol, disconnecting peer=%d\n", inv.hash.ToString(), pfrom->GetId());
+                pfrom->fDisconnect = true;
+                return true;
+            }
+        }
+        if (vInvNeedMain.empty()) {
+            return true;
+        }
+
         LOCK(cs_main);
 
         uint32_t nFetchFlags = GetFetchFlags(pfrom);
         const auto current_time = GetTime<std::chrono::microseconds>();
 
-        for (CInv &inv : vInv)
+        for (CInv &inv : vInvNeedMain)
         {
             if (interruptMsgProc)
                 return true;
@@ -2685,20 +2751,38 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
         CInv inv(MSG_TX, tx.GetHash());
         pfrom->AddInventoryKnown(inv);
 
-        LOCK2(cs_main, g_cs_orphans);
-
         bool fMissingInputs = false;
         CValidationState state;
+        std::list<CTransactionRef> lRemovedTxn;
+
+        // With -parallelaccept the scripts are verified before taking the
+        // locks, together with those of transactions from other peers
+        bool fAlreadyHave = false;
+        bool fAccepted = false;
+        if (fParallelAccept) {
+            fAlreadyHave = WITH_LOCK(cs_main, return AlreadyHave(inv));
+            if (!fAlreadyHave) {
+                fAccepted = AcceptToMemoryPoolParallel(mempool, state, ptx, &fMissingInputs, &lRemovedTxn);
+            }
+        }
+
+        LOCK2(cs_main, g_cs_orphans);
 
         CNodeState* nodestate = State(pfrom->GetId());
         nodestate->m_tx_download.m_tx_announced.erase(inv.hash);
         nodestate->m_tx_download.m_tx_in_flight.erase(inv.hash);
         EraseTxRequest(inv.hash);
 
-        std::list<CTransactionRef> lRemovedTxn;
+        if (!fParallelAccept) {
+            fAlreadyHave = AlreadyHave(inv);
+            fAccepted = !fAlreadyHave && AcceptToMemoryPool(mempool, state, ptx, &fMissingInputs, &lRemovedTxn, false /* bypass_limits */, 0 /* nAbsurdFee */);
+        } else if (!fAccepted && state.GetReason() == ValidationInvalidReason::TX_CONFLICT && AlreadyHave(inv)) {
+            // Another peer's copy got in first; treat it like one we already had
+            state = CValidationState();
+            fMissingInputs = false;
+        }
 
-        if (!AlreadyHave(inv) &&
-            AcceptToMemoryPool(mempool, state, ptx, &fMissingInputs, &lRemovedTxn, false /* bypass_limits */, 0 /* nAbsurdFee */)) {
+        if (fAccepted) {
             mempool.check(&::ChainstateActive().CoinsTip());
             RelayTransaction(tx.GetHash(), *connman);
             for (unsigned int i = 0; i < tx.vout.size(); i++) {
@@ -4096,6 +4180,7 @@ bool PeerLogicValidation::SendMessages(CNode* pto)
                         vInv.push_back(CInv(MSG_TX, hash));
                         nRelayedTransactions++;
                         {
+                            LOCK(g_cs_relay);
                             // Expire old relay messages
                             while (!vRelayExpiration.empty() && vRelayExpiration.front().first < nNow)
                             {
@@ -4281,7 +4366,13 @@ bool PeerLogicValidation::SendMessages(CNode* pto)
             if (timeNow > pto->m_tx_relay->nextSendTimeFeeFilter) {
                 static CFeeRate default_feerate(DEFAULT_MIN_RELAY_TX_FEE);
                 static FeeFilterRounder filterRounder(default_feerate);
-                CAmount filterToSend = filterRounder.round(currentFilter);
+                static Mutex cs_filterRounder;
+                CAmount filterToSend;
+                {
+                    // The rounder's randomness is shared by all message handler threads
+                    LOCK(cs_filterRounder);
+                    filterToSend = filterRounder.round(currentFilter);
+                }
                 // We always have a fee filter of at least minRelayTxFee
                 filterToSend = std::max(filterToSend, ::minRelayTxFee.GetFeePerK());
                 if (filterToSend != pto->m_tx_relay->lastSentFeeFilter) {
@@ -4362,6 +4453,7 @@ void static PruneOrphanBlocks()
 
 bool ProcessNetBlock(const CChainParams& chainparams, const std::shared_ptr<const CBlock> pblock, bool fForceProcessing, bool* fNewBlock, CNode* pfrom, CConnman& connman)
 {
+    LOCK(g_cs_net_block);
     {
         LOCK(cs_main);
 
@@ -4542,6 +4634,9 @@ bool RemoveBlockIndex(CBlockIndex *pindex)
     return ret;
 }
 
+/** Maximum number of block indexes erased per cs_main acquisition */
+static const size_t CLEAN_BLOCK_INDEX_BATCH = 1000;
+
 void CleanBlockIndex()
 {
     unsigned int cleanTimeout = gArgs.GetArg("-cleanblockindextimeout", DEFAULT_CLEANBLOCKINDEXTIMEOUT) * 1000;
@@ -4551,43 +4646,57 @@ void CleanBlockIndex()
     {
         if(!::ChainstateActive().IsInitialBlockDownload())
         {
-            // Select block indexes to delete
+            // Select block indexes to delete, in increasing height order
             std::vector<uint256> indexNeedErase;
             {
                 LOCK(cs_main);
                 const CBlockIndex *pindexCheck = ::ChainActive()[::ChainActive().Height() - nCheckpointSpan -1];
                 if(pindexCheck)
                 {
-                    for (BlockMap::iterator it=::BlockIndex().begin(); it!=::BlockIndex().end(); it++)
+                    std::set<CBlockIndex*, CBlockIndexHeightComparator>& candidates = StaleBlockIndexCandidates();
+                    for (auto it = candidates.begin(); it != candidates.end();)
                     {
-                        CBlockIndex *pindex = (*it).second;
+                        CBlockIndex *pindex = *it;
+                        if(pindex->nHeight <= pindexCheck->nHeight && ::ChainActive().Contains(pindex))
+                        {
+                            // Settled on the active chain
+                            it = candidates.erase(it);
+                            continue;
+                        }
                         if(NeedToEraseBlockIndex(pindex, pindexCheck))
                         {
                             indexNeedErase.push_back(pindex->GetBlockHash());
                         }
+                        it++;
                     }
                 }
             }
 
-            // Delete selected block indexes
+            // Delete selected block indexes, descendants before their ancestors
+            // so that no remaining index points to a deleted one between batches
             if(indexNeedErase.size() > 0)
             {
                 SyncWithValidationInterfaceQueue();
 
-                LOCK(cs_main);
-                for(uint256 blockHash : indexNeedErase)
+                auto itErase = indexNeedErase.rbegin();
+                while(itErase != indexNeedErase.rend() && !ShutdownRequested())
                 {
-                    BlockMap::iterator it=::BlockIndex().find(blockHash);
-                    if(it!=::BlockIndex().end())
+                    LOCK(cs_main);
+                    for(size_t n = 0; n < CLEAN_BLOCK_INDEX_BATCH && itErase != indexNeedErase.rend(); n++, itErase++)
                     {
-                        CBlockIndex *pindex = (*it).second;
-                        if(RemoveBlockIndex(pindex))
+                        BlockMap::iterator it=::BlockIndex().find(*itErase);
+                        if(it!=::BlockIndex().end())
                         {
-                            delete pindex;
-                            ::BlockIndex().erase(it);
+                            CBlockIndex *pindex = (*it).second;
+                            if(RemoveBlockIndex(pindex))
+                            {
+                                delete pindex;
+                                ::BlockIndex().erase(it);
+                            }
                         }
                     }
                 }
+                LogPrint(BCLog::BENCH, "%s: erased %u stale block indexes\n", __func__, indexNeedErase.size());
             }
         }
 
@@ -482,6 +482,11 @@ bool CBlockPolicyEstimator::removeTx(uint256 hash, bool inBlock)
         feeStats->removeTx(pos->second.blockHeight, nBestSeenHeight, pos->second.bucketIndex, inBlock);
         shortStats->removeTx(pos->second.blockHeight, nBestSeenHeight, pos->second.bucketIndex, inBlock);
         longStats->removeTx(pos->second.blockHeight, nBestSeenHeight, pos->second.bucketIndex, inBlock);
+        if (pos->second.gasTracked) {
+            gasStats->removeTx(pos->second.blockHeight, nBestSeenHeight, pos->second.gasBucketIndex, inBlock);
+            gasShortStats->removeTx(pos->second.blockHeight, nBestSeenHeight, pos->second.gasBucketIndex, inBlock);
+            gasLongStats->removeTx(pos->second.blockHeight, nBestSeenHeight, pos->second.gasBucketIndex, inBlock);
+        }
         mapMemPoolTxs.erase(hash);
         return true;
     } else {
@@ -505,6 +510,19 @@ CBlockPolicyEstimator::CBlockPolicyEstimator()
     feeStats = std::unique_ptr<TxConfirmStats>(new TxConfirmStats(buckets, bucketMap, MED_BLOCK_PERIODS, MED_DECAY, MED_SCALE));
     shortStats = std::unique_ptr<TxConfirmStats>(new TxConfirmStats(buckets, bucketMap, SHORT_BLOCK_PERIODS, SHORT_DECAY, SHORT_SCALE));
     longStats = std::unique_ptr<TxConfirmStats>(new TxConfirmStats(buckets, bucketMap, LONG_BLOCK_PERIODS, LONG_DECAY, LONG_SCALE));
+
+    bucketIndex = 0;
+    for (double bucketBoundary = MIN_BUCKET_GASPRICE; bucketBoundary <= MAX_BUCKET_GASPRICE; bucketBoundary *= GAS_SPACING, bucketIndex++) {
+        gasBuckets.push_back(bucketBoundary);
+        gasBucketMap[bucketBoundary] = bucketIndex;
+    }
+    gasBuckets.push_back(INF_FEERATE);
+    gasBucketMap[INF_FEERATE] = bucketIndex;
+    assert(gasBucketMap.size() == gasBuckets.size());
+
+    gasStats = std::unique_ptr<TxConfirmStats>(new TxConfirmStats(gasBuckets, gasBucketMap, MED_BLOCK_PERIODS, MED_DECAY, MED_SCALE));
+    gasShortStats = std::unique_ptr<TxConfirmStats>(new TxConfirmStats(gasBuckets, gasBucketMap, SHORT_BLOCK_PERIODS, SHORT_DECAY, SHORT_SCALE));
+    gasLongStats = std::unique_ptr<TxConfirmStats>(new TxConfirmStats(gasBuckets, gasBucketMap, LONG_BLOCK_PERIODS, LONG_DECAY, LONG_SCALE));
 }
 
 CBlockPolicyEstimator::~CBlockPolicyEstimator()
@@ -548,6 +566,17 @@ void CBlockPolicyEstimator::processTransaction(const CTxMemPoolEntry& entry, boo
     assert(bucketIndex == bucketIndex2);
     unsigned int bucketIndex3 = longStats->NewTx(txHeight, (double)feeRate.GetFeePerK());
     assert(bucketIndex == bucketIndex3);
+
+    // Contract transactions are ordered by gas price, which is tracked separately
+    if (entry.GetTx().HasCreateOrCall() && entry.GetMinGasPrice() > 0) {
+        double gasPrice = entry.GetMinGasPrice();
+        mapMemPoolTxs[hash].gasTracked = true;
+        mapMemPoolTxs[hash].gasBucketIndex = gasStats->NewTx(txHeight, gasPrice);
+        unsigned int gasBucketIndex2 = gasShortStats->NewTx(txHeight, gasPrice);
+        assert(mapMemPoolTxs[hash].gasBucketIndex == gasBucketIndex2);
+        unsigned int gasBucketIndex3 = gasLongStats->NewTx(txHeight, gasPrice);
+        assert(mapMemPoolTxs[hash].gasBucketIndex == gasBucketIndex3);
+    }
 }
 
 bool CBlockPolicyEstimator::processBlockTx(unsigned int nBlockHeight, const CTxMemPoolEntry* entry)
@@ -557,11 +586,6 @@ bool CBlockPolicyEstimator::processBlockTx(unsigned int nBlockHeight, const CTxM
         return false;
     }
 
-    if(entry->GetTx().HasCreateOrCall()){
-    	//Exclude contract transactions
-    	return false;
-    }
-
     // How many blocks did it take for miners to include this transaction?
     // blocksToConfirm is 1-based, so a transaction included in the earliest
     // possible block has confirmation count of 1
@@ -573,6 +597,18 @@ bool CBlockPolicyEstimator::processBlockTx(unsigned int nBlockHeight, const CTxM
         return false;
     }
 
+    if(entry->GetTx().HasCreateOrCall()){
+        //Exclude contract transactions from the fee rates, record their gas price instead
+        if (entry->GetMinGasPrice() <= 0) {
+            return false;
+        }
+        double gasPrice = entry->GetMinGasPrice();
+        gasStats->Record(blocksToConfirm, gasPrice);
+        gasShortStats->Record(blocksToConfirm, gasPrice);
+        gasLongStats->Record(blocksToConfirm, gasPrice);
+        return true;
+    }
+
     // Feerates are stored and reported as BTC-per-kb:
     CFeeRate feeRate(entry->GetFee(), entry->GetTxSize());
 
@@ -604,11 +640,17 @@ void CBlockPolicyEstimator::processBlock(unsigned int nBlockHeight,
     feeStats->ClearCurrent(nBlockHeight);
     shortStats->ClearCurrent(nBlockHeight);
     longStats->ClearCurrent(nBlockHeight);
+    gasStats->ClearCurrent(nBlockHeight);
+    gasShortStats->ClearCurrent(nBlockHeight);
+    gasLongStats->ClearCurrent(nBlockHeight);
 
     // Decay all exponential averages
     feeStats->UpdateMovingAverages();
     shortStats->UpdateMovingAverages();
     longStats->UpdateMovingAverages();
+    gasStats->UpdateMovingAverages();
+    gasShortStats->UpdateMovingAverages();
+    gasLongStats->UpdateMovingAverages();
 
     unsigned int countedTxs = 0;
     // Update averages with data points from current block
@@ -721,36 +763,57 @@ unsigned int CBlockPolicyEstimator::MaxUsableEstimate() const
     return std::min(longStats->GetMaxConfirms(), std::max(BlockSpan(), HistoricalBlockSpan()) / 2);
 }
 
+const TxConfirmStats& CBlockPolicyEstimator::GetStats(FeeEstimateHorizon horizon, bool gas) const
+{
+    switch (horizon) {
+    case FeeEstimateHorizon::SHORT_HALFLIFE: {
+        return gas ? *gasShortStats : *shortStats;
+    }
+    case FeeEstimateHorizon::MED_HALFLIFE: {
+        return gas ? *gasStats : *feeStats;
+    }
+    case FeeEstimateHorizon::LONG_HALFLIFE: {
+        return gas ? *gasLongStats : *longStats;
+    }
+    default: {
+        throw std::out_of_range("CBlockPolicyEstimator::GetStats unknown FeeEstimateHorizon");
+    }
+    }
+}
+
 /** Return a fee estimate at the required successThreshold from the shortest
  * time horizon which tracks confirmations up to the desired target.  If
  * checkShorterHorizon is requested, also allow short time horizon estimates
  * for a lower target to reduce the given answer */
-double CBlockPolicyEstimator::estimateCombinedFee(unsigned int confTarget, double successThreshold, bool checkShorterHorizon, EstimationResult *result) const
+double CBlockPolicyEstimator::estimateCombinedFee(unsigned int confTarget, double successThreshold, bool checkShorterHorizon, EstimationResult *result, bool gas) const
 {
+    const TxConfirmStats* short_stats = &GetStats(FeeEstimateHorizon::SHORT_HALFLIFE, gas);
+    const TxConfirmStats* med_stats = &GetStats(FeeEstimateHorizon::MED_HALFLIFE, gas);
+    const TxConfirmStats* long_stats = &GetStats(FeeEstimateHorizon::LONG_HALFLIFE, gas);
     double estimate = -1;
-    if (confTarget >= 1 && confTarget <= longStats->GetMaxConfirms()) {
+    if (confTarget >= 1 && confTarget <= long_stats->GetMaxConfirms()) {
         // Find estimate from shortest time horizon possible
-        if (confTarget <= shortStats->GetMaxConfirms()) { // short horizon
-            estimate = shortStats->EstimateMedianVal(confTarget, SUFFICIENT_TXS_SHORT, successThreshold, true, nBestSeenHeight, result);
+        if (confTarget <= short_stats->GetMaxConfirms()) { // short horizon
+            estimate = short_stats->EstimateMedianVal(confTarget, SUFFICIENT_TXS_SHORT, successThreshold, true, nBestSeenHeight, result);
         }
-        else if (confTarget <= feeStats->GetMaxConfirms()) { // medium horizon
-            estimate = feeStats->EstimateMedianVal(confTarget, SUFFICIENT_FEETXS, successThreshold, true, nBestSeenHeight, result);
+        else if (confTarget <= med_stats->GetMaxConfirms()) { // medium horizon
+            estimate = med_stats->EstimateMedianVal(confTarget, SUFFICIENT_FEETXS, successThreshold, true, nBestSeenHeight, result);
         }
         else { // long horizon
-            estimate = longStats->EstimateMedianVal(confTarget, SUFFICIENT_FEETXS, successThreshold, true, nBestSeenHeight, result);
+            estimate = long_stats->EstimateMedianVal(confTarget, SUFFICIENT_FEETXS, successThreshold, true, nBestSeenHeight, result);
         }
         if (checkShorterHorizon) {
             EstimationResult tempResult;
             // If a lower confTarget from a more recent horizon returns a lower answer use it.
-            if (confTarget > feeStats->GetMaxConfirms()) {
-                double medMax = feeStats->EstimateMedianVal(feeStats->GetMaxConfirms(), SUFFICIENT_FEETXS, successThreshold, true, nBestSeenHeight, &tempResult);
+            if (confTarget > med_stats->GetMaxConfirms()) {
+                double medMax = med_stats->EstimateMedianVal(med_stats->GetMaxConfirms(), SUFFICIENT_FEETXS, successThreshold, true, nBestSeenHeight, &tempResult);
                 if (medMax > 0 && (estimate == -1 || medMax < estimate)) {
                     estimate = medMax;
                     if (result) *result = tempResult;
                 }
             }
-            if (confTarget > shortStats->GetMaxConfirms()) {
-                double shortMax = shortStats->EstimateMedianVal(shortStats->GetMaxConfirms(), SUFFICIENT_TXS_SHORT, successThreshold, true, nBestSeenHeight, &tempResult);
+            if (confTarget > short_stats->GetMaxConfirms()) {
+                double shortMax = short_stats->EstimateMedianVal(short_stats->GetMaxConfirms(), SUFFICIENT_TXS_SHORT, successThreshold, true, nBestSeenHeight, &tempResult);
                 if (shortMax > 0 && (estimate == -1 || shortMax < estimate)) {
                     estimate = shortMax;
                     if (result) *result = tempResult;
@@ -764,15 +827,18 @@ double CBlockPolicyEstimator::estimateCombinedFee(unsigned int confTarget, doubl
 /** Ensure that for a conservative estimate, the DOUBLE_SUCCESS_PCT is also met
  * at 2 * target for any longer time horizons.
  */
-double CBlockPolicyEstimator::estimateConservativeFee(unsigned int doubleTarget, EstimationResult *result) const
+double CBlockPolicyEstimator::estimateConservativeFee(unsigned int doubleTarget, EstimationResult *result, bool gas) const
 {
+    const TxConfirmStats* short_stats = &GetStats(FeeEstimateHorizon::SHORT_HALFLIFE, gas);
+    const TxConfirmStats* med_stats = &GetStats(FeeEstimateHorizon::MED_HALFLIFE, gas);
+    const TxConfirmStats* long_stats = &GetStats(FeeEstimateHorizon::LONG_HALFLIFE, gas);
     double estimate = -1;
     EstimationResult tempResult;
-    if (doubleTarget <= shortStats->GetMaxConfirms()) {
-        estimate = feeStats->EstimateMedianVal(doubleTarget, SUFFICIENT_FEETXS, DOUBLE_SUCCESS_PCT, true, nBestSeenHeight, result);
+    if (doubleTarget <= short_stats->GetMaxConfirms()) {
+        estimate = med_stats->EstimateMedianVal(doubleTarget, SUFFICIENT_FEETXS, DOUBLE_SUCCESS_PCT, true, nBestSeenHeight, result);
     }
-    if (doubleTarget <= feeStats->GetMaxConfirms()) {
-        double longEstimate = longStats->EstimateMedianVal(doubleTarget, SUFFICIENT_FEETXS, DOUBLE_SUCCESS_PCT, true, nBestSeenHeight, &tempResult);
+    if (doubleTarget <= med_stats->GetMaxConfirms()) {
+        double longEstimate = long_stats->EstimateMedianVal(doubleTarget, SUFFICIENT_FEETXS, DOUBLE_SUCCESS_PCT, true, nBestSeenHeight, &tempResult);
         if (longEstimate > estimate) {
             estimate = longEstimate;
             if (result) *result = tempResult;
@@ -792,6 +858,24 @@ CFeeRate CBlockPolicyEstimator::estimateSmartFee(int confTarget, FeeCalculation
 {
     LOCK(m_cs_fee_estimator);
 
+    double median = estimateSmart(confTarget, feeCalc, conservative, false);
+    if (median < 0) return CFeeRate(0); // error condition
+
+    return CFeeRate(llround(median));
+}
+
+CAmount CBlockPolicyEstimator::estimateSmartGasPrice(int confTarget, FeeCalculation *feeCalc, bool conservative) const
+{
+    LOCK(m_cs_fee_estimator);
+
+    double median = estimateSmart(confTarget, feeCalc, conservative, true);
+    if (median < 0) return 0; // error condition
+
+    return llround(median);
+}
+
+double CBlockPolicyEstimator::estimateSmart(int confTarget, FeeCalculation *feeCalc, bool conservative, bool gas) const
+{
     if (feeCalc) {
         feeCalc->desiredTarget = confTarget;
         feeCalc->returnedTarget = confTarget;
@@ -802,7 +886,7 @@ CFeeRate CBlockPolicyEstimator::estimateSmartFee(int confTarget, FeeCalculation
 
     // Return failure if trying to analyze a target we're not tracking
     if (confTarget <= 0 || (unsigned int)confTarget > longStats->GetMaxConfirms()) {
-        return CFeeRate(0);  // error condition
+        return -1;  // error condition
     }
 
     // It's not possible to get reasonable estimates for confTarget of 1
@@ -814,7 +898,7 @@ CFeeRate CBlockPolicyEstimator::estimateSmartFee(int confTarget, FeeCalculation
     }
     if (feeCalc) feeCalc->returnedTarget = confTarget;
 
-    if (confTarget <= 1) return CFeeRate(0); // error condition
+    if (confTarget <= 1) return -1; // error condition
 
     assert(confTarget > 0); //estimateCombinedFee and estimateConservativeFee take unsigned ints
     /** true is passed to estimateCombined fee for target/2 and target so
@@ -827,13 +911,13 @@ CFeeRate CBlockPolicyEstimator::estimateSmartFee(int confTarget, FeeCalculation
      * the purpose of conservative estimates is not to let short term
      * fluctuations lower our estimates by too much.
      */
-    double halfEst = estimateCombinedFee(confTarget/2, HALF_SUCCESS_PCT, true, &tempResult);
+    double halfEst = estimateCombinedFee(confTarget/2, HALF_SUCCESS_PCT, true, &tempResult, gas);
     if (feeCalc) {
         feeCalc->est = tempResult;
         feeCalc->reason = FeeReason::HALF_ESTIMATE;
     }
     median = halfEst;
-    double actualEst = estimateCombinedFee(confTarget, SUCCESS_PCT, true, &tempResult);
+    double actualEst = estimateCombinedFee(confTarget, SUCCESS_PCT, true, &tempResult, gas);
     if (actualEst > median) {
         median = actualEst;
         if (feeCalc) {
@@ -841,7 +925,7 @@ CFeeRate CBlockPolicyEstimator::estimateSmartFee(int confTarget, FeeCalculation
             feeCalc->reason = FeeReason::FULL_ESTIMATE;
         }
     }
-    double doubleEst = estimateCombinedFee(2 * confTarget, DOUBLE_SUCCESS_PCT, !conservative, &tempResult);
+    double doubleEst = estimateCombinedFee(2 * confTarget, DOUBLE_SUCCESS_PCT, !conservative, &tempResult, gas);
     if (doubleEst > median) {
         median = doubleEst;
         if (feeCalc) {
@@ -851,7 +935,7 @@ CFeeRate CBlockPolicyEstimator::estimateSmartFee(int confTarget, FeeCalculation
     }
 
     if (conservative || median == -1) {
-        double consEst =  estimateConservativeFee(2 * confTarget, &tempResult);
+        double consEst =  estimateConservativeFee(2 * confTarget, &tempResult, gas);
         if (consEst > median) {
             median = consEst;
             if (feeCalc) {
@@ -861,9 +945,7 @@ CFeeRate CBlockPolicyEstimator::estimateSmartFee(int confTarget, FeeCalculation
         }
     }
 
-    if (median < 0) return CFeeRate(0); // error condition
-
-    return CFeeRate(llround(median));
+    return median;
 }
 
 
@@ -952,6 +1034,70 @@ bool CBlockPolicyEstimator::Read(CAutoFile& filein)
     return true;
 }
 
+bool CBlockPolicyEstimator::WriteGasPrices(CAutoFile& fileout) const
+{
+    try {
+        LOCK(m_cs_fee_estimator);
+        fileout << 2050300; // version required to read: 2.5.3 or later
+        fileout << CLIENT_VERSION; // version that wrote the file
+        fileout << nBestSeenHeight;
+        fileout << gasBuckets;
+        gasStats->Write(fileout);
+        gasShortStats->Write(fileout);
+        gasLongStats->Write(fileout);
+    }
+    catch (const std::exception&) {
+        LogPrintf("CBlockPolicyEstimator::WriteGasPrices(): unable to write gas price estimator data (non-fatal)\n");
+        return false;
+    }
+    return true;
+}
+
+bool CBlockPolicyEstimator::ReadGasPrices(CAutoFile& filein)
+{
+    try {
+        LOCK(m_cs_fee_estimator);
+        int nVersionRequired, nVersionThatWrote;
+        filein >> nVersionRequired >> nVersionThatWrote;
+        if (nVersionRequired > CLIENT_VERSION)
+            return error("CBlockPolicyEstimator::ReadGasPrices(): up-version (%d) gas price estimate file", nVersionRequired);
+
+        unsigned int nFileBestSeenHeight;
+        filein >> nFileBestSeenHeight;
+        if (nFileBestSeenHeight != nBestSeenHeight) {
+            // The block spans used for estimates come from the fee estimates file
+            throw std::runtime_error("Gas price estimates do not match the fee estimates");
+        }
+        std::vector<double> fileBuckets;
+        filein >> fileBuckets;
+        size_t numBuckets = fileBuckets.size();
+        if (numBuckets <= 1 || numBuckets > 1000)
+            throw std::runtime_error("Corrupt estimates file. Must have between 2 and 1000 gas price buckets");
+
+        std::unique_ptr<TxConfirmStats> fileGasStats(new TxConfirmStats(gasBuckets, gasBucketMap, MED_BLOCK_PERIODS, MED_DECAY, MED_SCALE));
+        std::unique_ptr<TxConfirmStats> fileGasShortStats(new TxConfirmStats(gasBuckets, gasBucketMap, SHORT_BLOCK_PERIODS, SHORT_DECAY, SHORT_SCALE));
+        std::unique_ptr<TxConfirmStats> fileGasLongStats(new TxConfirmStats(gasBuckets, gasBucketMap, LONG_BLOCK_PERIODS, LONG_DECAY, LONG_SCALE));
+        fileGasStats->Read(filein, nVersionThatWrote, numBuckets);
+        fileGasShortStats->Read(filein, nVersionThatWrote, numBuckets);
+        fileGasLongStats->Read(filein, nVersionThatWrote, numBuckets);
+
+        gasBuckets = fileBuckets;
+        gasBucketMap.clear();
+        for (unsigned int i = 0; i < gasBuckets.size(); i++) {
+            gasBucketMap[gasBuckets[i]] = i;
+        }
+
+        gasStats = std::move(fileGasStats);
+        gasShortStats = std::move(fileGasShortStats);
+        gasLongStats = std::move(fileGasLongStats);
+    }
+    catch (const std::exception& e) {
+        LogPrintf("CBlockPolicyEstimator::ReadGasPrices(): unable to read gas price estimator data (non-fatal): %s\n",e.what());
+        return false;
+    }
+    return true;
+}
+
 void CBlockPolicyEstimator::FlushUnconfirmed() {
     int64_t startclear = GetTimeMicros();
     LOCK(m_cs_fee_estimator);
@@ -179,6 +179,13 @@ private:
      */
     static constexpr double FEE_SPACING = 1.05;
 
+    /** Minimum and Maximum values for tracking the gas prices of contract
+     * transactions, in satoshis per gas unit, and the spacing of their buckets
+     */
+    static constexpr double MIN_BUCKET_GASPRICE = 10;
+    static constexpr double MAX_BUCKET_GASPRICE = 1e5;
+    static constexpr double GAS_SPACING = 1.05;
+
 public:
     /** Create new BlockPolicyEstimator and initialize stats tracking classes with default values */
     CBlockPolicyEstimator();
@@ -210,12 +217,25 @@ public:
      */
     CFeeRate estimateRawFee(int confTarget, double successThreshold, FeeEstimateHorizon horizon, EstimationResult *result = nullptr) const;
 
+    /** Estimate the gas price, in satoshis per gas unit, needed for a contract
+     *  transaction to be included in a block within confTarget blocks. Works
+     *  like estimateSmartFee, over the lowest gas price of each transaction's
+     *  contract outputs. Returns 0 if no estimate can be given.
+     */
+    CAmount estimateSmartGasPrice(int confTarget, FeeCalculation *feeCalc, bool conservative) const;
+
     /** Write estimation data to a file */
     bool Write(CAutoFile& fileout) const;
 
     /** Read estimation data from a file */
     bool Read(CAutoFile& filein);
 
+    /** Write gas price estimation data to a file */
+    bool WriteGasPrices(CAutoFile& fileout) const;
+
+    /** Read gas price estimation data from a file */
+    bool ReadGasPrices(CAutoFile& filein);
+
     /** Empty mempool transactions on shutdown to record failure to confirm for txs still in mempool */
     void FlushUnconfirmed();
 
@@ -234,7 +254,9 @@ private:
     {
         unsigned int blockHeight;
         unsigned int bucketIndex;
-        TxStatsInfo() : blockHeight(0), bucketIndex(0) {}
+        bool gasTracked;
+        unsigned int gasBucketIndex;
+        TxStatsInfo() : blockHeight(0), bucketIndex(0), gasTracked(false), gasBucketIndex(0) {}
     };
 
     // map of txids to information about that transaction
@@ -245,19 +267,30 @@ private:
     std::unique_ptr<TxConfirmStats> shortStats PT_GUARDED_BY(m_cs_fee_estimator);
     std::unique_ptr<TxConfirmStats> longStats PT_GUARDED_BY(m_cs_fee_estimator);
 
+    /** The same, over the gas prices of contract transactions */
+    std::unique_ptr<TxConfirmStats> gasStats PT_GUARDED_BY(m_cs_fee_estimator);
+    std::unique_ptr<TxConfirmStats> gasShortStats PT_GUARDED_BY(m_cs_fee_estimator);
+    std::unique_ptr<TxConfirmStats> gasLongStats PT_GUARDED_BY(m_cs_fee_estimator);
+
     unsigned int trackedTxs GUARDED_BY(m_cs_fee_estimator);
     unsigned int untrackedTxs GUARDED_BY(m_cs_fee_estimator);
 
     std::vector<double> buckets GUARDED_BY(m_cs_fee_estimator); // The upper-bound of the range for the bucket (inclusive)
     std::map<double, unsigned int> bucketMap GUARDED_BY(m_cs_fee_estimator); // Map of bucket upper-bound to index into all vectors by bucket
+    std::vector<double> gasBuckets GUARDED_BY(m_cs_fee_estimator);
+    std::map<double, unsigned int> gasBucketMap GUARDED_BY(m_cs_fee_estimator);
 
     /** Process a transaction confirmed in a block*/
     bool processBlockTx(unsigned int nBlockHeight, const CTxMemPoolEntry* entry) EXCLUSIVE_LOCKS_REQUIRED(m_cs_fee_estimator);
 
+    /** The fee rate or, with gas, the gas price stats of a time horizon */
+    const TxConfirmStats& GetStats(FeeEstimateHorizon horizon, bool gas) const EXCLUSIVE_LOCKS_REQUIRED(m_cs_fee_estimator);
+    /** Helper for estimateSmartFee and estimateSmartGasPrice */
+    double estimateSmart(int confTarget, FeeCalculation *feeCalc, bool conservative, bool gas) const EXCLUSIVE_LOCKS_REQUIRED(m_cs_fee_estimator);
     /** Helper for estimateSmartFee */
-    double estimateCombinedFee(unsigned int confTarget, double successThreshold, bool checkShorterHorizon, EstimationResult *result) const EXCLUSIVE_LOCKS_REQUIRED(m_cs_fee_estimator);
+    double estimateCombinedFee(unsigned int confTarget, double successThreshold, bool checkShorterHorizon, EstimationResult *result, bool gas = false) const EXCLUSIVE_LOCKS_REQUIRED(m_cs_fee_estimator);
     /** Helper for estimateSmartFee */
-    double estimateConservativeFee(unsigned int doubleTarget, EstimationResult *result) const EXCLUSIVE_LOCKS_REQUIRED(m_cs_fee_estimator);
+    double estimateConservativeFee(unsigned int doubleTarget, EstimationResult *result, bool gas = false) const EXCLUSIVE_LOCKS_REQUIRED(m_cs_fee_estimator);
     /** Number of blocks of data recorded while fee estimates have been running */
     unsigned int BlockSpan() const EXCLUSIVE_LOCKS_REQUIRED(m_cs_fee_estimator);
     /** Number of blocks of recorded fee estimate data represented in saved data file */
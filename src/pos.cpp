@@ -10,6 +10,8 @@
 #include <validation.h>
 #include <arith_uint256.h>
 #include <hash.h>
+#include <crypto/sha256.h>
+#include <streams.h>
 #include <timedata.h>
 #include <chainparams.h>
 #include <script/sign.h>
@@ -98,6 +100,44 @@ bool CheckStakeKernelHash(CBlockIndex* pindexPrev, unsigned int nBits, uint32_t
     return true;
 }
 
+void CheckStakeKernelHashes(CBlockIndex* pindexPrev, unsigned int nBits, uint32_t nTimeBlock, const std::vector<COutPoint>& prevouts, const std::map<COutPoint, CStakeCache>& cache, std::vector<bool>& vKernel)
+{
+    vKernel.assign(prevouts.size(), true);
+
+    // Serialize the kernels of all cached coins back to back, as CheckStakeKernelHash does one at a time
+    std::vector<unsigned char> data;
+    CVectorWriter ss(SER_GETHASH, 0, data, 0);
+    std::vector<size_t> vIndex;
+    std::vector<CAmount> vAmount;
+    for (size_t i = 0; i < prevouts.size(); i++) {
+        auto it = cache.find(prevouts[i]);
+        if (it == cache.end() || nTimeBlock < it->second.blockFromTime)
+            continue;
+        ss << pindexPrev->nStakeModifier;
+        ss << it->second.blockFromTime << prevouts[i].hash << prevouts[i].n << nTimeBlock;
+        vIndex.push_back(i);
+        vAmount.push_back(it->second.amount);
+    }
+    if (vIndex.empty())
+        return;
+
+    const size_t nKernelSize = data.size() / vIndex.size();
+    std::vector<const unsigned char*> vInput(vIndex.size());
+    std::vector<size_t> vLength(vIndex.size(), nKernelSize);
+    for (size_t j = 0; j < vIndex.size(); j++) {
+        vInput[j] = data.data() + j * nKernelSize;
+    }
+    std::vector<uint256> vHash(vIndex.size());
+    SHA256DMulti(vHash[0].begin(), vInput.data(), vLength.data(), vHash.size());
+
+    for (size_t j = 0; j < vIndex.size(); j++) {
+        arith_uint256 bnTarget;
+        bnTarget.SetCompact(nBits);
+        bnTarget *= arith_uint256(vAmount[j]);
+        vKernel[vIndex[j]] = UintToArith256(vHash[j]) <= bnTarget;
+    }
+}
+
 // Check kernel hash target and coinstake signature
 bool CheckProofOfStake(CBlockIndex* pindexPrev, CValidationState& state, const CTransaction& tx, unsigned int nBits, uint32_t nTimeBlock, uint256& hashProofOfStake, uint256& targetProofOfStake, CCoinsViewCache& view)
 {
@@ -36,6 +36,11 @@ uint256 ComputeStakeModifier(const CBlockIndex* pindexPrev, const uint256& kerne
 // Sets hashProofOfStake on success return
 bool CheckStakeKernelHash(CBlockIndex* pindexPrev, unsigned int nBits, uint32_t blockFromTime, CAmount prevoutAmount, const COutPoint& prevout, unsigned int nTimeTx, uint256& hashProofOfStake, uint256& targetProofOfStake, bool fPrintProofOfStake=false);
 
+// Check the kernel hashes of many coins at once with the multi-way SHA256.
+// vKernel[i] is left set unless prevouts[i] is in the stake cache and misses
+// the target, so only the coins still set need to go through CheckKernel.
+void CheckStakeKernelHashes(CBlockIndex* pindexPrev, unsigned int nBits, uint32_t nTimeBlock, const std::vector<COutPoint>& prevouts, const std::map<COutPoint, CStakeCache>& cache, std::vector<bool>& vKernel);
+
 // Check kernel hash target and coinstake signature
 // Sets hashProofOfStake on success return
 bool CheckProofOfStake(CBlockIndex* pindexPrev, CValidationState& state, const CTransaction& tx, unsigned int nBits, uint32_t nTimeBlock, uint256& hashProofOfStake, uint256& targetProofOfStake, CCoinsViewCache& view);
@@ -5,7 +5,9 @@
 
 #include <primitives/transaction.h>
 
+#include <crypto/sha256.h>
 #include <hash.h>
+#include <streams.h>
 #include <tinyformat.h>
 #include <util/strencodings.h>
 
@@ -79,6 +81,44 @@ uint256 CTransaction::ComputeWitnessHash() const
 CTransaction::CTransaction() : vin(), vout(), nVersion(CTransaction::CURRENT_VERSION), nLockTime(0), hash{}, m_witness_hash{} {}
 CTransaction::CTransaction(const CMutableTransaction& tx) : vin(tx.vin), vout(tx.vout), nVersion(tx.nVersion), nLockTime(tx.nLockTime), hash{ComputeHash()}, m_witness_hash{ComputeWitnessHash()} {}
 CTransaction::CTransaction(CMutableTransaction&& tx) : vin(std::move(tx.vin)), vout(std::move(tx.vout)), nVersion(tx.nVersion), nLockTime(tx.nLockTime), hash{ComputeHash()}, m_witness_hash{ComputeWitnessHash()} {}
+CTransaction::CTransaction(CMutableTransaction&& tx, const uint256& hashIn, const uint256& witness_hash) : vin(std::move(tx.vin)), vout(std::move(tx.vout)), nVersion(tx.nVersion), nLockTime(tx.nLockTime), hash{hashIn}, m_witness_hash{witness_hash} {}
+
+std::vector<CTransactionRef> MakeTransactionRefs(std::vector<CMutableTransaction>&& txs)
+{
+    std::vector<CTransactionRef> vtx;
+    if (txs.empty()) return vtx;
+
+    // Serialize every transaction without its witness, and once more with it
+    // if it has one, then hash all of them in a single multi-way pass.
+    std::vector<unsigned char> data;
+    std::vector<size_t> ends;
+    ends.reserve(txs.size());
+    for (const CMutableTransaction& tx : txs) {
+        CVectorWriter(SER_GETHASH, SERIALIZE_TRANSACTION_NO_WITNESS, data, data.size()) << tx;
+        ends.push_back(data.size());
+        if (tx.HasWitness()) {
+            CVectorWriter(SER_GETHASH, 0, data, data.size()) << tx;
+            ends.push_back(data.size());
+        }
+    }
+    std::vector<const unsigned char*> inputs(ends.size());
+    std::vector<size_t> lengths(ends.size());
+    for (size_t i = 0, begin = 0; i < ends.size(); begin = ends[i++]) {
+        inputs[i] = data.data() + begin;
+        lengths[i] = ends[i] - begin;
+    }
+    std::vector<uint256> hashes(ends.size());
+    SHA256DMulti(hashes[0].begin(), inputs.data(), lengths.data(), hashes.size());
+
+    vtx.reserve(txs.size());
+    size_t next = 0;
+    for (CMutableTransaction& tx : txs) {
+        const uint256& hash = hashes[next++];
+        const uint256& witness_hash = tx.HasWitness() ? hashes[next++] : hash;
+        vtx.push_back(std::make_shared<const CTransaction>(std::move(tx), hash, witness_hash));
+    }
+    return vtx;
+}
 
 CAmount CTransaction::GetValueOut() const
 {
@@ -323,6 +323,8 @@ public:
     /** Convert a CMutableTransaction into a CTransaction. */
     CTransaction(const CMutableTransaction &tx);
     CTransaction(CMutableTransaction &&tx);
+    /** Convert a CMutableTransaction whose txid and wtxid were already computed, see MakeTransactionRefs. */
+    CTransaction(CMutableTransaction &&tx, const uint256& hashIn, const uint256& witness_hash);
 
     template <typename Stream>
     inline void Serialize(Stream& s) const {
@@ -454,4 +456,7 @@ typedef std::shared_ptr<const CTransaction> CTransactionRef;
 static inline CTransactionRef MakeTransactionRef() { return std::make_shared<const CTransaction>(); }
 template <typename Tx> static inline CTransactionRef MakeTransactionRef(Tx&& txIn) { return std::make_shared<const CTransaction>(std::forward<Tx>(txIn)); }
 
+/** Convert deserialized transactions into CTransactionRefs, computing all their txids and wtxids at once with SHA256DMulti. */
+std::vector<CTransactionRef> MakeTransactionRefs(std::vector<CMutableTransaction>&& txs);
+
 #endif // BITCOIN_PRIMITIVES_TRANSACTION_H
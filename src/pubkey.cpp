@@ -8,6 +8,8 @@
 #include <secp256k1.h>
 #include <secp256k1_recovery.h>
 
+#include <map>
+
 namespace
 {
 /* Global secp256k1_context object used for verification. */
@@ -183,6 +185,54 @@ bool CPubKey::Verify(const uint256 &hash, const std::vector<unsigned char>& vchS
     return secp256k1_ecdsa_verify(secp256k1_context_verify, &sig, hash.begin(), &pubkey);
 }
 
+void CPubKeyBatchVerifier::Add(const CPubKey& pubkey, const uint256& hash, const std::vector<unsigned char>& vchSig) {
+    m_pubkeys.push_back(pubkey);
+    m_hashes.push_back(hash);
+    m_sigs.push_back(vchSig);
+}
+
+bool CPubKeyBatchVerifier::Verify(std::vector<bool>& results) const {
+    const size_t n = m_hashes.size();
+    results.assign(n, false);
+    std::vector<secp256k1_pubkey> pubkeys(n);
+    std::vector<secp256k1_ecdsa_signature> sigs(n);
+    std::vector<const secp256k1_pubkey*> pubkey_ptrs;
+    std::vector<const secp256k1_ecdsa_signature*> sig_ptrs;
+    std::vector<const unsigned char*> msg_ptrs;
+    std::vector<size_t> entries;
+    // Index of the first entry with each public key, or n if it failed to parse
+    std::map<CPubKey, size_t> parsed;
+    bool all = true;
+    for (size_t i = 0; i < n; i++) {
+        const CPubKey& pubkey = m_pubkeys[i];
+        auto it = parsed.find(pubkey);
+        if (it == parsed.end()) {
+            const bool ok = pubkey.IsValid() && secp256k1_ec_pubkey_parse(secp256k1_context_verify, &pubkeys[i], pubkey.data(), pubkey.size());
+            it = parsed.emplace(pubkey, ok ? i : n).first;
+        }
+        if (it->second == n || !ecdsa_signature_parse_der_lax(secp256k1_context_verify, &sigs[i], m_sigs[i].data(), m_sigs[i].size())) {
+            all = false;
+            continue;
+        }
+        /* libsecp256k1's ECDSA verification requires lower-S signatures, which have
+         * not historically been enforced in Bitcoin, so normalize them first. */
+        secp256k1_ecdsa_signature_normalize(secp256k1_context_verify, &sigs[i], &sigs[i]);
+        pubkey_ptrs.push_back(&pubkeys[it->second]);
+        sig_ptrs.push_back(&sigs[i]);
+        msg_ptrs.push_back(m_hashes[i].begin());
+        entries.push_back(i);
+    }
+    if (entries.empty()) {
+        return all;
+    }
+    std::vector<int> verified(entries.size());
+    all &= secp256k1_ecdsa_verify_batch(secp256k1_context_verify, verified.data(), sig_ptrs.data(), msg_ptrs.data(), pubkey_ptrs.data(), entries.size()) == 1;
+    for (size_t j = 0; j < entries.size(); j++) {
+        results[entries[j]] = verified[j] == 1;
+    }
+    return all;
+}
+
 bool CPubKey::RecoverLaxDER(const uint256 &hash, const std::vector<unsigned char>& vchSig, uint8_t recid, bool fComp) {
     secp256k1_ecdsa_signature sig;
     if (!ecdsa_signature_parse_der_lax(secp256k1_context_verify, &sig, vchSig.data(), vchSig.size())) {
@@ -256,6 +256,31 @@ struct CExtPubKey {
     }
 };
 
+/**
+ * Collects DER signatures to verify them together. Each signature is checked
+ * exactly as by CPubKey::Verify, but public keys that appear several times
+ * are only parsed once and the inversions of the signatures' s values are
+ * shared by the whole batch.
+ */
+class CPubKeyBatchVerifier
+{
+private:
+    std::vector<CPubKey> m_pubkeys;
+    std::vector<uint256> m_hashes;
+    std::vector<std::vector<unsigned char>> m_sigs;
+
+public:
+    void Add(const CPubKey& pubkey, const uint256& hash, const std::vector<unsigned char>& vchSig);
+
+    size_t size() const { return m_hashes.size(); }
+
+    /**
+     * Verify all signatures added so far, results[i] tells whether the i'th
+     * one is valid. Returns whether all of them are.
+     */
+    bool Verify(std::vector<bool>& results) const;
+};
+
 /** Users of this module must hold an ECCVerifyHandle. The constructor and
  *  destructor of these are not allowed to run in parallel, though. */
 class ECCVerifyHandle
@@ -1,19 +1,50 @@
 #include <qtum/storageresults.h>
+#include <dbwrapper.h>
+#include <streams.h>
 #include <util/convert.h>
 
+static void SerializeAddress(CDataStream& ss, const dev::Address& address)
+{
+    ss.write((const char*)address.data(), dev::Address::size);
+}
+
+void SerializeLogEntry(CDataStream& ss, const dev::eth::LogEntry& log)
+{
+    SerializeAddress(ss, log.address);
+    WriteCompactSize(ss, log.topics.size());
+    for (const dev::h256& topic : log.topics)
+        ss.write((const char*)topic.data(), dev::h256::size);
+    ss << log.data;
+}
+
+void SerializeReceipt(CDataStream& ss, const TransactionReceiptInfo& receipt)
+{
+    ss << receipt.blockHash << receipt.blockNumber << receipt.transactionHash << receipt.transactionIndex << receipt.outputIndex;
+    SerializeAddress(ss, receipt.from);
+    SerializeAddress(ss, receipt.to);
+    SerializeAddress(ss, receipt.contractAddress);
+    ss << receipt.cumulativeGasUsed << receipt.gasUsed << static_cast<uint32_t>(receipt.excepted) << receipt.exceptedMessage;
+    WriteCompactSize(ss, receipt.logs.size());
+    for (const dev::eth::LogEntry& log : receipt.logs)
+        SerializeLogEntry(ss, log);
+}
+
 StorageResults::StorageResults(std::string const& _path){
 	path = _path + "/resultsDB";
-    leveldb::Options options;
+    ApplyDBProfile(GetDBProfile("resultsDB"), options);
     options.create_if_missing = true;
     leveldb::Status status = leveldb::DB::Open(options, path, &db);
     assert(status.ok());
+    RegisterLevelDB("resultsDB", db);
     LogPrintf("Opened LevelDB successfully\n");
 }
 
 StorageResults::~StorageResults()
 {
+    UnregisterLevelDB(db);
     delete db;
     db = NULL;
+    delete options.filter_policy;
 }
 
 void StorageResults::addResult(dev::h256 hashTx, std::vector<TransactionReceiptInfo>& result){
@@ -28,14 +59,14 @@ void StorageResults::wipeResults(){
     LogPrintf("Wiping LevelDB in %s\n", path);
     bool opened = db;
     if (opened) {
+        UnregisterLevelDB(db);
         delete db;
     }
     leveldb::Status result = leveldb::DestroyDB(path, leveldb::Options());
     if (opened) {
-        leveldb::Options options;
-        options.create_if_missing = true;
         leveldb::Status status = leveldb::DB::Open(options, path, &db);
         assert(status.ok());
+        RegisterLevelDB("resultsDB", db);
     }
 }
 
@@ -39,6 +39,13 @@ struct TransactionReceiptInfoSerialized{
     std::vector<uint32_t> outputIndexes;
 };
 
+class CDataStream;
+
+/** Compact binary encoding of a log entry and of a receipt, used by the ZMQ
+ *  contract topics and the REST block range export */
+void SerializeLogEntry(CDataStream& ss, const dev::eth::LogEntry& log);
+void SerializeReceipt(CDataStream& ss, const TransactionReceiptInfo& receipt);
+
 class StorageResults{
 
 public:
@@ -68,6 +75,8 @@ private:
 
 	std::string path;
 
+    leveldb::Options options;
+
     leveldb::DB* db;
 
 	std::unordered_map<dev::h256, std::vector<TransactionReceiptInfo>> m_cache_result;
@@ -12,11 +12,13 @@
 #include <primitives/block.h>
 #include <primitives/transaction.h>
 #include <rpc/blockchain.h>
+#include <rpc/jsonstream.h>
 #include <rpc/protocol.h>
 #include <rpc/server.h>
 #include <streams.h>
 #include <sync.h>
 #include <txmempool.h>
+#include <util/convert.h>
 #include <util/strencodings.h>
 #include <validation.h>
 #include <version.h>
@@ -26,6 +28,7 @@
 #include <univalue.h>
 
 static const size_t MAX_GETUTXOS_OUTPOINTS = 15; //allow a max of 15 outpoints to be queried at once
+static const size_t MAX_BLOCKRANGE_BLOCKS = 2000; //allow a max of 2000 blocks to be exported at once
 
 enum class RetFormat {
     UNDEF,
@@ -70,6 +73,18 @@ static bool RESTERR(HTTPRequest* req, enum HTTPStatusCode status, std::string me
     return false;
 }
 
+/** Send a JSON document produced by writeJSON with chunked encoding, flushing as it is written */
+static bool RESTStreamJSON(HTTPRequest* req, const std::function<void(JSONStreamWriter&)>& writeJSON)
+{
+    req->WriteHeader("Content-Type", "application/json");
+    JSONStreamWriter writer([req](const std::string& data) { return req->StreamChunk(data); });
+    writeJSON(writer);
+    writer.Write("\n");
+    writer.Flush(true);
+    req->StreamEnd();
+    return true;
+}
+
 static RetFormat ParseDataFormat(std::string& param, const std::string& strReq)
 {
     const std::string::size_type pos = strReq.rfind('.');
@@ -243,11 +258,9 @@ static bool rest_block(HTTPRequest* req,
     }
 
     case RetFormat::JSON: {
-        UniValue objBlock = blockToJSON(block, tip, pblockindex, showTxDetails);
-        std::string strJSON = objBlock.write() + "\n";
-        req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strJSON);
-        return true;
+        return RESTStreamJSON(req, [&](JSONStreamWriter& writer) {
+            blockToJSONStream(writer, block, tip, pblockindex, showTxDetails);
+        });
     }
 
     default: {
@@ -323,12 +336,9 @@ static bool rest_mempool_contents(HTTPRequest* req, const std::string& strURIPar
 
     switch (rf) {
     case RetFormat::JSON: {
-        UniValue mempoolObject = MempoolToJSON(::mempool, true);
-
-        std::string strJSON = mempoolObject.write() + "\n";
-        req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strJSON);
-        return true;
+        return RESTStreamJSON(req, [](JSONStreamWriter& writer) {
+            MempoolToJSONStream(writer, ::mempool);
+        });
     }
     default: {
         return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: json)");
@@ -622,6 +632,107 @@ static bool rest_blockhash_by_height(HTTPRequest* req,
     }
 }
 
+/**
+ * Serialize one block of a block range export: height, block, receipts of its
+ * contract transactions and the address index entries it adds. Builds without
+ * the bitcore RPCs write no address index entries.
+ */
+static bool SerializeBlockRangeRecord(CDataStream& ss, const CBlockIndex* pindex) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    CBlock block;
+    if (!ReadBlockFromDisk(block, pindex, Params().GetConsensus()))
+        return false;
+#ifdef ENABLE_BITCORE_RPC
+    std::vector<std::pair<CAddressIndexKey, CAmount> > deltas;
+    if (!GetBlockAddressDeltas(block, pindex, deltas))
+        return false;
+#endif
+    std::vector<TransactionReceiptInfo> receipts;
+    for (const CTransactionRef& tx : block.vtx) {
+        std::vector<TransactionReceiptInfo> txReceipts = pstorageresult->getResult(uintToh256(tx->GetHash()));
+        receipts.insert(receipts.end(), txReceipts.begin(), txReceipts.end());
+    }
+
+    ss << uint32_t(pindex->nHeight) << block;
+    WriteCompactSize(ss, receipts.size());
+    for (const TransactionReceiptInfo& receipt : receipts)
+        SerializeReceipt(ss, receipt);
+#ifdef ENABLE_BITCORE_RPC
+    WriteCompactSize(ss, deltas.size());
+    for (const auto& delta : deltas) {
+        const CAddressIndexKey& key = delta.first;
+        ss << uint8_t(key.type) << key.hashBytes << uint32_t(key.txindex) << key.txhash;
+        ss << uint32_t(key.index) << uint8_t(key.spending) << delta.second;
+    }
+#else
+    WriteCompactSize(ss, 0);
+#endif
+    return true;
+}
+
+static bool rest_blockrange(HTTPRequest* req,
+                            const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string param;
+    const RetFormat rf = ParseDataFormat(param, strURIPart);
+    std::vector<std::string> path;
+    boost::split(path, param, boost::is_any_of("/"));
+
+    if (path.size() != 2)
+        return RESTERR(req, HTTP_BAD_REQUEST, "No block count specified. Use /rest/blockrange/<height>/<count>.<ext>.");
+
+    int32_t height;
+    if (!ParseInt32(path[0], &height) || height < 0)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid height: " + SanitizeString(path[0]));
+    int32_t count;
+    if (!ParseInt32(path[1], &count) || count < 1 || (size_t)count > MAX_BLOCKRANGE_BLOCKS)
+        return RESTERR(req, HTTP_BAD_REQUEST, "Block count out of range: " + SanitizeString(path[1]));
+
+    if (rf != RetFormat::BINARY && rf != RetFormat::HEX)
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: .bin, .hex)");
+
+    if (!fLogEvents)
+        return RESTERR(req, HTTP_NOT_FOUND, "Events indexing disabled");
+
+    // Pin the range up front so a reorg while streaming can not mix branches
+    std::vector<const CBlockIndex*> blocks;
+    {
+        LOCK(cs_main);
+        if (height > ::ChainActive().Height())
+            return RESTERR(req, HTTP_NOT_FOUND, "Block height out of range");
+        for (const CBlockIndex* pindex = ::ChainActive()[height]; pindex && blocks.size() < (size_t)count; pindex = ::ChainActive().Next(pindex)) {
+            if (IsBlockPruned(pindex))
+                return RESTERR(req, HTTP_NOT_FOUND, pindex->GetBlockHash().GetHex() + " not available (pruned data)");
+            blocks.push_back(pindex);
+        }
+    }
+
+    req->WriteHeader("Content-Type", rf == RetFormat::BINARY ? "application/octet-stream" : "text/plain");
+    for (const CBlockIndex* pindex : blocks) {
+        CDataStream ssRecord(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags());
+        {
+            LOCK(cs_main);
+            if (!SerializeBlockRangeRecord(ssRecord, pindex)) {
+                // Too late for an error reply, end the export early
+                LogPrintf("%s: failed to read block %s\n", __func__, pindex->GetBlockHash().GetHex());
+                break;
+            }
+        }
+        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+        ss << uint32_t(ssRecord.size());
+        ss.write(ssRecord.data(), ssRecord.size());
+        std::string chunk = rf == RetFormat::BINARY ? ss.str() : HexStr(ss.begin(), ss.end());
+        if (!req->StreamChunk(chunk))
+            break;
+    }
+    if (rf == RetFormat::HEX)
+        req->StreamChunk("\n");
+    req->StreamEnd();
+    return true;
+}
+
 static const struct {
     const char* prefix;
     bool (*handler)(HTTPRequest* req, const std::string& strReq);
@@ -635,6 +746,7 @@ static const struct {
       {"/rest/headers/", rest_headers},
       {"/rest/getutxos", rest_getutxos},
       {"/rest/blockhashbyheight/", rest_blockhash_by_height},
+      {"/rest/blockrange/", rest_blockrange},
 };
 
 void StartREST()
@@ -15,14 +15,17 @@
 #include <consensus/validation.h>
 #include <core_io.h>
 #include <hash.h>
+#include <httpserver.h>
 #include <index/blockfilterindex.h>
 #include <key_io.h>
 #include <policy/feerate.h>
 #include <policy/policy.h>
 #include <policy/rbf.h>
 #include <primitives/transaction.h>
+#include <rpc/jsonstream.h>
 #include <rpc/server.h>
 #include <rpc/util.h>
+#include <scheduler.h>
 #include <script/descriptor.h>
 #include <streams.h>
 #include <sync.h>
@@ -50,6 +53,8 @@
 #include <boost/thread/thread.hpp> // boost::thread::interrupt
 
 #include <condition_variable>
+#include <list>
+#include <map>
 #include <memory>
 #include <mutex>
 
@@ -214,59 +219,88 @@ UniValue blockheaderToJSON(const CBlockIndex* tip, const CBlockIndex* blockindex
     return result;
 }
 
+/** Fill in the fields of a block that come before and after its transaction list */
+static void blockFieldsToJSON(const CBlock& block, const CBlockIndex* tip, const CBlockIndex* blockindex, UniValue& before, UniValue& after)
+{
+    before.pushKV("hash", blockindex->GetBlockHash().GetHex());
+    const CBlockIndex* pnext;
+    int confirmations = ComputeNextBlockAndDepth(tip, blockindex, pnext);
+    before.pushKV("confirmations", confirmations);
+    before.pushKV("strippedsize", (int)::GetSerializeSize(block, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS));
+    before.pushKV("size", (int)::GetSerializeSize(block, PROTOCOL_VERSION));
+    before.pushKV("weight", (int)::GetBlockWeight(block));
+    before.pushKV("height", blockindex->nHeight);
+    before.pushKV("version", block.nVersion);
+    before.pushKV("versionHex", strprintf("%08x", block.nVersion));
+    before.pushKV("merkleroot", block.hashMerkleRoot.GetHex());
+    before.pushKV("hashStateRoot", block.hashStateRoot.GetHex()); // qtum
+    before.pushKV("hashUTXORoot", block.hashUTXORoot.GetHex()); // qtum
+
+    after.pushKV("time", block.GetBlockTime());
+    after.pushKV("mediantime", (int64_t)blockindex->GetMedianTimePast());
+    after.pushKV("nonce", (uint64_t)block.nNonce);
+    after.pushKV("bits", strprintf("%08x", block.nBits));
+    after.pushKV("difficulty", GetDifficulty(blockindex));
+    after.pushKV("chainwork", blockindex->nChainWork.GetHex());
+    after.pushKV("nTx", (uint64_t)blockindex->nTx);
+
+    if (blockindex->pprev)
+        after.pushKV("previousblockhash", blockindex->pprev->GetBlockHash().GetHex());
+    if (pnext)
+        after.pushKV("nextblockhash", pnext->GetBlockHash().GetHex());
+
+    after.pushKV("flags", strprintf("%s", blockindex->IsProofOfStake()? "proof-of-stake" : "proof-of-work"));
+    after.pushKV("proofhash", blockindex->hashProof.GetHex());
+    after.pushKV("modifier", blockindex->nStakeModifier.GetHex());
+
+    if (block.IsProofOfStake())
+        after.pushKV("signature", HexStr(block.vchBlockSig.begin(), block.vchBlockSig.end()));
+}
+
+static UniValue blockTxToJSON(const CTransactionRef& tx, bool txDetails)
+{
+    if (!txDetails)
+        return tx->GetHash().GetHex();
+    UniValue objTx(UniValue::VOBJ);
+    TxToUniv(*tx, uint256(), objTx, true, RPCSerializationFlags());
+    return objTx;
+}
+
 UniValue blockToJSON(const CBlock& block, const CBlockIndex* tip, const CBlockIndex* blockindex, bool txDetails)
 {
     // Serialize passed information without accessing chain state of the active chain!
     AssertLockNotHeld(cs_main); // For performance reasons
 
     UniValue result(UniValue::VOBJ);
-    result.pushKV("hash", blockindex->GetBlockHash().GetHex());
-    const CBlockIndex* pnext;
-    int confirmations = ComputeNextBlockAndDepth(tip, blockindex, pnext);
-    result.pushKV("confirmations", confirmations);
-    result.pushKV("strippedsize", (int)::GetSerializeSize(block, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS));
-    result.pushKV("size", (int)::GetSerializeSize(block, PROTOCOL_VERSION));
-    result.pushKV("weight", (int)::GetBlockWeight(block));
-    result.pushKV("height", blockindex->nHeight);
-    result.pushKV("version", block.nVersion);
-    result.pushKV("versionHex", strprintf("%08x", block.nVersion));
-    result.pushKV("merkleroot", block.hashMerkleRoot.GetHex());
-    result.pushKV("hashStateRoot", block.hashStateRoot.GetHex()); // qtum
-    result.pushKV("hashUTXORoot", block.hashUTXORoot.GetHex()); // qtum
+    UniValue after(UniValue::VOBJ);
+    blockFieldsToJSON(block, tip, blockindex, result, after);
     UniValue txs(UniValue::VARR);
     for(const auto& tx : block.vtx)
-    {
-        if(txDetails)
-        {
-            UniValue objTx(UniValue::VOBJ);
-            TxToUniv(*tx, uint256(), objTx, true, RPCSerializationFlags());
-            txs.push_back(objTx);
-        }
-        else
-            txs.push_back(tx->GetHash().GetHex());
-    }
+        txs.push_back(blockTxToJSON(tx, txDetails));
     result.pushKV("tx", txs);
-    result.pushKV("time", block.GetBlockTime());
-    result.pushKV("mediantime", (int64_t)blockindex->GetMedianTimePast());
-    result.pushKV("nonce", (uint64_t)block.nNonce);
-    result.pushKV("bits", strprintf("%08x", block.nBits));
-    result.pushKV("difficulty", GetDifficulty(blockindex));
-    result.pushKV("chainwork", blockindex->nChainWork.GetHex());
-    result.pushKV("nTx", (uint64_t)blockindex->nTx);
-
-    if (blockindex->pprev)
-        result.pushKV("previousblockhash", blockindex->pprev->GetBlockHash().GetHex());
-    if (pnext)
-        result.pushKV("nextblockhash", pnext->GetBlockHash().GetHex());
+    result.pushKVs(after);
 
-    result.pushKV("flags", strprintf("%s", blockindex->IsProofOfStake()? "proof-of-stake" : "proof-of-work"));
-    result.pushKV("proofhash", blockindex->hashProof.GetHex());
-    result.pushKV("modifier", blockindex->nStakeModifier.GetHex());
+    return result;
+}
 
-    if (block.IsProofOfStake())
-        result.pushKV("signature", HexStr(block.vchBlockSig.begin(), block.vchBlockSig.end()));	
+void blockToJSONStream(JSONStreamWriter& writer, const CBlock& block, const CBlockIndex* tip, const CBlockIndex* blockindex, bool txDetails)
+{
+    AssertLockNotHeld(cs_main); // The writer may block on the client
 
-    return result;
+    UniValue before(UniValue::VOBJ);
+    UniValue after(UniValue::VOBJ);
+    blockFieldsToJSON(block, tip, blockindex, before, after);
+    writer.BeginObject();
+    writer.Fields(before);
+    writer.Key("tx");
+    writer.BeginArray();
+    for (const auto& tx : block.vtx) {
+        writer.Value(blockTxToJSON(tx, txDetails));
+        if (!writer.Flush()) return;
+    }
+    writer.EndArray();
+    writer.Fields(after);
+    writer.EndObject();
 }
 
 //////////////////////////////////////////////////////////////////////////// // qtum
@@ -636,6 +670,33 @@ static void entryToJSON(const CTxMemPool& pool, UniValue& info, const CTxMemPool
     info.pushKV("bip125-replaceable", rbfStatus);
 }
 
+/** Number of mempool entries serialized per lock acquisition when streaming */
+static const size_t MEMPOOL_STREAM_BATCH = 100;
+
+void MempoolToJSONStream(JSONStreamWriter& writer, const CTxMemPool& pool)
+{
+    // Take the lock per batch of entries only, never while the writer flushes
+    std::vector<uint256> vtxid;
+    pool.queryHashes(vtxid);
+
+    writer.BeginObject();
+    for (size_t i = 0; i < vtxid.size();) {
+        {
+            LOCK(pool.cs);
+            for (size_t end = std::min(vtxid.size(), i + MEMPOOL_STREAM_BATCH); i < end; ++i) {
+                auto it = pool.mapTx.find(vtxid[i]);
+                if (it == pool.mapTx.end()) continue; // removed in the meantime
+                UniValue info(UniValue::VOBJ);
+                entryToJSON(pool, info, *it);
+                writer.Key(vtxid[i].ToString());
+                writer.Value(info);
+            }
+        }
+        if (!writer.Flush()) return;
+    }
+    writer.EndObject();
+}
+
 UniValue MempoolToJSON(const CTxMemPool& pool, bool verbose)
 {
     if (verbose) {
@@ -693,6 +754,13 @@ static UniValue getrawmempool(const JSONRPCRequest& request)
     if (!request.params[0].isNull())
         fVerbose = request.params[0].get_bool();
 
+    if (fVerbose && request.canStream) {
+        request.StreamReply([](JSONStreamWriter& writer) {
+            MempoolToJSONStream(writer, ::mempool);
+        });
+        return NullUniValue;
+    }
+
     return MempoolToJSON(::mempool, fVerbose);
 }
 
@@ -1241,6 +1309,13 @@ static UniValue getblock(const JSONRPCRequest& request)
         return strHex;
     }
 
+    if (verbosity >= 2 && request.canStream) {
+        request.StreamReply([&](JSONStreamWriter& writer) {
+            blockToJSONStream(writer, block, tip, pblockindex, true);
+        });
+        return NullUniValue;
+    }
+
     return blockToJSON(block, tip, pblockindex, verbosity >= 2);
 }
 
@@ -1532,6 +1607,318 @@ private:
     }
 };
 
+/** Interval in milliseconds between liveness pings of parked waitforlogs requests */
+static const int64_t WAITFORLOGS_PING_INTERVAL = 1000;
+
+/** Receipts of the transactions with logs of a single block */
+typedef std::vector<std::vector<TransactionReceiptInfo>> BlockLogs;
+
+/** Receipts of the blocks with logs read during one tip update, shared between all waiters */
+struct BlockLogsCache
+{
+    std::map<int, BlockLogs> blocks;
+    //! Heights scanned so far, none while low > high
+    int low = 0;
+    int high = -1;
+};
+
+static void ReadBlockLogs(int low, int high, std::map<int, BlockLogs>& blocks) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    std::vector<std::vector<uint256>> hashesToBlock;
+    std::vector<int> heights;
+    pblocktree->ReadHeightIndex(low, high, 0, hashesToBlock, std::set<dev::h160>(), &heights);
+
+    std::map<int, std::set<uint256>> dupes;
+    for (size_t i = 0; i < hashesToBlock.size(); i++) {
+        std::set<uint256>& blockDupes = dupes[heights[i]];
+        for (const auto& txHash : hashesToBlock[i]) {
+            if (blockDupes.insert(txHash).second) {
+                blocks[heights[i]].push_back(pstorageresult->getResult(uintToh256(txHash)));
+            }
+        }
+    }
+}
+
+/** Make sure the cache covers the heights from..last, scanning only the parts not read yet */
+static void ScanBlockLogs(BlockLogsCache& cache, int from, int last) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    if (from > last) {
+        return;
+    }
+    if (cache.low > cache.high) {
+        ReadBlockLogs(from, last, cache.blocks);
+        cache.low = from;
+        cache.high = last;
+        return;
+    }
+    if (from < cache.low) {
+        ReadBlockLogs(from, cache.low - 1, cache.blocks);
+        cache.low = from;
+    }
+    if (last > cache.high) {
+        ReadBlockLogs(cache.high + 1, last, cache.blocks);
+        cache.high = last;
+    }
+}
+
+static bool MatchLogTopics(const dev::eth::LogEntry& log, const std::vector<boost::optional<dev::h256>>& filterTopics)
+{
+    for (size_t i = 0; i < filterTopics.size(); i++) {
+        if (!filterTopics[i]) {
+            continue;
+        }
+        if (i >= log.topics.size() || log.topics[i] != filterTopics[i].get()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool MatchLogAddresses(const std::vector<TransactionReceiptInfo>& receipts, const std::set<dev::h160>& addresses)
+{
+    if (addresses.empty()) {
+        return true;
+    }
+    for (const auto& receipt : receipts) {
+        for (const auto& log : receipt.logs) {
+            if (addresses.count(log.address)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/**
+ * Registry of parked waitforlogs requests.
+ *
+ * A parked request does not hold an HTTP worker thread. On every tip update
+ * the receipts of each newly confirmed block are read once and matched
+ * against the filters of all waiters; finished requests are replied to from
+ * the HTTP work queue.
+ */
+class LogWaiters final : public CValidationInterface
+{
+public:
+    /**
+     * Match the request against the blocks available now. Returns true and
+     * sets result if it is already satisfied, otherwise parks the request
+     * and returns false.
+     */
+    bool Register(JSONRPCRequest& request, const WaitForLogsParams& params, UniValue& result);
+    void Start(CScheduler& scheduler);
+    void Stop();
+
+protected:
+    void UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload) override;
+
+private:
+    struct Waiter {
+        JSONRPCRequest request;
+        std::shared_ptr<HTTPRequest> httpRequest;
+        WaitForLogsParams params;
+        //! Lowest block height not yet matched against the filter
+        int nextHeight;
+
+        Waiter(const JSONRPCRequest& _request, const WaitForLogsParams& _params) :
+            request(_request), httpRequest(_request.req->shared_from_this()), params(_params), nextHeight(_params.fromBlock) {}
+    };
+
+    bool Match(Waiter& waiter, BlockLogsCache& cache, UniValue& result) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    void PingAll();
+    static void Reply(const std::shared_ptr<Waiter>& waiter, const UniValue& result);
+    static void Cancel(const std::shared_ptr<Waiter>& waiter);
+
+    Mutex m_mutex;
+    std::list<std::shared_ptr<Waiter>> m_waiters GUARDED_BY(m_mutex);
+    bool m_running GUARDED_BY(m_mutex) = false;
+};
+
+static LogWaiters g_log_waiters;
+
+bool LogWaiters::Match(Waiter& waiter, BlockLogsCache& cache, UniValue& result)
+{
+    const WaitForLogsParams& params = waiter.params;
+
+    int lastHeight = ::ChainActive().Height() - params.minconf;
+    if (params.toBlock > -1) {
+        lastHeight = std::min(lastHeight, params.toBlock);
+    }
+
+    // if curheight stays 0 no log entry was found in the new blocks, keep waiting.
+    // if curheight advanced, but all filtered out, return an empty array, but advance the cursor anyway.
+    int curheight = 0;
+    UniValue jsonLogs(UniValue::VARR);
+
+    ScanBlockLogs(cache, waiter.nextHeight, lastHeight);
+    auto end = cache.blocks.upper_bound(lastHeight);
+    for (auto it = cache.blocks.lower_bound(waiter.nextHeight); it != end; ++it) {
+        const BlockLogs& blockLogs = it->second;
+        curheight = it->first;
+
+        for (const auto& receipts : blockLogs) {
+            if (!MatchLogAddresses(receipts, params.addresses)) {
+                continue;
+            }
+            for (const auto& receipt : receipts) {
+                for (const auto& log : receipt.logs) {
+                    if (!MatchLogTopics(log, params.topics)) {
+                        continue;
+                    }
+
+                    UniValue jsonLog(UniValue::VOBJ);
+
+                    assignJSON(jsonLog, receipt);
+                    assignJSON(jsonLog, log, false);
+
+                    jsonLogs.push_back(jsonLog);
+                }
+            }
+        }
+    }
+    waiter.nextHeight = std::max(waiter.nextHeight, lastHeight + 1);
+
+    if (curheight == 0) {
+        return false;
+    }
+
+    result = UniValue(UniValue::VOBJ);
+    result.pushKV("entries", jsonLogs);
+    result.pushKV("count", (int) jsonLogs.size());
+    result.pushKV("nextblock", curheight + 1);
+    return true;
+}
+
+bool LogWaiters::Register(JSONRPCRequest& request, const WaitForLogsParams& params, UniValue& result)
+{
+    LOCK2(cs_main, m_mutex);
+
+    if (!m_running) {
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Log waiters not running");
+    }
+
+    std::shared_ptr<Waiter> waiter = std::make_shared<Waiter>(request, params);
+    BlockLogsCache cache;
+    if (Match(*waiter, cache, result)) {
+        return true;
+    }
+
+    request.PollStart();
+    request.isParked = true;
+    waiter->request = request;
+    m_waiters.push_back(waiter);
+    LogPrint(BCLog::HTTPPOLL, "waitforlogs parked from block %d, %d waiting\n", waiter->nextHeight, m_waiters.size());
+    return false;
+}
+
+void LogWaiters::Reply(const std::shared_ptr<Waiter>& waiter, const UniValue& result)
+{
+    auto func = [waiter, result] { waiter->request.PollReply(result); };
+    if (!QueueHTTPWork(func)) {
+        func();
+    }
+}
+
+void LogWaiters::Cancel(const std::shared_ptr<Waiter>& waiter)
+{
+    auto func = [waiter] { waiter->request.PollCancel(); };
+    if (!IsRPCRunning() || !QueueHTTPWork(func)) {
+        func();
+    }
+}
+
+void LogWaiters::UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload)
+{
+    {
+        LOCK(m_mutex);
+        if (m_waiters.empty()) {
+            return;
+        }
+    }
+
+    // Replying may block on the client, so it happens after the locks are released
+    std::vector<std::pair<std::shared_ptr<Waiter>, UniValue>> replies;
+    {
+        LOCK2(cs_main, m_mutex);
+
+        // Blocks are read once per tip update and shared between all waiters
+        BlockLogsCache cache;
+        for (auto it = m_waiters.begin(); it != m_waiters.end(); ) {
+            UniValue result;
+            if (Match(**it, cache, result)) {
+                replies.emplace_back(*it, std::move(result));
+                it = m_waiters.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    for (const auto& reply : replies) {
+        Reply(reply.first, reply.second);
+    }
+}
+
+void LogWaiters::PingAll()
+{
+    std::vector<std::shared_ptr<Waiter>> cancelled;
+    {
+        LOCK(m_mutex);
+
+        for (auto it = m_waiters.begin(); it != m_waiters.end(); ) {
+            JSONRPCRequest& request = (*it)->request;
+            if (!request.PollAlive() || !IsRPCRunning()) {
+                LogPrintf("waitforlogs client disconnected\n");
+                cancelled.push_back(*it);
+                it = m_waiters.erase(it);
+            } else {
+                // send an empty space to the client to ensure that it's still alive.
+                request.PollPing();
+                ++it;
+            }
+        }
+    }
+
+    for (const auto& waiter : cancelled) {
+        Cancel(waiter);
+    }
+}
+
+void LogWaiters::Start(CScheduler& scheduler)
+{
+    {
+        LOCK(m_mutex);
+        m_running = true;
+    }
+    RegisterValidationInterface(this);
+    scheduler.scheduleEvery([this] { PingAll(); }, WAITFORLOGS_PING_INTERVAL);
+}
+
+void LogWaiters::Stop()
+{
+    UnregisterValidationInterface(this);
+
+    std::list<std::shared_ptr<Waiter>> cancelled;
+    {
+        LOCK(m_mutex);
+        m_running = false;
+        cancelled.swap(m_waiters);
+    }
+    for (const auto& waiter : cancelled) {
+        Cancel(waiter);
+    }
+}
+
+void StartWaitForLogs(CScheduler& scheduler)
+{
+    g_log_waiters.Start(scheduler);
+}
+
+void StopWaitForLogs()
+{
+    g_log_waiters.Stop();
+}
+
 UniValue waitforlogs(const JSONRPCRequest& request_) {
     // this is a long poll function. force cast to non const pointer
     JSONRPCRequest& request = (JSONRPCRequest&) request_;
@@ -1576,123 +1963,23 @@ UniValue waitforlogs(const JSONRPCRequest& request_) {
     if(!request.req)
         throw JSONRPCError(RPC_INTERNAL_ERROR, "HTTP connection not available");
 
-    WaitForLogsParams params(request.params);
-
-    request.PollStart();
-
-    std::vector<std::vector<uint256>> hashesToBlock;
-
-    int curheight = 0;
-
-    auto& addresses = params.addresses;
-    auto& filterTopics = params.topics;
-
-    while (curheight == 0) {
-        {
-            LOCK(cs_main);
-            curheight = pblocktree->ReadHeightIndex(params.fromBlock, params.toBlock, params.minconf,
-                    hashesToBlock, addresses);
-        }
-
-        // if curheight >= fromBlock. Blockchain extended with new log entries. Return next block height to client.
-        //    nextBlock = curheight + 1
-        // if curheight == 0. No log entry found in index. Wait for new block then try again.
-        //    nextBlock = fromBlock
-        // if curheight == -1. Incorrect parameters has entered.
-        //
-        // if curheight advanced, but all filtered out, API should return empty array, but advancing the cursor anyway.
-
-        if (curheight > 0) {
-            break;
-        }
-
-        if (curheight == -1) {
-            throw JSONRPCError(RPC_INVALID_PARAMETER, "Incorrect params");
-        }
-
-        // wait for a new block to arrive
-        {
-            while (true) {
-                std::unique_lock<std::mutex> lock(cs_blockchange);
-                auto blockHeight = latestblock.height;
+    // Waiting takes over the HTTP connection, which a batch shares with its other calls
+    if (!request.canStream)
+        throw JSONRPCError(RPC_INVALID_REQUEST, "waitforlogs is not allowed in a batch request");
 
-                request.PollPing();
-
-                cond_blockchange.wait_for(lock, std::chrono::milliseconds(1000));
-                if (latestblock.height > blockHeight) {
-                    break;
-                }
+    WaitForLogsParams params(request.params);
 
-                // TODO: maybe just merge `IsRPCRunning` this into PollAlive
-                if (!request.PollAlive() || !IsRPCRunning()) {
-                    LogPrintf("waitforlogs client disconnected\n");
-                    return NullUniValue;
-                }
-            }
-        }
+    if ((params.toBlock < params.fromBlock && params.toBlock > -1) || (params.toBlock == 0 && params.fromBlock == 0) ||
+            params.toBlock < -1 || params.fromBlock < 0) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Incorrect params");
     }
 
-    LOCK(cs_main);
-
-    UniValue jsonLogs(UniValue::VARR);
-
-    std::set<uint256> dupes;
-
-    for (const auto& txHashes : hashesToBlock) {
-        for (const auto& txHash : txHashes) {
-
-            if(dupes.find(txHash) != dupes.end()) {
-                continue;
-            }
-            dupes.insert(txHash);
-
-            std::vector<TransactionReceiptInfo> receipts = pstorageresult->getResult(
-                    uintToh256(txHash));
-
-            for (const auto& receipt : receipts) {
-                for (const auto& log : receipt.logs) {
-
-                    bool includeLog = true;
-
-                    if (!filterTopics.empty()) {
-                        for (size_t i = 0; i < filterTopics.size(); i++) {
-                            auto filterTopic = filterTopics[i];
-
-                            if (!filterTopic) {
-                                continue;
-                            }
-
-                            auto filterTopicContent = filterTopic.get();
-                            auto topicContent = log.topics[i];
-
-                            if (topicContent != filterTopicContent) {
-                                includeLog = false;
-                                break;
-                            }
-                        }
-                    }
-
-
-                    if (!includeLog) {
-                        continue;
-                    }
-
-                    UniValue jsonLog(UniValue::VOBJ);
-
-                    assignJSON(jsonLog, receipt);
-                    assignJSON(jsonLog, log, false);
-
-                    jsonLogs.push_back(jsonLog);
-                }
-            }
-        }
+    UniValue result;
+    if (!g_log_waiters.Register(request, params, result)) {
+        // The request was parked, the reply is sent when a matching block arrives
+        return NullUniValue;
     }
 
-    UniValue result(UniValue::VOBJ);
-    result.pushKV("entries", jsonLogs);
-    result.pushKV("count", (int) jsonLogs.size());
-    result.pushKV("nextblock", curheight + 1);
-
     return result;
 }
 
@@ -15,7 +15,9 @@ extern RecursiveMutex cs_main;
 
 class CBlock;
 class CBlockIndex;
+class CScheduler;
 class CTxMemPool;
+class JSONStreamWriter;
 class UniValue;
 
 static constexpr int NUM_GETBLOCKSTATS_PERCENTILES = 5;
@@ -31,15 +33,27 @@ double GetDifficulty(const CBlockIndex* blockindex);
 /** Callback for when block tip changed. */
 void RPCNotifyBlockChange(bool ibd, const CBlockIndex *);
 
+/** Start serving parked waitforlogs requests from new tips. */
+void StartWaitForLogs(CScheduler& scheduler);
+
+/** Cancel all parked waitforlogs requests. Call after StopRPC, before StopHTTPServer. */
+void StopWaitForLogs();
+
 /** Block description to JSON */
 UniValue blockToJSON(const CBlock& block, const CBlockIndex* tip, const CBlockIndex* blockindex, bool txDetails = false) LOCKS_EXCLUDED(cs_main);
 
+/** Block description to JSON, written incrementally so that transactions are serialized one at a time */
+void blockToJSONStream(JSONStreamWriter& writer, const CBlock& block, const CBlockIndex* tip, const CBlockIndex* blockindex, bool txDetails = false) LOCKS_EXCLUDED(cs_main);
+
 /** Mempool information to JSON */
 UniValue MempoolInfoToJSON(const CTxMemPool& pool);
 
 /** Mempool to JSON */
 UniValue MempoolToJSON(const CTxMemPool& pool, bool verbose = false);
 
+/** Verbose mempool to JSON, written incrementally without holding the mempool lock while flushing */
+void MempoolToJSONStream(JSONStreamWriter& writer, const CTxMemPool& pool);
+
 /** Block header to JSON */
 UniValue blockheaderToJSON(const CBlockIndex* tip, const CBlockIndex* blockindex) LOCKS_EXCLUDED(cs_main);
 
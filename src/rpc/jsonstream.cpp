@@ -0,0 +1,99 @@
+// Copyright (c) 2019 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <rpc/jsonstream.h>
+
+#include <univalue.h>
+
+#include <assert.h>
+
+JSONStreamWriter::JSONStreamWriter(const Sink& sink, size_t flush_size)
+    : m_sink(sink), m_flush_size(flush_size), m_after_key(false), m_good(true)
+{
+    m_buffer.reserve(flush_size);
+}
+
+void JSONStreamWriter::Separate()
+{
+    if (m_after_key) {
+        m_after_key = false;
+        return;
+    }
+    if (!m_empty.empty()) {
+        if (!m_empty.back()) m_buffer += ',';
+        m_empty.back() = false;
+    }
+}
+
+void JSONStreamWriter::BeginObject()
+{
+    Separate();
+    m_buffer += '{';
+    m_empty.push_back(true);
+}
+
+void JSONStreamWriter::EndObject()
+{
+    assert(!m_empty.empty() && !m_after_key);
+    m_buffer += '}';
+    m_empty.pop_back();
+}
+
+void JSONStreamWriter::BeginArray()
+{
+    Separate();
+    m_buffer += '[';
+    m_empty.push_back(true);
+}
+
+void JSONStreamWriter::EndArray()
+{
+    assert(!m_empty.empty() && !m_after_key);
+    m_buffer += ']';
+    m_empty.pop_back();
+}
+
+void JSONStreamWriter::Key(const std::string& key)
+{
+    assert(!m_after_key);
+    Separate();
+    m_buffer += UniValue(key).write();
+    m_buffer += ':';
+    m_after_key = true;
+}
+
+void JSONStreamWriter::Value(const UniValue& value)
+{
+    Separate();
+    m_buffer += value.write();
+}
+
+void JSONStreamWriter::Fields(const UniValue& obj)
+{
+    const std::vector<std::string>& keys = obj.getKeys();
+    const std::vector<UniValue>& values = obj.getValues();
+    for (size_t i = 0; i < keys.size(); ++i) {
+        Key(keys[i]);
+        Value(values[i]);
+    }
+}
+
+void JSONStreamWriter::Write(const std::string& raw)
+{
+    m_buffer += raw;
+}
+
+bool JSONStreamWriter::Flush(bool force)
+{
+    if (!m_good) {
+        m_buffer.clear();
+        return false;
+    }
+    if (m_buffer.empty() || (!force && m_buffer.size() < m_flush_size)) {
+        return true;
+    }
+    m_good = m_sink(m_buffer);
+    m_buffer.clear();
+    return m_good;
+}
@@ -0,0 +1,68 @@
+// Copyright (c) 2019 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_RPC_JSONSTREAM_H
+#define BITCOIN_RPC_JSONSTREAM_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+class UniValue;
+
+/** Default number of bytes collected before output is handed to the sink */
+static const size_t DEFAULT_JSON_STREAM_FLUSH_SIZE = 64 * 1024;
+
+/**
+ * Writes a JSON document incrementally. Output is collected in a buffer that
+ * is handed to a sink on Flush once it has grown past the flush size, so large
+ * results never have to be built as a single UniValue or string.
+ *
+ * Small values are still written through UniValue, the writer only takes care
+ * of the enclosing objects and arrays. The output is identical to what
+ * UniValue::write() produces for the same document.
+ */
+class JSONStreamWriter
+{
+public:
+    /** Receives the next part of the output, returns false to abort */
+    typedef std::function<bool(const std::string&)> Sink;
+
+    explicit JSONStreamWriter(const Sink& sink, size_t flush_size = DEFAULT_JSON_STREAM_FLUSH_SIZE);
+
+    void BeginObject();
+    void EndObject();
+    void BeginArray();
+    void EndArray();
+
+    /** Write an object key, must be followed by a value, object or array */
+    void Key(const std::string& key);
+    void Value(const UniValue& value);
+    /** Write all key/value pairs of obj into the current object */
+    void Fields(const UniValue& obj);
+    /** Append raw text outside of the document, e.g. a trailing newline */
+    void Write(const std::string& raw);
+
+    /**
+     * Hand the buffered output to the sink if it reached the flush size, or
+     * unconditionally if force is set. Callers should not hold locks while
+     * flushing as the sink may block.
+     * Returns false once the sink failed, output is discarded from then on.
+     */
+    bool Flush(bool force = false);
+    bool Good() const { return m_good; }
+
+private:
+    void Separate();
+
+    Sink m_sink;
+    size_t m_flush_size;
+    std::string m_buffer;
+    //! For each open object or array, whether it has no elements yet
+    std::vector<bool> m_empty;
+    bool m_after_key;
+    bool m_good;
+};
+
+#endif // BITCOIN_RPC_JSONSTREAM_H
@@ -1169,6 +1169,59 @@ static UniValue estimatesmartfee(const JSONRPCRequest& request)
     return result;
 }
 
+static UniValue estimatesmartgasprice(const JSONRPCRequest& request)
+{
+            RPCHelpMan{"estimatesmartgasprice",
+                "\nEstimates the approximate gas price needed for a contract transaction to begin\n"
+                "confirmation within conf_target blocks if possible and return the number of blocks\n"
+                "for which the estimate is valid. Falls back to the minimum gas price of the\n"
+                "DGP when there is not enough data for an estimate.\n",
+                {
+                    {"conf_target", RPCArg::Type::NUM, RPCArg::Optional::NO, "Confirmation target in blocks (1 - 1008)"},
+                    {"estimate_mode", RPCArg::Type::STR, /* default */ "CONSERVATIVE", "The estimate mode, same as for estimatesmartfee.\n"
+            "       \"UNSET\"\n"
+            "       \"ECONOMICAL\"\n"
+            "       \"CONSERVATIVE\""},
+                },
+                RPCResult{
+            "{\n"
+            "  \"gasprice\" : x.x,    (numeric) estimate gas price in " + CURRENCY_UNIT + " per gas unit\n"
+            "  \"blocks\" : n         (numeric) block number where estimate was found, 0 for the DGP minimum\n"
+            "}\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("estimatesmartgasprice", "6")
+            + HelpExampleRpc("estimatesmartgasprice", "6")
+                },
+            }.Check(request);
+
+    RPCTypeCheck(request.params, {UniValue::VNUM, UniValue::VSTR});
+    RPCTypeCheckArgument(request.params[0], UniValue::VNUM);
+    unsigned int max_target = ::feeEstimator.HighestTargetTracked(FeeEstimateHorizon::LONG_HALFLIFE);
+    unsigned int conf_target = ParseConfirmTarget(request.params[0], max_target);
+    bool conservative = true;
+    if (!request.params[1].isNull()) {
+        FeeEstimateMode fee_mode;
+        if (!FeeModeFromString(request.params[1].get_str(), fee_mode)) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid estimate_mode parameter");
+        }
+        if (fee_mode == FeeEstimateMode::ECONOMICAL) conservative = false;
+    }
+
+    UniValue result(UniValue::VOBJ);
+    FeeCalculation feeCalc;
+    CAmount gasPrice = ::feeEstimator.estimateSmartGasPrice(conf_target, &feeCalc, conservative);
+    if (gasPrice == 0) {
+        LOCK(cs_main);
+        QtumDGP qtumDGP(globalState.get(), fGettingValuesDGP);
+        gasPrice = CAmount(qtumDGP.getMinGasPrice(::ChainActive().Height()));
+        feeCalc.returnedTarget = 0;
+    }
+    result.pushKV("gasprice", ValueFromAmount(gasPrice));
+    result.pushKV("blocks", feeCalc.returnedTarget);
+    return result;
+}
+
 static UniValue estimaterawfee(const JSONRPCRequest& request)
 {
             RPCHelpMan{"estimaterawfee",
@@ -1293,6 +1346,7 @@ static const CRPCCommand commands[] =
     { "generating",         "generatetoaddress",      &generatetoaddress,      {"nblocks","address","maxtries"} },
 
     { "util",               "estimatesmartfee",       &estimatesmartfee,       {"conf_target", "estimate_mode"} },
+    { "util",               "estimatesmartgasprice",  &estimatesmartgasprice,  {"conf_target", "estimate_mode"} },
 
     { "hidden",             "estimaterawfee",         &estimaterawfee,         {"conf_target", "threshold"} },
 };
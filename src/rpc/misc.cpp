@@ -4,6 +4,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <crypto/ripemd160.h>
+#include <dbwrapper.h>
 #include <key_io.h>
 #include <httpserver.h>
 #include <outputtype.h>
@@ -451,15 +452,42 @@ UniValue getaddressutxos(const JSONRPCRequest& request)
     }
 }
 
+static UniValue mempoolDeltaToJSON(const CMempoolAddressDeltaKey& key, const CMempoolAddressDelta& value)
+{
+    std::string address;
+    if (!getAddressFromIndex(key.type, key.addressBytes, address)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown address type");
+    }
+
+    UniValue delta(UniValue::VOBJ);
+    delta.pushKV("address", address);
+    delta.pushKV("txid", key.txhash.GetHex());
+    delta.pushKV("index", (int)key.index);
+    delta.pushKV("satoshis", value.amount);
+    delta.pushKV("timestamp", value.time);
+    if (value.amount < 0) {
+        delta.pushKV("prevtxid", value.prevhash.GetHex());
+        delta.pushKV("prevout", (int)value.prevout);
+    }
+    return delta;
+}
+
 UniValue getaddressmempool(const JSONRPCRequest& request)
 {
             RPCHelpMan{"getaddressmempool",
-                "\nReturns all mempool deltas for an address (requires addressindex to be enabled).\n",
+                "\nReturns all mempool deltas for an address (requires addressindex to be enabled).\n"
+                "With \"since\", returns only the changes after that sequence number instead.\n",
                 {
-                    {"addresses", RPCArg::Type::ARR, RPCArg::Optional::NO, "The HTML addresses",
+                    {"Input params", RPCArg::Type::OBJ, RPCArg::Optional::NO, "Json object",
                         {
-                            {"address", RPCArg::Type::STR, RPCArg::Optional::OMITTED, "The HTML address"},
-                        }},
+                            {"addresses", RPCArg::Type::ARR, RPCArg::Optional::NO, "The HTML addresses",
+                                {
+                                    {"address", RPCArg::Type::STR, RPCArg::Optional::OMITTED, "The HTML address"},
+                                }
+                            },
+                            {"since", RPCArg::Type::NUM, RPCArg::Optional::OMITTED_NAMED_ARG, "The sequence number returned by an earlier call"},
+                        }
+                    }
                 },
                 RPCResult{
             "[\n"
@@ -473,13 +501,35 @@ UniValue getaddressmempool(const JSONRPCRequest& request)
             "    \"prevout\"  (string) The previous transaction output index (if spending)\n"
             "  }\n"
             "]\n"
+            "\nResult (with since):\n"
+            "{\n"
+            "  \"sequence\"  (number) The sequence number to pass as since in the next call\n"
+            "  \"complete\"  (boolean) False if removals after since are no longer known, for example after a restart, and all deltas should be fetched again\n"
+            "  \"added\"  (array) Deltas added after since, as above\n"
+            "  \"removed\"  (array) Deltas added up to since and removed after it, as above\n"
+            "}\n"
                 },
                 RPCExamples{
                     HelpExampleCli("getaddressmempool", "'{\"addresses\": [\"HpT9T7cAWwvPS8EEjJ2tt3WWFncctCpya8\"]}'")
-            + HelpExampleRpc("getaddressmempool", "{\"addresses\": [\"HpT9T7cAWwvPS8EEjJ2tt3WWFncctCpya8\"]}")
+            + HelpExampleRpc("getaddressmempool", "{\"addresses\": [\"HpT9T7cAWwvPS8EEjJ2tt3WWFncctCpya8\"]}") +
+                    HelpExampleCli("getaddressmempool", "'{\"addresses\": [\"HpT9T7cAWwvPS8EEjJ2tt3WWFncctCpya8\"], \"since\": 1000}'")
+            + HelpExampleRpc("getaddressmempool", "{\"addresses\": [\"HpT9T7cAWwvPS8EEjJ2tt3WWFncctCpya8\"], \"since\": 1000}")
                 },
             }.Check(request);
 
+    bool fSince = false;
+    uint64_t since = 0;
+    if (request.params[0].isObject()) {
+        UniValue sinceValue = find_value(request.params[0].get_obj(), "since");
+        if (!sinceValue.isNull()) {
+            if (!sinceValue.isNum() || sinceValue.get_int64() < 0) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Since is expected to be a non-negative number");
+            }
+            fSince = true;
+            since = sinceValue.get_int64();
+        }
+    }
+
     std::vector<std::pair<uint256, int> > addresses;
 
     if (!getAddressesFromParams(request.params, addresses)) {
@@ -487,8 +537,13 @@ UniValue getaddressmempool(const JSONRPCRequest& request)
     }
 
     std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> > indexes;
+    std::vector<CMempoolAddressRemoval> removals;
+    uint64_t sequence = 0;
+    bool complete = true;
 
-    if (!mempool.getAddressIndex(addresses, indexes)) {
+    if (fSince) {
+        complete = mempool.getAddressDeltas(addresses, since, indexes, removals, sequence);
+    } else if (!mempool.getAddressIndex(addresses, indexes)) {
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
     }
 
@@ -498,26 +553,24 @@ UniValue getaddressmempool(const JSONRPCRequest& request)
 
     for (std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> >::iterator it = indexes.begin();
          it != indexes.end(); it++) {
+        result.push_back(mempoolDeltaToJSON(it->first, it->second));
+    }
 
-        std::string address;
-        if (!getAddressFromIndex(it->first.type, it->first.addressBytes, address)) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown address type");
-        }
+    if (!fSince) {
+        return result;
+    }
 
-        UniValue delta(UniValue::VOBJ);
-        delta.pushKV("address", address);
-        delta.pushKV("txid", it->first.txhash.GetHex());
-        delta.pushKV("index", (int)it->first.index);
-        delta.pushKV("satoshis", it->second.amount);
-        delta.pushKV("timestamp", it->second.time);
-        if (it->second.amount < 0) {
-            delta.pushKV("prevtxid", it->second.prevhash.GetHex());
-            delta.pushKV("prevout", (int)it->second.prevout);
-        }
-        result.push_back(delta);
+    UniValue removed(UniValue::VARR);
+    for (const CMempoolAddressRemoval& removal : removals) {
+        removed.push_back(mempoolDeltaToJSON(removal.key, removal.delta));
     }
 
-    return result;
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("sequence", sequence);
+    ret.pushKV("complete", complete);
+    ret.pushKV("added", result);
+    ret.pushKV("removed", removed);
+    return ret;
 }
 
 UniValue getblockhashes(const JSONRPCRequest& request)
@@ -1126,6 +1179,116 @@ static UniValue getmemoryinfo(const JSONRPCRequest& request)
     }
 }
 
+static UniValue getdbstats(const JSONRPCRequest& request)
+{
+            RPCHelpMan{"getdbstats",
+                "Returns the LevelDB settings and activity of each open database since it was opened.\n"
+                "The contract state and receipt databases are listed with their levels and memory usage only.\n",
+                {},
+                RPCResult{
+            "[\n"
+            "  {\n"
+            "    \"name\": \"xxxx\",                (string) Name of the database\n"
+            "    \"profile\": {                    (json object) Settings the database was opened with, see -dbprofile\n"
+            "      \"compression\": true|false,    (boolean) Whether table blocks are compressed\n"
+            "      \"writebuffer\": n,             (numeric) Share of the cache per write buffer, in percent\n"
+            "      \"bloombits\": n,               (numeric) Bits per key of the bloom filter\n"
+            "      \"maxfilesize\": n,             (numeric) Size at which table files are split, in bytes\n"
+            "      \"blocksize\": n                (numeric) Size of table blocks, in bytes\n"
+            "    },\n"
+            "    \"reads\": n,                     (numeric) Point lookups\n"
+            "    \"bytes_read\": n,                (numeric) Bytes of the values returned by lookups\n"
+            "    \"batches_written\": n,           (numeric) Write batches\n"
+            "    \"bytes_written\": n,             (numeric) Bytes of the write batches\n"
+            "    \"cache_lookups\": n,             (numeric) Block cache lookups, including those of iterators and compactions\n"
+            "    \"cache_hits\": n,                (numeric) Block cache lookups that found the block\n"
+            "    \"compaction_bytes_read\": n,     (numeric) Bytes read by compactions\n"
+            "    \"compaction_bytes_written\": n,  (numeric) Bytes written by memtable flushes and compactions\n"
+            "    \"read_amplification\": x.xxx,    (numeric) Table blocks read from disk per lookup\n"
+            "    \"write_amplification\": x.xxx,   (numeric) Bytes written to disk, log included, per byte written to the database\n"
+            "    \"l0_slowdowns\": n,              (numeric) Writes delayed because level 0 had many files\n"
+            "    \"l0_stops\": n,                  (numeric) Writes that waited for level 0 to be compacted\n"
+            "    \"write_buffer_stalls\": n,       (numeric) Writes that waited for the previous write buffer to be flushed\n"
+            "    \"stall_micros\": n,              (numeric) Time spent in delayed writes, in microseconds\n"
+            "    \"memory_usage\": n,              (numeric) Memory used by the memtables and the block cache, in bytes\n"
+            "    \"levels\": [                     (json array) Levels that hold files or have seen compactions\n"
+            "      {\n"
+            "        \"level\": n,                 (numeric) Level number\n"
+            "        \"files\": n,                 (numeric) Table files in the level\n"
+            "        \"bytes\": n,                 (numeric) Size of the level\n"
+            "        \"compaction_seconds\": n,    (numeric) Time spent compacting into the level, in whole seconds\n"
+            "        \"compaction_bytes_read\": n, (numeric) Bytes read by compactions into the level\n"
+            "        \"compaction_bytes_written\": n (numeric) Bytes written by compactions into the level\n"
+            "      },\n"
+            "      ...\n"
+            "    ]\n"
+            "  },\n"
+            "  ...\n"
+            "]\n"
+                },
+                RPCExamples{
+                    HelpExampleCli("getdbstats", "")
+            + HelpExampleRpc("getdbstats", "")
+                },
+            }.Check(request);
+
+    const auto levels_to_json = [](const LevelDBProperties& properties) {
+        UniValue levels(UniValue::VARR);
+        for (const LevelDBLevelStats& level : properties.levels) {
+            UniValue obj(UniValue::VOBJ);
+            obj.pushKV("level", level.level);
+            obj.pushKV("files", level.files);
+            obj.pushKV("bytes", level.bytes);
+            obj.pushKV("compaction_seconds", level.compaction_seconds);
+            obj.pushKV("compaction_bytes_read", level.compaction_bytes_read);
+            obj.pushKV("compaction_bytes_written", level.compaction_bytes_written);
+            levels.push_back(obj);
+        }
+        return levels;
+    };
+
+    UniValue ret(UniValue::VARR);
+    ForEachDBWrapper([&](const CDBWrapper& dbw) {
+        const DBWrapperStats stats = dbw.GetStats();
+        UniValue profile(UniValue::VOBJ);
+        profile.pushKV("compression", stats.profile.compression);
+        profile.pushKV("writebuffer", stats.profile.write_buffer_percent);
+        profile.pushKV("bloombits", stats.profile.bloom_bits);
+        profile.pushKV("maxfilesize", (uint64_t)stats.profile.max_file_size);
+        profile.pushKV("blocksize", (uint64_t)stats.profile.block_size);
+
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("name", stats.name);
+        obj.pushKV("profile", profile);
+        obj.pushKV("reads", stats.reads);
+        obj.pushKV("bytes_read", stats.bytes_read);
+        obj.pushKV("batches_written", stats.batches_written);
+        obj.pushKV("bytes_written", stats.bytes_written);
+        obj.pushKV("cache_lookups", stats.cache_lookups);
+        obj.pushKV("cache_hits", stats.cache_hits);
+        obj.pushKV("compaction_bytes_read", stats.compaction_bytes_read);
+        obj.pushKV("compaction_bytes_written", stats.compaction_bytes_written);
+        obj.pushKV("read_amplification", stats.reads ? double(stats.cache_lookups - stats.cache_hits) / stats.reads : 0.0);
+        obj.pushKV("write_amplification", stats.bytes_written ? double(stats.bytes_written + stats.compaction_bytes_written) / stats.bytes_written : 0.0);
+        obj.pushKV("l0_slowdowns", stats.l0_slowdowns);
+        obj.pushKV("l0_stops", stats.l0_stops);
+        obj.pushKV("write_buffer_stalls", stats.write_buffer_stalls);
+        obj.pushKV("stall_micros", stats.stall_micros);
+        obj.pushKV("memory_usage", stats.properties.memory_usage);
+        obj.pushKV("levels", levels_to_json(stats.properties));
+        ret.push_back(obj);
+    });
+    ForEachLevelDB([&](const std::string& name, leveldb::DB* db) {
+        const LevelDBProperties properties = GetLevelDBProperties(db);
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("name", name);
+        obj.pushKV("memory_usage", properties.memory_usage);
+        obj.pushKV("levels", levels_to_json(properties));
+        ret.push_back(obj);
+    });
+    return ret;
+}
+
 static void EnableOrDisableLogCategories(UniValue cats, bool enable) {
     cats = cats.get_array();
     for (unsigned int i = 0; i < cats.size(); ++i) {
@@ -1233,6 +1396,7 @@ static UniValue echo(const JSONRPCRequest& request)
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         argNames
   //  --------------------- ------------------------  -----------------------  ----------
+    { "control",            "getdbstats",             &getdbstats,             {} },
     { "control",            "getmemoryinfo",          &getmemoryinfo,          {"mode"} },
     { "control",            "logging",                &logging,                {"include", "exclude"}},
     { "util",               "validateaddress",        &validateaddress,        {"address"} },
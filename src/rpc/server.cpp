@@ -7,6 +7,7 @@
 
 #include <fs.h>
 #include <key_io.h>
+#include <rpc/jsonstream.h>
 #include <rpc/util.h>
 #include <shutdown.h>
 #include <sync.h>
@@ -209,6 +210,20 @@ static UniValue getrpcinfo(const JSONRPCRequest& request)
             "   },...\n"
             "  ],\n"
             " \"logpath\": \"xxx\" (string) The complete file path to the debug log\n"
+            " \"work_queues\" (array) The HTTP work queues serving requests\n"
+            "  [\n"
+            "   {               (object) Counters of a work queue since startup\n"
+            "    \"name\"         (string)  The name of the queue, see -rpcqueue\n"
+            "    \"threads\"      (numeric) The number of worker threads\n"
+            "    \"depth\"        (numeric) The number of requests waiting for a worker\n"
+            "    \"max_depth\"    (numeric) The maximum number of waiting requests\n"
+            "    \"processed\"    (numeric) The number of requests served\n"
+            "    \"rejected\"     (numeric) The number of requests refused because the queue was full\n"
+            "    \"avg_wait\"     (numeric) The average time requests waited for a worker in microseconds\n"
+            "    \"max_wait\"     (numeric) The longest time a request waited for a worker in microseconds\n"
+            "    \"avg_exec\"     (numeric) The average time to serve a request in microseconds\n"
+            "   },...\n"
+            "  ]\n"
             "}\n"
                 },
                 RPCExamples{
@@ -232,6 +247,22 @@ static UniValue getrpcinfo(const JSONRPCRequest& request)
     UniValue log_path(UniValue::VSTR, path);
     result.pushKV("logpath", log_path);
 
+    UniValue work_queues(UniValue::VARR);
+    for (const HTTPWorkQueueStats& stats : GetHTTPWorkQueueStats()) {
+        UniValue entry(UniValue::VOBJ);
+        entry.pushKV("name", stats.name);
+        entry.pushKV("threads", stats.threads);
+        entry.pushKV("depth", (uint64_t)stats.depth);
+        entry.pushKV("max_depth", (uint64_t)stats.maxDepth);
+        entry.pushKV("processed", stats.processed);
+        entry.pushKV("rejected", stats.rejected);
+        entry.pushKV("avg_wait", stats.started ? stats.totalWaitMicros / (int64_t)stats.started : 0);
+        entry.pushKV("max_wait", stats.maxWaitMicros);
+        entry.pushKV("avg_exec", stats.processed ? stats.totalExecMicros / (int64_t)stats.processed : 0);
+        work_queues.push_back(entry);
+    }
+    result.pushKV("work_queues", work_queues);
+
     return result;
 }
 
@@ -368,6 +399,30 @@ void JSONRPCRequest::PollReply(const UniValue& result) {
     req->ChunkEnd();
 }
 
+void JSONRPCRequest::StreamReply(const std::function<void(JSONStreamWriter&)>& writeResult) const {
+    assert(canStream && req);
+    req->WriteHeader("Content-Type", "application/json");
+
+    HTTPRequest* http_req = req;
+    JSONStreamWriter writer([http_req](const std::string& data) { return http_req->StreamChunk(data); });
+    try {
+        writer.BeginObject();
+        writer.Key("result");
+        writeResult(writer);
+        writer.Key("error");
+        writer.Value(NullUniValue);
+        writer.Key("id");
+        writer.Value(id);
+        writer.EndObject();
+        writer.Write("\n");
+        writer.Flush(true);
+    } catch (...) {
+        // The status line is already out, all we can do is cut the reply short
+        LogPrintf("%s: %s failed while streaming the reply\n", __func__, strMethod);
+    }
+    req->StreamEnd();
+}
+
 bool IsDeprecatedRPCEnabled(const std::string& method)
 {
     const std::vector<std::string> enabled_methods = gArgs.GetArgs("-deprecatedrpc");
@@ -35,6 +35,7 @@ static CUpdatedBlock latestblock;
 
 class CRPCCommand;
 class HTTPRequest;
+class JSONStreamWriter;
 
 namespace RPCServer
 {
@@ -48,6 +49,8 @@ public:
     JSONRPCRequest() : JSONRPCRequestBase() {
         req = NULL;
         isLongPolling = false;
+        isParked = false;
+        canStream = false;
     };
 
     JSONRPCRequest(HTTPRequest *_req);
@@ -79,6 +82,25 @@ public:
 
     bool isLongPolling;
 
+    /**
+     * The long poll request was handed over to another thread, which will
+     * reply to it. The HTTP handler must not touch it anymore.
+     */
+    bool isParked;
+
+    /**
+     * Send the reply by streaming the result into the HTTP connection instead
+     * of returning it. writeResult must write exactly one JSON value. Only
+     * allowed if canStream is set; the handler should return NullUniValue.
+     */
+    void StreamReply(const std::function<void(JSONStreamWriter&)>& writeResult) const;
+
+    /**
+     * This is a single request received over HTTP, so the handler may use
+     * StreamReply for large results, or park the request.
+     */
+    bool canStream;
+
     // FIXME: make this private?
     HTTPRequest *req;
 };
@@ -10,6 +10,7 @@
 #include <crypto/sha256.h>
 #include <pubkey.h>
 #include <script/script.h>
+#include <streams.h>
 #include <uint256.h>
 #include <script/standard.h>
 
@@ -1281,6 +1282,9 @@ uint256 GetOutputsOpSenderHash(const T& txTo)
 
 } // namespace
 
+/** Size of an input with the script blanked out: prevout, empty script and nSequence */
+static const size_t LEGACY_BLANKED_INPUT_SIZE = 36 + 1 + 4;
+
 template <class T>
 PrecomputedTransactionData::PrecomputedTransactionData(const T& txTo)
 {
@@ -1295,6 +1299,30 @@ PrecomputedTransactionData::PrecomputedTransactionData(const T& txTo)
         }
         ready = true;
     }
+
+    // Legacy signature hashes serialize the whole transaction for every input,
+    // which is quadratic for coinstakes and consolidations. Keep the blanked
+    // inputs serialized once and the hasher state in front of each input.
+    size_t nLegacyInputs = 0;
+    for (const auto& txin : txTo.vin) {
+        if (txin.scriptWitness.IsNull()) nLegacyInputs++;
+    }
+    if (nLegacyInputs > 1) {
+        CVectorWriter tail(SER_GETHASH, 0, legacyTail, 0);
+        for (const auto& txin : txTo.vin) {
+            tail << txin.prevout << CScript() << txin.nSequence;
+        }
+        tail << txTo.vout << txTo.nLockTime;
+
+        CHashWriter ss(SER_GETHASH, 0);
+        ss << txTo.nVersion;
+        WriteCompactSize(ss, txTo.vin.size());
+        legacyMidstates.reserve(txTo.vin.size());
+        for (size_t i = 0; i < txTo.vin.size(); i++) {
+            legacyMidstates.push_back(ss);
+            ss.write((const char*)&legacyTail[i * LEGACY_BLANKED_INPUT_SIZE], LEGACY_BLANKED_INPUT_SIZE);
+        }
+    }
 }
 
 // explicit instantiation
@@ -1419,6 +1447,17 @@ uint256 SignatureHash(const CScript& scriptCode, const T& txTo, unsigned int nIn
     // Wrapper to serialize only the necessary parts of the transaction being signed
     CTransactionSignatureSerializer<T> txTmp(txTo, scriptCode, nIn, nHashType);
 
+    // With SIGHASH_ALL only the input being signed differs from the precomputed serialization
+    if (cache && nIn < cache->legacyMidstates.size() && !(nHashType & SIGHASH_ANYONECANPAY) &&
+        (nHashType & 0x1f) != SIGHASH_SINGLE && (nHashType & 0x1f) != SIGHASH_NONE) {
+        CHashWriter ss(cache->legacyMidstates[nIn]);
+        txTmp.SerializeInput(ss, nIn);
+        const size_t nNext = (nIn + 1) * LEGACY_BLANKED_INPUT_SIZE;
+        ss.write((const char*)cache->legacyTail.data() + nNext, cache->legacyTail.size() - nNext);
+        ss << nHashType;
+        return ss.GetHash();
+    }
+
     // Serialize and hash
     CHashWriter ss(SER_GETHASH, 0);
     ss << txTmp << nHashType;
@@ -6,6 +6,7 @@
 #ifndef BITCOIN_SCRIPT_INTERPRETER_H
 #define BITCOIN_SCRIPT_INTERPRETER_H
 
+#include <hash.h>
 #include <script/script_error.h>
 #include <primitives/transaction.h>
 
@@ -133,6 +134,10 @@ struct PrecomputedTransactionData
 {
     uint256 hashPrevouts, hashSequence, hashOutputs, hashOutputsOpSender;
     bool ready = false;
+    //! Legacy SIGHASH_ALL serialization of all inputs with blanked scripts, followed by the outputs and nLockTime
+    std::vector<unsigned char> legacyTail;
+    //! Hasher states after nVersion and the blanked inputs that precede each input
+    std::vector<CHashWriter> legacyMidstates;
 
     template <class T>
     explicit PrecomputedTransactionData(const T& tx);
@@ -13,20 +13,40 @@
 #include <cuckoocache.h>
 #include <boost/thread.hpp>
 
+#include <array>
+
 namespace {
 /**
  * Valid signature cache, to avoid doing expensive ECDSA signature checking
  * twice for every transaction (once when accepted into memory pool, and
  * again when accepted into the block chain)
+ *
+ * The cache is split into SIGNATURE_CACHE_SHARDS independent cuckoo caches,
+ * each with its own lock and its own epochs, so that script check threads
+ * working on different signatures rarely touch the same lock. The shard is
+ * picked from the low bits of the first hash word, which the cuckoo cache
+ * only uses as the least significant part of its bucket index.
  */
 class CSignatureCache
 {
 private:
+    static constexpr size_t SIGNATURE_CACHE_SHARDS = 32;
+    static_assert((SIGNATURE_CACHE_SHARDS & (SIGNATURE_CACHE_SHARDS - 1)) == 0, "shard count must be a power of two");
+
      //! Entries are SHA256(nonce || signature hash || public key || signature):
     uint256 nonce;
     typedef CuckooCache::cache<uint256, SignatureCacheHasher> map_type;
-    map_type setValid;
-    boost::shared_mutex cs_sigcache;
+    //! Aligned so that neighbouring shard locks do not share a cache line
+    struct alignas(64) Shard {
+        map_type setValid;
+        boost::shared_mutex cs_sigcache;
+    };
+    std::array<Shard, SIGNATURE_CACHE_SHARDS> shards;
+
+    Shard& GetShard(const uint256& entry)
+    {
+        return shards[*entry.begin() & (SIGNATURE_CACHE_SHARDS - 1)];
+    }
 
 public:
     CSignatureCache()
@@ -43,19 +63,30 @@ public:
     bool
     Get(const uint256& entry, const bool erase)
     {
-        boost::shared_lock<boost::shared_mutex> lock(cs_sigcache);
-        return setValid.contains(entry, erase);
+        Shard& shard = GetShard(entry);
+        boost::shared_lock<boost::shared_mutex> lock(shard.cs_sigcache);
+        return shard.setValid.contains(entry, erase);
     }
 
     void Set(uint256& entry)
     {
-        boost::unique_lock<boost::shared_mutex> lock(cs_sigcache);
-        setValid.insert(entry);
+        Shard& shard = GetShard(entry);
+        boost::unique_lock<boost::shared_mutex> lock(shard.cs_sigcache);
+        shard.setValid.insert(entry);
     }
-    uint32_t setup_bytes(size_t n)
+
+    //! Splits n bytes evenly over the shards, returns the total number of elements
+    size_t setup_bytes(size_t n)
     {
-        return setValid.setup_bytes(n);
+        size_t nElems = 0;
+        for (Shard& shard : shards) {
+            boost::unique_lock<boost::shared_mutex> lock(shard.cs_sigcache);
+            nElems += shard.setValid.setup_bytes(n / SIGNATURE_CACHE_SHARDS);
+        }
+        return nElems;
     }
+
+    size_t shard_count() const { return SIGNATURE_CACHE_SHARDS; }
 };
 
 /* In previous versions of this code, signatureCache was a local static variable
@@ -75,8 +106,8 @@ void InitSignatureCache()
     // setup_bytes creates the minimum possible cache (2 elements).
     size_t nMaxCacheSize = std::min(std::max((int64_t)0, gArgs.GetArg("-maxsigcachesize", DEFAULT_MAX_SIG_CACHE_SIZE) / 2), MAX_MAX_SIG_CACHE_SIZE) * ((size_t) 1 << 20);
     size_t nElems = signatureCache.setup_bytes(nMaxCacheSize);
-    LogPrintf("Using %zu MiB out of %zu/2 requested for signature cache, able to store %zu elements\n",
-            (nElems*sizeof(uint256)) >>20, (nMaxCacheSize*2)>>20, nElems);
+    LogPrintf("Using %zu MiB out of %zu/2 requested for signature cache, able to store %zu elements in %zu shards\n",
+            (nElems*sizeof(uint256)) >>20, (nMaxCacheSize*2)>>20, nElems, signatureCache.shard_count());
 }
 
 bool CachingTransactionSignatureChecker::VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash) const
@@ -92,6 +123,16 @@ bool CachingTransactionSignatureChecker::VerifySignature(const std::vector<unsig
     return true;
 }
 
+bool BatchingTransactionSignatureChecker::VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash) const
+{
+    uint256 entry;
+    signatureCache.ComputeEntry(entry, sighash, vchSig, pubkey);
+    if (signatureCache.Get(entry, !store))
+        return true;
+    batch.Add(pubkey, sighash, vchSig);
+    return true;
+}
+
 bool CachingTransactionSignatureOutputChecker::VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash) const
 {
     uint256 entry;
@@ -18,6 +18,7 @@ static const unsigned int DEFAULT_MAX_SIG_CACHE_SIZE = 32;
 static const int64_t MAX_MAX_SIG_CACHE_SIZE = 16384;
 
 class CPubKey;
+class CPubKeyBatchVerifier;
 
 /**
  * We're hashing a nonce into the entries themselves, so we don't need extra
@@ -62,6 +63,24 @@ public:
     bool VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, const uint256& sighash) const override;
 };
 
+/**
+ * Looks signatures up in the signature cache like
+ * CachingTransactionSignatureChecker, but adds the ones it misses to a batch
+ * and reports them as valid. The outcome of a script run with it only holds
+ * once all signatures of the batch are verified.
+ */
+class BatchingTransactionSignatureChecker : public TransactionSignatureChecker
+{
+private:
+    bool store;
+    CPubKeyBatchVerifier& batch;
+
+public:
+    BatchingTransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, const CAmount& amountIn, bool storeIn, PrecomputedTransactionData& txdataIn, CPubKeyBatchVerifier& batchIn) : TransactionSignatureChecker(txToIn, nInIn, amountIn, txdataIn), store(storeIn), batch(batchIn) {}
+
+    bool VerifySignature(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, const uint256& sighash) const override;
+};
+
 void InitSignatureCache();
 
 #endif // BITCOIN_SCRIPT_SIGCACHE_H
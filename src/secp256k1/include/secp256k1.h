@@ -428,6 +428,32 @@ SECP256K1_API SECP256K1_WARN_UNUSED_RESULT int secp256k1_ecdsa_verify(
     const secp256k1_pubkey *pubkey
 ) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(3) SECP256K1_ARG_NONNULL(4);
 
+/** Verify a batch of ECDSA signatures.
+ *
+ *  Returns: 1: all signatures are correct
+ *           0: at least one signature is incorrect
+ *  Args:    ctx:       a secp256k1 context object, initialized for verification.
+ *  Out:     results:   an array of n ints, set to 1 for each correct signature and
+ *                      to 0 for each incorrect one (cannot be NULL)
+ *  In:      sigs:      an array of n pointers to the signatures being verified
+ *           msg32s:    an array of n pointers to the 32-byte message hashes
+ *           pubkeys:   an array of n pointers to the public keys to verify with
+ *           n:         the number of signatures
+ *
+ * Every signature is checked exactly as by secp256k1_ecdsa_verify, only the
+ * inversions of the s values are shared by all signatures of the batch.
+ *
+ * Local change, not in upstream libsecp256k1.
+ */
+SECP256K1_API int secp256k1_ecdsa_verify_batch(
+    const secp256k1_context* ctx,
+    int *results,
+    const secp256k1_ecdsa_signature * const *sigs,
+    const unsigned char * const *msg32s,
+    const secp256k1_pubkey * const *pubkeys,
+    size_t n
+) SECP256K1_ARG_NONNULL(1) SECP256K1_ARG_NONNULL(2) SECP256K1_ARG_NONNULL(3) SECP256K1_ARG_NONNULL(4) SECP256K1_ARG_NONNULL(5);
+
 /** Convert a signature to a normalized lower-S form.
  *
  *  Returns: 1 if sigin was not normalized, 0 if it already was.
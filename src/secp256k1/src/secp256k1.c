@@ -328,6 +328,77 @@ int secp256k1_ecdsa_verify(const secp256k1_context* ctx, const secp256k1_ecdsa_s
             secp256k1_ecdsa_sig_verify(&ctx->ecmult_ctx, &r, &s, &q, &m));
 }
 
+/* Local change, not in upstream libsecp256k1: batched ECDSA verification. */
+
+/* Number of signatures whose s values are inverted together by secp256k1_ecdsa_verify_batch */
+#define ECDSA_VERIFY_BATCH_SIZE 64
+
+int secp256k1_ecdsa_verify_batch(const secp256k1_context* ctx, int *results, const secp256k1_ecdsa_signature * const *sigs, const unsigned char * const *msg32s, const secp256k1_pubkey * const *pubkeys, size_t n) {
+    secp256k1_scalar r[ECDSA_VERIFY_BATCH_SIZE], s[ECDSA_VERIFY_BATCH_SIZE], prod[ECDSA_VERIFY_BATCH_SIZE];
+    secp256k1_scalar inv, m;
+    secp256k1_ge q;
+    size_t offset, count, i, last;
+    int all = 1;
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(secp256k1_ecmult_context_is_built(&ctx->ecmult_ctx));
+    ARG_CHECK(results != NULL);
+    ARG_CHECK(sigs != NULL);
+    ARG_CHECK(msg32s != NULL);
+    ARG_CHECK(pubkeys != NULL);
+
+    for (offset = 0; offset < n; offset += count) {
+        count = n - offset < ECDSA_VERIFY_BATCH_SIZE ? n - offset : ECDSA_VERIFY_BATCH_SIZE;
+
+        /* Multiply up the valid s values, prod[i] holds the product of the
+         * first i+1 of them, so that one inversion serves the whole batch
+         * (Montgomery's trick). */
+        last = count;
+        for (i = 0; i < count; i++) {
+            secp256k1_ecdsa_signature_load(ctx, &r[i], &s[i], sigs[offset + i]);
+            results[offset + i] = !secp256k1_scalar_is_high(&s[i]) &&
+                                  !secp256k1_scalar_is_zero(&r[i]) &&
+                                  !secp256k1_scalar_is_zero(&s[i]);
+            if (!results[offset + i]) {
+                continue;
+            }
+            if (last == count) {
+                prod[i] = s[i];
+            } else {
+                secp256k1_scalar_mul(&prod[i], &prod[last], &s[i]);
+            }
+            last = i;
+        }
+        if (last == count) {
+            all = 0;
+            continue;
+        }
+        secp256k1_scalar_inverse_var(&inv, &prod[last]);
+
+        /* Walk back, peeling off one s value at a time. */
+        for (i = count; i-- > 0;) {
+            size_t prev;
+            secp256k1_scalar sn;
+            if (!results[offset + i]) {
+                continue;
+            }
+            for (prev = i; prev-- > 0 && !results[offset + prev];) {}
+            if (prev < i) {
+                secp256k1_scalar_mul(&sn, &inv, &prod[prev]);
+                secp256k1_scalar_mul(&inv, &inv, &s[i]);
+            } else {
+                sn = inv;
+            }
+            secp256k1_scalar_set_b32(&m, msg32s[offset + i], NULL);
+            results[offset + i] = secp256k1_pubkey_load(ctx, &q, pubkeys[offset + i]) &&
+                                  secp256k1_ecdsa_sig_verify_sinv(&ctx->ecmult_ctx, &r[i], &sn, &q, &m);
+        }
+        for (i = 0; i < count; i++) {
+            all &= results[offset + i];
+        }
+    }
+    return all;
+}
+
 static SECP256K1_INLINE void buffer_append(unsigned char *buf, unsigned int *offset, const void *data, unsigned int len) {
     memcpy(buf + *offset, data, len);
     *offset += len;
@@ -4248,6 +4248,73 @@ void run_ecdsa_end_to_end(void) {
     }
 }
 
+void test_ecdsa_verify_batch(void) {
+    secp256k1_ecdsa_signature sigs[150];
+    secp256k1_pubkey pubkeys[150];
+    unsigned char msgs[150][32];
+    const secp256k1_ecdsa_signature *sig_ptrs[150];
+    const secp256k1_pubkey *pubkey_ptrs[150];
+    const unsigned char *msg_ptrs[150];
+    int results[150];
+    int ret;
+    int all = 1;
+    size_t i;
+    size_t n = 1 + secp256k1_rand_int(150);
+
+    for (i = 0; i < n; i++) {
+        unsigned char privkey[32];
+        secp256k1_scalar key, msg, r, s;
+        random_scalar_order_test(&key);
+        random_scalar_order_test(&msg);
+        secp256k1_scalar_get_b32(privkey, &key);
+        secp256k1_scalar_get_b32(msgs[i], &msg);
+        CHECK(secp256k1_ec_pubkey_create(ctx, &pubkeys[i], privkey) == 1);
+        CHECK(secp256k1_ecdsa_sign(ctx, &sigs[i], msgs[i], privkey, NULL, NULL) == 1);
+        switch (secp256k1_rand_int(8)) {
+        case 0:
+            /* Wrong message */
+            msgs[i][secp256k1_rand_int(32)] ^= 1 + secp256k1_rand_int(255);
+            break;
+        case 1:
+            /* High s */
+            secp256k1_ecdsa_signature_load(ctx, &r, &s, &sigs[i]);
+            secp256k1_scalar_negate(&s, &s);
+            secp256k1_ecdsa_signature_save(&sigs[i], &r, &s);
+            break;
+        case 2:
+            /* Zero s */
+            secp256k1_ecdsa_signature_load(ctx, &r, &s, &sigs[i]);
+            secp256k1_scalar_clear(&s);
+            secp256k1_ecdsa_signature_save(&sigs[i], &r, &s);
+            break;
+        case 3:
+            /* Somebody else's key */
+            if (i > 0) {
+                pubkeys[i] = pubkeys[i - 1];
+            }
+            break;
+        }
+        sig_ptrs[i] = &sigs[i];
+        pubkey_ptrs[i] = &pubkeys[i];
+        msg_ptrs[i] = msgs[i];
+    }
+
+    ret = secp256k1_ecdsa_verify_batch(ctx, results, sig_ptrs, msg_ptrs, pubkey_ptrs, n);
+    for (i = 0; i < n; i++) {
+        int single = secp256k1_ecdsa_verify(ctx, &sigs[i], msgs[i], &pubkeys[i]);
+        CHECK(results[i] == single);
+        all &= single;
+    }
+    CHECK(ret == all);
+}
+
+void run_ecdsa_verify_batch(void) {
+    int i;
+    for (i = 0; i < count; i++) {
+        test_ecdsa_verify_batch();
+    }
+}
+
 int test_ecdsa_der_parse(const unsigned char *sig, size_t siglen, int certainly_der, int certainly_not_der) {
     static const unsigned char zeroes[32] = {0};
 #ifdef ENABLE_OPENSSL_TESTS
@@ -5129,6 +5196,7 @@ int main(int argc, char **argv) {
     run_ecdsa_der_parse();
     run_ecdsa_sign_verify();
     run_ecdsa_end_to_end();
+    run_ecdsa_verify_batch();
     run_ecdsa_edge_cases();
 #ifdef ENABLE_OPENSSL_TESTS
     run_ecdsa_openssl();
@@ -145,9 +145,10 @@ typedef CCheckQueue<FrozenCleanupCheck> FrozenCleanup_Queue;
 /** This test case checks that the CCheckQueue works properly
  * with each specified size_t Checks pushed.
  */
-static void Correct_Queue_range(std::vector<size_t> range)
+static void Correct_Queue_range(std::vector<size_t> range, CheckQueueMode mode = CheckQueueMode::SHARED)
 {
     auto small_queue = MakeUnique<Correct_Queue>(QUEUE_BATCH_SIZE);
+    small_queue->SetMode(mode);
     boost::thread_group tg;
     for (auto x = 0; x < nScriptCheckThreads; ++x) {
        tg.create_thread([&]{small_queue->Thread();});
@@ -207,6 +208,17 @@ BOOST_AUTO_TEST_CASE(test_CheckQueue_Correct_Random)
     Correct_Queue_range(range);
 }
 
+/** Test that MAX and random numbers of checks are correct with work stealing
+ */
+BOOST_AUTO_TEST_CASE(test_CheckQueue_WorkStealing_Correct)
+{
+    Correct_Queue_range({0, 1, 100000}, CheckQueueMode::WORK_STEALING);
+    std::vector<size_t> range;
+    for (size_t i = 2; i < 100000; i += std::max((size_t)1, (size_t)InsecureRandRange(std::min((size_t)1000, ((size_t)100000) - i))))
+        range.push_back(i);
+    Correct_Queue_range(range, CheckQueueMode::WORK_STEALING);
+}
+
 
 /** Test that failing checks are caught */
 BOOST_AUTO_TEST_CASE(test_CheckQueue_Catches_Failure)
@@ -242,9 +254,10 @@ BOOST_AUTO_TEST_CASE(test_CheckQueue_Catches_Failure)
 }
 // Test that a block validation which fails does not interfere with
 // future blocks, ie, the bad state is cleared.
-BOOST_AUTO_TEST_CASE(test_CheckQueue_Recovers_From_Failure)
+static void Failing_Queue_recovers(CheckQueueMode mode = CheckQueueMode::SHARED)
 {
     auto fail_queue = MakeUnique<Failing_Queue>(QUEUE_BATCH_SIZE);
+    fail_queue->SetMode(mode);
     boost::thread_group tg;
     for (auto x = 0; x < nScriptCheckThreads; ++x) {
        tg.create_thread([&]{fail_queue->Thread();});
@@ -267,12 +280,24 @@ BOOST_AUTO_TEST_CASE(test_CheckQueue_Recovers_From_Failure)
     tg.join_all();
 }
 
+BOOST_AUTO_TEST_CASE(test_CheckQueue_Recovers_From_Failure)
+{
+    Failing_Queue_recovers();
+}
+
+BOOST_AUTO_TEST_CASE(test_CheckQueue_WorkStealing_Recovers_From_Failure)
+{
+    Failing_Queue_recovers(CheckQueueMode::WORK_STEALING);
+}
+
 // Test that unique checks are actually all called individually, rather than
 // just one check being called repeatedly. Test that checks are not called
 // more than once as well
-BOOST_AUTO_TEST_CASE(test_CheckQueue_UniqueCheck)
+static void Unique_Queue_calls_once(CheckQueueMode mode = CheckQueueMode::SHARED)
 {
+    UniqueCheck::results.clear();
     auto queue = MakeUnique<Unique_Queue>(QUEUE_BATCH_SIZE);
+    queue->SetMode(mode);
     boost::thread_group tg;
     for (auto x = 0; x < nScriptCheckThreads; ++x) {
        tg.create_thread([&]{queue->Thread();});
@@ -300,15 +325,26 @@ BOOST_AUTO_TEST_CASE(test_CheckQueue_UniqueCheck)
     tg.join_all();
 }
 
+BOOST_AUTO_TEST_CASE(test_CheckQueue_UniqueCheck)
+{
+    Unique_Queue_calls_once();
+}
+
+BOOST_AUTO_TEST_CASE(test_CheckQueue_WorkStealing_UniqueCheck)
+{
+    Unique_Queue_calls_once(CheckQueueMode::WORK_STEALING);
+}
+
 
 // Test that blocks which might allocate lots of memory free their memory aggressively.
 //
 // This test attempts to catch a pathological case where by lazily freeing
 // checks might mean leaving a check un-swapped out, and decreasing by 1 each
 // time could leave the data hanging across a sequence of blocks.
-BOOST_AUTO_TEST_CASE(test_CheckQueue_Memory)
+static void Memory_Queue_frees(CheckQueueMode mode = CheckQueueMode::SHARED)
 {
     auto queue = MakeUnique<Memory_Queue>(QUEUE_BATCH_SIZE);
+    queue->SetMode(mode);
     boost::thread_group tg;
     for (auto x = 0; x < nScriptCheckThreads; ++x) {
        tg.create_thread([&]{queue->Thread();});
@@ -335,6 +371,16 @@ BOOST_AUTO_TEST_CASE(test_CheckQueue_Memory)
     tg.join_all();
 }
 
+BOOST_AUTO_TEST_CASE(test_CheckQueue_Memory)
+{
+    Memory_Queue_frees();
+}
+
+BOOST_AUTO_TEST_CASE(test_CheckQueue_WorkStealing_Memory)
+{
+    Memory_Queue_frees(CheckQueueMode::WORK_STEALING);
+}
+
 // Test that a new verification cannot occur until all checks
 // have been destructed
 BOOST_AUTO_TEST_CASE(test_CheckQueue_FrozenCleanup)
@@ -8,9 +8,11 @@
 #include <script/standard.h>
 #include <streams.h>
 #include <test/setup_common.h>
+#include <txdb.h>
 #include <uint256.h>
 #include <undo.h>
 #include <util/strencodings.h>
+#include <util/time.h>
 
 #include <map>
 #include <vector>
@@ -80,7 +82,7 @@ public:
     void SelfTest() const
     {
         // Manually recompute the dynamic usage of the whole data, and compare it.
-        size_t ret = memusage::DynamicUsage(cacheCoins);
+        size_t ret = cacheCoins.DynamicMemoryUsage();
         size_t count = 0;
         for (const auto& entry : cacheCoins) {
             ret += entry.second.coin.DynamicMemoryUsage();
@@ -861,4 +863,203 @@ BOOST_AUTO_TEST_CASE(ccoins_write)
                     CheckWriteCoins(parent_value, child_value, parent_value, parent_flags, child_flags, parent_flags);
 }
 
+BOOST_AUTO_TEST_CASE(ccoins_prefetch)
+{
+    CCoinsViewTest base;
+    std::vector<COutPoint> outpoints;
+    {
+        CCoinsViewCacheTest cache(&base);
+        for (int i = 0; i < 100; i++) {
+            outpoints.emplace_back(InsecureRand256(), 0);
+            cache.AddCoin(outpoints.back(), Coin(CTxOut(i + 1, CScript() << OP_TRUE), 1, false, false), false);
+        }
+        cache.SetBestBlock(InsecureRand256());
+        BOOST_CHECK(cache.Flush());
+    }
+
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vout.resize(1);
+    CMutableTransaction spend;
+    for (const COutPoint& outpoint : outpoints) {
+        spend.vin.emplace_back(outpoint);
+    }
+    spend.vout.resize(1);
+    CBlock block;
+    block.vtx.push_back(MakeTransactionRef(coinbase));
+    block.vtx.push_back(MakeTransactionRef(spend));
+
+    CCoinsViewPrefetch prefetch(&base, 2);
+    prefetch.Prefetch(block);
+    for (int i = 0; i < 1000 && prefetch.m_staged_total < outpoints.size(); i++) {
+        MilliSleep(10);
+    }
+    BOOST_CHECK_EQUAL(prefetch.m_staged_total.load(), outpoints.size());
+
+    // Staged coins are handed out once, later lookups go to the view below
+    Coin coin;
+    BOOST_CHECK(prefetch.GetCoin(outpoints[0], coin));
+    BOOST_CHECK_EQUAL(coin.out.nValue, 1);
+    BOOST_CHECK(prefetch.GetCoin(outpoints[0], coin));
+    BOOST_CHECK_EQUAL(coin.out.nValue, 1);
+    BOOST_CHECK_EQUAL(prefetch.m_hits.load(), 1U);
+    BOOST_CHECK_EQUAL(prefetch.m_misses.load(), 1U);
+
+    // Writing through the view drops all staged coins and frees their memory
+    const size_t staged_usage = prefetch.DynamicMemoryUsage();
+    BOOST_CHECK(staged_usage > 0);
+    {
+        CCoinsViewCacheTest cache(&prefetch);
+        cache.map().emplace(outpoints[1], CCoinsCacheEntry());
+        cache.map()[outpoints[1]].flags = CCoinsCacheEntry::DIRTY;
+        cache.SetBestBlock(InsecureRand256());
+        BOOST_CHECK(cache.Flush());
+    }
+    BOOST_CHECK(prefetch.DynamicMemoryUsage() < staged_usage / 2);
+    BOOST_CHECK(!CCoinsViewCacheTest(&prefetch).HaveCoin(outpoints[1]));
+    BOOST_CHECK(prefetch.HaveCoin(outpoints[2]));
+    BOOST_CHECK(prefetch.GetCoin(outpoints[2], coin));
+    BOOST_CHECK_EQUAL(prefetch.m_hits.load(), 1U);
+
+    // Coins the cache above never takes are dropped as later blocks are prefetched
+    prefetch.Prefetch(block);
+    for (int i = 0; i < 1000 && prefetch.m_staged_total < 2 * outpoints.size() - 1; i++) {
+        MilliSleep(10);
+    }
+    BOOST_CHECK(prefetch.m_staged_total >= 2 * outpoints.size() - 1);
+    CBlock empty;
+    empty.vtx.push_back(MakeTransactionRef(coinbase));
+    for (uint64_t i = 1; i < PREFETCH_STAGED_MAX_AGE; i++) {
+        prefetch.Prefetch(empty);
+    }
+    BOOST_CHECK(prefetch.DynamicMemoryUsage() > staged_usage / 2);
+    prefetch.Prefetch(empty);
+    BOOST_CHECK(prefetch.DynamicMemoryUsage() < staged_usage / 2);
+    BOOST_CHECK(prefetch.GetCoin(outpoints[3], coin));
+    BOOST_CHECK_EQUAL(prefetch.m_hits.load(), 1U);
+}
+
+BOOST_AUTO_TEST_CASE(ccoins_flat_map)
+{
+    // Random inserts and erases on a small key space, checked against std::map
+    CCoinsMap map(CCoinsMap::Type::FLAT);
+    std::map<COutPoint, CAmount> expected;
+    std::vector<uint256> txids(500);
+    for (uint256& txid : txids) {
+        txid = InsecureRand256();
+    }
+    for (unsigned int i = 0; i < NUM_SIMULATION_ITERATIONS; i++) {
+        const COutPoint outpoint(txids[InsecureRandRange(txids.size())], InsecureRandRange(4));
+        if (InsecureRandBool()) {
+            auto inserted = map.try_emplace(outpoint);
+            BOOST_CHECK_EQUAL(inserted.second, expected.count(outpoint) == 0);
+            if (inserted.second) {
+                inserted.first->second.coin.out.nValue = i;
+                expected[outpoint] = i;
+            }
+            BOOST_CHECK_EQUAL(inserted.first->second.coin.out.nValue, expected[outpoint]);
+        } else {
+            auto it = map.find(outpoint);
+            BOOST_CHECK_EQUAL(it != map.end(), expected.count(outpoint) == 1);
+            if (it != map.end()) {
+                map.erase(it);
+                expected.erase(outpoint);
+            }
+        }
+        BOOST_CHECK_EQUAL(map.size(), expected.size());
+    }
+
+    // Erasing while iterating visits every entry once
+    size_t visited = 0;
+    for (auto it = map.begin(); it != map.end();) {
+        BOOST_CHECK_EQUAL(it->second.coin.out.nValue, expected.at(it->first));
+        visited++;
+        if (visited % 2) {
+            expected.erase(it->first);
+            it = map.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    BOOST_CHECK_EQUAL(visited, expected.size() + (visited + 1) / 2);
+    BOOST_CHECK_EQUAL(map.size(), expected.size());
+    for (const auto& entry : expected) {
+        BOOST_CHECK(map.find(entry.first) != map.end());
+    }
+
+    map.clear();
+    BOOST_CHECK(map.empty());
+    BOOST_CHECK(map.begin() == map.end());
+    BOOST_CHECK_EQUAL(map.DynamicMemoryUsage(), 0U);
+
+    // A stack of caches flushes through flat maps as it does through unordered ones
+    CCoinsMap::SetDefaultType(CCoinsMap::Type::FLAT);
+    CCoinsViewTest base;
+    {
+        CCoinsViewCacheTest top(&base);
+        CCoinsViewCacheTest middle(&top);
+        for (int i = 0; i < 1000; i++) {
+            middle.AddCoin(COutPoint(txids[i % txids.size()], i / txids.size()), Coin(CTxOut(i + 1, CScript() << OP_TRUE), 1, false, false), false);
+        }
+        middle.SpendCoin(COutPoint(txids[0], 0));
+        BOOST_CHECK(middle.map().GetType() == CCoinsMap::Type::FLAT);
+        middle.SelfTest();
+        middle.SetBestBlock(InsecureRand256());
+        BOOST_CHECK(middle.Flush());
+        top.SelfTest();
+        BOOST_CHECK_EQUAL(top.GetCacheSize(), 999U);
+        BOOST_CHECK(top.Flush());
+    }
+    CCoinsMap::SetDefaultType(CCoinsMap::Type::UNORDERED);
+    Coin coin;
+    BOOST_CHECK(!base.GetCoin(COutPoint(txids[0], 0), coin));
+    BOOST_CHECK(base.GetCoin(COutPoint(txids[1], 0), coin));
+    BOOST_CHECK_EQUAL(coin.out.nValue, 2);
+}
+
+BOOST_AUTO_TEST_CASE(ccoins_sync)
+{
+    CCoinsViewDB db(GetDataDir() / "coins_sync", 1 << 20, true, true, true);
+    CCoinsViewCacheTest cache(&db);
+    std::vector<COutPoint> outpoints;
+    for (int i = 0; i < 100; i++) {
+        outpoints.emplace_back(InsecureRand256(), 0);
+        cache.AddCoin(outpoints.back(), Coin(CTxOut(i + 1, CScript() << OP_TRUE), 1, false, false), false);
+    }
+    const uint256 block1 = InsecureRand256();
+    cache.SetBestBlock(block1);
+    BOOST_CHECK(cache.Sync());
+
+    // The coins stay cached, and can be read below while they are written
+    cache.SelfTest();
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), outpoints.size());
+    for (const auto& entry : cache.map()) {
+        BOOST_CHECK(entry.second.flags == 0);
+    }
+    Coin coin;
+    BOOST_CHECK(db.GetCoin(outpoints[0], coin));
+    BOOST_CHECK_EQUAL(coin.out.nValue, 1);
+    BOOST_CHECK(db.GetBestBlock() == block1);
+
+    // Spent coins leave the cache with the next write
+    BOOST_CHECK(cache.SpendCoin(outpoints[0]));
+    const uint256 block2 = InsecureRand256();
+    cache.SetBestBlock(block2);
+    BOOST_CHECK(cache.Sync());
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), outpoints.size() - 1);
+    BOOST_CHECK(!db.HaveCoin(outpoints[0]));
+    BOOST_CHECK(db.WaitForWrites());
+    BOOST_CHECK(!db.HaveCoin(outpoints[0]));
+    BOOST_CHECK(db.HaveCoin(outpoints[1]));
+    BOOST_CHECK(db.GetBestBlock() == block2);
+    BOOST_CHECK(db.GetHeadBlocks().empty());
+
+    // Unmodified coins can be dropped, modified ones are kept
+    BOOST_CHECK(cache.SpendCoin(outpoints[1]));
+    cache.Trim(0);
+    cache.SelfTest();
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 1U);
+    BOOST_CHECK(cache.HaveCoin(outpoints[2]));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -749,4 +749,30 @@ BOOST_AUTO_TEST_CASE(sha256d64)
     }
 }
 
+BOOST_AUTO_TEST_CASE(sha256multi)
+{
+    for (int i = 0; i <= 32; ++i) {
+        std::vector<std::vector<unsigned char>> msgs(i);
+        std::vector<const unsigned char*> in(i);
+        std::vector<size_t> lengths(i);
+        for (int j = 0; j < i; ++j) {
+            // Cover empty messages and every padding case, in any mix of block counts
+            msgs[j] = g_insecure_rand_ctx.randbytes(InsecureRandRange(200));
+            in[j] = msgs[j].data();
+            lengths[j] = msgs[j].size();
+        }
+        unsigned char out1[32 * 32], out2[32 * 32];
+        for (int j = 0; j < i; ++j) {
+            CSHA256().Write(in[j], lengths[j]).Finalize(out1 + 32 * j);
+        }
+        SHA256Multi(out2, in.data(), lengths.data(), i);
+        BOOST_CHECK(memcmp(out1, out2, 32 * i) == 0);
+        for (int j = 0; j < i; ++j) {
+            CHash256().Write(in[j], lengths[j]).Finalize(out1 + 32 * j);
+        }
+        SHA256DMulti(out2, in.data(), lengths.data(), i);
+        BOOST_CHECK(memcmp(out1, out2, 32 * i) == 0);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -319,4 +319,85 @@ BOOST_AUTO_TEST_CASE(iterator_string_ordering)
 
 
 
+BOOST_AUTO_TEST_CASE(dbwrapper_profile)
+{
+    std::string error;
+    gArgs.ForceSetArg("-dbprofile", "dbwrapper_profile:compression=1,bloombits=0,maxfilesize=4096");
+    BOOST_CHECK(CheckDBProfiles(error));
+    DBProfile profile = GetDBProfile("dbwrapper_profile");
+    BOOST_CHECK(profile.compression);
+    BOOST_CHECK_EQUAL(profile.bloom_bits, 0);
+    BOOST_CHECK_EQUAL(profile.max_file_size, 4U << 20);
+    BOOST_CHECK_EQUAL(profile.write_buffer_percent, DBProfile().write_buffer_percent);
+    // Other databases keep the defaults
+    BOOST_CHECK(!GetDBProfile("chainstate").compression);
+
+    {
+        CDBWrapper dbw(GetDataDir() / "dbwrapper_profile", 1 << 20, true, false, false);
+        for (char key = 'a'; key <= 'z'; key++) {
+            BOOST_CHECK(dbw.Write(key, InsecureRand256()));
+        }
+        uint256 res;
+        BOOST_CHECK(dbw.Read('a', res));
+        BOOST_CHECK(!dbw.Exists('A'));
+
+        DBWrapperStats stats = dbw.GetStats();
+        BOOST_CHECK_EQUAL(stats.name, "dbwrapper_profile");
+        BOOST_CHECK(stats.profile.compression);
+        BOOST_CHECK_EQUAL(stats.reads, 3U);
+        BOOST_CHECK_EQUAL(stats.bytes_read, 32U);
+        BOOST_CHECK_EQUAL(stats.batches_written, 26U);
+        BOOST_CHECK_GT(stats.bytes_written, 26U * 32);
+
+        size_t open = 0;
+        ForEachDBWrapper([&](const CDBWrapper& other) { open += &other == &dbw; });
+        BOOST_CHECK_EQUAL(open, 1U);
+    }
+    size_t open = 0;
+    ForEachDBWrapper([&](const CDBWrapper& other) { open += other.GetName() == "dbwrapper_profile"; });
+    BOOST_CHECK_EQUAL(open, 0U);
+
+    for (const std::string arg : {"chainstate", "chainstate:bloombits", "chainstate:writebuffer=90", "chainstate:foo=1", ":compression=1"}) {
+        gArgs.ForceSetArg("-dbprofile", arg);
+        BOOST_CHECK(!CheckDBProfiles(error));
+    }
+    gArgs.ForceSetArg("-dbprofile", "");
+}
+
+BOOST_AUTO_TEST_CASE(dbwrapper_leveldb_stats)
+{
+    CDBWrapper dbw(GetDataDir() / "dbwrapper_leveldb_stats", 1 << 20, true, false, false);
+    for (int i = 0; i < 1000; i++) {
+        BOOST_CHECK(dbw.Write(i, InsecureRand256()));
+    }
+    // Flush the memtable into a table file
+    dbw.CompactRange(0, 1000);
+
+    DBWrapperStats stats = dbw.GetStats();
+    BOOST_CHECK_GT(stats.properties.memory_usage, 0U);
+    BOOST_CHECK(!stats.properties.levels.empty());
+    int files = 0;
+    for (const LevelDBLevelStats& level : stats.properties.levels) {
+        files += level.files;
+    }
+    BOOST_CHECK_GT(files, 0);
+    BOOST_CHECK_EQUAL(stats.l0_stops, 0U);
+
+    // Databases opened without CDBWrapper are listed once registered
+    leveldb::DB* db;
+    leveldb::Options options;
+    options.create_if_missing = true;
+    BOOST_REQUIRE(leveldb::DB::Open(options, (GetDataDir() / "dbwrapper_leveldb_raw").string(), &db).ok());
+    RegisterLevelDB("raw", db);
+    size_t registered = 0;
+    ForEachLevelDB([&](const std::string& name, leveldb::DB* other) { registered += name == "raw" && other == db; });
+    BOOST_CHECK_EQUAL(registered, 1U);
+    BOOST_CHECK_GT(GetLevelDBProperties(db).memory_usage, 0U);
+    UnregisterLevelDB(db);
+    registered = 0;
+    ForEachLevelDB([&](const std::string&, leveldb::DB*) { registered++; });
+    BOOST_CHECK_EQUAL(registered, 0U);
+    delete db;
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -123,4 +123,44 @@ BOOST_AUTO_TEST_CASE(flatfile_flush)
     BOOST_CHECK_EQUAL(fs::file_size(seq.FileName(FlatFilePos(0, 1))), 1);
 }
 
+BOOST_AUTO_TEST_CASE(flatfile_map)
+{
+    const auto data_dir = GetDataDir();
+    FlatFileSeq seq(data_dir, "a", 100);
+
+    // Missing files can't be mapped.
+    BOOST_CHECK(!seq.Map(FlatFilePos(0, 0)));
+
+    std::vector<unsigned char> data1{'a', 'b', 'c'};
+    std::vector<unsigned char> data2{'d', 'e'};
+    {
+        CAutoFile file(seq.Open(FlatFilePos(0, 0)), SER_DISK, CLIENT_VERSION);
+        file.write((const char*)data1.data(), data1.size());
+    }
+
+#ifndef WIN32
+    std::shared_ptr<const FlatFileMapping> mapping1 = seq.Map(FlatFilePos(0, 0));
+    BOOST_REQUIRE(mapping1);
+    BOOST_CHECK_EQUAL(mapping1->size(), data1.size());
+    BOOST_CHECK(std::equal(data1.begin(), data1.end(), mapping1->data()));
+
+    // Appended data is only covered by a new mapping, and removing the file
+    // leaves existing mappings intact.
+    {
+        CAutoFile file(seq.Open(FlatFilePos(0, data1.size())), SER_DISK, CLIENT_VERSION);
+        file.write((const char*)data2.data(), data2.size());
+    }
+    std::shared_ptr<const FlatFileMapping> mapping2 = seq.Map(FlatFilePos(0, 0));
+    BOOST_REQUIRE(mapping2);
+    BOOST_CHECK_EQUAL(mapping1->size(), data1.size());
+    BOOST_CHECK_EQUAL(mapping2->size(), data1.size() + data2.size());
+    BOOST_CHECK(std::equal(data2.begin(), data2.end(), mapping2->data() + data1.size()));
+
+    fs::remove(seq.FileName(FlatFilePos(0, 0)));
+    BOOST_CHECK(std::equal(data1.begin(), data1.end(), mapping1->data()));
+#else
+    BOOST_CHECK(!seq.Map(FlatFilePos(0, 0)));
+#endif
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,84 @@
+// Copyright (c) 2019 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <rpc/jsonstream.h>
+#include <test/setup_common.h>
+
+#include <univalue.h>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(jsonstream_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(jsonstream_matches_univalue)
+{
+    UniValue inner(UniValue::VOBJ);
+    inner.pushKV("n", 42);
+    inner.pushKV("quoted \"key\"", "line\nbreak");
+    UniValue arr(UniValue::VARR);
+    arr.push_back(inner);
+    arr.push_back(UniValue(UniValue::VARR));
+    arr.push_back(NullUniValue);
+    UniValue doc(UniValue::VOBJ);
+    doc.pushKV("a", true);
+    doc.pushKV("list", arr);
+    doc.pushKV("empty", UniValue(UniValue::VOBJ));
+    doc.pushKV("z", 1.5);
+
+    std::string out;
+    JSONStreamWriter writer([&out](const std::string& data) { out += data; return true; });
+    writer.BeginObject();
+    writer.Key("a");
+    writer.Value(true);
+    writer.Key("list");
+    writer.BeginArray();
+    writer.BeginObject();
+    writer.Fields(inner);
+    writer.EndObject();
+    writer.BeginArray();
+    writer.EndArray();
+    writer.Value(NullUniValue);
+    writer.EndArray();
+    writer.Key("empty");
+    writer.BeginObject();
+    writer.EndObject();
+    writer.Key("z");
+    writer.Value(1.5);
+    writer.EndObject();
+
+    // Nothing is handed out before the flush size is reached
+    BOOST_CHECK(writer.Flush());
+    BOOST_CHECK(out.empty());
+    BOOST_CHECK(writer.Flush(true));
+    BOOST_CHECK_EQUAL(out, doc.write());
+}
+
+BOOST_AUTO_TEST_CASE(jsonstream_flush)
+{
+    std::vector<std::string> chunks;
+    JSONStreamWriter writer([&chunks](const std::string& data) { chunks.push_back(data); return chunks.size() < 4; }, 16);
+    UniValue expected(UniValue::VARR);
+    writer.BeginArray();
+    for (int i = 0; i < 4; ++i) {
+        writer.Value("0123456789");
+        expected.push_back("0123456789");
+        writer.Flush();
+    }
+    writer.EndArray();
+    BOOST_CHECK(writer.Flush(true));
+    BOOST_CHECK_EQUAL(chunks.size(), 3U);
+    std::string out;
+    for (const std::string& chunk : chunks) out += chunk;
+    BOOST_CHECK_EQUAL(out, expected.write());
+
+    // Once the sink failed all further output is dropped
+    writer.Write("x");
+    BOOST_CHECK(!writer.Flush(true));
+    BOOST_CHECK(!writer.Good());
+    writer.Write("y");
+    BOOST_CHECK(!writer.Flush(true));
+    BOOST_CHECK_EQUAL(chunks.size(), 4U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
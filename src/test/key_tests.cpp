@@ -10,6 +10,7 @@
 #include <util/strencodings.h>
 #include <test/setup_common.h>
 
+#include <algorithm>
 #include <string>
 #include <vector>
 
@@ -186,6 +187,48 @@ BOOST_AUTO_TEST_CASE(key_signature_tests)
     BOOST_CHECK(found_small);
 }
 
+BOOST_AUTO_TEST_CASE(key_batch_verify)
+{
+    std::vector<CKey> keys(3);
+    for (CKey& key : keys) key.MakeNewKey(true);
+    keys[2].MakeNewKey(false);
+
+    CPubKeyBatchVerifier batch;
+    std::vector<CPubKey> pubkeys;
+    std::vector<uint256> hashes;
+    std::vector<std::vector<unsigned char>> sigs;
+    for (int i = 0; i < 200; ++i) {
+        const CKey& key = keys[i % keys.size()];
+        uint256 hash = InsecureRand256();
+        std::vector<unsigned char> sig;
+        BOOST_CHECK(key.Sign(hash, sig));
+        CPubKey pubkey = key.GetPubKey();
+        if (i % 7 == 3) hash = InsecureRand256(); // wrong message
+        if (i % 31 == 5) sig.assign(10, 0x30); // unparseable signature
+        if (i % 47 == 6) pubkey = CPubKey(); // invalid public key
+        batch.Add(pubkey, hash, sig);
+        pubkeys.push_back(pubkey);
+        hashes.push_back(hash);
+        sigs.push_back(sig);
+    }
+    BOOST_CHECK_EQUAL(batch.size(), 200U);
+
+    std::vector<bool> results;
+    BOOST_CHECK(!batch.Verify(results));
+    BOOST_CHECK_EQUAL(results.size(), 200U);
+    for (size_t i = 0; i < results.size(); ++i) {
+        BOOST_CHECK_EQUAL(results[i], pubkeys[i].Verify(hashes[i], sigs[i]));
+    }
+
+    // A batch of valid signatures only
+    CPubKeyBatchVerifier valid_batch;
+    for (size_t i = 0; i < results.size(); ++i) {
+        if (results[i]) valid_batch.Add(pubkeys[i], hashes[i], sigs[i]);
+    }
+    BOOST_CHECK(valid_batch.Verify(results));
+    BOOST_CHECK_EQUAL(std::count(results.begin(), results.end(), true), (long)valid_batch.size());
+}
+
 BOOST_AUTO_TEST_CASE(key_key_negation)
 {
     // create a dummy hash for signature comparison
@@ -2,8 +2,10 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <clientversion.h>
 #include <policy/policy.h>
 #include <policy/fees.h>
+#include <streams.h>
 #include <txmempool.h>
 #include <uint256.h>
 #include <util/system.h>
@@ -181,4 +183,85 @@ BOOST_AUTO_TEST_CASE(BlockPolicyEstimates)
     }
 }
 
+BOOST_AUTO_TEST_CASE(BlockPolicyGasPriceEstimates)
+{
+    CBlockPolicyEstimator feeEst;
+    CTxMemPool mpool(&feeEst);
+    LOCK2(cs_main, mpool.cs);
+    TestMemPoolEntryHelper entry;
+    CAmount baseGasPrice(40);
+    std::vector<uint256> txHashes[10];
+
+    // A contract call paying the same fee rate at every gas price
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vout.resize(1);
+    tx.vout[0].scriptPubKey = CScript() << OP_1 << OP_CALL;
+    tx.vout[0].nValue = 0LL;
+
+    std::vector<CTransactionRef> block;
+    int blocknum = 0;
+
+    // Higher gas prices are included more often, as in BlockPolicyEstimates
+    while (blocknum < 200) {
+        for (int j = 0; j < 10; j++) {
+            for (int k = 0; k < 4; k++) {
+                tx.vin[0].prevout.n = 10000*blocknum+100*j+k;
+                uint256 hash = tx.GetHash();
+                mpool.addUnchecked(entry.Fee(10000).MinGasPrice(baseGasPrice * (j+1)).Time(GetTime()).Height(blocknum).FromTx(tx));
+                txHashes[j].push_back(hash);
+            }
+        }
+        for (int h = 0; h <= blocknum%10; h++) {
+            while (txHashes[9-h].size()) {
+                CTransactionRef ptx = mpool.get(txHashes[9-h].back());
+                if (ptx)
+                    block.push_back(ptx);
+                txHashes[9-h].pop_back();
+            }
+        }
+        mpool.removeForBlock(block, ++blocknum);
+        block.clear();
+    }
+
+    // Contract transactions do not count towards fee rate estimates
+    BOOST_CHECK(feeEst.estimateSmartFee(2, nullptr, true) == CFeeRate(0));
+
+    std::vector<CAmount> origGasEst;
+    for (int i = 2; i < 10; i++) {
+        FeeCalculation feeCalc;
+        origGasEst.push_back(feeEst.estimateSmartGasPrice(i, &feeCalc, false));
+        BOOST_CHECK_EQUAL(feeCalc.returnedTarget, i);
+        BOOST_CHECK(origGasEst.back() >= baseGasPrice && origGasEst.back() <= 10 * baseGasPrice * 105 / 100);
+        if (i > 2) { // Gas price estimates should be monotonically decreasing
+            BOOST_CHECK(origGasEst[i-2] <= origGasEst[i-3]);
+        }
+    }
+    BOOST_CHECK(origGasEst.front() > origGasEst.back());
+
+    // Gas price estimates are saved next to the fee estimates
+    fs::path fee_path = GetDataDir() / "fee_estimates.dat", gas_path = GetDataDir() / "gas_estimates.dat";
+    {
+        CAutoFile fee_out(fsbridge::fopen(fee_path, "wb"), SER_DISK, CLIENT_VERSION);
+        CAutoFile gas_out(fsbridge::fopen(gas_path, "wb"), SER_DISK, CLIENT_VERSION);
+        BOOST_CHECK(feeEst.Write(fee_out));
+        BOOST_CHECK(feeEst.WriteGasPrices(gas_out));
+    }
+    CBlockPolicyEstimator readEst;
+    {
+        CAutoFile gas_in(fsbridge::fopen(gas_path, "rb"), SER_DISK, CLIENT_VERSION);
+        // Gas price estimates are only read on top of their fee estimates
+        BOOST_CHECK(!readEst.ReadGasPrices(gas_in));
+    }
+    {
+        CAutoFile fee_in(fsbridge::fopen(fee_path, "rb"), SER_DISK, CLIENT_VERSION);
+        CAutoFile gas_in(fsbridge::fopen(gas_path, "rb"), SER_DISK, CLIENT_VERSION);
+        BOOST_CHECK(readEst.Read(fee_in));
+        BOOST_CHECK(readEst.ReadGasPrices(gas_in));
+    }
+    for (int i = 2; i < 10; i++) {
+        BOOST_CHECK_EQUAL(readEst.estimateSmartGasPrice(i, nullptr, false), origGasEst[i-2]);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
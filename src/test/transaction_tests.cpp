@@ -496,6 +496,83 @@ BOOST_AUTO_TEST_CASE(test_big_witness_transaction)
     threadGroup.join_all();
 }
 
+// Check the inputs one at a time and as a single batch, and compare the outcomes
+static bool CheckInputsBatched(const CMutableTransaction& mtx, const std::vector<CTxOut>& spent)
+{
+    const CTransaction tx(mtx);
+    PrecomputedTransactionData txdata(tx);
+    // Without NULLFAIL, a failing OP_CHECKSIG does not end the script
+    const unsigned int flags = SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_DERSIG;
+
+    bool single_ok = true;
+    ScriptError single_error = SCRIPT_ERR_OK;
+    for (unsigned int i = 0; i < tx.vin.size() && single_ok; i++) {
+        CScriptCheck check(spent[i], tx, i, flags, false, &txdata);
+        single_ok = check();
+        single_error = check.GetScriptError();
+    }
+
+    std::vector<CScriptCheck> checks;
+    for (unsigned int i = 0; i < tx.vin.size(); i++) {
+        checks.emplace_back(spent[i], tx, i, flags, false, &txdata);
+        BOOST_CHECK(checks.back().IsBatchable());
+    }
+    CScriptCheck batch(std::move(checks));
+    BOOST_CHECK_EQUAL(batch(), single_ok);
+    if (!single_ok) {
+        BOOST_CHECK_EQUAL(ScriptErrorString(batch.GetScriptError()), ScriptErrorString(single_error));
+    }
+    return single_ok;
+}
+
+BOOST_AUTO_TEST_CASE(test_script_check_batch)
+{
+    std::vector<CKey> keys(2);
+    keys[0].MakeNewKey(true);
+    keys[1].MakeNewKey(false);
+
+    // P2PKH inputs signed by alternating keys
+    CMutableTransaction mtx;
+    std::vector<CTxOut> spent;
+    std::vector<valtype> sigs;
+    for (uint32_t i = 0; i < 20; i++) {
+        const CPubKey pubkey = keys[i % keys.size()].GetPubKey();
+        spent.emplace_back(1000, GetScriptForDestination(PKHash(pubkey)));
+        mtx.vin.emplace_back(COutPoint(InsecureRand256(), i));
+    }
+    mtx.vout.emplace_back(1000, CScript() << OP_1);
+    for (uint32_t i = 0; i < mtx.vin.size(); i++) {
+        const CKey& key = keys[i % keys.size()];
+        valtype sig;
+        BOOST_CHECK(key.Sign(SignatureHash(spent[i].scriptPubKey, mtx, i, SIGHASH_ALL, spent[i].nValue, SigVersion::BASE), sig));
+        sig.push_back(SIGHASH_ALL);
+        sigs.push_back(sig);
+        mtx.vin[i].scriptSig = CScript() << sig << ToByteVector(key.GetPubKey());
+    }
+    BOOST_CHECK(CheckInputsBatched(mtx, spent));
+
+    // A well-formed signature of another message
+    valtype bad_sig;
+    BOOST_CHECK(keys[1].Sign(InsecureRand256(), bad_sig));
+    bad_sig.push_back(SIGHASH_ALL);
+    const CScript good_script_sig = mtx.vin[7].scriptSig;
+
+    // One bad signature among valid ones
+    mtx.vin[7].scriptSig = CScript() << bad_sig << ToByteVector(keys[1].GetPubKey());
+    BOOST_CHECK(!CheckInputsBatched(mtx, spent));
+
+    // A scriptSig that only passes because an OP_CHECKSIG fails. Run with its
+    // signatures assumed valid, it fails, and has to be checked again on its own.
+    mtx.vin[7].scriptSig = CScript() << bad_sig << ToByteVector(keys[1].GetPubKey()) << OP_CHECKSIG << OP_NOT << OP_VERIFY << sigs[7] << ToByteVector(keys[1].GetPubKey());
+    BOOST_CHECK(CheckInputsBatched(mtx, spent));
+
+    // Both of them in one batch
+    mtx.vin[12].scriptSig = CScript() << bad_sig << ToByteVector(keys[0].GetPubKey());
+    BOOST_CHECK(!CheckInputsBatched(mtx, spent));
+    mtx.vin[7].scriptSig = good_script_sig;
+    BOOST_CHECK(!CheckInputsBatched(mtx, spent));
+}
+
 SignatureData CombineSignatures(const CMutableTransaction& input1, const CMutableTransaction& input2, const CTransactionRef tx)
 {
     SignatureData sigdata;
@@ -5,8 +5,12 @@
 #include <validation.h>
 #include <consensus/validation.h>
 #include <primitives/transaction.h>
+#include <script/interpreter.h>
 #include <script/script.h>
 #include <test/setup_common.h>
+#include <txmempool.h>
+
+#include <thread>
 
 #include <boost/test/unit_test.hpp>
 
@@ -53,4 +57,87 @@ BOOST_FIXTURE_TEST_CASE(tx_mempool_reject_coinbase, TestChain100Setup)
     BOOST_CHECK(state.GetReason() == ValidationInvalidReason::CONSENSUS);
 }
 
+static void SignSpend(CMutableTransaction& tx, const CScript& scriptPubKey, const CKey& key)
+{
+    std::vector<unsigned char> vchSig;
+    uint256 hash = SignatureHash(scriptPubKey, tx, 0, SIGHASH_ALL, 0, SigVersion::BASE);
+    BOOST_CHECK(key.Sign(hash, vchSig));
+    vchSig.push_back((unsigned char)SIGHASH_ALL);
+    tx.vin[0].scriptSig = CScript() << vchSig;
+}
+
+/**
+ * Ensure that transactions accepted from several threads at once, with their
+ * scripts verified in shared batches, are only admitted if valid, and that
+ * conflicts between them are caught when they are added.
+ */
+BOOST_FIXTURE_TEST_CASE(tx_mempool_accept_parallel, TestChain100Setup)
+{
+    const int NUM_TXS = 16;
+    CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+
+    // Split a mature coinbase into outputs to spend
+    CMutableTransaction split;
+    split.nVersion = 1;
+    split.vin.resize(1);
+    split.vin[0].prevout = COutPoint(m_coinbase_txns[0]->GetHash(), 0);
+    const CAmount value = (m_coinbase_txns[0]->vout[0].nValue - CENT) / NUM_TXS;
+    split.vout.assign(NUM_TXS, CTxOut(value, scriptPubKey));
+    SignSpend(split, scriptPubKey, coinbaseKey);
+    CreateAndProcessBlock({split}, scriptPubKey);
+
+    std::vector<CTransactionRef> txs;
+    for (int i = 0; i <= NUM_TXS; i++) {
+        CMutableTransaction spend;
+        spend.nVersion = 1;
+        spend.vin.resize(1);
+        spend.vin[0].prevout = COutPoint(split.GetHash(), i % NUM_TXS);
+        spend.vout.resize(1);
+        spend.vout[0].nValue = value - CENT;
+        spend.vout[0].scriptPubKey = scriptPubKey;
+        SignSpend(spend, scriptPubKey, coinbaseKey);
+        if (i == NUM_TXS - 1) {
+            // The signature no longer commits to the output
+            spend.vout[0].nValue -= CENT;
+        } else if (i == NUM_TXS) {
+            // A conflicting twin of the first spend
+            spend.vout[0].nValue -= 2 * CENT;
+            SignSpend(spend, scriptPubKey, coinbaseKey);
+        }
+        txs.push_back(MakeTransactionRef(spend));
+    }
+
+    std::vector<CValidationState> states(txs.size());
+    std::vector<char> accepted(txs.size());
+    std::vector<char> missing_inputs(txs.size());
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&, t] {
+            for (size_t i = t; i < txs.size(); i += 4) {
+                bool fMissingInputs;
+                accepted[i] = AcceptToMemoryPoolParallel(mempool, states[i], txs[i], &fMissingInputs, nullptr);
+                missing_inputs[i] = fMissingInputs;
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    for (int i = 0; i <= NUM_TXS; i++) {
+        BOOST_CHECK(!missing_inputs[i]);
+    }
+    for (int i = 1; i < NUM_TXS - 1; i++) {
+        BOOST_CHECK(accepted[i]);
+        BOOST_CHECK(mempool.exists(txs[i]->GetHash()));
+    }
+    BOOST_CHECK(!accepted[NUM_TXS - 1]);
+    BOOST_CHECK(states[NUM_TXS - 1].GetRejectReason().find("mandatory-script-verify-flag-failed") == 0);
+
+    // Exactly one of the twins got in
+    BOOST_CHECK(accepted[0] != accepted[NUM_TXS]);
+    BOOST_CHECK_EQUAL(states[accepted[0] ? NUM_TXS : 0].GetRejectReason(), "txn-mempool-conflict");
+    BOOST_CHECK_EQUAL(mempool.size(), (size_t)NUM_TXS - 1);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -69,19 +69,62 @@ struct CoinEntry {
 
 }
 
-CCoinsViewDB::CCoinsViewDB(fs::path ldb_path, size_t nCacheSize, bool fMemory, bool fWipe) : db(ldb_path, nCacheSize, fMemory, fWipe, true)
+CCoinsViewDB::CCoinsViewDB(fs::path ldb_path, size_t nCacheSize, bool fMemory, bool fWipe, bool background_writes) : db(ldb_path, nCacheSize, fMemory, fWipe, true)
 {
+    if (background_writes) {
+        m_writer = std::thread([this] {
+            util::ThreadRename("coinswrite");
+            ThreadWrite();
+        });
+    }
+}
+
+CCoinsViewDB::~CCoinsViewDB()
+{
+    if (m_writer.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(m_pending_mutex);
+            m_stop = true;
+        }
+        m_pending_cond.notify_all();
+        // The writer finishes the write in progress first
+        m_writer.join();
+    }
 }
 
 bool CCoinsViewDB::GetCoin(const COutPoint &outpoint, Coin &coin) const {
+    if (m_writer.joinable()) {
+        std::lock_guard<std::mutex> lock(m_pending_mutex);
+        auto it = m_pending.find(outpoint);
+        if (it != m_pending.end()) {
+            if (it->second.coin.IsSpent()) {
+                return false;
+            }
+            coin = it->second.coin;
+            return true;
+        }
+    }
     return db.Read(CoinEntry(&outpoint), coin);
 }
 
 bool CCoinsViewDB::HaveCoin(const COutPoint &outpoint) const {
+    if (m_writer.joinable()) {
+        std::lock_guard<std::mutex> lock(m_pending_mutex);
+        auto it = m_pending.find(outpoint);
+        if (it != m_pending.end()) {
+            return !it->second.coin.IsSpent();
+        }
+    }
     return db.Exists(CoinEntry(&outpoint));
 }
 
 uint256 CCoinsViewDB::GetBestBlock() const {
+    if (m_writer.joinable()) {
+        std::lock_guard<std::mutex> lock(m_pending_mutex);
+        if (!m_pending_block.IsNull()) {
+            return m_pending_block;
+        }
+    }
     uint256 hashBestChain;
     if (!db.Read(DB_BEST_BLOCK, hashBestChain))
         return uint256();
@@ -96,16 +139,10 @@ std::vector<uint256> CCoinsViewDB::GetHeadBlocks() const {
     return vhashHeadBlocks;
 }
 
-bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
-    CDBBatch batch(db);
-    size_t count = 0;
-    size_t changed = 0;
-    size_t batch_size = (size_t)gArgs.GetArg("-dbbatchsize", nDefaultDbBatchSize);
-    int crash_simulate = gArgs.GetArg("-dbcrashratio", 0);
-    assert(!hashBlock.IsNull());
-
-    uint256 old_tip = GetBestBlock();
-    if (old_tip.IsNull()) {
+uint256 CCoinsViewDB::GetOldTip(const uint256& hashBlock) const
+{
+    uint256 old_tip;
+    if (!db.Read(DB_BEST_BLOCK, old_tip)) {
         // We may be in the middle of replaying.
         std::vector<uint256> old_heads = GetHeadBlocks();
         if (old_heads.size() == 2) {
@@ -113,6 +150,40 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
             old_tip = old_heads[1];
         }
     }
+    return old_tip;
+}
+
+bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
+    assert(!hashBlock.IsNull());
+    if (!m_writer.joinable()) {
+        return WriteCoins(mapCoins, hashBlock, GetOldTip(hashBlock), true);
+    }
+
+    std::unique_lock<std::mutex> lock(m_pending_mutex);
+    m_pending_cond.wait(lock, [this] { return m_pending_block.IsNull(); });
+    if (m_write_failed) {
+        return false;
+    }
+    m_pending_old_tip = GetOldTip(hashBlock);
+    for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();) {
+        if (it->second.flags & CCoinsCacheEntry::DIRTY) {
+            m_pending.try_emplace(it->first, std::move(it->second));
+        }
+        it = mapCoins.erase(it);
+    }
+    m_pending_block = hashBlock;
+    lock.unlock();
+    m_pending_cond.notify_all();
+    return true;
+}
+
+bool CCoinsViewDB::WriteCoins(CCoinsMap& mapCoins, const uint256& hashBlock, const uint256& old_tip, bool erase)
+{
+    CDBBatch batch(db);
+    size_t count = 0;
+    size_t changed = 0;
+    size_t batch_size = (size_t)gArgs.GetArg("-dbbatchsize", nDefaultDbBatchSize);
+    int crash_simulate = gArgs.GetArg("-dbcrashratio", 0);
 
     // In the first batch, mark the database as being in the middle of a
     // transition from old_tip to hashBlock.
@@ -131,8 +202,11 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
             changed++;
         }
         count++;
-        CCoinsMap::iterator itOld = it++;
-        mapCoins.erase(itOld);
+        if (erase) {
+            it = mapCoins.erase(it);
+        } else {
+            ++it;
+        }
         if (batch.SizeEstimate() > batch_size) {
             LogPrint(BCLog::COINDB, "Writing partial batch of %.2f MiB\n", batch.SizeEstimate() * (1.0 / 1048576.0));
             db.WriteBatch(batch);
@@ -157,6 +231,44 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
     return ret;
 }
 
+bool CCoinsViewDB::WaitForWrites() const
+{
+    std::unique_lock<std::mutex> lock(m_pending_mutex);
+    m_pending_cond.wait(lock, [this] { return m_pending_block.IsNull(); });
+    return !m_write_failed;
+}
+
+void CCoinsViewDB::ThreadWrite()
+{
+    std::unique_lock<std::mutex> lock(m_pending_mutex);
+    while (true) {
+        m_pending_cond.wait(lock, [this] { return m_stop || !m_pending_block.IsNull(); });
+        if (m_pending_block.IsNull()) {
+            return;
+        }
+        lock.unlock();
+
+        // Only this thread changes m_pending until m_pending_block is reset,
+        // so it is read here without the lock.
+        int64_t nStart = GetTimeMicros();
+        bool ret = false;
+        try {
+            ret = WriteCoins(m_pending, m_pending_block, m_pending_old_tip, false);
+        } catch (const std::runtime_error& e) {
+            LogPrintf("%s: %s\n", __func__, e.what());
+        }
+        LogPrint(BCLog::COINDB, "Background coin database write took %.2fms\n", (GetTimeMicros() - nStart) * 0.001);
+
+        lock.lock();
+        m_pending.clear();
+        m_pending_block.SetNull();
+        if (!ret) {
+            m_write_failed = true;
+        }
+        m_pending_cond.notify_all();
+    }
+}
+
 size_t CCoinsViewDB::EstimateSize() const
 {
     return db.EstimateSize(DB_COIN, (char)(DB_COIN+1));
@@ -184,8 +296,178 @@ bool CBlockTreeDB::ReadLastBlockFile(int &nFile) {
     return Read(DB_LAST_BLOCK, nFile);
 }
 
+CCoinsViewPrefetch::CCoinsViewPrefetch(CCoinsView* view, int threads) : CCoinsViewBacked(view)
+{
+    for (int i = 0; i < threads; i++) {
+        m_threads.emplace_back([this, i] {
+            util::ThreadRename(strprintf("coinprefetch.%i", i));
+            ThreadLookup();
+        });
+    }
+}
+
+CCoinsViewPrefetch::~CCoinsViewPrefetch()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_cond.notify_all();
+    for (std::thread& thread : m_threads) {
+        thread.join();
+    }
+}
+
+bool CCoinsViewPrefetch::GetCoin(const COutPoint &outpoint, Coin &coin) const
+{
+    if (!m_threads.empty()) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_staged.find(outpoint);
+        if (it != m_staged.end()) {
+            // The cache above keeps the coin from now on
+            m_staged_usage -= it->second.coin.DynamicMemoryUsage();
+            coin = std::move(it->second.coin);
+            m_staged.erase(it);
+            m_hits++;
+            return true;
+        }
+        m_misses++;
+    }
+    return base->GetCoin(outpoint, coin);
+}
+
+bool CCoinsViewPrefetch::HaveCoin(const COutPoint &outpoint) const
+{
+    if (!m_threads.empty()) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_staged.count(outpoint)) {
+            return true;
+        }
+    }
+    return base->HaveCoin(outpoint);
+}
+
+bool CCoinsViewPrefetch::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock)
+{
+    if (!m_threads.empty()) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        // Coins the cache above has not taken by the time it is flushed are
+        // unlikely to be wanted, and flushing must free the memory they use
+        m_staged.clear();
+        m_staged_order.clear();
+        m_staged_usage = 0;
+        m_generation++;
+        m_writing = true;
+    }
+    bool ret = base->BatchWrite(mapCoins, hashBlock);
+    if (!m_threads.empty()) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_generation++;
+        m_writing = false;
+    }
+    return ret;
+}
+
+void CCoinsViewPrefetch::Prefetch(const CBlock& block)
+{
+    if (m_threads.empty()) {
+        return;
+    }
+    std::vector<std::vector<COutPoint>> batches(1);
+    for (const auto& tx : block.vtx) {
+        if (tx->IsCoinBase()) {
+            continue;
+        }
+        for (const CTxIn& txin : tx->vin) {
+            if (batches.back().size() == PREFETCH_LOOKUP_BATCH) {
+                batches.emplace_back();
+            }
+            batches.back().push_back(txin.prevout);
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_sequence++;
+        for (std::vector<COutPoint>& batch : batches) {
+            if (!batch.empty()) {
+                m_queue.emplace_back(m_sequence, std::move(batch));
+            }
+        }
+        EvictStaged();
+    }
+    m_cond.notify_all();
+}
+
+void CCoinsViewPrefetch::EvictStaged()
+{
+    while (!m_staged_order.empty() && m_staged_order.front().first + PREFETCH_STAGED_MAX_AGE <= m_sequence) {
+        auto it = m_staged.find(m_staged_order.front().second);
+        // The coin may have been taken, and staged again by a later block
+        if (it != m_staged.end() && it->second.sequence == m_staged_order.front().first) {
+            m_staged_usage -= it->second.coin.DynamicMemoryUsage();
+            m_staged.erase(it);
+        }
+        m_staged_order.pop_front();
+    }
+}
+
+size_t CCoinsViewPrefetch::DynamicMemoryUsage() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return memusage::DynamicUsage(m_staged) + m_staged_usage +
+        m_staged_order.size() * sizeof(decltype(m_staged_order)::value_type);
+}
+
+void CCoinsViewPrefetch::ThreadLookup()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true) {
+        m_cond.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+        if (m_stop) {
+            return;
+        }
+        const uint64_t sequence = m_queue.front().first;
+        std::vector<COutPoint> batch = std::move(m_queue.front().second);
+        m_queue.pop_front();
+        const uint64_t generation = m_generation;
+        lock.unlock();
+
+        std::vector<std::pair<COutPoint, Coin>> found;
+        for (const COutPoint& outpoint : batch) {
+            Coin coin;
+            // Outputs created by recent blocks are not in the view below yet
+            if (base->GetCoin(outpoint, coin)) {
+                found.emplace_back(outpoint, std::move(coin));
+            }
+        }
+
+        lock.lock();
+        // A write to the view below may have changed the coins since they were read
+        if (m_writing || generation != m_generation) {
+            continue;
+        }
+        // The block may have been connected long ago
+        if (sequence + PREFETCH_STAGED_MAX_AGE <= m_sequence) {
+            continue;
+        }
+        for (auto& entry : found) {
+            if (m_staged.size() >= MAX_PREFETCH_STAGED_COINS) {
+                break;
+            }
+            const size_t usage = entry.second.DynamicMemoryUsage();
+            if (m_staged.emplace(entry.first, StagedCoin{std::move(entry.second), sequence}).second) {
+                m_staged_order.emplace_back(sequence, entry.first);
+                m_staged_usage += usage;
+                m_staged_total++;
+            }
+        }
+    }
+}
+
 CCoinsViewCursor *CCoinsViewDB::Cursor() const
 {
+    // Iterate over a database that is consistent with its best block
+    WaitForWrites();
     CCoinsViewDBCursor *i = new CCoinsViewDBCursor(const_cast<CDBWrapper&>(db).NewIterator(), GetBestBlock());
     /* It seems that there are no "const iterators" for LevelDB.  Since we
        only need read operations on it, use a const-cast to get around
@@ -271,7 +553,8 @@ bool CBlockTreeDB::WriteHeightIndex(const CHeightTxIndexKey &heightIndex, const
 
 int CBlockTreeDB::ReadHeightIndex(int low, int high, int minconf,
         std::vector<std::vector<uint256>> &blocksOfHashes,
-        std::set<dev::h160> const &addresses) {
+        std::set<dev::h160> const &addresses,
+        std::vector<int> *heights) {
 
     if ((high < low && high > -1) || (high == 0 && low == 0) || (high < -1 || low < 0)) {
        return -1;
@@ -319,6 +602,9 @@ int CBlockTreeDB::ReadHeightIndex(int low, int high, int minconf,
         count += hashesTx.size();
 
         blocksOfHashes.push_back(hashesTx);
+        if (heights) {
+            heights->push_back(nextHeight);
+        }
     }
 
     return curheight;
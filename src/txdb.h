@@ -13,9 +13,15 @@
 #include <libdevcore/Common.h>
 #include <libdevcore/FixedHash.h>
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -86,7 +92,15 @@ struct CDiskTxPos : public FlatFilePos
     }
 };
 
-/** CCoinsView backed by the coin database (chainstate/) */
+/**
+ * CCoinsView backed by the coin database (chainstate/)
+ *
+ * With background writes, BatchWrite hands the dirty coins to a
+ * writer thread and returns. They are written in batches of -dbbatchsize
+ * bytes between the usual DB_HEAD_BLOCKS and DB_BEST_BLOCK markers, and
+ * lookups are answered from them until the last batch is on disk. A
+ * further BatchWrite waits for the previous one to complete.
+ */
 class CCoinsViewDB final : public CCoinsView
 {
 protected:
@@ -94,8 +108,10 @@ protected:
 public:
     /**
      * @param[in] ldb_path    Location in the filesystem where leveldb data will be stored.
+     * @param[in] background_writes  Write coins from a background thread.
      */
-    explicit CCoinsViewDB(fs::path ldb_path, size_t nCacheSize, bool fMemory, bool fWipe);
+    explicit CCoinsViewDB(fs::path ldb_path, size_t nCacheSize, bool fMemory, bool fWipe, bool background_writes = false);
+    ~CCoinsViewDB();
 
     bool GetCoin(const COutPoint &outpoint, Coin &coin) const override;
     bool HaveCoin(const COutPoint &outpoint) const override;
@@ -107,6 +123,25 @@ public:
     //! Attempt to update from an older database format. Returns whether an error occurred.
     bool Upgrade();
     size_t EstimateSize() const override;
+
+    /** Wait for the coins handed to the writer thread to be on disk. Returns false if any write failed. */
+    bool WaitForWrites() const;
+
+private:
+    uint256 GetOldTip(const uint256& hashBlock) const;
+    bool WriteCoins(CCoinsMap& mapCoins, const uint256& hashBlock, const uint256& old_tip, bool erase);
+    void ThreadWrite();
+
+    mutable std::mutex m_pending_mutex;
+    mutable std::condition_variable m_pending_cond;
+    //! Dirty coins of the write in progress
+    CCoinsMap m_pending;
+    //! Block the write in progress moves the database to, null if there is none
+    uint256 m_pending_block;
+    uint256 m_pending_old_tip;
+    bool m_write_failed = false;
+    bool m_stop = false;
+    std::thread m_writer;
 };
 
 /** Specialization of CCoinsViewCursor to iterate over a CCoinsViewDB */
@@ -131,6 +166,75 @@ private:
     friend class CCoinsViewDB;
 };
 
+//! Maximum number of coins held by CCoinsViewPrefetch that the cache above has not taken yet
+static const size_t MAX_PREFETCH_STAGED_COINS = 100000;
+//! Number of outpoints looked up by a prefetch thread at a time
+static const size_t PREFETCH_LOOKUP_BATCH = 32;
+//! Number of prefetched blocks after which CCoinsViewPrefetch drops the coins staged for a block
+static const uint64_t PREFETCH_STAGED_MAX_AGE = 512;
+
+/**
+ * Coins view between the coins cache and the database that looks up the
+ * inputs of upcoming blocks from background threads. Misses of the cache
+ * above are then served from memory instead of by LevelDB point reads.
+ *
+ * Staged coins are given to the cache above at most once. Coins that the
+ * cache above has not taken are dropped once PREFETCH_STAGED_MAX_AGE more
+ * blocks have been prefetched, and by every write to the view below, which
+ * also discards lookups that may have read around it. Staged coins thus
+ * always match the view below, and flushing the cache above frees them.
+ */
+class CCoinsViewPrefetch final : public CCoinsViewBacked
+{
+public:
+    CCoinsViewPrefetch(CCoinsView* view, int threads);
+    ~CCoinsViewPrefetch();
+
+    bool GetCoin(const COutPoint &outpoint, Coin &coin) const override;
+    bool HaveCoin(const COutPoint &outpoint) const override;
+    bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) override;
+
+    /** Queue the inputs of the block's transactions for lookup. */
+    void Prefetch(const CBlock& block);
+
+    //! Memory used by the staged coins
+    size_t DynamicMemoryUsage() const;
+
+    //! Lookups answered by a staged coin
+    mutable std::atomic<uint64_t> m_hits{0};
+    //! Lookups passed on to the view below
+    mutable std::atomic<uint64_t> m_misses{0};
+    //! Coins staged by the lookup threads
+    std::atomic<uint64_t> m_staged_total{0};
+
+private:
+    struct StagedCoin {
+        Coin coin;
+        //! Prefetch call that queued the lookup of the coin
+        uint64_t sequence;
+    };
+
+    void ThreadLookup();
+    void EvictStaged();
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cond;
+    std::deque<std::pair<uint64_t, std::vector<COutPoint>>> m_queue;
+    mutable std::unordered_map<COutPoint, StagedCoin, SaltedOutpointHasher> m_staged;
+    //! Staged outpoints in the order they were staged, for eviction
+    std::deque<std::pair<uint64_t, COutPoint>> m_staged_order;
+    //! Dynamic memory used by the scripts of the staged coins
+    mutable size_t m_staged_usage = 0;
+    //! Advanced by every call to Prefetch
+    uint64_t m_sequence = 0;
+    //! Advanced around every write to the view below
+    uint64_t m_generation = 0;
+    //! Whether a write to the view below is in progress
+    bool m_writing = false;
+    bool m_stop = false;
+    std::vector<std::thread> m_threads;
+};
+
 /** Access to the block database (blocks/index/) */
 class CBlockTreeDB : public CDBWrapper
 {
@@ -157,12 +261,14 @@ public:
      * @param minconf stop iterating of the block height does not have enough confirmations (ignored if <= 0)
      * @param blocksOfHashes transaction hashes in blocks iterated are collected into this vector.
      * @param addresses filter out a block unless it matches one of the addresses in this set.
+     * @param heights if set, the height of each entry of blocksOfHashes is collected into this vector.
      *
      * @return the height of the latest block iterated. 0 if no block is iterated.
      */
     int ReadHeightIndex(int low, int high, int minconf,
             std::vector<std::vector<uint256>> &blocksOfHashes,
-            std::set<dev::h160> const &addresses);
+            std::set<dev::h160> const &addresses,
+            std::vector<int> *heights = nullptr);
     bool EraseHeightIndex(const unsigned int &height);
     bool WipeHeightIndex();
 
@@ -34,6 +34,7 @@ CTxMemPoolEntry::CTxMemPoolEntry(const CTransactionRef& _tx, const CAmount& _nFe
     nModFeesWithDescendants = nFee;
 
     feeDelta = 0;
+    m_epoch = 0;
 
     nCountWithAncestors = 1;
     nSizeWithAncestors = GetTxSize();
@@ -63,13 +64,17 @@ size_t CTxMemPoolEntry::GetTxSize() const
 // descendants.
 void CTxMemPool::UpdateForDescendants(txiter updateIt, cacheMap &cachedDescendants, const std::set<uint256> &setExclude)
 {
-    setEntries stageEntries, setAllDescendants;
-    stageEntries = GetMemPoolChildren(updateIt);
+    const auto epoch = GetFreshEpoch();
+    std::vector<txiter> stageEntries, vAllDescendants;
+    for (txiter childEntry : GetMemPoolChildren(updateIt)) {
+        visited(childEntry);
+        stageEntries.push_back(childEntry);
+    }
 
     while (!stageEntries.empty()) {
-        const txiter cit = *stageEntries.begin();
-        setAllDescendants.insert(cit);
-        stageEntries.erase(cit);
+        const txiter cit = stageEntries.back();
+        vAllDescendants.push_back(cit);
+        stageEntries.pop_back();
         const setEntries &setChildren = GetMemPoolChildren(cit);
         for (txiter childEntry : setChildren) {
             cacheMap::iterator cacheIt = cachedDescendants.find(childEntry);
@@ -77,25 +82,27 @@ void CTxMemPool::UpdateForDescendants(txiter updateIt, cacheMap &cachedDescendan
                 // We've already calculated this one, just add the entries for this set
                 // but don't traverse again.
                 for (txiter cacheEntry : cacheIt->second) {
-                    setAllDescendants.insert(cacheEntry);
+                    if (!visited(cacheEntry)) {
+                        vAllDescendants.push_back(cacheEntry);
+                    }
                 }
-            } else if (!setAllDescendants.count(childEntry)) {
+            } else if (!visited(childEntry)) {
                 // Schedule for later processing
-                stageEntries.insert(childEntry);
+                stageEntries.push_back(childEntry);
             }
         }
     }
-    // setAllDescendants now contains all in-mempool descendants of updateIt.
+    // vAllDescendants now contains all in-mempool descendants of updateIt.
     // Update and add to cached descendant map
     int64_t modifySize = 0;
     CAmount modifyFee = 0;
     int64_t modifyCount = 0;
-    for (txiter cit : setAllDescendants) {
+    for (txiter cit : vAllDescendants) {
         if (!setExclude.count(cit->GetTx().GetHash())) {
             modifySize += cit->GetTxSize();
             modifyFee += cit->GetModifiedFee();
             modifyCount++;
-            cachedDescendants[updateIt].insert(cit);
+            cachedDescendants[updateIt].push_back(cit);
             // Update ancestor state for each descendant
             mapTx.modify(cit, update_ancestor_state(updateIt->GetTxSize(), updateIt->GetModifiedFee(), 1, updateIt->GetSigOpCost()));
         }
@@ -126,25 +133,27 @@ void CTxMemPool::UpdateTransactionsFromBlock(const std::vector<uint256> &vHashes
     // setMemPoolChildren will be updated, an assumption made in
     // UpdateForDescendants.
     for (const uint256 &hash : reverse_iterate(vHashesToUpdate)) {
-        // we cache the in-mempool children to avoid duplicate updates
-        setEntries setChildren;
         // calculate children from mapNextTx
         txiter it = mapTx.find(hash);
         if (it == mapTx.end()) {
             continue;
         }
-        auto iter = mapNextTx.lower_bound(COutPoint(hash, 0));
-        // First calculate the children, and update setMemPoolChildren to
-        // include them, and update their setMemPoolParents to include this tx.
-        for (; iter != mapNextTx.end() && iter->first->hash == hash; ++iter) {
-            const uint256 &childHash = iter->second->GetHash();
-            txiter childIter = mapTx.find(childHash);
-            assert(childIter != mapTx.end());
-            // We can skip updating entries we've encountered before or that
-            // are in the block (which are already accounted for).
-            if (setChildren.insert(childIter).second && !setAlreadyIncluded.count(childHash)) {
-                UpdateChild(it, childIter, true);
-                UpdateParent(childIter, it, true);
+        {
+            // we mark the in-mempool children to avoid duplicate updates
+            const auto epoch = GetFreshEpoch();
+            auto iter = mapNextTx.lower_bound(COutPoint(hash, 0));
+            // First calculate the children, and update setMemPoolChildren to
+            // include them, and update their setMemPoolParents to include this tx.
+            for (; iter != mapNextTx.end() && iter->first->hash == hash; ++iter) {
+                const uint256 &childHash = iter->second->GetHash();
+                txiter childIter = mapTx.find(childHash);
+                assert(childIter != mapTx.end());
+                // We can skip updating entries we've encountered before or that
+                // are in the block (which are already accounted for).
+                if (!visited(childIter) && !setAlreadyIncluded.count(childHash)) {
+                    UpdateChild(it, childIter, true);
+                    UpdateParent(childIter, it, true);
+                }
             }
         }
         UpdateForDescendants(it, mapMemPoolDescendantsToUpdate, setAlreadyIncluded);
@@ -153,8 +162,13 @@ void CTxMemPool::UpdateTransactionsFromBlock(const std::vector<uint256> &vHashes
 
 bool CTxMemPool::CalculateMemPoolAncestors(const CTxMemPoolEntry &entry, setEntries &setAncestors, uint64_t limitAncestorCount, uint64_t limitAncestorSize, uint64_t limitDescendantCount, uint64_t limitDescendantSize, std::string &errString, bool fSearchForParents /* = true */) const
 {
-    setEntries parentHashes;
+    // Entries already staged or in setAncestors are marked with the epoch
+    const auto epoch = GetFreshEpoch();
+    std::vector<txiter> parentHashes;
     const CTransaction &tx = entry.GetTx();
+    for (txiter it : setAncestors) {
+        visited(it);
+    }
 
     if (fSearchForParents) {
         // Get parents of this transaction that are in the mempool
@@ -162,8 +176,8 @@ bool CTxMemPool::CalculateMemPoolAncestors(const CTxMemPoolEntry &entry, setEntr
         // iterate mapTx to find parents.
         for (unsigned int i = 0; i < tx.vin.size(); i++) {
             boost::optional<txiter> piter = GetIter(tx.vin[i].prevout.hash);
-            if (piter) {
-                parentHashes.insert(*piter);
+            if (piter && !visited(*piter)) {
+                parentHashes.push_back(*piter);
                 if (parentHashes.size() + 1 > limitAncestorCount) {
                     errString = strprintf("too many unconfirmed parents [limit: %u]", limitAncestorCount);
                     return false;
@@ -174,16 +188,20 @@ bool CTxMemPool::CalculateMemPoolAncestors(const CTxMemPoolEntry &entry, setEntr
         // If we're not searching for parents, we require this to be an
         // entry in the mempool already.
         txiter it = mapTx.iterator_to(entry);
-        parentHashes = GetMemPoolParents(it);
+        for (txiter piter : GetMemPoolParents(it)) {
+            if (!visited(piter)) {
+                parentHashes.push_back(piter);
+            }
+        }
     }
 
     size_t totalSizeWithAncestors = entry.GetTxSize();
 
     while (!parentHashes.empty()) {
-        txiter stageit = *parentHashes.begin();
+        txiter stageit = parentHashes.back();
 
         setAncestors.insert(stageit);
-        parentHashes.erase(stageit);
+        parentHashes.pop_back();
         totalSizeWithAncestors += stageit->GetTxSize();
 
         if (stageit->GetSizeWithDescendants() + entry.GetTxSize() > limitDescendantSize) {
@@ -200,8 +218,8 @@ bool CTxMemPool::CalculateMemPoolAncestors(const CTxMemPoolEntry &entry, setEntr
         const setEntries & setMemPoolParents = GetMemPoolParents(stageit);
         for (txiter phash : setMemPoolParents) {
             // If this is a new ancestor, add it.
-            if (setAncestors.count(phash) == 0) {
-                parentHashes.insert(phash);
+            if (!visited(phash)) {
+                parentHashes.push_back(phash);
             }
             if (parentHashes.size() + setAncestors.size() + 1 > limitAncestorCount) {
                 errString = strprintf("too many unconfirmed ancestors [limit: %u]", limitAncestorCount);
@@ -213,6 +231,25 @@ bool CTxMemPool::CalculateMemPoolAncestors(const CTxMemPoolEntry &entry, setEntr
     return true;
 }
 
+CTxMemPool::EpochGuard CTxMemPool::GetFreshEpoch() const
+{
+    return EpochGuard(*this);
+}
+
+CTxMemPool::EpochGuard::EpochGuard(const CTxMemPool& in) : pool(in)
+{
+    assert(!pool.m_has_epoch_guard);
+    ++pool.m_epoch;
+    pool.m_has_epoch_guard = true;
+}
+
+CTxMemPool::EpochGuard::~EpochGuard()
+{
+    // prevents stale results being used
+    ++pool.m_epoch;
+    pool.m_has_epoch_guard = false;
+}
+
 void CTxMemPool::UpdateAncestorsOf(bool add, txiter it, setEntries &setAncestors)
 {
     setEntries parentIters = GetMemPoolParents(it);
@@ -333,6 +370,13 @@ CTxMemPool::CTxMemPool(CBlockPolicyEstimator* estimator)
 {
     _clear(); //lock free clear
 
+#ifdef ENABLE_BITCORE_RPC
+    // Start the address sequence at a random point below 2^52, so that it
+    // stays exact in JSON and sequence numbers handed out by an earlier
+    // process are seen as unknown rather than as an empty set of changes
+    nAddressSequence = nAddressRemovalsDropped = GetRand(1 << 20) << 32;
+#endif
+
     // Sanity checks off by default for performance, because otherwise
     // accepting transactions becomes O(N^2) where N is the number
     // of transactions in the pool
@@ -439,22 +483,21 @@ void CTxMemPool::removeUnchecked(txiter it, MemPoolRemovalReason reason)
 // can save time by not iterating over those entries.
 void CTxMemPool::CalculateDescendants(txiter entryit, setEntries& setDescendants) const
 {
-    setEntries stage;
-    if (setDescendants.count(entryit) == 0) {
-        stage.insert(entryit);
+    std::vector<txiter> stage;
+    if (setDescendants.insert(entryit).second) {
+        stage.push_back(entryit);
     }
     // Traverse down the children of entry, only adding children that are not
     // accounted for in setDescendants already (because those children have either
     // already been walked, or will be walked in this iteration).
     while (!stage.empty()) {
-        txiter it = *stage.begin();
-        setDescendants.insert(it);
-        stage.erase(it);
+        txiter it = stage.back();
+        stage.pop_back();
 
         const setEntries &setChildren = GetMemPoolChildren(it);
         for (txiter childiter : setChildren) {
-            if (!setDescendants.count(childiter)) {
-                stage.insert(childiter);
+            if (setDescendants.insert(childiter).second) {
+                stage.push_back(childiter);
             }
         }
     }
@@ -1126,6 +1169,10 @@ void CTxMemPool::SetIsLoaded(bool loaded)
 
 SaltedTxidHasher::SaltedTxidHasher() : k0(GetRand(std::numeric_limits<uint64_t>::max())), k1(GetRand(std::numeric_limits<uint64_t>::max())) {}
 
+#ifdef ENABLE_BITCORE_RPC
+SaltedAddressHasher::SaltedAddressHasher() : k0(GetRand(std::numeric_limits<uint64_t>::max())), k1(GetRand(std::numeric_limits<uint64_t>::max())) {}
+#endif
+
 #ifdef ENABLE_BITCORE_RPC
 /////////////////////////////////////////////////////// // qtum
 void CTxMemPool::addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewCache &view)
@@ -1133,6 +1180,7 @@ void CTxMemPool::addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewC
     LOCK(cs);
     const CTransaction& tx = entry.GetTx();
     std::vector<CMempoolAddressDeltaKey> inserted;
+    const uint64_t sequence = ++nAddressSequence;
 
     uint256 txhash = tx.GetHash();
     for (unsigned int j = 0; j < tx.vin.size(); j++) {
@@ -1149,7 +1197,8 @@ void CTxMemPool::addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewC
             std::copy(bytesID.begin(), bytesID.end(), addressBytes.begin());
             CMempoolAddressDeltaKey key(dest.which(), uint256(addressBytes), txhash, j, 1);
             CMempoolAddressDelta delta(entry.GetTime(), prevout.nValue * -1, input.prevout.hash, input.prevout.n);
-            mapAddress.insert(std::make_pair(key, delta));
+            delta.sequence = sequence;
+            mapAddress[CMempoolAddressKey(key.type, key.addressBytes)].deltas.insert(std::make_pair(key, delta));
             inserted.push_back(key);
         }
     }
@@ -1166,7 +1215,9 @@ void CTxMemPool::addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewC
             valtype addressBytes(32);
             std::copy(bytesID.begin(), bytesID.end(), addressBytes.begin());
             CMempoolAddressDeltaKey key(dest.which(), uint256(addressBytes), txhash, k, 0);
-            mapAddress.insert(std::make_pair(key, CMempoolAddressDelta(entry.GetTime(), out.nValue)));
+            CMempoolAddressDelta delta(entry.GetTime(), out.nValue);
+            delta.sequence = sequence;
+            mapAddress[CMempoolAddressKey(key.type, key.addressBytes)].deltas.insert(std::make_pair(key, delta));
             inserted.push_back(key);
         }
     }
@@ -1178,26 +1229,72 @@ bool CTxMemPool::getAddressIndex(std::vector<std::pair<uint256, int> > &addresse
 {
     LOCK(cs);
     for (std::vector<std::pair<uint256, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        addressDeltaMap::iterator ait = mapAddress.lower_bound(CMempoolAddressDeltaKey((*it).second, (*it).first));
-        while (ait != mapAddress.end() && (*ait).first.addressBytes == (*it).first && (*ait).first.type == (*it).second) {
-            results.push_back(*ait);
-            ait++;
+        addressDeltaMap::const_iterator ait = mapAddress.find(CMempoolAddressKey((*it).second, (*it).first));
+        if (ait != mapAddress.end()) {
+            results.insert(results.end(), ait->second.deltas.begin(), ait->second.deltas.end());
         }
     }
     return true;
 }
 
+bool CTxMemPool::getAddressDeltas(const std::vector<std::pair<uint256, int> > &addresses, uint64_t since,
+                                  std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> > &added,
+                                  std::vector<CMempoolAddressRemoval> &removed, uint64_t &sequence)
+{
+    LOCK(cs);
+    for (const std::pair<uint256, int>& address : addresses) {
+        addressDeltaMap::const_iterator ait = mapAddress.find(CMempoolAddressKey(address.second, address.first));
+        if (ait == mapAddress.end()) {
+            continue;
+        }
+        for (const auto& delta : ait->second.deltas) {
+            if (delta.second.sequence > since) {
+                added.push_back(delta);
+            }
+        }
+        // Removals are kept in order, so only the newest ones are scanned
+        const std::deque<CMempoolAddressRemoval>& removals = ait->second.removals;
+        for (auto rit = removals.rbegin(); rit != removals.rend() && rit->sequence > since; ++rit) {
+            if (rit->delta.sequence <= since) {
+                removed.push_back(*rit);
+            }
+        }
+    }
+    sequence = nAddressSequence;
+    return since == 0 || (since >= nAddressRemovalsDropped && since <= nAddressSequence);
+}
+
 bool CTxMemPool::removeAddressIndex(const uint256 txhash)
 {
     LOCK(cs);
     addressDeltaMapInserted::iterator it = mapAddressInserted.find(txhash);
 
     if (it != mapAddressInserted.end()) {
+        const uint64_t sequence = ++nAddressSequence;
         std::vector<CMempoolAddressDeltaKey> keys = (*it).second;
         for (std::vector<CMempoolAddressDeltaKey>::iterator mit = keys.begin(); mit != keys.end(); mit++) {
-            mapAddress.erase(*mit);
+            CMempoolAddressKey address((*mit).type, (*mit).addressBytes);
+            CMempoolAddressBucket& bucket = mapAddress.at(address);
+            auto dit = bucket.deltas.find(*mit);
+            if (dit == bucket.deltas.end()) {
+                continue;
+            }
+            bucket.removals.emplace_back(dit->first, dit->second, sequence);
+            bucket.deltas.erase(dit);
+            addressRemovals.push_back(address);
         }
         mapAddressInserted.erase(it);
+
+        // Forget the oldest removals, and the addresses left without deltas
+        while (addressRemovals.size() > MAX_MEMPOOL_ADDRESS_REMOVALS) {
+            addressDeltaMap::iterator ait = mapAddress.find(addressRemovals.front());
+            nAddressRemovalsDropped = ait->second.removals.front().sequence;
+            ait->second.removals.pop_front();
+            if (ait->second.deltas.empty() && ait->second.removals.empty()) {
+                mapAddress.erase(ait);
+            }
+            addressRemovals.pop_front();
+        }
     }
 
     return true;
@@ -6,11 +6,15 @@
 #ifndef BITCOIN_TXMEMPOOL_H
 #define BITCOIN_TXMEMPOOL_H
 
+#include <algorithm>
 #include <atomic>
+#include <cassert>
+#include <deque>
 #include <map>
 #include <memory>
 #include <set>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -71,12 +75,14 @@ struct CMempoolAddressDelta
     CAmount amount;
     uint256 prevhash;
     unsigned int prevout;
+    uint64_t sequence; //!< Address index change that added this delta
 
     CMempoolAddressDelta(int64_t t, CAmount a, uint256 hash, unsigned int out) {
         time = t;
         amount = a;
         prevhash = hash;
         prevout = out;
+        sequence = 0;
     }
 
     CMempoolAddressDelta(int64_t t, CAmount a) {
@@ -84,6 +90,7 @@ struct CMempoolAddressDelta
         amount = a;
         prevhash.SetNull();
         prevout = 0;
+        sequence = 0;
     }
 };
 
@@ -134,6 +141,53 @@ struct CMempoolAddressDeltaKeyCompare
         }
     }
 };
+
+struct CMempoolAddressKey
+{
+    int type;
+    uint256 addressBytes;
+
+    CMempoolAddressKey(int addressType, const uint256& addressHash) : type(addressType), addressBytes(addressHash) {}
+
+    friend bool operator==(const CMempoolAddressKey& a, const CMempoolAddressKey& b) {
+        return a.type == b.type && a.addressBytes == b.addressBytes;
+    }
+};
+
+class SaltedAddressHasher
+{
+private:
+    /** Salt */
+    const uint64_t k0, k1;
+
+public:
+    SaltedAddressHasher();
+
+    size_t operator()(const CMempoolAddressKey& key) const {
+        return SipHashUint256Extra(k0, k1, key.addressBytes, key.type);
+    }
+};
+
+/** A delta that was removed from the mempool address index */
+struct CMempoolAddressRemoval
+{
+    CMempoolAddressDeltaKey key;
+    CMempoolAddressDelta delta;
+    uint64_t sequence; //!< Address index change that removed the delta
+
+    CMempoolAddressRemoval(const CMempoolAddressDeltaKey& k, const CMempoolAddressDelta& d, uint64_t s) : key(k), delta(d), sequence(s) {}
+};
+
+/** The mempool deltas of one address, and its most recent removals in the
+ *  order they happened */
+struct CMempoolAddressBucket
+{
+    std::map<CMempoolAddressDeltaKey, CMempoolAddressDelta, CMempoolAddressDeltaKeyCompare> deltas;
+    std::deque<CMempoolAddressRemoval> removals;
+};
+
+//! Number of address index removals kept for getAddressDeltas
+static const size_t MAX_MEMPOOL_ADDRESS_REMOVALS = 100000;
 ////////////////////////////////////////////////////////
 #endif
 
@@ -218,6 +272,7 @@ public:
     int64_t GetSigOpCostWithAncestors() const { return nSigOpCostWithAncestors; }
 
     mutable size_t vTxHashesIdx; //!< Index in mempool's vTxHashes
+    mutable uint64_t m_epoch; //!< epoch when last touched, useful for graph algorithms
 };
 
 // Helpers for modifying CTxMemPool::mapTx, which is a boost multi_index.
@@ -596,6 +651,9 @@ private:
 
     bool m_is_loaded GUARDED_BY(cs){false};
 
+    mutable uint64_t m_epoch{0};
+    mutable bool m_has_epoch_guard{false};
+
 public:
 
     static const int ROLLING_FEE_HALFLIFE = 60 * 60 * 12; // public only for testing
@@ -676,7 +734,7 @@ public:
     const setEntries & GetMemPoolChildren(txiter entry) const EXCLUSIVE_LOCKS_REQUIRED(cs);
     uint64_t CalculateDescendantMaximum(txiter entry) const EXCLUSIVE_LOCKS_REQUIRED(cs);
 private:
-    typedef std::map<txiter, setEntries, CompareIteratorByHash> cacheMap;
+    typedef std::map<txiter, std::vector<txiter>, CompareIteratorByHash> cacheMap;
 
     struct TxLinks {
         setEntries parents;
@@ -688,9 +746,16 @@ private:
 
 #ifdef ENABLE_BITCORE_RPC
     //////////////////////////////////////////////////////////////// // qtum
-    typedef std::map<CMempoolAddressDeltaKey, CMempoolAddressDelta, CMempoolAddressDeltaKeyCompare> addressDeltaMap;
+    typedef std::unordered_map<CMempoolAddressKey, CMempoolAddressBucket, SaltedAddressHasher> addressDeltaMap;
     addressDeltaMap mapAddress;
 
+    //! Sequence number of the last change to mapAddress, starting at a random point
+    uint64_t nAddressSequence = 0;
+    //! Sequence number of the last removal dropped from the address buckets, or the starting point
+    uint64_t nAddressRemovalsDropped = 0;
+    //! Addresses of the kept removals, oldest first
+    std::deque<CMempoolAddressKey> addressRemovals;
+
     typedef std::map<uint256, std::vector<CMempoolAddressDeltaKey> > addressDeltaMapInserted;
     addressDeltaMapInserted mapAddressInserted;
 
@@ -705,9 +770,10 @@ private:
     void UpdateParent(txiter entry, txiter parent, bool add);
     void UpdateChild(txiter entry, txiter child, bool add);
 
+public:
+    /** All entries, ordered so that parents come before their children */
     std::vector<indexed_transaction_set::const_iterator> GetSortedDepthAndScore() const EXCLUSIVE_LOCKS_REQUIRED(cs);
 
-public:
     indirectmap<COutPoint, const CTransaction*> mapNextTx GUARDED_BY(cs);
     std::map<uint256, CAmount> mapDeltas;
 
@@ -739,6 +805,13 @@ public:
     void addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewCache &view);
     bool getAddressIndex(std::vector<std::pair<uint256, int> > &addresses,
                          std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> > &results);
+    /** Deltas of the given addresses added after change number since, and
+     *  the removals after it of deltas added before it. Returns false if
+     *  some of those removals are no longer known, or since was not handed
+     *  out by this process. */
+    bool getAddressDeltas(const std::vector<std::pair<uint256, int> > &addresses, uint64_t since,
+                          std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> > &added,
+                          std::vector<CMempoolAddressRemoval> &removed, uint64_t &sequence);
     bool removeAddressIndex(const uint256 txhash);
 
     void addSpentIndex(const CTxMemPoolEntry &entry, const CCoinsViewCache &view);
@@ -880,6 +953,27 @@ public:
     boost::signals2::signal<void (CTransactionRef, MemPoolRemovalReason)> NotifyEntryRemoved;
 
 private:
+    /** Graph walks mark the entries they reach with the current epoch instead
+     *  of collecting them in a set. An EpochGuard starts a fresh epoch for
+     *  one walk; walks may not be nested.
+     */
+    class EpochGuard {
+        const CTxMemPool& pool;
+    public:
+        EpochGuard(const CTxMemPool& in);
+        ~EpochGuard();
+    };
+    EpochGuard GetFreshEpoch() const EXCLUSIVE_LOCKS_REQUIRED(cs);
+
+    /** Mark an entry as reached in the current epoch; returns whether it
+     *  was already reached. */
+    bool visited(txiter it) const EXCLUSIVE_LOCKS_REQUIRED(cs) {
+        assert(m_has_epoch_guard);
+        bool ret = it->m_epoch >= m_epoch;
+        it->m_epoch = std::max(it->m_epoch, m_epoch);
+        return ret;
+    }
+
     /** UpdateForDescendants is used by UpdateTransactionsFromBlock to update
      *  the descendants for a single transaction that has been added to the
      *  mempool but may have child transactions in the mempool, eg during a
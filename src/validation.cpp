@@ -16,6 +16,8 @@
 #include <consensus/tx_check.h>
 #include <consensus/tx_verify.h>
 #include <consensus/validation.h>
+#include <crypto/common.h>
+#include <crypto/sha256.h>
 #include <cuckoocache.h>
 #include <flatfile.h>
 #include <hash.h>
@@ -58,9 +60,16 @@
 #include <util/convert.h>
 
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <future>
+#include <list>
+#include <mutex>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <unordered_map>
 
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/thread.hpp>
@@ -103,6 +112,11 @@ bool CBlockIndexWorkComparator::operator()(const CBlockIndex *pa, const CBlockIn
     return false;
 }
 
+bool CBlockIndexHeightComparator::operator()(const CBlockIndex *pa, const CBlockIndex *pb) const {
+    if (pa->nHeight != pb->nHeight) return pa->nHeight < pb->nHeight;
+    return pa < pb;
+}
+
 namespace {
 BlockManager g_blockman;
 } // anon namespace
@@ -136,6 +150,10 @@ Mutex g_best_block_mutex;
 std::condition_variable g_best_block_cv;
 uint256 g_best_block;
 int nScriptCheckThreads = 0;
+int nCoinPrefetchThreads = DEFAULT_COIN_PREFETCH_THREADS;
+bool fIncrementalFlush = DEFAULT_INCREMENTAL_FLUSH;
+bool fParallelAccept = DEFAULT_PARALLEL_ACCEPT;
+int nSignatureBatchSize = DEFAULT_SIGNATURE_BATCH_SIZE;
 std::atomic_bool fImporting(false);
 std::atomic_bool fReindex(false);
 #ifdef ENABLE_BITCORE_RPC
@@ -458,8 +476,115 @@ static bool CheckInputsFromMempoolAndCache(const CTransaction& tx, CValidationSt
     return CheckInputs(tx, state, view, flags, cacheSigStore, true, txdata);
 }
 
+/**
+ * A script check of a transaction accepted with AcceptToMemoryPoolParallel.
+ * The checks of several transactions are verified in one batch, so a failure
+ * marks its own transaction instead of failing the batch.
+ */
+class CMempoolScriptCheck
+{
+private:
+    CScriptCheck m_check;
+    std::atomic<bool>* m_failed;
+
+public:
+    CMempoolScriptCheck() : m_failed(nullptr) {}
+    CMempoolScriptCheck(CScriptCheck& check, std::atomic<bool>* failed) : m_failed(failed) { m_check.swap(check); }
+
+    bool operator()()
+    {
+        // The remaining inputs of a transaction that already failed are skipped
+        if (!*m_failed && !m_check()) {
+            *m_failed = true;
+        }
+        return true;
+    }
+
+    void swap(CMempoolScriptCheck& check)
+    {
+        m_check.swap(check.m_check);
+        std::swap(m_failed, check.m_failed);
+    }
+};
+
+static CCheckQueue<CMempoolScriptCheck> mempoolcheckqueue(128);
+
+void ThreadMempoolScriptCheck(int worker_num) {
+    util::ThreadRename(strprintf("txscriptch.%i", worker_num));
+    mempoolcheckqueue.Thread();
+}
+
 namespace {
 
+/**
+ * Collects the script checks of transactions accepted by several threads at
+ * once. Checks handed in while a batch is verified wait for the next batch,
+ * which is run by the first caller to find the queue idle.
+ */
+class MempoolScriptBatch
+{
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    std::vector<CMempoolScriptCheck> m_pending;
+    size_t m_pending_txs{0};
+    bool m_running{false};
+    //! Batch the pending checks will be verified in, and the last batch done
+    uint64_t m_next_batch{1};
+    uint64_t m_done_batch{0};
+
+    static void Run(std::vector<CMempoolScriptCheck>& checks, size_t txs)
+    {
+        const int64_t start = GetTimeMicros();
+        const size_t count = checks.size();
+        if (nScriptCheckThreads) {
+            CCheckQueueControl<CMempoolScriptCheck> control(&mempoolcheckqueue);
+            control.Add(checks);
+            control.Wait();
+        } else {
+            for (CMempoolScriptCheck& check : checks) {
+                check();
+            }
+        }
+        LogPrint(BCLog::BENCH, "    - Mempool script checks: %u inputs of %u txs in %.2fms\n", count, txs, (GetTimeMicros() - start) * MILLI);
+    }
+
+public:
+    //! Verify the checks of one transaction, batched with those of other callers
+    bool Verify(std::vector<CScriptCheck>& checks)
+    {
+        if (checks.empty()) return true;
+        std::atomic<bool> failed{false};
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (CScriptCheck& check : checks) {
+            m_pending.emplace_back(check, &failed);
+        }
+        m_pending_txs++;
+        const uint64_t batch = m_next_batch;
+        while (m_done_batch < batch) {
+            if (m_running) {
+                m_cond.wait(lock);
+                continue;
+            }
+            m_running = true;
+            std::vector<CMempoolScriptCheck> checks_to_run;
+            checks_to_run.swap(m_pending);
+            const size_t txs = m_pending_txs;
+            m_pending_txs = 0;
+            const uint64_t running = m_next_batch++;
+            lock.unlock();
+            Run(checks_to_run, txs);
+            lock.lock();
+            m_done_batch = running;
+            m_running = false;
+            m_cond.notify_all();
+        }
+        return !failed;
+    }
+};
+
+MempoolScriptBatch g_mempool_script_batch;
+
 class MemPoolAccept
 {
 public:
@@ -491,8 +616,14 @@ public:
         bool m_raw_tx;
     };
 
-    // Single transaction acceptance
-    bool AcceptSingleTransaction(const CTransactionRef& ptx, ATMPArgs& args) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    // Single transaction acceptance. txdata may hold the precomputed data of
+    // an earlier PrepareScriptChecks(), whose checks passed if
+    // policy_scripts_verified is set.
+    bool AcceptSingleTransaction(const CTransactionRef& ptx, ATMPArgs& args, PrecomputedTransactionData* txdata = nullptr, bool policy_scripts_verified = false) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
+    // Run the policy checks and collect the script checks with our policy
+    // flags, so that they can be verified without holding cs_main.
+    bool PrepareScriptChecks(const CTransactionRef& ptx, ATMPArgs& args, std::unique_ptr<PrecomputedTransactionData>& txdata, std::vector<CScriptCheck>& checks) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
 private:
     // All the intermediate state that gets passed between the various levels
@@ -1168,7 +1299,7 @@ bool MemPoolAccept::Finalize(ATMPArgs& args, Workspace& ws)
     return true;
 }
 
-bool MemPoolAccept::AcceptSingleTransaction(const CTransactionRef& ptx, ATMPArgs& args)
+bool MemPoolAccept::AcceptSingleTransaction(const CTransactionRef& ptx, ATMPArgs& args, PrecomputedTransactionData* txdata, bool policy_scripts_verified)
 {
     AssertLockHeld(cs_main);
     LOCK(m_pool.cs); // mempool "read lock" (held through GetMainSignals().TransactionAddedToMempool())
@@ -1181,11 +1312,17 @@ bool MemPoolAccept::AcceptSingleTransaction(const CTransactionRef& ptx, ATMPArgs
     // scripts (ie, other policy checks pass). We perform the inexpensive
     // checks first and avoid hashing and signature verification unless those
     // checks pass, to mitigate CPU exhaustion denial-of-service attacks.
-    PrecomputedTransactionData txdata(*ptx);
+    std::unique_ptr<PrecomputedTransactionData> own_txdata;
+    if (!txdata) {
+        own_txdata = MakeUnique<PrecomputedTransactionData>(*ptx);
+        txdata = own_txdata.get();
+    }
 
-    if (!PolicyScriptChecks(args, workspace, txdata)) return false;
+    // The scripts only depend on the transaction and the outputs it spends,
+    // so a verification done before the mempool changed still holds.
+    if (!policy_scripts_verified && !PolicyScriptChecks(args, workspace, *txdata)) return false;
 
-    if (!ConsensusScriptChecks(args, workspace, txdata)) return false;
+    if (!ConsensusScriptChecks(args, workspace, *txdata)) return false;
 
     // Tx was accepted, but not added
     if (args.m_test_accept) return true;
@@ -1197,17 +1334,26 @@ bool MemPoolAccept::AcceptSingleTransaction(const CTransactionRef& ptx, ATMPArgs
     return true;
 }
 
+bool MemPoolAccept::PrepareScriptChecks(const CTransactionRef& ptx, ATMPArgs& args, std::unique_ptr<PrecomputedTransactionData>& txdata, std::vector<CScriptCheck>& checks)
+{
+    AssertLockHeld(cs_main);
+    LOCK(m_pool.cs);
+
+    Workspace workspace(ptx);
+
+    if (!PreChecks(args, workspace)) return false;
+
+    txdata = MakeUnique<PrecomputedTransactionData>(*ptx);
+
+    // Without running the scripts, this only fails for spends of locked outputs
+    return CheckInputs(*ptx, args.m_state, m_view, STANDARD_SCRIPT_VERIFY_FLAGS, true, false, *txdata, &checks);
+}
+
 } // anon namespace
 
-/** (try to) add transaction to memory pool with a specified acceptance time **/
-static bool AcceptToMemoryPoolWithTime(const CChainParams& chainparams, CTxMemPool& pool, CValidationState &state, const CTransactionRef &tx,
-                        bool* pfMissingInputs, int64_t nAcceptTime, std::list<CTransactionRef>* plTxnReplaced,
-                        bool bypass_limits, const CAmount nAbsurdFee, bool test_accept, bool rawTx = false) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+static void UncacheRejectedCoins(const CChainParams& chainparams, bool accepted, const std::vector<COutPoint>& coins_to_uncache) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
 {
-    std::vector<COutPoint> coins_to_uncache;
-    MemPoolAccept::ATMPArgs args { chainparams, state, pfMissingInputs, nAcceptTime, plTxnReplaced, bypass_limits, nAbsurdFee, coins_to_uncache, test_accept, rawTx };
-    bool res = MemPoolAccept(pool).AcceptSingleTransaction(tx, args);
-    if (!res) {
+    if (!accepted) {
         // Remove coins that were not present in the coins cache before calling ATMPW;
         // this is to prevent memory DoS in case we receive a large number of
         // invalid transactions that attempt to overrun the in-memory coins cache
@@ -1219,6 +1365,42 @@ static bool AcceptToMemoryPoolWithTime(const CChainParams& chainparams, CTxMemPo
     // After we've (potentially) uncached entries, ensure our coins cache is still within its size limits
     CValidationState stateDummy;
     ::ChainstateActive().FlushStateToDisk(chainparams, stateDummy, FlushStateMode::PERIODIC);
+}
+
+/** (try to) add transaction to memory pool with a specified acceptance time **/
+static bool AcceptToMemoryPoolWithTime(const CChainParams& chainparams, CTxMemPool& pool, CValidationState &state, const CTransactionRef &tx,
+                        bool* pfMissingInputs, int64_t nAcceptTime, std::list<CTransactionRef>* plTxnReplaced,
+                        bool bypass_limits, const CAmount nAbsurdFee, bool test_accept, bool rawTx = false) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    std::vector<COutPoint> coins_to_uncache;
+    MemPoolAccept::ATMPArgs args { chainparams, state, pfMissingInputs, nAcceptTime, plTxnReplaced, bypass_limits, nAbsurdFee, coins_to_uncache, test_accept, rawTx };
+    bool res = MemPoolAccept(pool).AcceptSingleTransaction(tx, args);
+    UncacheRejectedCoins(chainparams, res, coins_to_uncache);
+    return res;
+}
+
+bool AcceptToMemoryPoolParallel(CTxMemPool& pool, CValidationState &state, const CTransactionRef &tx,
+                                bool* pfMissingInputs, std::list<CTransactionRef>* plTxnReplaced)
+{
+    const CChainParams& chainparams = Params();
+    const CAmount nAbsurdFee = 0;
+    std::vector<COutPoint> coins_to_uncache;
+    MemPoolAccept::ATMPArgs args { chainparams, state, pfMissingInputs, GetTime(), plTxnReplaced, false /* bypass_limits */, nAbsurdFee, coins_to_uncache, false /* test_accept */, false /* rawTx */ };
+
+    std::unique_ptr<PrecomputedTransactionData> txdata;
+    std::vector<CScriptCheck> checks;
+    bool res = WITH_LOCK(cs_main, return MemPoolAccept(pool).PrepareScriptChecks(tx, args, txdata, checks));
+
+    // A failed verification is repeated inline below, which finds out why it failed
+    const bool scripts_verified = res && g_mempool_script_batch.Verify(checks);
+
+    LOCK(cs_main);
+    if (res) {
+        // The mempool and the tip may have changed meanwhile, so check the
+        // transaction against them again
+        res = MemPoolAccept(pool).AcceptSingleTransaction(tx, args, txdata.get(), scripts_verified);
+    }
+    UncacheRejectedCoins(chainparams, res, coins_to_uncache);
     return res;
 }
 
@@ -1450,6 +1632,81 @@ bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const CBlockIndex* pindex
     return ReadRawBlockFromDisk(block, block_pos, message_start);
 }
 
+/** Number of block files kept memory-mapped for MapRawBlockFromDisk */
+static const size_t MAX_BLOCK_FILE_MAPPINGS = 8;
+static Mutex cs_block_file_mappings;
+/** Memory-mapped block files, most recently used first */
+static std::list<std::pair<int, std::shared_ptr<const FlatFileMapping>>> g_block_file_mappings GUARDED_BY(cs_block_file_mappings);
+
+static std::shared_ptr<const FlatFileMapping> GetBlockFileMapping(const FlatFilePos& pos, bool remap)
+{
+    LOCK(cs_block_file_mappings);
+    auto it = std::find_if(g_block_file_mappings.begin(), g_block_file_mappings.end(),
+                           [&pos](const std::pair<int, std::shared_ptr<const FlatFileMapping>>& entry) { return entry.first == pos.nFile; });
+    if (it != g_block_file_mappings.end()) {
+        if (!remap) {
+            g_block_file_mappings.splice(g_block_file_mappings.begin(), g_block_file_mappings, it);
+            return it->second;
+        }
+        g_block_file_mappings.erase(it);
+    }
+
+    std::shared_ptr<const FlatFileMapping> mapping = BlockFileSeq().Map(pos);
+    if (mapping) {
+        g_block_file_mappings.emplace_front(pos.nFile, mapping);
+        if (g_block_file_mappings.size() > MAX_BLOCK_FILE_MAPPINGS) {
+            g_block_file_mappings.pop_back();
+        }
+    }
+    return mapping;
+}
+
+/** Drop the mapping of a block file, so that the space of a deleted file is released */
+static void ForgetBlockFileMapping(int nFile)
+{
+    LOCK(cs_block_file_mappings);
+    g_block_file_mappings.remove_if([nFile](const std::pair<int, std::shared_ptr<const FlatFileMapping>>& entry) { return entry.first == nFile; });
+}
+
+bool MapRawBlockFromDisk(std::shared_ptr<const FlatFileMapping>& mapping, Span<const unsigned char>& block, const FlatFilePos& pos, const CMessageHeader::MessageStartChars& message_start)
+{
+    // Mapping whole block files would exhaust the address space of 32-bit systems
+    if (sizeof(void*) < 8) {
+        return false;
+    }
+
+    // A cached mapping may predate the block if it was appended to the file
+    // later, so retry once with a fresh mapping.
+    for (int attempt = 0; attempt < 2; attempt++) {
+        std::shared_ptr<const FlatFileMapping> file = GetBlockFileMapping(pos, attempt > 0);
+        if (!file) {
+            return false;
+        }
+        // Meta header: message start and block size
+        if (pos.nPos < 8 || pos.nPos > file->size()) {
+            continue;
+        }
+        const unsigned char* header = file->data() + pos.nPos - 8;
+        if (memcmp(header, message_start, CMessageHeader::MESSAGE_START_SIZE)) {
+            return error("%s: Block magic mismatch for %s: %s versus expected %s", __func__, pos.ToString(),
+                    HexStr(header, header + CMessageHeader::MESSAGE_START_SIZE),
+                    HexStr(message_start, message_start + CMessageHeader::MESSAGE_START_SIZE));
+        }
+        uint32_t blk_size = ReadLE32(header + CMessageHeader::MESSAGE_START_SIZE);
+        if (blk_size > MAX_SIZE) {
+            return error("%s: Block data is larger than maximum deserialization size for %s: %s versus %s", __func__, pos.ToString(),
+                    blk_size, MAX_SIZE);
+        }
+        if ((uint64_t)pos.nPos + blk_size > file->size()) {
+            continue;
+        }
+        mapping = std::move(file);
+        block = Span<const unsigned char>(mapping->data() + pos.nPos, blk_size);
+        return true;
+    }
+    return error("%s: Block at %s extends past the end of its file", __func__, pos.ToString());
+}
+
 CAmount GetBlockSubsidy(int nHeight, const Consensus::Params& consensusParams)
 {
     // 70.8 billion coins to cover existing coins, developer fund and exchange reimbursement
@@ -1477,12 +1734,13 @@ CoinsViews::CoinsViews(
     size_t cache_size_bytes,
     bool in_memory,
     bool should_wipe) : m_dbview(
-                            GetDataDir() / ldb_name, cache_size_bytes, in_memory, should_wipe),
-                        m_catcherview(&m_dbview) {}
+                            GetDataDir() / ldb_name, cache_size_bytes, in_memory, should_wipe, fIncrementalFlush),
+                        m_catcherview(&m_dbview),
+                        m_prefetchview(&m_catcherview, nCoinPrefetchThreads) {}
 
 void CoinsViews::InitCache()
 {
-    m_cacheview = MakeUnique<CCoinsViewCache>(&m_catcherview);
+    m_cacheview = MakeUnique<CCoinsViewCache>(&m_prefetchview);
 }
 
 // NOTE: for now m_blockman is set to a global, but this will be changed
@@ -1540,6 +1798,20 @@ BlockMap& BlockIndex()
     return g_blockman.m_block_index;
 }
 
+std::set<CBlockIndex*, CBlockIndexHeightComparator>& StaleBlockIndexCandidates()
+{
+    AssertLockHeld(cs_main);
+    if (!g_blockman.m_stale_candidates_seeded) {
+        // One pass over the index loaded at startup, later entries are added as they come
+        for (const BlockMap::value_type& entry : g_blockman.m_block_index) {
+            if (!::ChainActive().Contains(entry.second))
+                g_blockman.m_stale_candidates.insert(entry.second);
+        }
+        g_blockman.m_stale_candidates_seeded = true;
+    }
+    return g_blockman.m_stale_candidates;
+}
+
 static void AlertNotify(const std::string& strMessage)
 {
     uiInterface.NotifyAlertChanged();
@@ -1681,7 +1953,58 @@ void UpdateCoins(const CTransaction& tx, CCoinsViewCache& inputs, int nHeight)
     UpdateCoins(tx, inputs, txundo, nHeight);
 }
 
+CScriptCheck::CScriptCheck(std::vector<CScriptCheck>&& batch) :
+    ptxTo(nullptr), nIn(0), nFlags(0), cacheStore(false), error(SCRIPT_ERR_UNKNOWN_ERROR), txdata(nullptr), nOut(-1),
+    m_batch(std::make_shared<std::vector<CScriptCheck>>(std::move(batch))) {}
+
+bool CScriptCheck::IsBatchable() const
+{
+    if (checkOutput() || m_batch) return false;
+    std::vector<std::vector<unsigned char>> solutions;
+    const txnouttype type = Solver(m_tx_out.scriptPubKey, solutions);
+    return type == TX_PUBKEY || type == TX_PUBKEYHASH || type == TX_WITNESS_V0_KEYHASH;
+}
+
+bool CScriptCheck::VerifyBatch()
+{
+    // Run the scripts with the signatures they need added to the batch
+    // instead of verified, and remember which signatures belong to which
+    CPubKeyBatchVerifier batch;
+    std::vector<bool> deferred_ok(m_batch->size());
+    std::vector<size_t> first_sig(m_batch->size() + 1);
+    for (size_t i = 0; i < m_batch->size(); i++) {
+        CScriptCheck& check = (*m_batch)[i];
+        const CTxIn& txin = check.ptxTo->vin[check.nIn];
+        first_sig[i] = batch.size();
+        deferred_ok[i] = VerifyScript(txin.scriptSig, check.m_tx_out.scriptPubKey, &txin.scriptWitness, check.nFlags,
+            BatchingTransactionSignatureChecker(check.ptxTo, check.nIn, check.m_tx_out.nValue, check.cacheStore, *check.txdata, batch), &check.error);
+    }
+    first_sig.back() = batch.size();
+
+    std::vector<bool> valid;
+    batch.Verify(valid);
+
+    // A script that succeeded with all of its signatures valid took the same
+    // path it takes when they are verified one at a time. Every other script
+    // is run again the usual way to find out its real result.
+    for (size_t i = 0; i < m_batch->size(); i++) {
+        CScriptCheck& check = (*m_batch)[i];
+        if (deferred_ok[i] && std::all_of(valid.begin() + first_sig[i], valid.begin() + first_sig[i + 1], [](bool b) { return b; })) {
+            continue;
+        }
+        if (!check()) {
+            error = check.GetScriptError();
+            return false;
+        }
+    }
+    return true;
+}
+
 bool CScriptCheck::operator()() {
+    if (m_batch) {
+        return VerifyBatch();
+    }
+
     if(checkOutput())
     {
         // Check the sender signature inside the output, used to identify VM sender
@@ -1879,12 +2202,17 @@ static bool UndoWriteToDisk(const CBlockUndo& blockundo, FlatFilePos& pos, const
     return true;
 }
 
+static bool WaitForUndoWrites();
+
 bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex)
 {
     FlatFilePos pos = pindex->GetUndoPos();
     if (pos.IsNull()) {
         return error("%s: no undo data available", __func__);
     }
+    if (!WaitForUndoWrites()) {
+        return error("%s: queued undo data could not be written", __func__);
+    }
 
     // Open history file to read
     CAutoFile filein(OpenUndoFile(pos, true), SER_DISK, CLIENT_VERSION);
@@ -1930,6 +2258,368 @@ static bool AbortNode(CValidationState& state, const std::string& strMessage, co
     return state.Error(strMessage);
 }
 
+bool CheckBlockSignature(const CBlock& block);
+
+/**
+ * Writes block undo data in a background thread. The position of the undo
+ * data is reserved and recorded in the block index while the block is being
+ * connected, so only serializing, hashing and writing the data is deferred.
+ * Anything that reads undo files or makes them durable waits for the queue
+ * to drain first. At most MAX_UNDO_WRITE_QUEUE blocks are queued; connecting
+ * further blocks waits for the writer to catch up.
+ */
+class CUndoWriter
+{
+private:
+    struct Job {
+        CBlockUndo blockundo;
+        FlatFilePos pos;
+        uint256 hashPrev;
+    };
+
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    std::deque<Job> m_jobs;
+    bool m_busy = false;
+    bool m_failed = false;
+    bool m_stop = false;
+    std::thread m_thread;
+    CMessageHeader::MessageStartChars m_message_start;
+
+    void Thread()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true) {
+            m_cond.wait(lock, [this] { return m_stop || !m_jobs.empty(); });
+            // Queued data is written out before stopping
+            if (m_jobs.empty()) {
+                return;
+            }
+            Job job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+            m_busy = true;
+            lock.unlock();
+
+            int64_t nTimeStart = GetTimeMicros();
+            bool fWritten = UndoWriteToDisk(job.blockundo, job.pos, job.hashPrev, m_message_start);
+            m_time_write += GetTimeMicros() - nTimeStart;
+            m_writes++;
+            if (!fWritten) {
+                AbortNode("Failed to write undo data");
+            }
+
+            lock.lock();
+            m_busy = false;
+            m_failed |= !fWritten;
+            m_cond.notify_all();
+        }
+    }
+
+public:
+    //! Time spent writing undo data in the background, in microseconds
+    std::atomic<int64_t> m_time_write{0};
+    //! Time the caller spent waiting for queued writes or queue space, in microseconds
+    std::atomic<int64_t> m_time_wait{0};
+    std::atomic<uint64_t> m_writes{0};
+
+    ~CUndoWriter() { Stop(); }
+
+    void Start(const CMessageHeader::MessageStartChars& message_start)
+    {
+        memcpy(m_message_start, message_start, sizeof(m_message_start));
+        m_stop = false;
+        m_thread = std::thread([this] {
+            util::ThreadRename("undowriter");
+            Thread();
+        });
+    }
+
+    void Stop()
+    {
+        if (!m_thread.joinable()) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_cond.notify_all();
+        m_thread.join();
+    }
+
+    bool IsRunning() const { return m_thread.joinable(); }
+
+    /** Queue undo data to be written at pos, a position returned by FindUndoPos. Waits while the queue is full. */
+    void Enqueue(CBlockUndo&& blockundo, const FlatFilePos& pos, const uint256& hashPrev)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if (m_jobs.size() >= MAX_UNDO_WRITE_QUEUE) {
+                int64_t nTimeStart = GetTimeMicros();
+                m_cond.wait(lock, [this] { return m_jobs.size() < MAX_UNDO_WRITE_QUEUE; });
+                m_time_wait += GetTimeMicros() - nTimeStart;
+            }
+            m_jobs.push_back(Job{std::move(blockundo), pos, hashPrev});
+        }
+        m_cond.notify_all();
+    }
+
+    /** Wait until all queued undo data has been written. Returns false if any write failed. */
+    bool Wait()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (!m_jobs.empty() || m_busy) {
+            int64_t nTimeStart = GetTimeMicros();
+            m_cond.wait(lock, [this] { return m_jobs.empty() && !m_busy; });
+            m_time_wait += GetTimeMicros() - nTimeStart;
+        }
+        return !m_failed;
+    }
+};
+
+static CUndoWriter g_undo_writer;
+
+static bool WaitForUndoWrites()
+{
+    return g_undo_writer.Wait();
+}
+
+/**
+ * Reads the blocks that are about to be connected from disk in background
+ * threads during initial block download, and verifies their merkle root and
+ * block signature there. ConnectTip then finds the next block deserialized
+ * and only runs the checks that depend on the current consensus parameters.
+ */
+class CBlockPrefetcher
+{
+private:
+    enum class State { QUEUED, READING, DONE };
+
+    struct Entry {
+        uint256 hash;
+        FlatFilePos pos;
+        State state = State::QUEUED;
+        std::shared_ptr<CBlock> block;
+        //! Whether the merkle root and block signature are valid
+        bool fVerified = false;
+        //! Whether the inputs of the block have been queued for lookup
+        bool fInputsQueued = false;
+    };
+
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    //! Queued blocks, in the order they will be connected
+    std::list<std::shared_ptr<Entry>> m_entries;
+    int m_depth = 0;
+    bool m_stop = false;
+    std::vector<std::thread> m_threads;
+    const Consensus::Params* m_consensus = nullptr;
+
+    void Thread()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true) {
+            std::shared_ptr<Entry> entry;
+            m_cond.wait(lock, [this, &entry] {
+                if (m_stop) return true;
+                for (const std::shared_ptr<Entry>& queued : m_entries) {
+                    if (queued->state == State::QUEUED) {
+                        entry = queued;
+                        return true;
+                    }
+                }
+                return false;
+            });
+            if (m_stop) {
+                return;
+            }
+            entry->state = State::READING;
+            lock.unlock();
+
+            int64_t nTime1 = GetTimeMicros();
+            std::shared_ptr<CBlock> block = std::make_shared<CBlock>();
+            bool fRead = ReadBlockFromDisk(*block, entry->pos, *m_consensus) && block->GetHash() == entry->hash;
+            int64_t nTime2 = GetTimeMicros();
+            bool fVerified = false;
+            if (fRead) {
+                // Failures are left to ConnectBlock, which repeats the checks
+                bool mutated;
+                fVerified = BlockMerkleRoot(*block, &mutated) == block->hashMerkleRoot && !mutated && CheckBlockSignature(*block);
+            }
+            int64_t nTime3 = GetTimeMicros();
+            m_time_read += nTime2 - nTime1;
+            m_time_verify += nTime3 - nTime2;
+            m_reads++;
+
+            lock.lock();
+            if (fRead) {
+                entry->block = std::move(block);
+                entry->fVerified = fVerified;
+            }
+            entry->state = State::DONE;
+            m_cond.notify_all();
+        }
+    }
+
+public:
+    //! Time the prefetch threads spent reading blocks, in microseconds
+    std::atomic<int64_t> m_time_read{0};
+    //! Time the prefetch threads spent verifying merkle roots and signatures, in microseconds
+    std::atomic<int64_t> m_time_verify{0};
+    //! Time ConnectTip spent waiting for a block being read, in microseconds
+    std::atomic<int64_t> m_time_wait{0};
+    std::atomic<uint64_t> m_reads{0};
+    std::atomic<uint64_t> m_hits{0};
+    std::atomic<uint64_t> m_misses{0};
+
+    ~CBlockPrefetcher() { Stop(); }
+
+    void Start(int depth, int threads, const Consensus::Params& consensus)
+    {
+        m_depth = depth;
+        m_consensus = &consensus;
+        m_stop = false;
+        for (int i = 0; i < threads; i++) {
+            m_threads.emplace_back([this, i] {
+                util::ThreadRename(strprintf("blkprefetch.%i", i));
+                Thread();
+            });
+        }
+    }
+
+    void Stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_cond.notify_all();
+        for (std::thread& thread : m_threads) {
+            thread.join();
+        }
+        m_threads.clear();
+        m_entries.clear();
+    }
+
+    bool IsRunning() const { return !m_threads.empty(); }
+
+    /**
+     * Queue the blocks of the chain towards pindexMostWork that follow the
+     * block at nForkHeight, up to the prefetch depth. Queued blocks that are
+     * no longer among them are dropped. If fSkipMostWork is set, the block at
+     * pindexMostWork is already in memory and is not read.
+     */
+    void Prefetch(const CBlockIndex* pindexMostWork, int nForkHeight, bool fSkipMostWork) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+    {
+        std::vector<const CBlockIndex*> vpindexNext;
+        const CBlockIndex* pindex = pindexMostWork->GetAncestor(std::min(nForkHeight + m_depth, pindexMostWork->nHeight));
+        while (pindex && pindex->nHeight > nForkHeight) {
+            if ((pindex != pindexMostWork || !fSkipMostWork) && (pindex->nStatus & BLOCK_HAVE_DATA)) {
+                vpindexNext.push_back(pindex);
+            }
+            pindex = pindex->pprev;
+        }
+
+        std::list<std::shared_ptr<Entry>> entries;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (const CBlockIndex* pindexNext : reverse_iterate(vpindexNext)) {
+                const uint256 hash = pindexNext->GetBlockHash();
+                auto it = std::find_if(m_entries.begin(), m_entries.end(), [&hash](const std::shared_ptr<Entry>& entry) { return entry->hash == hash; });
+                if (it != m_entries.end()) {
+                    entries.splice(entries.end(), m_entries, it);
+                } else {
+                    std::shared_ptr<Entry> entry = std::make_shared<Entry>();
+                    entry->hash = hash;
+                    entry->pos = pindexNext->GetBlockPos();
+                    entries.push_back(std::move(entry));
+                }
+            }
+            // Blocks being read when dropped are discarded by their reader
+            m_entries.swap(entries);
+        }
+        m_cond.notify_all();
+    }
+
+    /** Return the blocks read since the last call, to look up their inputs. */
+    std::vector<std::shared_ptr<const CBlock>> TakeBlocksToLookUp()
+    {
+        std::vector<std::shared_ptr<const CBlock>> blocks;
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const std::shared_ptr<Entry>& entry : m_entries) {
+            if (entry->state == State::DONE && entry->block && !entry->fInputsQueued) {
+                entry->fInputsQueued = true;
+                blocks.push_back(entry->block);
+            }
+        }
+        return blocks;
+    }
+
+    /**
+     * Take the prefetched block for pindex out of the queue, waiting for it
+     * if it is being read. Returns nullptr if the block was not read, in
+     * which case the caller reads it itself.
+     */
+    std::shared_ptr<const CBlock> Take(const CBlockIndex* pindex, const Consensus::Params& consensus) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+    {
+        const uint256 hash = pindex->GetBlockHash();
+        std::shared_ptr<Entry> entry;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            auto it = std::find_if(m_entries.begin(), m_entries.end(), [&hash](const std::shared_ptr<Entry>& queued) { return queued->hash == hash; });
+            if (it == m_entries.end()) {
+                m_misses++;
+                return nullptr;
+            }
+            entry = *it;
+            m_entries.erase(it);
+            // Reading it here is faster than waiting behind the blocks queued before it
+            if (entry->state == State::QUEUED) {
+                m_misses++;
+                return nullptr;
+            }
+            if (entry->state != State::DONE) {
+                int64_t nTimeStart = GetTimeMicros();
+                m_cond.wait(lock, [&entry] { return entry->state == State::DONE; });
+                m_time_wait += GetTimeMicros() - nTimeStart;
+            }
+        }
+        if (!entry->block) {
+            m_misses++;
+            return nullptr;
+        }
+        m_hits++;
+
+        if (entry->fVerified) {
+            // The remaining context-free checks depend on consensus parameters
+            // that connecting the previous blocks may have changed, so they run
+            // here rather than in the prefetch thread.
+            CValidationState state;
+            if (CheckBlock(*entry->block, state, consensus, true, false, false)) {
+                entry->block->fChecked = true;
+            }
+        }
+        return entry->block;
+    }
+};
+
+static CBlockPrefetcher g_block_prefetcher;
+
+void StartBlockPipelineThreads(int prefetch_depth)
+{
+    const CChainParams& chainparams = Params();
+    g_undo_writer.Start(chainparams.MessageStart());
+    if (prefetch_depth > 0) {
+        g_block_prefetcher.Start(prefetch_depth, BLOCK_PREFETCH_THREADS, chainparams.GetConsensus());
+    }
+}
+
+void StopBlockPipelineThreads()
+{
+    g_block_prefetcher.Stop();
+    g_undo_writer.Stop();
+}
+
 /**
  * Restore the UTXO in a Coin at a given COutPoint
  * @param undo The Coin to be restored.
@@ -2110,6 +2800,12 @@ void static FlushBlockFile(bool fFinalize = false)
 {
     LOCK(cs_LastBlockFile);
 
+    // Undo data queued for the background writer must reach the file first
+    if (!g_undo_writer.Wait()) {
+        AbortNode("Failed to write undo data");
+        return;
+    }
+
     FlatFilePos block_pos_old(nLastBlockFile, vinfoBlockFile[nLastBlockFile].nSize);
     FlatFilePos undo_pos_old(nLastBlockFile, vinfoBlockFile[nLastBlockFile].nUndoSize);
 
@@ -2123,15 +2819,21 @@ void static FlushBlockFile(bool fFinalize = false)
 
 static bool FindUndoPos(CValidationState &state, int nFile, FlatFilePos &pos, unsigned int nAddSize);
 
-static bool WriteUndoDataForBlock(const CBlockUndo& blockundo, CValidationState& state, CBlockIndex* pindex, const CChainParams& chainparams)
+static bool WriteUndoDataForBlock(CBlockUndo&& blockundo, CValidationState& state, CBlockIndex* pindex, const CChainParams& chainparams)
 {
     // Write undo information to disk
     if (pindex->GetUndoPos().IsNull()) {
         FlatFilePos _pos;
         if (!FindUndoPos(state, pindex->nFile, _pos, ::GetSerializeSize(blockundo, CLIENT_VERSION) + 40))
             return error("ConnectBlock(): FindUndoPos failed");
-        if (!UndoWriteToDisk(blockundo, _pos, pindex->pprev->GetBlockHash(), chainparams.MessageStart()))
+        if (g_undo_writer.IsRunning()) {
+            // The undo data follows the message start and size written by UndoWriteToDisk
+            FlatFilePos write_pos = _pos;
+            _pos.nPos += CMessageHeader::MESSAGE_START_SIZE + sizeof(unsigned int);
+            g_undo_writer.Enqueue(std::move(blockundo), write_pos, pindex->pprev->GetBlockHash());
+        } else if (!UndoWriteToDisk(blockundo, _pos, pindex->pprev->GetBlockHash(), chainparams.MessageStart())) {
             return AbortNode(state, "Failed to write undo data");
+        }
 
         // update nUndoPos in block index
         pindex->nUndoPos = _pos.nPos;
@@ -2144,6 +2846,11 @@ static bool WriteUndoDataForBlock(const CBlockUndo& blockundo, CValidationState&
 
 static CCheckQueue<CScriptCheck> scriptcheckqueue(128);
 
+void SetScriptCheckQueueMode(CheckQueueMode mode) {
+    scriptcheckqueue.SetMode(mode);
+    mempoolcheckqueue.SetMode(mode);
+}
+
 void ThreadScriptCheck(int worker_num) {
     util::ThreadRename(strprintf("scriptch.%i", worker_num));
     scriptcheckqueue.Thread();
@@ -2858,7 +3565,8 @@ size_t QtumTxConverter::correctedStackSize(size_t size){
  *  Validity checks that depend on the UTXO set are also done; ConnectBlock()
  *  can fail if those validity checks fail (among other reasons). */
 bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pindex,
-                  CCoinsViewCache& view, const CChainParams& chainparams, bool fJustCheck)
+                  CCoinsViewCache& view, const CChainParams& chainparams, bool fJustCheck,
+                  std::vector<TransactionReceiptInfo>* pvReceipts)
 {
     AssertLockHeld(cs_main);
     assert(pindex);
@@ -3078,6 +3786,8 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
     CBlockUndo blockundo;
 
     CCheckQueueControl<CScriptCheck> control(fScriptChecks && nScriptCheckThreads ? &scriptcheckqueue : nullptr);
+    // Single-signature input checks waiting to be handed to the queue as one group
+    std::vector<CScriptCheck> vBatchChecks;
 
     std::vector<int> prevheights;
     CAmount nFees = 0;
@@ -3205,6 +3915,18 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
                 return error("ConnectBlock(): CheckInputs on %s failed with %s",
                     tx.GetHash().ToString(), FormatStateMessage(state));
             }
+            if (nSignatureBatchSize > 0) {
+                auto batchable = std::stable_partition(vChecks.begin(), vChecks.end(), [](const CScriptCheck& check) { return !check.IsBatchable(); });
+                for (auto it = batchable; it != vChecks.end(); ++it) {
+                    vBatchChecks.emplace_back();
+                    it->swap(vBatchChecks.back());
+                }
+                vChecks.erase(batchable, vChecks.end());
+                if (vBatchChecks.size() >= (size_t)nSignatureBatchSize) {
+                    vChecks.emplace_back(std::move(vBatchChecks));
+                    vBatchChecks.clear();
+                }
+            }
             control.Add(vChecks);
 
             for(const CTxIn& j : tx.vin){
@@ -3349,6 +4071,8 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
                 }
 
                 pstorageresult->addResult(uintToh256(tx.GetHash()), tri);
+                if (pvReceipts)
+                    pvReceipts->insert(pvReceipts->end(), tri.begin(), tri.end());
             }
 
             blockGasUsed += bcer.usedGas;
@@ -3405,6 +4129,11 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
         }
         UpdateCoins(tx, view, i == 0 ? undoDummy : blockundo.vtxundo.back(), pindex->nHeight);
     }
+    if (!vBatchChecks.empty()) {
+        std::vector<CScriptCheck> vChecks;
+        vChecks.emplace_back(std::move(vBatchChecks));
+        control.Add(vChecks);
+    }
     int64_t nTime3 = GetTimeMicros(); nTimeConnect += nTime3 - nTime2;
     LogPrint(BCLog::BENCH, "      - Connect %u transactions: %.2fms (%.3fms/tx, %.3fms/txin) [%.2fs (%.2fms/blk)]\n", (unsigned)block.vtx.size(), MILLI * (nTime3 - nTime2), MILLI * (nTime3 - nTime2) / block.vtx.size(), nInputs <= 1 ? 0 : MILLI * (nTime3 - nTime2) / (nInputs-1), nTimeConnect * MICRO, nTimeConnect * MILLI / nBlocksTotal);
 
@@ -3493,7 +4222,7 @@ bool CChainState::ConnectBlock(const CBlock& block, CValidationState& state, CBl
 
     pindex->nMoneySupply = (pindex->pprev? pindex->pprev->nMoneySupply : 0) + nValueOut - nValueIn;
 
-    if (!WriteUndoDataForBlock(blockundo, state, pindex, chainparams))
+    if (!WriteUndoDataForBlock(std::move(blockundo), state, pindex, chainparams))
         return false;
 
     if (!pindex->IsValid(BLOCK_VALID_SCRIPTS)) {
@@ -3615,7 +4344,8 @@ bool CChainState::FlushStateToDisk(
             nLastFlush = nNow;
         }
         int64_t nMempoolSizeMax = gArgs.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000;
-        int64_t cacheSize = CoinsTip().DynamicMemoryUsage() * DB_PEAK_USAGE_FACTOR;
+        // Coins staged by the prefetch threads are freed by the flush as well
+        int64_t cacheSize = CoinsTip().DynamicMemoryUsage() * DB_PEAK_USAGE_FACTOR + CoinsPrefetch().DynamicMemoryUsage();
         int64_t nTotalSpace = nCoinCacheUsage + std::max<int64_t>(nMempoolSizeMax - nMempoolUsage, 0);
         // The cache is large and we're within 10% and 10 MiB of the limit, but we have time now (not in the middle of a block processing).
         bool fCacheLarge = mode == FlushStateMode::PERIODIC && cacheSize > std::max((9 * nTotalSpace) / 10, nTotalSpace - MAX_BLOCK_COINSDB_USAGE * 1024 * 1024);
@@ -3626,14 +4356,19 @@ bool CChainState::FlushStateToDisk(
         // It's been very long since we flushed the cache. Do this infrequently, to optimize cache usage.
         bool fPeriodicFlush = mode == FlushStateMode::PERIODIC && nNow > nLastFlush + (int64_t)DATABASE_FLUSH_INTERVAL * 1000000;
         // Combine all conditions that result in a full cache flush.
-        fDoFullFlush = (mode == FlushStateMode::ALWAYS) || fCacheLarge || fCacheCritical || fPeriodicFlush || fFlushForPrune;
+        fDoFullFlush = (mode == FlushStateMode::ALWAYS) || fFlushForPrune || (!fIncrementalFlush && (fCacheLarge || fCacheCritical || fPeriodicFlush));
+        // With -incrementalflush, write the modified coins in the background and keep the rest of the cache.
+        bool fDoSync = !fDoFullFlush && fIncrementalFlush && (fCacheLarge || fCacheCritical || fPeriodicFlush);
         // Write blocks and block index to disk.
-        if (fDoFullFlush || fPeriodicWrite) {
+        if (fDoFullFlush || fDoSync || fPeriodicWrite) {
             // Depend on nMinDiskSpace to ensure we can write block index
             if (!CheckDiskSpace(GetBlocksDir())) {
                 return AbortNode(state, "Disk space is too low!", _("Error: Disk space is too low!").translated, CClientUIInterface::MSG_NOPREFIX);
             }
             // First make sure all block and undo data is flushed to disk.
+            if (!g_undo_writer.Wait()) {
+                return AbortNode(state, "Failed to write undo data");
+            }
             FlushBlockFile();
             // Then update all block file information (which may refer to block and undo files).
             {
@@ -3659,7 +4394,7 @@ bool CChainState::FlushStateToDisk(
             nLastWrite = nNow;
         }
         // Flush best chain related state. This can only be done if the blocks / block index write was also done.
-        if (fDoFullFlush && !CoinsTip().GetBestBlock().IsNull()) {
+        if ((fDoFullFlush || fDoSync) && !CoinsTip().GetBestBlock().IsNull()) {
             // Typical Coin structures on disk are around 48 bytes in size.
             // Pushing a new one to the database can cause it to be written
             // twice (once in the log, and once in the tables). This is already
@@ -3669,8 +4404,15 @@ bool CChainState::FlushStateToDisk(
                 return AbortNode(state, "Disk space is too low!", _("Error: Disk space is too low!").translated, CClientUIInterface::MSG_NOPREFIX);
             }
             // Flush the chainstate (which may refer to block index entries).
-            if (!CoinsTip().Flush())
-                return AbortNode(state, "Failed to write to coin database");
+            if (fDoSync) {
+                if (!CoinsTip().Sync())
+                    return AbortNode(state, "Failed to write to coin database");
+                // Make room for new coins, keeping three quarters of the space warm.
+                CoinsTip().Trim((3 * nTotalSpace / 4) / DB_PEAK_USAGE_FACTOR);
+            } else {
+                if (!CoinsTip().Flush() || !CoinsDB().WaitForWrites())
+                    return AbortNode(state, "Failed to write to coin database");
+            }
             nLastFlush = nNow;
             full_flush_completed = true;
         }
@@ -3818,6 +4560,8 @@ bool CChainState::DisconnectTip(CValidationState& state, const CChainParams& cha
     }
 
     m_chain.SetTip(pindexDelete->pprev);
+    if (m_blockman.m_stale_candidates_seeded)
+        m_blockman.m_stale_candidates.insert(pindexDelete);
 
     UpdateTip(pindexDelete->pprev, chainparams);
     // Let wallets know transactions went from 1-confirmed to
@@ -3836,6 +4580,7 @@ struct PerBlockConnectTrace {
     CBlockIndex* pindex = nullptr;
     std::shared_ptr<const CBlock> pblock;
     std::shared_ptr<std::vector<CTransactionRef>> conflictedTxs;
+    std::shared_ptr<const std::vector<TransactionReceiptInfo>> receipts;
     PerBlockConnectTrace() : conflictedTxs(std::make_shared<std::vector<CTransactionRef>>()) {}
 };
 /**
@@ -3865,12 +4610,13 @@ public:
         m_connNotifyEntryRemoved = pool.NotifyEntryRemoved.connect(std::bind(&ConnectTrace::NotifyEntryRemoved, this, std::placeholders::_1, std::placeholders::_2));
     }
 
-    void BlockConnected(CBlockIndex* pindex, std::shared_ptr<const CBlock> pblock) {
+    void BlockConnected(CBlockIndex* pindex, std::shared_ptr<const CBlock> pblock, std::shared_ptr<const std::vector<TransactionReceiptInfo>> receipts) {
         assert(!blocksConnected.back().pindex);
         assert(pindex);
         assert(pblock);
         blocksConnected.back().pindex = pindex;
         blocksConnected.back().pblock = std::move(pblock);
+        blocksConnected.back().receipts = std::move(receipts);
         blocksConnected.emplace_back();
     }
 
@@ -3907,10 +4653,15 @@ bool CChainState::ConnectTip(CValidationState& state, const CChainParams& chainp
     int64_t nTime1 = GetTimeMicros();
     std::shared_ptr<const CBlock> pthisBlock;
     if (!pblock) {
-        std::shared_ptr<CBlock> pblockNew = std::make_shared<CBlock>();
-        if (!ReadBlockFromDisk(*pblockNew, pindexNew, chainparams.GetConsensus()))
-            return AbortNode(state, "Failed to read block");
-        pthisBlock = pblockNew;
+        if (g_block_prefetcher.IsRunning()) {
+            pthisBlock = g_block_prefetcher.Take(pindexNew, chainparams.GetConsensus());
+        }
+        if (!pthisBlock) {
+            std::shared_ptr<CBlock> pblockNew = std::make_shared<CBlock>();
+            if (!ReadBlockFromDisk(*pblockNew, pindexNew, chainparams.GetConsensus()))
+                return AbortNode(state, "Failed to read block");
+            pthisBlock = pblockNew;
+        }
     } else {
         pthisBlock = pblock;
     }
@@ -3919,13 +4670,21 @@ bool CChainState::ConnectTip(CValidationState& state, const CChainParams& chainp
     int64_t nTime2 = GetTimeMicros(); nTimeReadFromDisk += nTime2 - nTime1;
     int64_t nTime3;
     LogPrint(BCLog::BENCH, "  - Load block from disk: %.2fms [%.2fs]\n", (nTime2 - nTime1) * MILLI, nTimeReadFromDisk * MICRO);
+    if (g_block_prefetcher.IsRunning() && LogAcceptCategory(BCLog::BENCH)) {
+        uint64_t nReads = g_block_prefetcher.m_reads;
+        LogPrint(BCLog::BENCH, "    - Prefetch: %u hits, %u misses [read %.2fms/blk, verify %.2fms/blk, %.1f blk/s per thread, waited %.2fs]\n",
+            g_block_prefetcher.m_hits.load(), g_block_prefetcher.m_misses.load(),
+            g_block_prefetcher.m_time_read * MILLI / std::max<uint64_t>(nReads, 1), g_block_prefetcher.m_time_verify * MILLI / std::max<uint64_t>(nReads, 1),
+            nReads / std::max((g_block_prefetcher.m_time_read + g_block_prefetcher.m_time_verify) * MICRO, 0.000001), g_block_prefetcher.m_time_wait * MICRO);
+    }
+    std::shared_ptr<std::vector<TransactionReceiptInfo>> preceipts = std::make_shared<std::vector<TransactionReceiptInfo>>();
     {
         CCoinsViewCache view(&CoinsTip());
 
         dev::h256 oldHashStateRoot(globalState->rootHash()); // qtum
         dev::h256 oldHashUTXORoot(globalState->rootHashUTXO()); // qtum
 
-        bool rv = ConnectBlock(blockConnecting, state, pindexNew, view, chainparams);
+        bool rv = ConnectBlock(blockConnecting, state, pindexNew, view, chainparams, false, preceipts.get());
         GetMainSignals().BlockChecked(blockConnecting, state);
         if (!rv) {
             if (state.IsInvalid())
@@ -3958,8 +4717,19 @@ bool CChainState::ConnectTip(CValidationState& state, const CChainParams& chainp
     int64_t nTime6 = GetTimeMicros(); nTimePostConnect += nTime6 - nTime5; nTimeTotal += nTime6 - nTime1;
     LogPrint(BCLog::BENCH, "  - Connect postprocess: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime6 - nTime5) * MILLI, nTimePostConnect * MICRO, nTimePostConnect * MILLI / nBlocksTotal);
     LogPrint(BCLog::BENCH, "- Connect block: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime6 - nTime1) * MILLI, nTimeTotal * MICRO, nTimeTotal * MILLI / nBlocksTotal);
+    if (nCoinPrefetchThreads > 0 && LogAcceptCategory(BCLog::BENCH)) {
+        const CCoinsViewPrefetch& prefetch = CoinsPrefetch();
+        LogPrint(BCLog::BENCH, "- Coin prefetch: %u hits, %u misses [%u coins staged]\n",
+            prefetch.m_hits.load(), prefetch.m_misses.load(), prefetch.m_staged_total.load());
+    }
+    if (g_undo_writer.IsRunning() && LogAcceptCategory(BCLog::BENCH)) {
+        uint64_t nWrites = g_undo_writer.m_writes;
+        LogPrint(BCLog::BENCH, "- Undo write: %u blocks in background [%.2fms/blk, %.1f blk/s, waited %.2fs]\n",
+            nWrites, g_undo_writer.m_time_write * MILLI / std::max<uint64_t>(nWrites, 1),
+            nWrites / std::max(g_undo_writer.m_time_write * MICRO, 0.000001), g_undo_writer.m_time_wait * MICRO);
+    }
 
-    connectTrace.BlockConnected(pindexNew, std::move(pthisBlock));
+    connectTrace.BlockConnected(pindexNew, std::move(pthisBlock), std::move(preceipts));
     return true;
 }
 
@@ -4069,6 +4839,12 @@ bool CChainState::ActivateBestChainStep(CValidationState& state, const CChainPar
     std::vector<CBlockIndex*> vpindexToConnect;
     bool fContinue = true;
     int nHeight = pindexFork ? pindexFork->nHeight : -1;
+    if (g_block_prefetcher.IsRunning()) {
+        g_block_prefetcher.Prefetch(pindexMostWork, nHeight, pblock != nullptr);
+        for (const std::shared_ptr<const CBlock>& block : g_block_prefetcher.TakeBlocksToLookUp()) {
+            CoinsPrefetch().Prefetch(*block);
+        }
+    }
     while (fContinue && nHeight != pindexMostWork->nHeight) {
         // Don't iterate the entire list of potential improvements toward the best tip, as we likely only need
         // a few blocks along the way.
@@ -4220,6 +4996,9 @@ bool CChainState::ActivateBestChain(CValidationState &state, const CChainParams&
                 for (const PerBlockConnectTrace& trace : connectTrace.GetBlocksConnected()) {
                     assert(trace.pblock && trace.pindex);
                     GetMainSignals().BlockConnected(trace.pblock, trace.pindex, trace.conflictedTxs);
+                    if (!trace.receipts->empty()) {
+                        GetMainSignals().ContractReceiptsConnected(trace.pindex, trace.receipts);
+                    }
                 }
             } while (!m_chain.Tip() || (starting_tip && CBlockIndexWorkComparator()(m_chain.Tip(), starting_tip)));
             if (!blocks_connected) return true;
@@ -4507,6 +5286,8 @@ CBlockIndex* BlockManager::AddToBlockIndex(const CBlockHeader& block)
         pindexBestHeader = pindexNew;
 
     setDirtyBlockIndex.insert(pindexNew);
+    if (m_stale_candidates_seeded)
+        m_stale_candidates.insert(pindexNew);
 
     return pindexNew;
 }
@@ -5524,6 +6305,10 @@ bool ProcessNewBlock(const CChainParams& chainparams, const std::shared_ptr<cons
         // Ensure that CheckBlock() passes before calling AcceptBlock, as
         // belt-and-suspenders.
         bool ret = CheckBlock(*pblock, state, chainparams.GetConsensus());
+        if (ret && ::ChainActive().Tip() && pblock->hashPrevBlock == ::ChainActive().Tip()->GetBlockHash()) {
+            // Look up the inputs while the block is stored and connected
+            ::ChainstateActive().CoinsPrefetch().Prefetch(*pblock);
+        }
         if (ret) {
             // Store to disk
             ret = ::ChainstateActive().AcceptBlock(pblock, state, chainparams, &pindex, fForceProcessing, nullptr, fNewBlock);
@@ -5636,6 +6421,7 @@ void UnlinkPrunedFiles(const std::set<int>& setFilesToPrune)
 {
     for (std::set<int>::iterator it = setFilesToPrune.begin(); it != setFilesToPrune.end(); ++it) {
         FlatFilePos pos(*it, 0);
+        ForgetBlockFileMapping(*it);
         fs::remove(BlockFileSeq().FileName(pos));
         fs::remove(UndoFileSeq().FileName(pos));
         LogPrintf("Prune: %s deleted blk/rev (%05u)\n", __func__, *it);
@@ -5848,6 +6634,8 @@ bool BlockManager::LoadBlockIndex(
 void BlockManager::Unload() {
     m_failed_blocks.clear();
     m_blocks_unlinked.clear();
+    m_stale_candidates.clear();
+    m_stale_candidates_seeded = false;
 
     for (const BlockMap::value_type& entry : m_block_index) {
         delete entry.second;
@@ -6753,6 +7541,8 @@ bool CChainState::RemoveBlockIndex(CBlockIndex *pindex)
 
     m_blockman.m_failed_blocks.erase(pindex);
 
+    m_blockman.m_stale_candidates.erase(pindex);
+
     setDirtyBlockIndex.erase(pindex);
 
     for (int b = 0; b < VERSIONBITS_NUM_BITS; b++) {
@@ -6797,11 +7587,356 @@ int VersionBitsTipStateSinceHeight(const Consensus::Params& params, Consensus::D
 }
 
 static const uint64_t MEMPOOL_DUMP_VERSION = 1;
+//! Snapshot of the mempool entries, tied to the tip it was dumped at
+static const uint64_t MEMPOOL_SNAPSHOT_VERSION = 2;
+//! Maximum number of threads decoding a mempool snapshot
+static const int MAX_MEMPOOL_LOAD_THREADS = 8;
 
-bool LoadMempool(CTxMemPool& pool)
+/**
+ * A mempool entry as stored in a mempool snapshot: the state AcceptToMemoryPool
+ * computed for it, and its ancestor and descendant totals as a check.
+ */
+struct MempoolSnapshotEntry
+{
+    CTransactionRef tx;
+    uint256 txid;
+    int64_t nTime;
+    int64_t nFeeDelta;
+    CAmount nFee;
+    unsigned int nHeight;
+    bool fSpendsCoinbase;
+    int64_t nSigOpCost;
+    int lock_height;
+    int64_t lock_time;
+    uint256 lock_max_input_block;
+    CAmount nMinGasPrice;
+    //! Positions of the in-mempool parents, which come earlier in the snapshot
+    std::vector<uint32_t> parents;
+    uint64_t nCountWithAncestors;
+    uint64_t nSizeWithAncestors;
+    CAmount nModFeesWithAncestors;
+    int64_t nSigOpCostWithAncestors;
+    uint64_t nCountWithDescendants;
+    uint64_t nSizeWithDescendants;
+    CAmount nModFeesWithDescendants;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(tx);
+        READWRITE(txid);
+        READWRITE(nTime);
+        READWRITE(nFeeDelta);
+        READWRITE(nFee);
+        READWRITE(nHeight);
+        READWRITE(fSpendsCoinbase);
+        READWRITE(nSigOpCost);
+        READWRITE(lock_height);
+        READWRITE(lock_time);
+        READWRITE(lock_max_input_block);
+        READWRITE(nMinGasPrice);
+        READWRITE(parents);
+        READWRITE(nCountWithAncestors);
+        READWRITE(nSizeWithAncestors);
+        READWRITE(nModFeesWithAncestors);
+        READWRITE(nSigOpCostWithAncestors);
+        READWRITE(nCountWithDescendants);
+        READWRITE(nSizeWithDescendants);
+        READWRITE(nModFeesWithDescendants);
+    }
+};
+
+struct MempoolLoadStats
+{
+    int64_t count = 0;
+    int64_t expired = 0;
+    int64_t failed = 0;
+    int64_t already_there = 0;
+};
+
+//! Run a saved transaction through AcceptToMemoryPool again
+static void ReacceptMempoolTransaction(CTxMemPool& pool, const CTransactionRef& tx, int64_t nTime, MempoolLoadStats& stats)
 {
     const CChainParams& chainparams = Params();
     int64_t nExpiryTimeout = gArgs.GetArg("-mempoolexpiry", DEFAULT_MEMPOOL_EXPIRY) * 60 * 60;
+    CValidationState state;
+    if (nTime + nExpiryTimeout > GetTime()) {
+        LOCK(cs_main);
+        AcceptToMemoryPoolWithTime(chainparams, pool, state, tx, nullptr /* pfMissingInputs */, nTime,
+                                   nullptr /* plTxnReplaced */, false /* bypass_limits */, 0 /* nAbsurdFee */,
+                                   false /* test_accept */);
+        if (state.IsValid()) {
+            ++stats.count;
+        } else {
+            // mempool may contain the transaction already, e.g. from
+            // wallet(s) having loaded it while we were processing
+            // mempool transactions; consider these as valid, instead of
+            // failed, but mark them as 'already there'
+            if (pool.exists(tx->GetHash())) {
+                ++stats.already_there;
+            } else {
+                ++stats.failed;
+            }
+        }
+    } else {
+        ++stats.expired;
+    }
+}
+
+/**
+ * Add the entries of a snapshot taken at the current tip without validating
+ * them again. Entries whose parents were not added, that conflict with
+ * transactions already in the mempool, or whose ancestor totals do not match
+ * are returned in reaccept.
+ */
+static void AddMempoolSnapshotEntries(CTxMemPool& pool, const std::vector<MempoolSnapshotEntry>& entries, MempoolLoadStats& stats, std::vector<CTransactionRef>& added_txs, std::vector<size_t>& reaccept) EXCLUSIVE_LOCKS_REQUIRED(cs_main, pool.cs)
+{
+    const int64_t nExpiryTimeout = gArgs.GetArg("-mempoolexpiry", DEFAULT_MEMPOOL_EXPIRY) * 60 * 60;
+    const int64_t nNow = GetTime();
+    const uint64_t nNoLimit = std::numeric_limits<uint64_t>::max();
+    std::string dummy;
+
+    // Into an empty mempool, the ancestors of an entry are its parents and
+    // theirs, all from the snapshot
+    const bool was_empty = pool.size() == 0;
+    std::vector<CTxMemPool::txiter> iters(entries.size());
+    std::vector<char> added(entries.size(), false);
+    std::vector<CTxMemPool::setEntries> ancestors(was_empty ? entries.size() : 0);
+
+#ifdef ENABLE_BITCORE_RPC
+    CCoinsViewMemPool viewMemPool(&::ChainstateActive().CoinsTip(), pool);
+    CCoinsViewCache view(&viewMemPool);
+#endif
+
+    for (size_t i = 0; i < entries.size(); i++) {
+        const MempoolSnapshotEntry& e = entries[i];
+        if (e.nTime + nExpiryTimeout <= nNow) {
+            ++stats.expired;
+            continue;
+        }
+        if (pool.exists(e.txid)) {
+            ++stats.already_there;
+            continue;
+        }
+
+        bool fast = true;
+        std::set<uint256> parent_txids;
+        for (uint32_t parent : e.parents) {
+            if (parent >= i || !added[parent]) {
+                fast = false;
+                break;
+            }
+            parent_txids.insert(entries[parent].txid);
+        }
+        for (const CTxIn& txin : e.tx->vin) {
+            if (!fast) break;
+            fast = !pool.isSpent(txin.prevout) && (parent_txids.count(txin.prevout.hash) || !pool.exists(txin.prevout.hash));
+        }
+        LockPoints lp;
+        lp.height = e.lock_height;
+        lp.time = e.lock_time;
+        if (fast && !e.lock_max_input_block.IsNull()) {
+            lp.maxInputBlock = LookupBlockIndex(e.lock_max_input_block);
+            fast = lp.maxInputBlock != nullptr;
+        }
+        if (!fast) {
+            reaccept.push_back(i);
+            continue;
+        }
+
+        CTxMemPoolEntry entry(e.tx, e.nFee, e.nTime, e.nHeight, e.fSpendsCoinbase, e.nSigOpCost, lp, e.nMinGasPrice);
+        CTxMemPool::setEntries setAncestors;
+        if (was_empty) {
+            CAmount delta = 0;
+            pool.ApplyDelta(e.txid, delta);
+            uint64_t size = entry.GetTxSize();
+            CAmount fees = entry.GetFee() + delta;
+            int64_t sigops = entry.GetSigOpCost();
+            for (uint32_t parent : e.parents) {
+                setAncestors.insert(iters[parent]);
+                setAncestors.insert(ancestors[parent].begin(), ancestors[parent].end());
+            }
+            for (CTxMemPool::txiter ancestor : setAncestors) {
+                size += ancestor->GetTxSize();
+                fees += ancestor->GetModifiedFee();
+                sigops += ancestor->GetSigOpCost();
+            }
+            if (1 + setAncestors.size() != e.nCountWithAncestors || size != e.nSizeWithAncestors ||
+                fees != e.nModFeesWithAncestors || sigops != e.nSigOpCostWithAncestors) {
+                reaccept.push_back(i);
+                continue;
+            }
+        } else {
+            pool.CalculateMemPoolAncestors(entry, setAncestors, nNoLimit, nNoLimit, nNoLimit, nNoLimit, dummy);
+        }
+
+#ifdef ENABLE_BITCORE_RPC
+        if (fAddressIndex) {
+            pool.addAddressIndex(entry, view);
+            pool.addSpentIndex(entry, view);
+        }
+#endif
+        pool.addUnchecked(entry, setAncestors, false);
+        iters[i] = pool.mapTx.find(e.txid);
+        added[i] = true;
+        added_txs.push_back(e.tx);
+        if (was_empty) {
+            ancestors[i] = std::move(setAncestors);
+        }
+        ++stats.count;
+    }
+
+    // With every entry added, the descendant totals come out the same as well
+    if (was_empty && reaccept.empty() && !stats.expired) {
+        for (size_t i = 0; i < entries.size(); i++) {
+            const MempoolSnapshotEntry& e = entries[i];
+            if (iters[i]->GetCountWithDescendants() != e.nCountWithDescendants || iters[i]->GetSizeWithDescendants() != e.nSizeWithDescendants ||
+                iters[i]->GetModFeesWithDescendants() != e.nModFeesWithDescendants) {
+                LogPrintf("Warning: mempool snapshot entry %s has different descendants after loading\n", e.txid.ToString());
+            }
+        }
+    }
+}
+
+static bool LoadMempoolSnapshot(CTxMemPool& pool, const fs::path& path)
+{
+    const int64_t start = GetTimeMicros();
+
+    std::shared_ptr<const FlatFileMapping> mapping = MapFile(path);
+    std::vector<unsigned char> buffer;
+    if (!mapping) {
+        CAutoFile file(fsbridge::fopen(path, "rb"), SER_DISK, CLIENT_VERSION);
+        if (file.IsNull() || fseek(file.Get(), 0, SEEK_END) != 0) {
+            return false;
+        }
+        buffer.resize(ftell(file.Get()));
+        rewind(file.Get());
+        file.read((char*)buffer.data(), buffer.size());
+    }
+    const unsigned char* data = mapping ? mapping->data() : buffer.data();
+    const size_t size = mapping ? mapping->size() : buffer.size();
+
+    // Layout: version, tip, count, count + 1 record offsets, records, fee
+    // deltas, and the SHA256 of all of it
+    const size_t HEADER_SIZE = 8 + 32 + 8;
+    uint256 checksum;
+    if (size < HEADER_SIZE + 8 + 32) {
+        LogPrintf("Mempool snapshot is truncated. Continuing anyway.\n");
+        return false;
+    }
+    CSHA256().Write(data, size - 32).Finalize(checksum.begin());
+    if (memcmp(checksum.begin(), data + size - 32, 32) != 0) {
+        LogPrintf("Mempool snapshot checksum mismatch. Continuing anyway.\n");
+        return false;
+    }
+    uint256 tip;
+    memcpy(tip.begin(), data + 8, 32);
+    const uint64_t count = ReadLE64(data + 40);
+    if (count >= (size - HEADER_SIZE - 32) / 8) {
+        LogPrintf("Mempool snapshot is truncated. Continuing anyway.\n");
+        return false;
+    }
+    const unsigned char* offsets = data + HEADER_SIZE;
+    const unsigned char* body = offsets + 8 * (count + 1);
+    const uint64_t body_size = ReadLE64(offsets + 8 * count);
+    if (body_size > size - 32 - (body - data)) {
+        LogPrintf("Mempool snapshot is truncated. Continuing anyway.\n");
+        return false;
+    }
+
+    // Decoding the transactions, which hashes them, is spread over several threads
+    std::vector<MempoolSnapshotEntry> entries(count);
+    std::atomic<bool> corrupt{false};
+    const int num_threads = std::max(1, std::min(GetNumCores(), MAX_MEMPOOL_LOAD_THREADS));
+    std::vector<std::thread> threads;
+    for (int t = 0; t < num_threads; t++) {
+        threads.emplace_back([&, t] {
+            for (uint64_t i = count * t / num_threads; i < count * (t + 1) / num_threads && !corrupt; i++) {
+                const uint64_t begin = ReadLE64(offsets + 8 * i);
+                const uint64_t end = ReadLE64(offsets + 8 * (i + 1));
+                if (begin > end || end > body_size) {
+                    corrupt = true;
+                    break;
+                }
+                try {
+                    CDataStream stream((const char*)body + begin, (const char*)body + end, SER_DISK, CLIENT_VERSION);
+                    stream >> entries[i];
+                    if (!stream.empty() || entries[i].tx->GetHash() != entries[i].txid) {
+                        corrupt = true;
+                    }
+                } catch (const std::exception&) {
+                    corrupt = true;
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    std::map<uint256, CAmount> mapDeltas;
+    try {
+        CDataStream stream((const char*)body + body_size, (const char*)data + size - 32, SER_DISK, CLIENT_VERSION);
+        stream >> mapDeltas;
+    } catch (const std::exception&) {
+        corrupt = true;
+    }
+    if (corrupt) {
+        LogPrintf("Failed to decode mempool snapshot. Continuing anyway.\n");
+        return false;
+    }
+    mapping.reset();
+    buffer.clear();
+
+    const int64_t decoded = GetTimeMicros();
+
+    for (const MempoolSnapshotEntry& e : entries) {
+        if (e.nFeeDelta) {
+            pool.PrioritiseTransaction(e.txid, e.nFeeDelta);
+        }
+    }
+
+    MempoolLoadStats stats;
+    std::vector<CTransactionRef> added_txs;
+    std::vector<size_t> reaccept;
+    {
+        LOCK2(cs_main, pool.cs);
+        if (::ChainActive().Tip() && ::ChainActive().Tip()->GetBlockHash() == tip) {
+            AddMempoolSnapshotEntries(pool, entries, stats, added_txs, reaccept);
+            LimitMempoolSize(pool, gArgs.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000, gArgs.GetArg("-mempoolexpiry", DEFAULT_MEMPOOL_EXPIRY) * 60 * 60);
+        } else {
+            LogPrintf("Mempool snapshot was taken at block %s, revalidating its %u transactions\n", tip.ToString(), entries.size());
+            for (size_t i = 0; i < entries.size(); i++) {
+                reaccept.push_back(i);
+            }
+        }
+    }
+    for (const CTransactionRef& tx : added_txs) {
+        if (pool.exists(tx->GetHash())) {
+            GetMainSignals().TransactionAddedToMempool(tx);
+        }
+    }
+
+    const int64_t added = GetTimeMicros();
+    const int64_t fast_count = stats.count;
+
+    for (size_t i : reaccept) {
+        ReacceptMempoolTransaction(pool, entries[i].tx, entries[i].nTime, stats);
+        if (ShutdownRequested())
+            return false;
+    }
+
+    for (const auto& i : mapDeltas) {
+        pool.PrioritiseTransaction(i.first, i.second);
+    }
+
+    LogPrintf("Imported mempool snapshot from disk: %i loaded, %i revalidated, %i failed, %i expired, %i already there (%.2fs to decode, %.2fs to add)\n",
+              fast_count, stats.count - fast_count, stats.failed, stats.expired, stats.already_there, (decoded - start) * MICRO, (added - decoded) * MICRO);
+    return true;
+}
+
+bool LoadMempool(CTxMemPool& pool)
+{
     FILE* filestr = fsbridge::fopen(GetDataDir() / "mempool.dat", "rb");
     CAutoFile file(filestr, SER_DISK, CLIENT_VERSION);
     if (file.IsNull()) {
@@ -6809,15 +7944,15 @@ bool LoadMempool(CTxMemPool& pool)
         return false;
     }
 
-    int64_t count = 0;
-    int64_t expired = 0;
-    int64_t failed = 0;
-    int64_t already_there = 0;
-    int64_t nNow = GetTime();
+    MempoolLoadStats stats;
 
     try {
         uint64_t version;
         file >> version;
+        if (version == MEMPOOL_SNAPSHOT_VERSION) {
+            file.fclose();
+            return LoadMempoolSnapshot(pool, GetDataDir() / "mempool.dat");
+        }
         if (version != MEMPOOL_DUMP_VERSION) {
             return false;
         }
@@ -6835,28 +7970,7 @@ bool LoadMempool(CTxMemPool& pool)
             if (amountdelta) {
                 pool.PrioritiseTransaction(tx->GetHash(), amountdelta);
             }
-            CValidationState state;
-            if (nTime + nExpiryTimeout > nNow) {
-                LOCK(cs_main);
-                AcceptToMemoryPoolWithTime(chainparams, pool, state, tx, nullptr /* pfMissingInputs */, nTime,
-                                           nullptr /* plTxnReplaced */, false /* bypass_limits */, 0 /* nAbsurdFee */,
-                                           false /* test_accept */);
-                if (state.IsValid()) {
-                    ++count;
-                } else {
-                    // mempool may contain the transaction already, e.g. from
-                    // wallet(s) having loaded it while we were processing
-                    // mempool transactions; consider these as valid, instead of
-                    // failed, but mark them as 'already there'
-                    if (pool.exists(tx->GetHash())) {
-                        ++already_there;
-                    } else {
-                        ++failed;
-                    }
-                }
-            } else {
-                ++expired;
-            }
+            ReacceptMempoolTransaction(pool, tx, nTime, stats);
             if (ShutdownRequested())
                 return false;
         }
@@ -6871,7 +7985,7 @@ bool LoadMempool(CTxMemPool& pool)
         return false;
     }
 
-    LogPrintf("Imported mempool transactions from disk: %i succeeded, %i failed, %i expired, %i already there\n", count, failed, expired, already_there);
+    LogPrintf("Imported mempool transactions from disk: %i succeeded, %i failed, %i expired, %i already there\n", stats.count, stats.failed, stats.expired, stats.already_there);
     return true;
 }
 
@@ -6880,41 +7994,84 @@ bool DumpMempool(const CTxMemPool& pool)
     int64_t start = GetTimeMicros();
 
     std::map<uint256, CAmount> mapDeltas;
-    std::vector<TxMempoolInfo> vinfo;
+    std::vector<MempoolSnapshotEntry> entries;
+    uint256 tip;
 
     static Mutex dump_mutex;
     LOCK(dump_mutex);
 
     {
-        LOCK(pool.cs);
+        LOCK2(cs_main, pool.cs);
+        if (::ChainActive().Tip()) {
+            tip = ::ChainActive().Tip()->GetBlockHash();
+        }
         for (const auto &i : pool.mapDeltas) {
             mapDeltas[i.first] = i.second;
         }
-        vinfo = pool.infoAll();
+        std::unordered_map<uint256, uint32_t, SaltedTxidHasher> positions;
+        entries.reserve(pool.size());
+        for (CTxMemPool::txiter it : pool.GetSortedDepthAndScore()) {
+            MempoolSnapshotEntry e;
+            e.tx = it->GetSharedTx();
+            e.txid = it->GetTx().GetHash();
+            e.nTime = it->GetTime();
+            e.nFeeDelta = it->GetModifiedFee() - it->GetFee();
+            e.nFee = it->GetFee();
+            e.nHeight = it->GetHeight();
+            e.fSpendsCoinbase = it->GetSpendsCoinbase();
+            e.nSigOpCost = it->GetSigOpCost();
+            e.lock_height = it->GetLockPoints().height;
+            e.lock_time = it->GetLockPoints().time;
+            if (it->GetLockPoints().maxInputBlock) {
+                e.lock_max_input_block = it->GetLockPoints().maxInputBlock->GetBlockHash();
+            }
+            e.nMinGasPrice = it->GetMinGasPrice();
+            for (CTxMemPool::txiter parent : pool.GetMemPoolParents(it)) {
+                e.parents.push_back(positions.at(parent->GetTx().GetHash()));
+            }
+            e.nCountWithAncestors = it->GetCountWithAncestors();
+            e.nSizeWithAncestors = it->GetSizeWithAncestors();
+            e.nModFeesWithAncestors = it->GetModFeesWithAncestors();
+            e.nSigOpCostWithAncestors = it->GetSigOpCostWithAncestors();
+            e.nCountWithDescendants = it->GetCountWithDescendants();
+            e.nSizeWithDescendants = it->GetSizeWithDescendants();
+            e.nModFeesWithDescendants = it->GetModFeesWithDescendants();
+            positions.emplace(e.txid, entries.size());
+            entries.push_back(std::move(e));
+        }
     }
 
     int64_t mid = GetTimeMicros();
 
     try {
+        // Records are serialized apart so that loading can decode them in parallel
+        CDataStream body(SER_DISK, CLIENT_VERSION);
+        std::vector<unsigned char> header(8 + 32 + 8 + 8 * (entries.size() + 1));
+        WriteLE64(header.data(), MEMPOOL_SNAPSHOT_VERSION);
+        memcpy(header.data() + 8, tip.begin(), 32);
+        WriteLE64(header.data() + 40, entries.size());
+        for (size_t i = 0; i < entries.size(); i++) {
+            WriteLE64(header.data() + 48 + 8 * i, body.size());
+            body << entries[i];
+            mapDeltas.erase(entries[i].txid);
+        }
+        WriteLE64(header.data() + 48 + 8 * entries.size(), body.size());
+        CDataStream deltas(SER_DISK, CLIENT_VERSION);
+        deltas << mapDeltas;
+
+        uint256 checksum;
+        CSHA256().Write(header.data(), header.size()).Write((const unsigned char*)body.data(), body.size()).Write((const unsigned char*)deltas.data(), deltas.size()).Finalize(checksum.begin());
+
         FILE* filestr = fsbridge::fopen(GetDataDir() / "mempool.dat.new", "wb");
         if (!filestr) {
             return false;
         }
 
         CAutoFile file(filestr, SER_DISK, CLIENT_VERSION);
-
-        uint64_t version = MEMPOOL_DUMP_VERSION;
-        file << version;
-
-        file << (uint64_t)vinfo.size();
-        for (const auto& i : vinfo) {
-            file << *(i.tx);
-            file << (int64_t)i.nTime;
-            file << (int64_t)i.nFeeDelta;
-            mapDeltas.erase(i.tx->GetHash());
-        }
-
-        file << mapDeltas;
+        file.write((const char*)header.data(), header.size());
+        file.write(body.data(), body.size());
+        file.write(deltas.data(), deltas.size());
+        file.write((const char*)checksum.begin(), checksum.size());
         if (!FileCommit(file.Get()))
             throw std::runtime_error("FileCommit failed");
         file.fclose();
@@ -7040,3 +8197,58 @@ bool GetTimestampIndex(const unsigned int &high, const unsigned int &low, const
 }
 //////////////////////////////////////////////////////////////////////////////////
 #endif
+
+#ifdef ENABLE_BITCORE_RPC
+////////////////////////////////////////////////////////////////////////////////// // qtum
+bool GetBlockAddressDeltas(const CBlock& block, const CBlockIndex* pindex, std::vector<std::pair<CAddressIndexKey, CAmount> >& deltas)
+{
+    AssertLockHeld(cs_main);
+
+    CBlockUndo blockUndo;
+    if (pindex->pprev && !UndoReadFromDisk(blockUndo, pindex))
+        return false;
+    if (pindex->pprev && blockUndo.vtxundo.size() + 1 != block.vtx.size())
+        return error("%s: block and undo data inconsistent", __func__);
+
+    // Same entries and order as the address index written by ConnectBlock
+    for (unsigned int i = 0; i < block.vtx.size(); i++) {
+        const CTransaction& tx = *(block.vtx[i]);
+        const uint256 txhash = tx.GetHash();
+
+        if (i > 0 && pindex->pprev) {
+            const CTxUndo& txundo = blockUndo.vtxundo[i-1];
+            if (txundo.vprevout.size() != tx.vin.size())
+                return error("%s: transaction and undo data inconsistent", __func__);
+            for (unsigned int j = 0; j < tx.vin.size(); j++) {
+                const CTxOut& prevout = txundo.vprevout[j].out;
+                CTxDestination dest;
+                if (ExtractDestination(tx.vin[j].prevout, prevout.scriptPubKey, dest)) {
+                    valtype bytesID(boost::apply_visitor(DataVisitor(), dest));
+                    if(bytesID.empty()) {
+                        continue;
+                    }
+                    valtype addressBytes(32);
+                    std::copy(bytesID.begin(), bytesID.end(), addressBytes.begin());
+                    deltas.push_back(std::make_pair(CAddressIndexKey(dest.which(), uint256(addressBytes), pindex->nHeight, i, txhash, j, true), prevout.nValue * -1));
+                }
+            }
+        }
+
+        for (unsigned int k = 0; k < tx.vout.size(); k++) {
+            const CTxOut& out = tx.vout[k];
+            CTxDestination dest;
+            if (ExtractDestination({txhash, k}, out.scriptPubKey, dest)) {
+                valtype bytesID(boost::apply_visitor(DataVisitor(), dest));
+                if(bytesID.empty()) {
+                    continue;
+                }
+                valtype addressBytes(32);
+                std::copy(bytesID.begin(), bytesID.end(), addressBytes.begin());
+                deltas.push_back(std::make_pair(CAddressIndexKey(dest.which(), uint256(addressBytes), pindex->nHeight, i, txhash, k, false), out.nValue));
+            }
+        }
+    }
+    return true;
+}
+//////////////////////////////////////////////////////////////////////////////////
+#endif
@@ -17,6 +17,7 @@
 #include <policy/feerate.h>
 #include <protocol.h> // For CMessageHeader::MessageStartChars
 #include <script/script_error.h>
+#include <span.h>
 #include <sync.h>
 #include <txmempool.h> // For CTxMemPool::cs
 #include <txdb.h>
@@ -61,6 +62,7 @@ using ExtractQtumTX = std::pair<std::vector<QtumTransaction>, std::vector<EthTra
 
 class CChainState;
 class CBlockIndex;
+enum class CheckQueueMode;
 class CBlockTreeDB;
 class CBlockUndo;
 class CChainParams;
@@ -109,11 +111,31 @@ static const unsigned int MAX_BLOCKFILE_SIZE = 0x8000000; // 128 MiB
 static const unsigned int BLOCKFILE_CHUNK_SIZE = 0x1000000; // 16 MiB
 /** The pre-allocation chunk size for rev?????.dat files (since 0.8) */
 static const unsigned int UNDOFILE_CHUNK_SIZE = 0x100000; // 1 MiB
+/** Maximum number of blocks whose undo data waits to be written in the background */
+static const unsigned int MAX_UNDO_WRITE_QUEUE = 8;
 
 /** Maximum number of script-checking threads allowed */
 static const int MAX_SCRIPTCHECK_THREADS = 16;
 /** -par default (number of script-checking threads, 0 = auto) */
 static const int DEFAULT_SCRIPTCHECK_THREADS = 0;
+/** -blockprefetch default (number of blocks read ahead of the tip during initial block download) */
+static const int DEFAULT_BLOCK_PREFETCH = 16;
+/** Maximum number of blocks read ahead of the tip */
+static const int MAX_BLOCK_PREFETCH = 256;
+/** Number of threads reading blocks ahead of the tip */
+static const int BLOCK_PREFETCH_THREADS = 2;
+/** -coinprefetchthreads default (number of threads looking up the inputs of upcoming blocks) */
+static const int DEFAULT_COIN_PREFETCH_THREADS = 4;
+/** Maximum number of threads looking up the inputs of upcoming blocks */
+static const int MAX_COIN_PREFETCH_THREADS = 16;
+/** -incrementalflush default (write the coins cache in the background without emptying it) */
+static const bool DEFAULT_INCREMENTAL_FLUSH = false;
+/** -parallelaccept default (verify the scripts of relayed transactions in batches outside cs_main) */
+static const bool DEFAULT_PARALLEL_ACCEPT = false;
+/** -sigbatchsize default (number of single-signature inputs of a block whose signatures are verified together, 0 = off) */
+static const int DEFAULT_SIGNATURE_BATCH_SIZE = 0;
+/** Maximum number of inputs whose signatures are verified together */
+static const int MAX_SIGNATURE_BATCH_SIZE = 1024;
 /** Number of blocks that can be requested at any given time from a single peer. */
 static const int MAX_BLOCKS_IN_TRANSIT_PER_PEER = 16;
 /** Timeout in seconds during which a peer must stall block download progress before being disconnected. */
@@ -194,6 +216,10 @@ extern uint256 g_best_block;
 extern std::atomic_bool fImporting;
 extern std::atomic_bool fReindex;
 extern int nScriptCheckThreads;
+extern int nCoinPrefetchThreads;
+extern bool fIncrementalFlush;
+extern bool fParallelAccept;
+extern int nSignatureBatchSize;
 #ifdef ENABLE_BITCORE_RPC
 extern bool fAddressIndex;
 #endif
@@ -295,8 +321,16 @@ bool LoadGenesisBlock(const CChainParams& chainparams);
 bool LoadBlockIndex(const CChainParams& chainparams) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 /** Unload database information */
 void UnloadBlockIndex();
+/** Select how the script check queues hand out checks, before their threads start */
+void SetScriptCheckQueueMode(CheckQueueMode mode);
 /** Run an instance of the script checking thread */
 void ThreadScriptCheck(int worker_num);
+/** Run an instance of the thread checking scripts of transactions accepted with AcceptToMemoryPoolParallel */
+void ThreadMempoolScriptCheck(int worker_num);
+/** Start the threads that read blocks ahead of the tip and write undo data in the background */
+void StartBlockPipelineThreads(int prefetch_depth);
+/** Stop the block pipeline threads, writing out any queued undo data */
+void StopBlockPipelineThreads();
 /** Retrieve a transaction (from memory pool, or from disk, if possible) */
 bool GetTransaction(const uint256& hash, CTransactionRef& tx, const Consensus::Params& params, uint256& hashBlock, const CBlockIndex* const blockIndex = nullptr, bool fAllowSlow = false);
 /**
@@ -336,6 +370,16 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransa
                         bool* pfMissingInputs, std::list<CTransactionRef>* plTxnReplaced,
                         bool bypass_limits, const CAmount nAbsurdFee, bool test_accept=false, bool rawTx = false) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
+/**
+ * (try to) add a relayed transaction to memory pool, verifying its scripts
+ * without holding cs_main. The scripts of transactions that other threads
+ * are accepting at the same time are verified together on the script check
+ * threads; the transaction is then checked again against the current mempool
+ * and added in a short step under cs_main.
+ */
+bool AcceptToMemoryPoolParallel(CTxMemPool& pool, CValidationState &state, const CTransactionRef &tx,
+                                bool* pfMissingInputs, std::list<CTransactionRef>* plTxnReplaced) LOCKS_EXCLUDED(cs_main);
+
 /** Get the BIP9 state for a given deployment at the current tip. */
 ThresholdState VersionBitsTipState(const Consensus::Params& params, Consensus::DeploymentPos pos);
 
@@ -393,6 +437,10 @@ private:
     ScriptError error;
     PrecomputedTransactionData *txdata;
     int nOut;
+    //! Checks whose signatures are verified together, when this check stands for a group of them
+    std::shared_ptr<std::vector<CScriptCheck>> m_batch;
+
+    bool VerifyBatch();
 
 public:
     CScriptCheck(): ptxTo(nullptr), nIn(0), nFlags(0), cacheStore(false), error(SCRIPT_ERR_UNKNOWN_ERROR), nOut(-1) {}
@@ -400,6 +448,8 @@ public:
         m_tx_out(outIn), ptxTo(&txToIn), nIn(nInIn), nFlags(nFlagsIn), cacheStore(cacheIn), error(SCRIPT_ERR_UNKNOWN_ERROR), txdata(txdataIn), nOut(-1) { }
     CScriptCheck(const CTransaction& txToIn, int nOutIn, unsigned int nFlagsIn, bool cacheIn, PrecomputedTransactionData* txdataIn) :
         ptxTo(&txToIn), nIn(0), nFlags(nFlagsIn), cacheStore(cacheIn), error(SCRIPT_ERR_UNKNOWN_ERROR), txdata(txdataIn), nOut(nOutIn) { }
+    //! A check that runs all the given input checks, verifying their signatures in one batch
+    explicit CScriptCheck(std::vector<CScriptCheck>&& batch);
 
     bool operator()();
 
@@ -412,11 +462,15 @@ public:
         std::swap(error, check.error);
         std::swap(txdata, check.txdata);
         std::swap(nOut, check.nOut);
+        std::swap(m_batch, check.m_batch);
     }
 
     ScriptError GetScriptError() const { return error; }
 
     bool checkOutput() const { return nOut > -1; }
+
+    //! Whether this checks an input whose script needs a single signature, which can be batched
+    bool IsBatchable() const;
 };
 
 /** Initializes the script-execution cache */
@@ -437,6 +491,11 @@ bool GetTimestampIndex(const unsigned int &high, const unsigned int &low, const
 /////////////////////////////////////////////////////////////////
 #endif
 
+#ifdef ENABLE_BITCORE_RPC
+/** Compute the address index entries of a block from the block and its undo data, without reading the index */
+bool GetBlockAddressDeltas(const CBlock& block, const CBlockIndex* pindex, std::vector<std::pair<CAddressIndexKey, CAmount> >& deltas) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+#endif
+
 /** Functions for disk access for blocks */
 //Template function that read the whole block or the header only depending on the type (CBlock or CBlockHeader)
 template <typename Block>
@@ -444,6 +503,12 @@ bool ReadBlockFromDisk(Block& block, const FlatFilePos& pos, const Consensus::Pa
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams);
 bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const FlatFilePos& pos, const CMessageHeader::MessageStartChars& message_start);
 bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const CBlockIndex* pindex, const CMessageHeader::MessageStartChars& message_start);
+/**
+ * Point block at the raw serialized block inside a memory mapping of its block
+ * file, which mapping keeps alive. Returns false if the file cannot be mapped,
+ * in which case ReadRawBlockFromDisk should be used instead.
+ */
+bool MapRawBlockFromDisk(std::shared_ptr<const FlatFileMapping>& mapping, Span<const unsigned char>& block, const FlatFilePos& pos, const CMessageHeader::MessageStartChars& message_start);
 
 bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex);
 
@@ -633,6 +698,11 @@ struct CBlockIndexWorkComparator
     bool operator()(const CBlockIndex *pa, const CBlockIndex *pb) const;
 };
 
+struct CBlockIndexHeightComparator
+{
+    bool operator()(const CBlockIndex *pa, const CBlockIndex *pb) const;
+};
+
 /**
  * Maintains a tree of blocks (stored in `m_block_index`) which is consulted
  * to determine where the most-work tip is.
@@ -670,6 +740,17 @@ public:
      */
     std::multimap<CBlockIndex*, CBlockIndex*> m_blocks_unlinked;
 
+    /**
+     * Block indexes that may be off the active chain, ordered by height, so
+     * that stale forks can be cleaned up without walking m_block_index.
+     * Seeded from m_block_index on first use, after that new headers and
+     * disconnected tips are added; entries which turn out to be on the active
+     * chain are dropped when the cleanup reaches them.
+     */
+    std::set<CBlockIndex*, CBlockIndexHeightComparator> m_stale_candidates;
+    //! Whether m_stale_candidates was seeded from m_block_index
+    bool m_stale_candidates_seeded = false;
+
     /**
      * Load the blocktree off disk and into memory. Populate certain metadata
      * per index entry (nStatus, nChainWork, nTimeMax, etc.) as well as peripheral
@@ -721,6 +802,9 @@ public:
     //! This view wraps access to the leveldb instance and handles read errors gracefully.
     CCoinsViewErrorCatcher m_catcherview GUARDED_BY(cs_main);
 
+    //! This view stages the inputs of upcoming blocks, looked up in the background.
+    CCoinsViewPrefetch m_prefetchview GUARDED_BY(cs_main);
+
     //! This is the top layer of the cache hierarchy - it keeps as many coins in memory as
     //! can fit per the dbcache setting.
     std::unique_ptr<CCoinsViewCache> m_cacheview GUARDED_BY(cs_main);
@@ -850,6 +934,13 @@ public:
         return m_coins_views->m_catcherview;
     }
 
+    //! @returns A reference to the view that looks up the inputs of
+    //!     upcoming blocks ahead of the in-memory UTXO set.
+    CCoinsViewPrefetch& CoinsPrefetch() EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+    {
+        return m_coins_views->m_prefetchview;
+    }
+
     //! Destructs all objects related to accessing the UTXO set.
     void ResetCoinsViews() { m_coins_views.reset(); }
 
@@ -901,7 +992,8 @@ public:
     // Block (dis)connection on a given view:
     DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view, bool* pfClean);
     bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pindex,
-                      CCoinsViewCache& view, const CChainParams& chainparams, bool fJustCheck = false) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+                      CCoinsViewCache& view, const CChainParams& chainparams, bool fJustCheck = false,
+                      std::vector<TransactionReceiptInfo>* pvReceipts = nullptr) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     bool UpdateHashProof(const CBlock& block, CValidationState& state, const Consensus::Params& consensusParams, CBlockIndex* pindex, CCoinsViewCache& view);
 
     // Apply the effects of a block disconnection on the UTXO set.
@@ -972,6 +1064,9 @@ CChain& ChainActive();
 /** @returns the global block index map. */
 BlockMap& BlockIndex();
 
+/** Block indexes that may be off the active chain, see BlockManager::m_stale_candidates */
+std::set<CBlockIndex*, CBlockIndexHeightComparator>& StaleBlockIndexCandidates() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
 // Most often ::ChainstateActive() should be used instead of this, but some code
 // may not be able to assume that this has been initialized yet and so must use it
 // directly, e.g. init.cpp.
@@ -19,6 +19,7 @@ struct CBlockLocator;
 class CConnman;
 class CValidationInterface;
 class CValidationState;
+struct TransactionReceiptInfo;
 class uint256;
 class CScheduler;
 class CTxMemPool;
@@ -115,6 +116,14 @@ protected:
      * Called on a background thread.
      */
     virtual void BlockDisconnected(const std::shared_ptr<const CBlock> &block) {}
+    /**
+     * Notifies listeners of the contract execution receipts produced while
+     * connecting a block. Delivered right after BlockConnected() for the same
+     * block, only when -logevents is enabled and the block executed contracts.
+     *
+     * Called on a background thread.
+     */
+    virtual void ContractReceiptsConnected(const CBlockIndex *pindex, const std::shared_ptr<const std::vector<TransactionReceiptInfo>> &receipts) {}
     /**
      * Notifies listeners of the new active block chain on-disk.
      *
@@ -179,6 +188,7 @@ public:
     void TransactionAddedToMempool(const CTransactionRef &);
     void BlockConnected(const std::shared_ptr<const CBlock> &, const CBlockIndex *pindex, const std::shared_ptr<const std::vector<CTransactionRef>> &);
     void BlockDisconnected(const std::shared_ptr<const CBlock> &);
+    void ContractReceiptsConnected(const CBlockIndex *, const std::shared_ptr<const std::vector<TransactionReceiptInfo>> &);
     void ChainStateFlushed(const CBlockLocator &);
     void BlockChecked(const CBlock&, const CValidationState&);
     void NewPoWValidBlock(const CBlockIndex *, const std::shared_ptr<const CBlock>&);
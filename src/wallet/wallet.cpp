@@ -3578,10 +3578,23 @@ bool CWallet::CreateCoinStake(interfaces::Chain::Lock& locked_chain, const Filla
     CScript scriptPubKeyKernel;
     CScript aggregateScriptPubKeyHashKernel;
 
+    // Hash the kernels of all cached coins at once, only candidates go through CheckKernel
+    std::vector<COutPoint> vPrevoutStake;
+    vPrevoutStake.reserve(setCoins.size());
+    for(const std::pair<const CWalletTx*,unsigned int> &pcoin : setCoins)
+    {
+        vPrevoutStake.push_back(COutPoint(pcoin.first->GetHash(), pcoin.second));
+    }
+    std::vector<bool> vKernel;
+    CheckStakeKernelHashes(pindexPrev, nBits, nTimeBlock, vPrevoutStake, stakeCache, vKernel);
+    size_t nCoin = 0;
+
     for(const std::pair<const CWalletTx*,unsigned int> &pcoin : setCoins)
     {
         bool fKernelFound = false;
         boost::this_thread::interruption_point();
+        if (!vKernel[nCoin++])
+            continue;
         // Search backward in time from the given txNew timestamp
         // Search nSearchInterval seconds back up to nMaxStakeSearchInterval
         COutPoint prevoutStake = COutPoint(pcoin.first->GetHash(), pcoin.second);
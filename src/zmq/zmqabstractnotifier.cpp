@@ -20,3 +20,13 @@ bool CZMQAbstractNotifier::NotifyTransaction(const CTransaction &/*transaction*/
 {
     return true;
 }
+
+bool CZMQAbstractNotifier::NotifyContractReceipts(const CBlockIndex * /*CBlockIndex*/, const std::vector<TransactionReceiptInfo> &/*receipts*/)
+{
+    return true;
+}
+
+bool CZMQAbstractNotifier::NotifyBlockDisconnected(const CBlock &/*block*/)
+{
+    return true;
+}
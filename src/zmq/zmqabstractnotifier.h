@@ -7,8 +7,11 @@
 
 #include <zmq/zmqconfig.h>
 
+#include <vector>
+
 class CBlockIndex;
 class CZMQAbstractNotifier;
+struct TransactionReceiptInfo;
 
 typedef CZMQAbstractNotifier* (*CZMQNotifierFactory)();
 
@@ -42,6 +45,8 @@ public:
 
     virtual bool NotifyBlock(const CBlockIndex *pindex);
     virtual bool NotifyTransaction(const CTransaction &transaction);
+    virtual bool NotifyContractReceipts(const CBlockIndex *pindex, const std::vector<TransactionReceiptInfo> &receipts);
+    virtual bool NotifyBlockDisconnected(const CBlock &block);
 
 protected:
     void *psocket;
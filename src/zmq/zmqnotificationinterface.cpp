@@ -47,6 +47,8 @@ CZMQNotificationInterface* CZMQNotificationInterface::Create()
     factories["pubhashtx"] = CZMQAbstractNotifier::Create<CZMQPublishHashTransactionNotifier>;
     factories["pubrawblock"] = CZMQAbstractNotifier::Create<CZMQPublishRawBlockNotifier>;
     factories["pubrawtx"] = CZMQAbstractNotifier::Create<CZMQPublishRawTransactionNotifier>;
+    factories["pubcontractlogs"] = CZMQAbstractNotifier::Create<CZMQPublishContractLogsNotifier>;
+    factories["pubreceipt"] = CZMQAbstractNotifier::Create<CZMQPublishReceiptNotifier>;
 
     for (const auto& entry : factories)
     {
@@ -192,6 +194,37 @@ void CZMQNotificationInterface::BlockDisconnected(const std::shared_ptr<const CB
         // Do a normal notify for each transaction removed in block disconnection
         TransactionAddedToMempool(ptx);
     }
+
+    for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
+    {
+        CZMQAbstractNotifier *notifier = *i;
+        if (notifier->NotifyBlockDisconnected(*pblock))
+        {
+            i++;
+        }
+        else
+        {
+            notifier->Shutdown();
+            i = notifiers.erase(i);
+        }
+    }
+}
+
+void CZMQNotificationInterface::ContractReceiptsConnected(const CBlockIndex* pindex, const std::shared_ptr<const std::vector<TransactionReceiptInfo>>& receipts)
+{
+    for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
+    {
+        CZMQAbstractNotifier *notifier = *i;
+        if (notifier->NotifyContractReceipts(pindex, *receipts))
+        {
+            i++;
+        }
+        else
+        {
+            notifier->Shutdown();
+            i = notifiers.erase(i);
+        }
+    }
 }
 
 CZMQNotificationInterface* g_zmq_notification_interface = nullptr;
@@ -16,6 +16,11 @@ static const char *MSG_HASHBLOCK = "hashblock";
 static const char *MSG_HASHTX    = "hashtx";
 static const char *MSG_RAWBLOCK  = "rawblock";
 static const char *MSG_RAWTX     = "rawtx";
+static const char *MSG_CONTRACTLOGS = "contractlogs";
+static const char *MSG_RECEIPT   = "receipt";
+
+static const unsigned char LABEL_CONNECTED    = 'C';
+static const unsigned char LABEL_DISCONNECTED = 'D';
 
 // Internal function to send multipart message
 static int zmq_send_multipart(void *sock, const void* data, size_t size, ...)
@@ -206,3 +211,72 @@ bool CZMQPublishRawTransactionNotifier::NotifyTransaction(const CTransaction &tr
     ss << transaction;
     return SendMessage(MSG_RAWTX, &(*ss.begin()), ss.size());
 }
+
+// Body of the reorg marker: label, hash and height of the disconnected block
+static bool SerializeDisconnectedBlock(CDataStream& ss, const CBlock& block)
+{
+    uint256 hash = block.GetHash();
+    int height;
+    {
+        LOCK(cs_main);
+        const CBlockIndex* pindex = LookupBlockIndex(hash);
+        if (!pindex)
+        {
+            zmqError("Can't find disconnected block index");
+            return false;
+        }
+        height = pindex->nHeight;
+    }
+    ss << LABEL_DISCONNECTED << hash << uint32_t(height);
+    return true;
+}
+
+bool CZMQPublishContractLogsNotifier::NotifyContractReceipts(const CBlockIndex *pindex, const std::vector<TransactionReceiptInfo> &receipts)
+{
+    LogPrint(BCLog::ZMQ, "zmq: Publish contractlogs %s\n", pindex->GetBlockHash().GetHex());
+    for (const TransactionReceiptInfo& receipt : receipts)
+    {
+        for (size_t i = 0; i < receipt.logs.size(); i++)
+        {
+            CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+            ss << LABEL_CONNECTED << receipt.blockHash << receipt.blockNumber << receipt.transactionHash;
+            ss << receipt.transactionIndex << receipt.outputIndex << uint32_t(i);
+            SerializeLogEntry(ss, receipt.logs[i]);
+            if (!SendMessage(MSG_CONTRACTLOGS, &(*ss.begin()), ss.size()))
+                return false;
+        }
+    }
+    return true;
+}
+
+bool CZMQPublishContractLogsNotifier::NotifyBlockDisconnected(const CBlock &block)
+{
+    LogPrint(BCLog::ZMQ, "zmq: Publish contractlogs disconnect %s\n", block.GetHash().GetHex());
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    if (!SerializeDisconnectedBlock(ss, block))
+        return false;
+    return SendMessage(MSG_CONTRACTLOGS, &(*ss.begin()), ss.size());
+}
+
+bool CZMQPublishReceiptNotifier::NotifyContractReceipts(const CBlockIndex *pindex, const std::vector<TransactionReceiptInfo> &receipts)
+{
+    LogPrint(BCLog::ZMQ, "zmq: Publish receipt %s\n", pindex->GetBlockHash().GetHex());
+    for (const TransactionReceiptInfo& receipt : receipts)
+    {
+        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+        ss << LABEL_CONNECTED;
+        SerializeReceipt(ss, receipt);
+        if (!SendMessage(MSG_RECEIPT, &(*ss.begin()), ss.size()))
+            return false;
+    }
+    return true;
+}
+
+bool CZMQPublishReceiptNotifier::NotifyBlockDisconnected(const CBlock &block)
+{
+    LogPrint(BCLog::ZMQ, "zmq: Publish receipt disconnect %s\n", block.GetHash().GetHex());
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    if (!SerializeDisconnectedBlock(ss, block))
+        return false;
+    return SendMessage(MSG_RECEIPT, &(*ss.begin()), ss.size());
+}
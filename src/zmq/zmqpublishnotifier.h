@@ -52,4 +52,23 @@ public:
     bool NotifyTransaction(const CTransaction &transaction) override;
 };
 
+/* Contract notifiers prefix every body with a one byte label:
+     'C' - data produced by a connected block
+     'D' - the block (hash & height) was disconnected, previously
+           published data for it must be rolled back by the subscriber
+*/
+class CZMQPublishContractLogsNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyContractReceipts(const CBlockIndex *pindex, const std::vector<TransactionReceiptInfo> &receipts) override;
+    bool NotifyBlockDisconnected(const CBlock &block) override;
+};
+
+class CZMQPublishReceiptNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyContractReceipts(const CBlockIndex *pindex, const std::vector<TransactionReceiptInfo> &receipts) override;
+    bool NotifyBlockDisconnected(const CBlock &block) override;
+};
+
 #endif // BITCOIN_ZMQ_ZMQPUBLISHNOTIFIER_H
@@ -0,0 +1,53 @@
+#!/usr/bin/env python3
+# Copyright (c) 2019 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test the block read-ahead and background undo writes of the initial sync.
+
+- node0 mines a chain, node1 reads blocks ahead while syncing it and node2
+  runs with -blockprefetch=0.
+- node1 reconnects the whole chain from disk with -reindex-chainstate, which
+  reports the prefetch and undo write stages in the bench log.
+- Blocks connected with queued undo data are disconnected again, and all
+  nodes end up with the same UTXO set.
+"""
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal, connect_nodes, wait_until
+
+class BlockPrefetchTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.setup_clean_chain = True
+        self.num_nodes = 3
+        self.extra_args = [[], ["-blockprefetch=32", "-debug=bench"], ["-blockprefetch=0"]]
+
+    def setup_network(self):
+        self.setup_nodes()
+
+    def run_test(self):
+        node0, node1, node2 = self.nodes
+        node0.generatetoaddress(300, node0.get_deterministic_priv_key().address)
+
+        self.log.info("Sync with and without reading blocks ahead")
+        connect_nodes(node1, 0)
+        connect_nodes(node2, 0)
+        self.sync_blocks()
+
+        self.log.info("Reconnect the chain from disk with the pipeline stages logged")
+        with node1.assert_debug_log(["    - Prefetch: ", "- Undo write: "]):
+            self.restart_node(1, extra_args=["-blockprefetch=32", "-debug=bench", "-reindex-chainstate"])
+            wait_until(lambda: node1.getblockcount() == 300)
+
+        self.log.info("Disconnect blocks whose undo data was written in the background")
+        tip = node1.getbestblockhash()
+        node1.invalidateblock(node1.getblockhash(250))
+        assert_equal(node1.getblockcount(), 249)
+        node1.reconsiderblock(node1.getblockhash(250))
+        assert_equal(node1.getbestblockhash(), tip)
+
+        utxo_hashes = [node.gettxoutsetinfo()['hash_serialized_2'] for node in self.nodes]
+        assert_equal(utxo_hashes[1], utxo_hashes[0])
+        assert_equal(utxo_hashes[2], utxo_hashes[0])
+
+if __name__ == '__main__':
+    BlockPrefetchTest().main()
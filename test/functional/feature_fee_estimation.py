@@ -248,6 +248,11 @@ class EstimateFeeTest(BitcoinTestFramework):
         self.log.info("Final estimates after emptying mempools")
         check_estimates(self.nodes[1], self.fees_per_kb)
 
+        self.log.info("Gas price estimates fall back to the DGP minimum without contract transactions")
+        gas_estimate = self.nodes[1].estimatesmartgasprice(6)
+        assert_equal(gas_estimate['blocks'], 0)
+        assert_equal(gas_estimate['gasprice'], Decimal(self.nodes[1].getdgpinfo()['mingasprice']) / COIN)
+
 
 if __name__ == '__main__':
     EstimateFeeTest().main()
@@ -0,0 +1,129 @@
+#!/usr/bin/env python3
+# Copyright (c) 2019 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test the optional block validation modes against the default one.
+
+Each entry of VALIDATION_MODES runs on its own node next to node0, which
+uses the defaults and mines the chain. For every mode:
+
+- A block spending 100 single-signature inputs in one transaction is
+  connected, and the UTXO set matches node0's.
+- A block with a bad signature among 100 inputs is rejected, and the same
+  block with the signatures intact is connected.
+- Blocks are disconnected and connected again.
+- An unknown value of the mode's option is an init error, where the option
+  takes a name.
+"""
+
+from test_framework.blocktools import create_block, create_coinbase
+from test_framework.messages import CTransaction, FromHex, ToHex
+from test_framework.qtumconfig import COINBASE_MATURITY
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.test_node import ErrorMatch
+from test_framework.util import assert_equal, connect_nodes
+
+# (description, node arguments, option that is checked for unknown values)
+VALIDATION_MODES = [
+    ("flat coin maps", ["-coinsmap=flat"], "-coinsmap"),
+    ("work stealing check queues", ["-checkqueue=stealing", "-par=4"], "-checkqueue"),
+    ("batched signature checks", ["-sigbatchsize=64", "-par=4"], None),
+]
+
+class ValidationModesTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.setup_clean_chain = True
+        self.num_nodes = 1 + len(VALIDATION_MODES)
+        self.extra_args = [[]] + [args for _, args, _ in VALIDATION_MODES]
+
+    def skip_test_if_missing_module(self):
+        self.skip_if_no_wallet()
+
+    def setup_network(self):
+        self.setup_nodes()
+        for i in range(1, self.num_nodes):
+            connect_nodes(self.nodes[i], 0)
+
+    def spend_outputs(self, addresses):
+        """Sign a transaction spending the outputs of node0's wallet to the given addresses."""
+        node0 = self.nodes[0]
+        unspents = [u for u in node0.listunspent() if u['address'] in addresses]
+        assert_equal(len(unspents), len(addresses))
+        inputs = [{'txid': u['txid'], 'vout': u['vout']} for u in unspents]
+        amount = sum(u['amount'] for u in unspents) - 1
+        raw = node0.createrawtransaction(inputs, {node0.getnewaddress("", "legacy"): amount})
+        ret = node0.signrawtransactionwithwallet(raw)
+        assert ret['complete']
+        return ret['hex']
+
+    def block_with(self, tx):
+        """Serialize a block on node0's tip with the given transaction."""
+        node0 = self.nodes[0]
+        tip = node0.getbestblockhash()
+        block = create_block(int(tip, 16), create_coinbase(node0.getblockcount() + 1), node0.getblock(tip)['time'] + 1)
+        block.vtx.append(tx)
+        block.hashMerkleRoot = block.calc_merkle_root()
+        block.solve()
+        return ToHex(block)
+
+    def check_utxo_sets(self):
+        utxo_hashes = [node.gettxoutsetinfo()['hash_serialized_2'] for node in self.nodes]
+        for (description, _, _), utxo_hash in zip(VALIDATION_MODES, utxo_hashes[1:]):
+            self.log.info("  UTXO set with %s matches" % description)
+            assert_equal(utxo_hash, utxo_hashes[0])
+
+    def run_test(self):
+        node0 = self.nodes[0]
+        node0.generatetoaddress(COINBASE_MATURITY + 100, node0.getnewaddress())
+        addresses = [node0.getnewaddress("", "legacy") for _ in range(200)]
+        node0.sendmany("", {address: 1 for address in addresses})
+        node0.generatetoaddress(1, node0.getnewaddress())
+        self.sync_blocks()
+
+        self.log.info("Connect a transaction with 100 single-signature inputs")
+        node0.sendrawtransaction(self.spend_outputs(addresses[:100]))
+        node0.generatetoaddress(1, node0.getnewaddress())
+        self.sync_blocks()
+        self.check_utxo_sets()
+
+        self.log.info("Reject a bad signature among 100 inputs")
+        spend_hex = self.spend_outputs(addresses[100:])
+        bad_tx = FromHex(CTransaction(), spend_hex)
+        # Flip a bit in the last byte of R of one input's signature. The
+        # scriptSig is <sig> <pubkey>, and the DER signature starts with
+        # 0x30 <len> 0x02 <len(R)>, so the signature stays well-formed.
+        script_sig = bytearray(bad_tx.vin[50].scriptSig)
+        script_sig[4 + script_sig[4]] ^= 1
+        bad_tx.vin[50].scriptSig = bytes(script_sig)
+        bad_tx.rehash()
+        tip = node0.getbestblockhash()
+        for (description, _, _), node in zip(VALIDATION_MODES, self.nodes[1:]):
+            self.log.info("  Rejected with %s" % description)
+            assert node.submitblock(self.block_with(bad_tx)) is not None
+            assert_equal(node.getbestblockhash(), tip)
+
+        self.log.info("Connect the same block with the signatures intact")
+        assert_equal(node0.submitblock(self.block_with(FromHex(CTransaction(), spend_hex))), None)
+        self.sync_blocks()
+        self.check_utxo_sets()
+
+        self.log.info("Disconnect and reconnect blocks")
+        tip = node0.getbestblockhash()
+        height = node0.getblockcount()
+        fork = node0.getblockhash(height - 2)
+        for node in self.nodes[1:]:
+            node.invalidateblock(fork)
+            assert_equal(node.getblockcount(), height - 3)
+            node.reconsiderblock(fork)
+            assert_equal(node.getbestblockhash(), tip)
+        self.check_utxo_sets()
+
+        self.log.info("Refuse unknown values of the mode options")
+        for i, (_, _, option) in enumerate(VALIDATION_MODES, 1):
+            if option is None:
+                continue
+            self.stop_node(i)
+            self.nodes[i].assert_start_raises_init_error([option + "=unknown"], "Error: Invalid %s .* 'unknown'" % option, match=ErrorMatch.PARTIAL_REGEX)
+
+if __name__ == '__main__':
+    ValidationModesTest().main()
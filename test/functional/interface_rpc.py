@@ -5,9 +5,11 @@
 """Tests some generic aspects of the RPC interface."""
 
 import os
+import threading
+import time
 from test_framework.authproxy import JSONRPCException
 from test_framework.test_framework import BitcoinTestFramework
-from test_framework.util import assert_equal, assert_greater_than_or_equal
+from test_framework.util import assert_equal, assert_greater_than, assert_greater_than_or_equal, get_rpc_proxy
 
 def expect_http_status(expected_http_status, expected_rpc_code,
                        fcn, *args):
@@ -22,6 +24,7 @@ class RPCInterfaceTest(BitcoinTestFramework):
     def set_test_params(self):
         self.num_nodes = 1
         self.setup_clean_chain = True
+        self.extra_args = [["-rpcthreads=1", "-rpcqueue=slow:1:4:waitfornewblock"]]
 
     def test_getrpcinfo(self):
         self.log.info("Testing getrpcinfo...")
@@ -33,6 +36,47 @@ class RPCInterfaceTest(BitcoinTestFramework):
         assert_equal(command['method'], 'getrpcinfo')
         assert_greater_than_or_equal(command['duration'], 0)
         assert_equal(info['logpath'], os.path.join(self.nodes[0].datadir, 'regtest', 'debug.log'))
+        queues = {q['name']: q for q in info['work_queues']}
+        assert_equal(sorted(queues.keys()), ['blocking', 'default', 'scan', 'slow'])
+        assert_equal(queues['default']['threads'], 1)
+        assert_equal(queues['slow']['max_depth'], 4)
+        assert_greater_than(queues['default']['processed'], 0)
+
+    def test_work_queues(self):
+        self.log.info("Testing that blocking calls don't hold up the default work queue...")
+
+        def wait_for_block():
+            rpc = get_rpc_proxy(self.nodes[0].url, 0, timeout=60)
+            rpc.waitfornewblock(3000)
+        thread = threading.Thread(target=wait_for_block)
+        thread.start()
+        time.sleep(0.5)
+        start = time.time()
+        self.nodes[0].getblockcount()
+        assert time.time() - start < 1
+        thread.join()
+
+        queues = {q['name']: q for q in self.nodes[0].getrpcinfo()['work_queues']}
+        assert_equal(queues['slow']['processed'], 1)
+        assert_greater_than_or_equal(queues['slow']['avg_exec'], 3000000)
+
+        self.log.info("Testing that scan control calls don't wait behind blocking calls...")
+
+        def wait_for_height():
+            rpc = get_rpc_proxy(self.nodes[0].url, 0, timeout=60)
+            rpc.waitforblockheight(1000, 3000)
+        threads = [threading.Thread(target=wait_for_height) for _ in range(queues['blocking']['threads'])]
+        for t in threads:
+            t.start()
+        time.sleep(0.5)
+        start = time.time()
+        assert_equal(self.nodes[0].scantxoutset("abort"), False)
+        assert time.time() - start < 1
+        for t in threads:
+            t.join()
+
+        queues = {q['name']: q for q in self.nodes[0].getrpcinfo()['work_queues']}
+        assert_equal(queues['scan']['processed'], 1)
 
     def test_batch_request(self):
         self.log.info("Testing basic JSON-RPC batch request...")
@@ -68,6 +112,7 @@ class RPCInterfaceTest(BitcoinTestFramework):
 
     def run_test(self):
         self.test_getrpcinfo()
+        self.test_work_queues()
         self.test_batch_request()
         self.test_http_status_codes()
 
@@ -33,6 +33,8 @@ Test is as follows:
     mempool.
   - Verify that savemempool throws when the RPC is called if
     node1 can't write to disk.
+  - Restore a mempool.dat saved before the last block on node1 and
+    verify that its transactions are validated again on startup.
 
 """
 from decimal import Decimal
@@ -105,8 +107,9 @@ class MempoolPersistTest(BitcoinTestFramework):
 
         self.log.debug("Stop-start node0. Verify that it has the transactions in its mempool.")
         self.stop_nodes()
-        self.start_node(0)
-        wait_until(lambda: self.nodes[0].getmempoolinfo()["loaded"])
+        with self.nodes[0].assert_debug_log(["Imported mempool snapshot from disk: 5 loaded, 0 revalidated"]):
+            self.start_node(0)
+            wait_until(lambda: self.nodes[0].getmempoolinfo()["loaded"])
         assert_equal(len(self.nodes[0].getrawmempool()), 5)
 
         mempooldat0 = os.path.join(self.nodes[0].datadir, 'regtest', 'mempool.dat')
@@ -131,6 +134,20 @@ class MempoolPersistTest(BitcoinTestFramework):
         assert_raises_rpc_error(-1, "Unable to dump mempool to disk", self.nodes[1].savemempool)
         os.rmdir(mempooldotnew1)
 
+        self.log.debug("Restore a mempool.dat from before the tip on node1. Verify that its transactions are validated again")
+        self.nodes[1].savemempool()
+        with open(mempooldat1, 'rb') as f:
+            snapshot = f.read()
+        self.nodes[1].generate(1)
+        assert_equal(len(self.nodes[1].getrawmempool()), 0)
+        self.stop_node(1)
+        with open(mempooldat1, 'wb') as f:
+            f.write(snapshot)
+        with self.nodes[1].assert_debug_log(["revalidating its 5 transactions", "0 loaded, 0 revalidated, 5 failed"]):
+            self.start_node(1, extra_args=[])
+            wait_until(lambda: self.nodes[1].getmempoolinfo()["loaded"])
+        assert_equal(len(self.nodes[1].getrawmempool()), 0)
+
 
 if __name__ == '__main__':
     MempoolPersistTest().main()
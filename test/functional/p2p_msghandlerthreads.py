@@ -0,0 +1,59 @@
+#!/usr/bin/env python3
+# Copyright (c) 2019 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test message processing with several message handler threads.
+
+- node0 shards its peers over 4 message handler threads.
+- Each of a set of peers sends a burst of pings; the pongs must come
+  back in the order the pings were sent.
+- Blocks mined on either node reach the other one.
+"""
+
+from test_framework.messages import msg_ping
+from test_framework.mininode import P2PInterface, mininode_lock
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal, connect_nodes, wait_until
+
+NUM_PEERS = 12
+NUM_PINGS = 50
+
+class PongRecorder(P2PInterface):
+    def __init__(self):
+        super().__init__()
+        self.pongs = []
+
+    def on_pong(self, message):
+        self.pongs.append(message.nonce)
+
+class MsgHandlerThreadsTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.setup_clean_chain = True
+        self.num_nodes = 2
+        self.extra_args = [["-msghandlerthreads=4"], []]
+
+    def setup_network(self):
+        self.setup_nodes()
+
+    def run_test(self):
+        node = self.nodes[0]
+
+        self.log.info("Per-peer message order is kept across handler threads")
+        peers = [node.add_p2p_connection(PongRecorder()) for _ in range(NUM_PEERS)]
+        for nonce in range(1, NUM_PINGS + 1):
+            for peer in peers:
+                peer.send_message(msg_ping(nonce=nonce))
+        for peer in peers:
+            wait_until(lambda: len(peer.pongs) == NUM_PINGS, timeout=60, lock=mininode_lock)
+            with mininode_lock:
+                assert_equal(peer.pongs, list(range(1, NUM_PINGS + 1)))
+
+        self.log.info("Blocks relay both ways")
+        connect_nodes(self.nodes[0], 1)
+        node.generatetoaddress(20, node.get_deterministic_priv_key().address)
+        self.sync_blocks()
+        self.nodes[1].generatetoaddress(20, self.nodes[1].get_deterministic_priv_key().address)
+        self.sync_blocks()
+
+if __name__ == '__main__':
+    MsgHandlerThreadsTest().main()
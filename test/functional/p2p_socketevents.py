@@ -0,0 +1,88 @@
+#!/usr/bin/env python3
+# Copyright (c) 2019 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test the -socketevents backends of the socket handler thread.
+
+- node0 runs the epoll backend, node1 the compile-time default.
+- Both serve the same number of idle inbound peers; the CPU time each
+  node spends while the peers sit idle is logged per peer.
+- Blocks relayed between the nodes and pings to every peer check that
+  the edge-triggered backend neither loses reads nor stalls sends.
+"""
+
+import os
+import platform
+import time
+
+from test_framework.messages import msg_ping
+from test_framework.mininode import P2PInterface, mininode_lock
+from test_framework.test_framework import BitcoinTestFramework, SkipTest
+from test_framework.test_node import ErrorMatch
+from test_framework.util import assert_equal, connect_nodes, wait_until
+
+NUM_IDLE_PEERS = 100
+IDLE_SECONDS = 10
+
+def process_cpu_seconds(pid):
+    with open('/proc/%d/stat' % pid, encoding='utf8') as f:
+        # The command name may contain spaces, fields are counted after it
+        fields = f.read().rsplit(')', 1)[1].split()
+    # utime and stime are fields 14 and 15 of the whole line
+    return (int(fields[11]) + int(fields[12])) / os.sysconf('SC_CLK_TCK')
+
+class SocketEventsTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.setup_clean_chain = True
+        self.num_nodes = 2
+        self.extra_args = [
+            ["-socketevents=epoll", "-maxconnections=%d" % (NUM_IDLE_PEERS + 20)],
+            ["-maxconnections=%d" % (NUM_IDLE_PEERS + 20)],
+        ]
+
+    def skip_test_if_missing_module(self):
+        if platform.system() != 'Linux':
+            raise SkipTest("epoll is only available on Linux")
+
+    def setup_network(self):
+        self.setup_nodes()
+
+    def run_test(self):
+        self.log.info("Connect %d idle peers to each node" % NUM_IDLE_PEERS)
+        for node in self.nodes:
+            for _ in range(NUM_IDLE_PEERS):
+                node.add_p2p_connection(P2PInterface())
+            assert_equal(len(node.getpeerinfo()), NUM_IDLE_PEERS)
+
+        self.log.info("Measure CPU time spent with idle peers")
+        start = [process_cpu_seconds(node.process.pid) for node in self.nodes]
+        time.sleep(IDLE_SECONDS)
+        for node, cpu_start, mode in zip(self.nodes, start, ["epoll", "default"]):
+            used = process_cpu_seconds(node.process.pid) - cpu_start
+            self.log.info("%s: %.3fs CPU over %ds, %.2fms per idle peer per second" %
+                          (mode, used, IDLE_SECONDS, used * 1000 / IDLE_SECONDS / NUM_IDLE_PEERS))
+
+        self.log.info("Every idle peer still gets answers")
+        for node in self.nodes:
+            for p2p in node.p2ps:
+                p2p.send_message(msg_ping(nonce=12345))
+            for p2p in node.p2ps:
+                wait_until(lambda: p2p.last_message.get("pong") and p2p.last_message["pong"].nonce == 12345, timeout=30, lock=mininode_lock)
+
+        self.log.info("Relay blocks between the epoll and default nodes")
+        connect_nodes(self.nodes[0], 1)
+        self.nodes[0].generatetoaddress(50, self.nodes[0].get_deterministic_priv_key().address)
+        self.sync_blocks()
+        self.nodes[1].generatetoaddress(50, self.nodes[1].get_deterministic_priv_key().address)
+        self.sync_blocks()
+
+        self.log.info("Disconnected peers are noticed")
+        self.nodes[0].disconnect_p2ps()
+        wait_until(lambda: len(self.nodes[0].getpeerinfo()) == 1, timeout=30)
+
+        self.log.info("Unknown modes are rejected at startup")
+        self.stop_node(0)
+        self.nodes[0].assert_start_raises_init_error(["-socketevents=foo"], "Error: Invalid -socketevents mode 'foo'", match=ErrorMatch.PARTIAL_TEXT)
+
+if __name__ == '__main__':
+    SocketEventsTest().main()
@@ -0,0 +1,126 @@
+#!/usr/bin/env python3
+# Copyright (c) 2015-2019 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test the REST block range export with receipts and address deltas."""
+import http.client
+import struct
+import urllib.parse
+from io import BytesIO
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.messages import CBlock, deser_compact_size, deser_string, deser_uint256
+from test_framework.util import assert_equal, assert_greater_than
+
+EVENT_CONTRACT = "6060604052600d600055341561001457600080fd5b61017e806100236000396000f30060606040526004361061004c576000357c0100000000000000000000000000000000000000000000000000000000900463ffffffff168063027c1aaf1461004e5780635b9af12b14610058575b005b61005661008f565b005b341561006357600080fd5b61007960048080359060200190919050506100a1565b6040518082815260200191505060405180910390f35b60026000808282540292505081905550565b60007fc5c442325655248f6bccf5c6181738f8755524172cea2a8bd1e38e43f833e7f282600054016000548460405180848152602001838152602001828152602001935050505060405180910390a17fc5c442325655248f6bccf5c6181738f8755524172cea2a8bd1e38e43f833e7f282600054016000548460405180848152602001838152602001828152602001935050505060405180910390a1816000540160008190555060005490509190505600a165627a7a7230582015732bfa66bdede47ecc05446bf4c1e8ed047efac25478cb13b795887df70f290029"
+
+def deser_log(f):
+    address = f.read(20).hex()
+    topics = [f.read(32).hex() for _ in range(deser_compact_size(f))]
+    data = deser_string(f)
+    return address, topics, data
+
+def deser_receipt(f):
+    r = {}
+    r['blockhash'] = "%064x" % deser_uint256(f)
+    r['blocknumber'], = struct.unpack("<I", f.read(4))
+    r['txid'] = "%064x" % deser_uint256(f)
+    r['txindex'], r['outputindex'] = struct.unpack("<II", f.read(8))
+    r['from'] = f.read(20).hex()
+    r['to'] = f.read(20).hex()
+    r['contractaddress'] = f.read(20).hex()
+    r['cumulativegasused'], r['gasused'], r['excepted'] = struct.unpack("<QQI", f.read(20))
+    r['exceptedmessage'] = deser_string(f)
+    r['logs'] = [deser_log(f) for _ in range(deser_compact_size(f))]
+    return r
+
+def deser_delta(f):
+    d = {}
+    d['type'], = struct.unpack("<B", f.read(1))
+    d['address'] = f.read(32).hex()
+    d['txindex'], = struct.unpack("<I", f.read(4))
+    d['txid'] = "%064x" % deser_uint256(f)
+    d['index'], d['spending'], d['satoshis'] = struct.unpack("<IBq", f.read(13))
+    return d
+
+def deser_records(data):
+    f = BytesIO(data)
+    records = []
+    while f.tell() < len(data):
+        size, = struct.unpack("<I", f.read(4))
+        rf = BytesIO(f.read(size))
+        r = {}
+        r['height'], = struct.unpack("<I", rf.read(4))
+        r['block'] = CBlock()
+        r['block'].deserialize(rf)
+        r['block'].rehash()
+        r['receipts'] = [deser_receipt(rf) for _ in range(deser_compact_size(rf))]
+        r['deltas'] = [deser_delta(rf) for _ in range(deser_compact_size(rf))]
+        assert_equal(rf.read(), b'')
+        records.append(r)
+    return records
+
+class QtumRestBlockRangeTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.setup_clean_chain = True
+        self.num_nodes = 1
+        self.extra_args = [["-rest", "-logevents"]]
+
+    def skip_test_if_missing_module(self):
+        self.skip_if_no_wallet()
+
+    def get_range(self, height, count, ext='bin', status=200):
+        conn = http.client.HTTPConnection(self.url.hostname, self.url.port)
+        conn.request('GET', '/rest/blockrange/%d/%d.%s' % (height, count, ext))
+        resp = conn.getresponse()
+        assert_equal(resp.status, status)
+        return resp.read()
+
+    def run_test(self):
+        self.url = urllib.parse.urlparse(self.nodes[0].url)
+        node = self.nodes[0]
+        node.generate(600)
+        contract_address = node.createcontract(EVENT_CONTRACT)['address']
+        node.generate(1)
+        txid = node.sendtocontract(contract_address, "5b9af12b")['txid']
+        tip = node.generate(1)[0]
+
+        self.log.info("Export the last blocks of the chain")
+        records = deser_records(self.get_range(600, 10))
+        assert_equal([r['height'] for r in records], [600, 601, 602])
+        for r in records:
+            assert_equal(r['block'].hash, node.getblockhash(r['height']))
+
+        r = records[2]
+        assert_equal(r['block'].hash, tip)
+        assert_equal(len(r['receipts']), 1)
+        receipt = r['receipts'][0]
+        rpc_receipt = node.gettransactionreceipt(txid)[0]
+        assert_equal(receipt['txid'], txid)
+        assert_equal(receipt['blockhash'], tip)
+        assert_equal(receipt['gasused'], rpc_receipt['gasUsed'])
+        assert_equal(len(receipt['logs']), len(rpc_receipt['log']))
+        assert_equal(receipt['logs'][0][0], contract_address)
+
+        if self.is_bitcore_compiled():
+            # The coinbase pays the miner, the contract call spends a wallet coin
+            assert any(d['txindex'] == 0 and not d['spending'] and d['satoshis'] > 0 for d in r['deltas'])
+            spends = [d for d in r['deltas'] if d['txid'] == txid and d['spending']]
+            assert_greater_than(len(spends), 0)
+            assert all(d['satoshis'] < 0 for d in spends)
+        else:
+            # Without the bitcore RPCs the records carry no address deltas
+            assert all(r['deltas'] == [] for r in records)
+
+        self.log.info("Hex export carries the same records")
+        hex_data = self.get_range(600, 3, 'hex').decode('ascii')
+        assert_equal(bytes.fromhex(hex_data.strip()), self.get_range(600, 3))
+
+        self.log.info("Invalid requests are rejected")
+        self.get_range(700, 1, status=404)
+        self.get_range(0, 0, status=400)
+        self.get_range(0, 2001, status=400)
+        self.get_range(0, 1, 'json', status=404)
+
+if __name__ == '__main__':
+    QtumRestBlockRangeTest().main()
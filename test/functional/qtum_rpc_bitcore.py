@@ -89,6 +89,16 @@ class QtumBitcoreTest(BitcoinTestFramework):
         assert_equal(ret[0]['txid'], mempool_txid)
         assert_equal(len(ret), 1)
 
+        ret = node.getaddressmempool({'addresses': [mempool_address], 'since': 0})
+        assert_equal(ret['complete'], True)
+        assert_equal([delta['txid'] for delta in ret['added']], [mempool_txid])
+        assert_equal(ret['removed'], [])
+        mempool_sequence = ret['sequence']
+        ret = node.getaddressmempool({'addresses': [mempool_address], 'since': mempool_sequence})
+        assert_equal(ret['added'], [])
+        assert_equal(ret['removed'], [])
+        assert_equal(ret['sequence'], mempool_sequence)
+
         new_block = node.getblock(node.getblockhash(994))
         old_block = node.getblock(node.getblockhash(991))
         ret = node.getblockhashes(new_block['time'], old_block['time'])
@@ -99,8 +109,28 @@ class QtumBitcoreTest(BitcoinTestFramework):
         spent_prevout = txinfo['vin'][0]
         ret = node.getspentinfo({"txid": spent_prevout['txid'], "index": spent_prevout['vout']})
         assert_equal(ret, {"txid": expected_address_txids[0], "index": 0, "height": 1002})
+
+        node.generate(1)
+        ret = node.getaddressmempool({'addresses': [mempool_address], 'since': mempool_sequence})
+        assert_equal(ret['added'], [])
+        assert_equal([delta['txid'] for delta in ret['removed']], [mempool_txid])
+        assert ret['sequence'] > mempool_sequence
+        assert_equal(node.getaddressmempool({'addresses': [mempool_address]}), [])
         self.sync_all()
 
+        # Sequence numbers handed out before a restart are not known afterwards
+        mempool_sequence = ret['sequence']
+        self.restart_node(0)
+        node = self.nodes[0]
+        ret = node.getaddressmempool({'addresses': [mempool_address], 'since': mempool_sequence})
+        assert_equal(ret['complete'], False)
+        ret = node.getaddressmempool({'addresses': [mempool_address], 'since': 0})
+        assert_equal(ret['complete'], True)
+        ret = node.getaddressmempool({'addresses': [mempool_address], 'since': ret['sequence']})
+        assert_equal(ret['complete'], True)
+        assert_equal(ret['added'], [])
+        assert_equal(ret['removed'], [])
+
 
 if __name__ == '__main__':
     QtumBitcoreTest().main()
\ No newline at end of file
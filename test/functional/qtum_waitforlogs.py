@@ -8,15 +8,19 @@ from test_framework.util import *
 from test_framework.script import *
 from test_framework.mininode import *
 import sys
+import threading
+import time
 
 
 RPC_INVALID_PARAMETER = -8
+RPC_INVALID_REQUEST = -32600
 
 class QtumRPCWaitforlogs(BitcoinTestFramework):
     def set_test_params(self):
         self.setup_clean_chain = True
         self.num_nodes = 1
-        self.extra_args = [["-logevents=1"]]
+        # A single RPC worker must be able to serve any number of parked waiters
+        self.extra_args = [["-logevents=1", "-rpcthreads=1", "-rpcworkqueue=64"]]
 
     def skip_test_if_missing_module(self):
         self.skip_if_no_wallet()
@@ -111,11 +115,57 @@ class QtumRPCWaitforlogs(BitcoinTestFramework):
         except JSONRPCException as exp:
             assert_equal(exp.error["code"], RPC_INVALID_PARAMETER)
 
+    def check_parked_waiters(self, contract_addresses):
+        num_waiters = 32
+        from_block = self.nodes[0].getblockcount() + 1
+        filters = {"addresses": [contract_addresses[0]]}
+        results = [None] * num_waiters
+
+        def wait(i):
+            rpc = get_rpc_proxy(self.nodes[0].url, 0, timeout=60)
+            results[i] = rpc.waitforlogs(from_block, None, filters, 0)
+
+        threads = [threading.Thread(target=wait, args=(i,)) for i in range(num_waiters)]
+        for t in threads:
+            t.start()
+        time.sleep(1)
+
+        # The single RPC worker is not pinned by the parked waiters
+        assert_equal(self.nodes[0].getblockcount(), from_block - 1)
+        self.nodes[0].sendtocontract(contract_addresses[0], "5b9af12b")
+        self.nodes[0].generate(1)
+
+        for t in threads:
+            t.join()
+        for ret in results:
+            assert_equal(ret['count'], 2)
+            assert_equal(ret['entries'][0]['blockNumber'], from_block)
+            assert_equal(ret['nextblock'], from_block + 1)
+
+    def check_batch(self):
+        node = self.nodes[0]
+        height = node.getblockcount()
+        # Refused in a batch, whether logs are available or it would have to wait
+        results = node.batch([
+            node.waitforlogs.get_request(604, 604),
+            node.waitforlogs.get_request(height + 1, None, {}, 0),
+            node.getblockcount.get_request(),
+        ])
+        assert_equal(results[0]['error']['code'], RPC_INVALID_REQUEST)
+        assert_equal(results[1]['error']['code'], RPC_INVALID_REQUEST)
+        assert_equal(results[2]['result'], height)
+
+        # Nothing was left parked on the batch's connection
+        node.generate(1)
+        assert_equal(node.getblockcount(), height + 1)
+
     def run_test(self):
         contract_addresses, send_result, block_hashes = self.create_contracts_with_logs()
 
         self.check_waitforlogs(contract_addresses, send_result, block_hashes)
         self.check_topics(contract_addresses, block_hashes, send_result)
+        self.check_parked_waiters(contract_addresses)
+        self.check_batch()
         self.stop_nodes()
         self.start_nodes()               #start node again
         self.check_topics(contract_addresses, block_hashes,send_result)
@@ -0,0 +1,135 @@
+#!/usr/bin/env python3
+# Copyright (c) 2015-2019 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test the ZMQ contract receipt and event log notifications."""
+import struct
+from io import BytesIO
+from time import sleep
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.messages import deser_compact_size, deser_string, deser_uint256
+from test_framework.util import assert_equal
+
+EVENT_CONTRACT = "6060604052600d600055341561001457600080fd5b61017e806100236000396000f30060606040526004361061004c576000357c0100000000000000000000000000000000000000000000000000000000900463ffffffff168063027c1aaf1461004e5780635b9af12b14610058575b005b61005661008f565b005b341561006357600080fd5b61007960048080359060200190919050506100a1565b6040518082815260200191505060405180910390f35b60026000808282540292505081905550565b60007fc5c442325655248f6bccf5c6181738f8755524172cea2a8bd1e38e43f833e7f282600054016000548460405180848152602001838152602001828152602001935050505060405180910390a17fc5c442325655248f6bccf5c6181738f8755524172cea2a8bd1e38e43f833e7f282600054016000548460405180848152602001838152602001828152602001935050505060405180910390a1816000540160008190555060005490509190505600a165627a7a7230582015732bfa66bdede47ecc05446bf4c1e8ed047efac25478cb13b795887df70f290029"
+EVENT_TOPIC = "c5c442325655248f6bccf5c6181738f8755524172cea2a8bd1e38e43f833e7f2"
+
+class ZMQSubscriber:
+    def __init__(self, socket, topic):
+        self.sequence = 0
+        self.socket = socket
+        self.topic = topic
+
+        import zmq
+        self.socket.setsockopt(zmq.SUBSCRIBE, self.topic)
+
+    def receive(self):
+        topic, body, seq = self.socket.recv_multipart()
+        assert_equal(topic, self.topic)
+        assert_equal(struct.unpack('<I', seq)[-1], self.sequence)
+        self.sequence += 1
+        return BytesIO(body)
+
+def deser_log(f):
+    address = f.read(20).hex()
+    topics = [f.read(32).hex() for _ in range(deser_compact_size(f))]
+    data = deser_string(f)
+    return address, topics, data
+
+def deser_receipt(f):
+    r = {}
+    r['blockhash'] = "%064x" % deser_uint256(f)
+    r['blocknumber'] = struct.unpack("<I", f.read(4))[0]
+    r['txid'] = "%064x" % deser_uint256(f)
+    r['txindex'] = struct.unpack("<I", f.read(4))[0]
+    r['outputindex'] = struct.unpack("<I", f.read(4))[0]
+    r['from'] = f.read(20).hex()
+    r['to'] = f.read(20).hex()
+    r['contractaddress'] = f.read(20).hex()
+    r['cumulativegasused'], r['gasused'] = struct.unpack("<QQ", f.read(16))
+    r['excepted'] = struct.unpack("<I", f.read(4))[0]
+    r['exceptedmessage'] = deser_string(f)
+    r['logs'] = [deser_log(f) for _ in range(deser_compact_size(f))]
+    return r
+
+class QtumZMQContractLogsTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.setup_clean_chain = True
+        self.num_nodes = 1
+
+    def skip_test_if_missing_module(self):
+        self.skip_if_no_py3_zmq()
+        self.skip_if_no_bitcoind_zmq()
+        self.skip_if_no_wallet()
+
+    def setup_nodes(self):
+        import zmq
+        self.ctx = zmq.Context()
+        self.address = 'tcp://127.0.0.1:28334'
+        self.socket = self.ctx.socket(zmq.SUB)
+        self.socket.set(zmq.RCVTIMEO, 60000)
+        self.receipt = ZMQSubscriber(self.socket, b"receipt")
+        self.contractlogs = ZMQSubscriber(self.socket, b"contractlogs")
+        self.extra_args = [["-logevents", "-zmqpubreceipt=%s" % self.address, "-zmqpubcontractlogs=%s" % self.address]]
+        self.add_nodes(self.num_nodes, self.extra_args)
+        self.start_nodes()
+
+    def run_test(self):
+        try:
+            self.socket.connect(self.address)
+            # Relax so that the subscriber is ready before publishing zmq messages
+            sleep(0.2)
+            self._test()
+        finally:
+            self.ctx.destroy(linger=None)
+
+    def _test(self):
+        node = self.nodes[0]
+        node.generate(600)
+
+        self.log.info("Contract creation publishes a receipt without logs")
+        contract_address = node.createcontract(EVENT_CONTRACT)['address']
+        blockhash = node.generate(1)[0]
+        f = self.receipt.receive()
+        assert_equal(f.read(1), b'C')
+        r = deser_receipt(f)
+        assert_equal(r['blockhash'], blockhash)
+        assert_equal(r['blocknumber'], 601)
+        assert_equal(r['contractaddress'], contract_address)
+        assert_equal(r['logs'], [])
+
+        self.log.info("Contract call publishes the receipt and each log entry")
+        txid = node.sendtocontract(contract_address, "5b9af12b")['txid']
+        blockhash = node.generate(1)[0]
+        # Notifiers sharing a socket publish in order: contractlogs, receipt
+        logs = []
+        for i in range(2):
+            f = self.contractlogs.receive()
+            assert_equal(f.read(1), b'C')
+            assert_equal("%064x" % deser_uint256(f), blockhash)
+            assert_equal(struct.unpack("<I", f.read(4))[0], 602)
+            assert_equal("%064x" % deser_uint256(f), txid)
+            f.read(8)
+            assert_equal(struct.unpack("<I", f.read(4))[0], i)
+            logs.append(deser_log(f))
+            assert_equal(logs[i][0], contract_address)
+            assert_equal(logs[i][1], [EVENT_TOPIC])
+        f = self.receipt.receive()
+        assert_equal(f.read(1), b'C')
+        r = deser_receipt(f)
+        assert_equal(r['txid'], txid)
+        assert_equal(r['excepted'], 0)
+        assert_equal(r['logs'], logs)
+        rpc_receipt = node.gettransactionreceipt(txid)[0]
+        assert_equal(r['gasused'], rpc_receipt['gasUsed'])
+
+        self.log.info("Disconnecting a block publishes a reorg marker")
+        node.invalidateblock(blockhash)
+        for sub in [self.contractlogs, self.receipt]:
+            f = sub.receive()
+            assert_equal(f.read(1), b'D')
+            assert_equal("%064x" % deser_uint256(f), blockhash)
+            assert_equal(struct.unpack("<I", f.read(4))[0], 602)
+
+if __name__ == '__main__':
+    QtumZMQContractLogsTest().main()
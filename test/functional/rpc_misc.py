@@ -6,6 +6,7 @@
 import xml.etree.ElementTree as ET
 
 from test_framework.test_framework import BitcoinTestFramework
+from test_framework.test_node import ErrorMatch
 from test_framework.util import (
     assert_raises_rpc_error,
     assert_equal,
@@ -46,6 +47,28 @@ class RpcMiscTest(BitcoinTestFramework):
 
         assert_raises_rpc_error(-8, "unknown mode foobar", node.getmemoryinfo, mode="foobar")
 
+        self.log.info("test getdbstats")
+        dbs = {db['name']: db for db in node.getdbstats()}
+        assert 'chainstate' in dbs and 'index' in dbs
+        assert_equal(dbs['chainstate']['profile']['bloombits'], 10)
+        assert_greater_than(dbs['index']['reads'], 0)
+        assert_greater_than_or_equal(dbs['chainstate']['write_amplification'], 0)
+        assert_greater_than(dbs['chainstate']['memory_usage'], 0)
+        assert_equal(dbs['chainstate']['l0_stops'], 0)
+        assert all(set(level.keys()) == {'level', 'files', 'bytes', 'compaction_seconds', 'compaction_bytes_read', 'compaction_bytes_written'} for level in dbs['index']['levels'])
+        assert 'resultsDB' in dbs and 'stateQtum' in dbs and 'qtumDB' in dbs
+        assert_greater_than(dbs['resultsDB']['memory_usage'], 0)
+
+        self.log.info("test -dbprofile")
+        self.restart_node(0, extra_args=["-dbprofile=chainstate:bloombits=0,blocksize=16"])
+        dbs = {db['name']: db for db in node.getdbstats()}
+        assert_equal(dbs['chainstate']['profile']['bloombits'], 0)
+        assert_equal(dbs['chainstate']['profile']['blocksize'], 16 * 1024)
+        assert_equal(dbs['index']['profile']['bloombits'], 10)
+        self.stop_node(0)
+        node.assert_start_raises_init_error(["-dbprofile=chainstate:foo=1"], "Error: Invalid -dbprofile setting 'foo=1' for chainstate", match=ErrorMatch.PARTIAL_TEXT)
+        self.start_node(0)
+
         self.log.info("test logging")
         assert_equal(node.logging()['qt'], True)
         node.logging(exclude=['qt'])
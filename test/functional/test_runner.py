@@ -95,6 +95,8 @@ BASE_SCRIPTS = [
     'wallet_labels.py',
     'p2p_segwit.py',
     'p2p_timeouts.py',
+    'p2p_socketevents.py',
+    'p2p_msghandlerthreads.py',
     'p2p_tx_download.py',
     'wallet_dump.py',
     'wallet_listtransactions.py',
@@ -110,6 +112,8 @@ BASE_SCRIPTS = [
     'wallet_address_types.py',
     'p2p_feefilter.py',
     'feature_reindex.py',
+    'feature_blockprefetch.py',
+    'feature_validation_modes.py',
     'feature_abortnode.py',
     # vv Tests less than 30s vv
     'wallet_keypool_topup.py',
@@ -258,6 +262,8 @@ BASE_SCRIPTS = [
     'qtum_prioritize_create_over_call.py',
     'qtum_callcontract_timestamp.py',
     'qtum_transaction_receipt_origin_contract_address.py',
+    'qtum_zmq_contractlogs.py',
+    'qtum_rest_blockrange.py',
     'qtum_block_number_corruption.py',
     'qtum_duplicate_stake.py',
     'qtum_rpc_bitcore.py',